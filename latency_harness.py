@@ -0,0 +1,361 @@
+import argparse
+import fnmatch
+import json
+import queue
+import sys
+import threading
+import time
+import types
+
+import numpy as np
+
+from pluck import pluck_detect, PLUCK_DOWN, PLUCK_UP
+from synth import PolySynth, NoteScheduler, fs, block_size
+
+# End-to-end motion-to-sound latency harness.
+#
+# Scripted plucks from a simulated sensor, or a replayed recording, are fed through
+# note_handler() and synth_play() of radar.py --poly: acquisition, pluck detection,
+# the jitter buffer, synthesis and audio out. The audio is played to an ALSA loopback
+# device (snd-aloop) and captured from its other side, and onsets in the captured
+# audio are matched to the notes. Each note is timestamped at every stage, and the
+# latency of each stage is reported as p50/p99.
+#
+#   sudo modprobe snd-aloop
+#   python3.6 latency_harness.py --audio --plucks 50 --json latency.json
+#
+# Without --audio the rendered blocks are paced by the sample clock and onsets are
+# detected in them directly, which measures the software part of the pipeline only.
+# --latency sets the latency of the jitter buffer, as --synth-latency of radar.py.
+
+# radar.py is imported with its radar client and audio output replaced by the harness.
+# The acconeer client modules are stood in for, and so is sound.py, which opens the
+# default audio output when imported, by the pluck detection radar.py takes from it.
+sound = types.ModuleType("sound")
+sound.pluck_detect = pluck_detect
+sound.PLUCK_DOWN = PLUCK_DOWN
+sound.PLUCK_UP = PLUCK_UP
+
+exptool = types.ModuleType("acconeer.exptool")
+exptool.configs = exptool.utils = None
+clients = types.ModuleType("acconeer.exptool.clients")
+clients.SocketClient = clients.SPIClient = clients.UARTClient = None
+
+sys.modules.update({"sound": sound, "acconeer": types.ModuleType("acconeer"), "acconeer.exptool": exptool,
+                    "acconeer.exptool.clients": clients})
+
+import radar
+
+STAGES = ["motion", "acquired", "detected", "rendered", "written", "onset"]
+
+
+# Simulated two sensor client. The pitch hand stays still, the pluck hand is
+# lifted and then plucked down towards the sensor once every period.
+class SimulatedClient:
+    def __init__(self, plucks, period=1.0, update_rate=50, length=800):
+        self.plucks = plucks
+        self.period = period
+        self.update_rate = update_rate
+        self.length = length
+        self.index = np.arange(length)
+        self.frame = 0
+        self.start = None
+        self.motion_times = []
+
+    def _sweep(self, position):
+        return 100 + 1000 * np.exp(-((self.index - position) / 10) ** 2)
+
+    # Position of the pluck hand at time t into the period
+    def _pluck_position(self, t):
+        near, far = 300, 600
+        if t < 0.2:
+            return near + (far - near) * t / 0.2        # lift
+        if t < 0.5:
+            return far                                  # hold
+        if t < 0.6:
+            return far - (far - near) * (t - 0.5) / 0.1 # pluck
+        return near
+
+    def done(self):
+        return self.frame >= self.plucks * self.period * self.update_rate
+
+    def get_next(self):
+        if self.start is None:
+            self.start = time.time()
+
+        due = self.start + self.frame / self.update_rate
+        delay = due - time.time()
+        if delay > 0:
+            time.sleep(delay)
+
+        # Both hands are gone after the last pluck, until note_handler() is stopped
+        if self.done():
+            self.frame += 1
+            return None, np.zeros((2, self.length))
+
+        t = (self.frame / self.update_rate) % self.period
+        if 0.5 <= t < 0.5 + 1 / self.update_rate:
+            self.motion_times.append(due)
+        self.frame += 1
+
+        return None, [self._sweep(self.length / 2), self._sweep(self._pluck_position(t))]
+
+
+# Replays a recording saved with np.save as an array of (frames, 2, length) sweeps.
+# Frames listed in motion_frames are where a pluck movement starts.
+class ReplayClient:
+    def __init__(self, path, update_rate=50, motion_frames=()):
+        self.data = np.load(path)
+        self.update_rate = update_rate
+        self.motion_frames = set(motion_frames)
+        self.frame = 0
+        self.start = None
+        self.motion_times = []
+
+    def done(self):
+        return self.frame >= len(self.data)
+
+    def get_next(self):
+        if self.start is None:
+            self.start = time.time()
+
+        due = self.start + self.frame / self.update_rate
+        delay = due - time.time()
+        if delay > 0:
+            time.sleep(delay)
+
+        if self.done():
+            self.frame += 1
+            return None, np.zeros_like(self.data[0])
+
+        if self.frame in self.motion_frames:
+            self.motion_times.append(due)
+        data = self.data[self.frame]
+        self.frame += 1
+
+        return None, data
+
+
+# Finds sound onsets, a sample above threshold after at least quiet s of silence
+class OnsetDetector:
+    def __init__(self, threshold=1000, quiet=0.05):
+        self.threshold = threshold
+        self.quiet = quiet
+        self.last_loud = -np.inf
+
+    def process(self, samples, t0):
+        loud = np.flatnonzero(np.abs(samples.astype(np.int32)) > self.threshold)
+        if loud.size == 0:
+            return []
+
+        times = t0 + loud / fs
+        gaps = np.diff(times, prepend=self.last_loud)
+        self.last_loud = times[-1]
+        return list(times[gaps > self.quiet])
+
+
+# Queue of the note events from note_handler() to synth_play(). The capture time
+# of the sweep and the detection time of each note are taken as its event is queued.
+class NoteEvents(queue.Queue):
+    def __init__(self, notes):
+        super().__init__()
+        self.notes = notes
+
+    def put(self, item, block=True, timeout=None):
+        timestamp, event = item
+        if event[0] == "on":
+            self.notes[event[1]] = {"acquired": timestamp, "detected": time.time()}
+        super().put(item, block, timeout)
+
+
+# Runs note_handler() and synth_play() of radar.py on the client, with the harness
+# as the audio output of synth_play().
+class Harness:
+    def __init__(self, client, audio=None, latency=0.05):
+        self.client = client
+        self.audio = audio
+        self.scheduler = NoteScheduler(PolySynth(), latency)
+        self.note_times = {}
+        self.events = NoteEvents(self.note_times)
+        self.notes = []
+        self.onsets = []
+        self.detector = OnsetDetector()
+        self.sink_time = 0
+
+        # Stands in for the interrupt handler of radar.py
+        self.stop = types.SimpleNamespace(got_signal=False)
+
+    # Blocking write of a rendered block. Notes that got a voice were started in it.
+    def write(self, data):
+        rendered = time.time()
+        samples = np.frombuffer(data, dtype=np.int16)
+
+        voices = self.scheduler.synth.note_voice
+        started = [note for note, times in list(self.note_times.items())
+                   if "rendered" not in times and note in voices]
+        for note in started:
+            self.note_times[note]["rendered"] = rendered
+
+        if self.audio is not None:
+            self.audio.write(samples)
+        else:
+            # Simulated sink holding one block. The block starts playing when the
+            # previous one is done, and the next block is accepted at that time.
+            start = max(self.sink_time, rendered)
+            self.onsets.extend(self.detector.process(samples, start))
+            self.sink_time = start + block_size / fs
+            delay = start - time.time()
+            if delay > 0:
+                time.sleep(delay)
+
+        written = time.time()
+        for note in started:
+            self.note_times[note]["written"] = written
+
+    # Time from a returned write until the next sample written is played
+    def get_output_latency(self):
+        if self.audio is not None:
+            return self.audio.output_latency
+        return block_size / fs
+
+    # Audio capture from the loopback device
+    def capture(self):
+        detector = OnsetDetector()
+        while not self.stop.got_signal:
+            samples, t0 = self.audio.read()
+            self.onsets.extend(detector.process(samples, t0))
+
+    def run(self):
+        # No MIDI or OSC output
+        args = argparse.Namespace(midi=False, osc=None, output_latency=0.0)
+
+        threads = [threading.Thread(target=radar.note_handler, args=(self.client, self.stop, self.events, args)),
+                   threading.Thread(target=radar.synth_play, args=(self.stop, self.events, self.scheduler, self))]
+        if self.audio is not None:
+            threads.append(threading.Thread(target=self.capture))
+
+        for thread in threads:
+            thread.start()
+
+        while not self.client.done():
+            time.sleep(0.1)
+
+        # Let the last note sound
+        time.sleep(0.5)
+        self.stop.got_signal = True
+
+        for thread in threads:
+            thread.join()
+
+        self.notes = [self.note_times[note] for note in sorted(self.note_times)]
+        self.match()
+
+    # Assigns motion times and onsets to the notes in order. An onset belongs to
+    # the oldest note without an onset that was rendered before it, onsets
+    # without such a note are spurious and ignored.
+    def match(self):
+        motion_times = list(self.client.motion_times)
+        for note in self.notes:
+            while motion_times and motion_times[0] <= note["acquired"]:
+                motion = motion_times.pop(0)
+                if not motion_times or motion_times[0] > note["acquired"]:
+                    note["motion"] = motion
+
+        onsets = sorted(self.onsets)
+        waiting = [note for note in self.notes if "rendered" in note]
+        for onset in onsets:
+            if waiting and waiting[0]["rendered"] <= onset:
+                waiting.pop(0)["onset"] = onset
+
+
+# Blocking PyAudio playback to and capture from the two sides of a loopback device
+class LoopbackAudio:
+    def __init__(self, playback_device, capture_device):
+        import pyaudio
+
+        self.pya = pyaudio.PyAudio()
+        self.output = self.pya.open(format=pyaudio.paInt16, channels=1, rate=fs, output=True,
+                                    frames_per_buffer=block_size,
+                                    output_device_index=find_device(self.pya, playback_device, "maxOutputChannels"))
+        self.input = self.pya.open(format=pyaudio.paInt16, channels=1, rate=fs, input=True,
+                                   frames_per_buffer=block_size,
+                                   input_device_index=find_device(self.pya, capture_device, "maxInputChannels"))
+        self.input_latency = self.input.get_input_latency()
+        self.output_latency = self.output.get_output_latency()
+
+    def write(self, samples):
+        self.output.write(samples.tobytes())
+
+    # Returns a block of captured samples and the time of its first sample
+    def read(self):
+        data = self.input.read(block_size, exception_on_overflow=False)
+        t0 = time.time() - self.input_latency - block_size / fs
+        return np.frombuffer(data, dtype=np.int16), t0
+
+
+# Returns the index of the first audio device whose name matches pattern
+def find_device(pya, pattern, channels):
+    for i in range(pya.get_device_count()):
+        info = pya.get_device_info_by_index(i)
+        if fnmatch.fnmatch(info["name"], pattern) and info[channels] > 0:
+            return i
+    raise OSError("No audio device matching " + pattern)
+
+
+# Returns p50/p99 in ms of the time from each stage to the next and in total
+def report(notes):
+    result = {}
+    for begin, end in list(zip(STAGES[:-1], STAGES[1:])) + [("motion", "onset")]:
+        latencies = [1000 * (note[end] - note[begin]) for note in notes if begin in note and end in note]
+        if latencies:
+            result[begin + "-" + end] = {"count": len(latencies),
+                                         "p50_ms": float(np.percentile(latencies, 50)),
+                                         "p99_ms": float(np.percentile(latencies, 99))}
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Motion-to-sound latency harness")
+    parser.add_argument("--plucks", type=int, default=20, help="number of simulated plucks")
+    parser.add_argument("--update-rate", type=float, default=50, help="sweeps per s")
+    parser.add_argument("--replay", metavar="FILE", help="replay sweeps saved with np.save instead of simulating")
+    parser.add_argument("--motion-frames", metavar="FILE", help="frame numbers where plucks start in the replay")
+    parser.add_argument("--audio", action="store_true", help="play and capture through an ALSA loopback device")
+    parser.add_argument("--playback-device", default="Loopback*,0)",
+                        help="playback device name pattern")
+    parser.add_argument("--capture-device", default="Loopback*,1)",
+                        help="capture device name pattern")
+    parser.add_argument("--latency", type=float, default=0.05,
+                        help="play notes this many s after sweep capture, as --synth-latency of radar.py")
+    parser.add_argument("--json", metavar="FILE", help="write the report as JSON")
+    args = parser.parse_args()
+
+    if args.replay:
+        motion_frames = np.loadtxt(args.motion_frames, dtype=int, ndmin=1) if args.motion_frames else ()
+        client = ReplayClient(args.replay, args.update_rate, motion_frames)
+    else:
+        client = SimulatedClient(args.plucks, update_rate=args.update_rate)
+
+    audio = LoopbackAudio(args.playback_device, args.capture_device) if args.audio else None
+
+    harness = Harness(client, audio, args.latency)
+    harness.run()
+
+    result = report(harness.notes)
+    print("%-18s %6s %8s %8s" % ("stage", "count", "p50 ms", "p99 ms"))
+    for stage, values in result.items():
+        print("%-18s %6d %8.2f %8.2f" % (stage, values["count"], values["p50_ms"], values["p99_ms"]))
+
+    missed = len([note for note in harness.notes if "onset" not in note])
+    if missed:
+        print("%d of %d notes without onset" % (missed, len(harness.notes)))
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"notes": len(harness.notes), "missed": missed, "stages": result}, f, indent=2)
+
+    return 0 if harness.notes and not missed else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
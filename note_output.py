@@ -0,0 +1,270 @@
+import ctypes
+import ctypes.util
+import math
+import socket
+import struct
+import time
+
+# Note outputs for driving external synthesizers from the radar processing loop.
+#
+# Events are sent as MIDI through an ALSA sequencer port and as OSC over UDP. Each
+# event carries the capture time of the sweep it was detected in. With a latency
+# set, events are scheduled at capture time + latency so processing jitter does not
+# reach the synthesizer. Event buffers are allocated once and reused for every event.
+
+# MIDI note number of A4
+A4_NOTE = 69
+
+# Pitch bend range of the receiving synthesizer in semitones
+BEND_RANGE = 2
+
+# Seconds between 1900, the OSC time tag epoch, and 1970
+NTP_EPOCH_OFFSET = 2208988800
+
+
+# Returns the nearest MIDI note of a frequency in Hz
+def note_from_freq(freq):
+    return int(round(A4_NOTE + 12 * math.log2(freq / 440.0)))
+
+
+# Returns the 14 bit pitch bend value, centered at 0, that bends note to freq
+def bend_from_freq(note, freq):
+    semitones = 12 * math.log2(freq / 440.0) + A4_NOTE - note
+    semitones = max(-BEND_RANGE, min(BEND_RANGE, semitones))
+    return max(-8192, min(8191, int(round(semitones / BEND_RANGE * 8192))))
+
+
+# ALSA sequencer definitions from alsa/seq_event.h and alsa/seq.h
+SND_SEQ_OPEN_OUTPUT = 1
+SND_SEQ_PORT_CAP_READ = 1 << 0
+SND_SEQ_PORT_CAP_SUBS_READ = 1 << 5
+SND_SEQ_PORT_TYPE_MIDI_GENERIC = 1 << 1
+SND_SEQ_PORT_TYPE_APPLICATION = 1 << 20
+SND_SEQ_EVENT_NOTEON = 6
+SND_SEQ_EVENT_NOTEOFF = 7
+SND_SEQ_EVENT_CONTROLLER = 10
+SND_SEQ_EVENT_PITCHBEND = 13
+SND_SEQ_EVENT_START = 30
+SND_SEQ_TIME_STAMP_REAL = 1 << 0
+SND_SEQ_QUEUE_DIRECT = 253
+SND_SEQ_ADDRESS_SUBSCRIBERS = 254
+SND_SEQ_ADDRESS_UNKNOWN = 253
+
+
+class SeqNote(ctypes.Structure):
+    _fields_ = [("channel", ctypes.c_ubyte),
+                ("note", ctypes.c_ubyte),
+                ("velocity", ctypes.c_ubyte),
+                ("off_velocity", ctypes.c_ubyte),
+                ("duration", ctypes.c_uint)]
+
+
+class SeqControl(ctypes.Structure):
+    _fields_ = [("channel", ctypes.c_ubyte),
+                ("unused", ctypes.c_ubyte * 3),
+                ("param", ctypes.c_uint),
+                ("value", ctypes.c_int)]
+
+
+class SeqData(ctypes.Union):
+    _fields_ = [("note", SeqNote),
+                ("control", SeqControl),
+                ("raw", ctypes.c_ubyte * 12)]
+
+
+class SeqEvent(ctypes.Structure):
+    _fields_ = [("type", ctypes.c_ubyte),
+                ("flags", ctypes.c_ubyte),
+                ("tag", ctypes.c_ubyte),
+                ("queue", ctypes.c_ubyte),
+                ("tv_sec", ctypes.c_uint),
+                ("tv_nsec", ctypes.c_uint),
+                ("source_client", ctypes.c_ubyte),
+                ("source_port", ctypes.c_ubyte),
+                ("dest_client", ctypes.c_ubyte),
+                ("dest_port", ctypes.c_ubyte),
+                ("data", SeqData)]
+
+
+# MIDI output through a virtual ALSA sequencer port that synthesizers can
+# subscribe to, e.g. with aconnect
+class MidiOutput:
+    def __init__(self, name="radar_instrument", channel=0, latency=0.0):
+        path = ctypes.util.find_library("asound")
+        if path is None:
+            raise OSError("libasound not found")
+
+        self.lib = ctypes.CDLL(path)
+        self.seq = ctypes.c_void_p()
+        if self.lib.snd_seq_open(ctypes.byref(self.seq), b"default", SND_SEQ_OPEN_OUTPUT, 0) < 0:
+            raise OSError("Failed to open ALSA sequencer")
+
+        self.lib.snd_seq_set_client_name(self.seq, name.encode())
+        self.port = self.lib.snd_seq_create_simple_port(
+            self.seq, name.encode(),
+            SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ,
+            SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION)
+        if self.port < 0:
+            raise OSError("Failed to create ALSA sequencer port")
+
+        self.channel = channel
+        self.latency = latency
+        self.queue = SND_SEQ_QUEUE_DIRECT
+
+        # Scheduled events go through a queue running in real time from start_time
+        if latency > 0:
+            self.queue = self.lib.snd_seq_alloc_queue(self.seq)
+            if self.queue < 0:
+                raise OSError("Failed to allocate ALSA sequencer queue")
+            self.lib.snd_seq_control_queue(self.seq, self.queue, SND_SEQ_EVENT_START, 0, None)
+            self.lib.snd_seq_drain_output(self.seq)
+        self.start_time = time.time()
+
+        self.event = SeqEvent()
+        self.event.source_port = self.port
+        self.event.dest_client = SND_SEQ_ADDRESS_SUBSCRIBERS
+        self.event.dest_port = SND_SEQ_ADDRESS_UNKNOWN
+        self.event_pointer = ctypes.byref(self.event)
+
+    def _send(self, event_type, timestamp):
+        event = self.event
+        event.type = event_type
+        event.queue = self.queue
+
+        if self.queue == SND_SEQ_QUEUE_DIRECT:
+            event.flags = 0
+            event.tv_sec = 0
+            event.tv_nsec = 0
+            self.lib.snd_seq_event_output_direct(self.seq, self.event_pointer)
+        else:
+            # Never schedule in the past, late events are played at once
+            due = max(0.0, timestamp + self.latency - self.start_time)
+            event.flags = SND_SEQ_TIME_STAMP_REAL
+            event.tv_sec = int(due)
+            event.tv_nsec = int((due - int(due)) * 1e9)
+            self.lib.snd_seq_event_output(self.seq, self.event_pointer)
+            self.lib.snd_seq_drain_output(self.seq)
+
+    def note_on(self, note, velocity, timestamp):
+        note_data = self.event.data.note
+        note_data.channel = self.channel
+        note_data.note = note
+        note_data.velocity = velocity
+        note_data.off_velocity = 0
+        note_data.duration = 0
+        self._send(SND_SEQ_EVENT_NOTEON, timestamp)
+
+    def note_off(self, note, timestamp):
+        note_data = self.event.data.note
+        note_data.channel = self.channel
+        note_data.note = note
+        note_data.velocity = 0
+        note_data.off_velocity = 0
+        note_data.duration = 0
+        self._send(SND_SEQ_EVENT_NOTEOFF, timestamp)
+
+    def pitch_bend(self, value, timestamp):
+        control = self.event.data.control
+        control.channel = self.channel
+        control.param = 0
+        control.value = value
+        self._send(SND_SEQ_EVENT_PITCHBEND, timestamp)
+
+    def control_change(self, controller, value, timestamp):
+        control = self.event.data.control
+        control.channel = self.channel
+        control.param = controller
+        control.value = value
+        self._send(SND_SEQ_EVENT_CONTROLLER, timestamp)
+
+    def close(self):
+        self.lib.snd_seq_close(self.seq)
+
+
+# OSC output over UDP. Every event is sent as a bundle whose time tag is the
+# capture time + latency, or "immediately" when no latency is set.
+#
+# Messages:
+#   /noteon  ,ii  note velocity
+#   /noteoff ,i   note
+#   /bend    ,i   value, -8192..8191
+#   /cc      ,ii  controller value
+class OscOutput:
+    def __init__(self, host, port, latency=0.0):
+        self.address = (host, port)
+        self.latency = latency
+        self.socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+        # Bundle header and one message template per event type, the time tag and
+        # arguments are packed into copies of them in place
+        self.messages = {}
+        for name, address, type_tags in [("noteon", b"/noteon", b",ii"),
+                                         ("noteoff", b"/noteoff", b",i"),
+                                         ("bend", b"/bend", b",i"),
+                                         ("cc", b"/cc", b",ii")]:
+            message = osc_string(address) + osc_string(type_tags)
+            size = len(message) + 4 * (len(type_tags) - 1)
+            buffer = bytearray(b"#bundle\0" + bytes(8) + struct.pack(">i", size) + message + bytes(size - len(message)))
+            self.messages[name] = (buffer, len(buffer) - 4 * (len(type_tags) - 1))
+
+    def _send(self, name, timestamp, *arguments):
+        buffer, offset = self.messages[name]
+
+        if self.latency > 0:
+            due = timestamp + self.latency + NTP_EPOCH_OFFSET
+            seconds = int(due)
+            struct.pack_into(">II", buffer, 8, seconds, int((due - seconds) * 4294967296.0))
+        else:
+            struct.pack_into(">II", buffer, 8, 0, 1)
+
+        for argument in arguments:
+            struct.pack_into(">i", buffer, offset, argument)
+            offset += 4
+
+        self.socket.sendto(buffer, self.address)
+
+    def note_on(self, note, velocity, timestamp):
+        self._send("noteon", timestamp, note, velocity)
+
+    def note_off(self, note, timestamp):
+        self._send("noteoff", timestamp, note)
+
+    def pitch_bend(self, value, timestamp):
+        self._send("bend", timestamp, value)
+
+    def control_change(self, controller, value, timestamp):
+        self._send("cc", timestamp, controller, value)
+
+    def close(self):
+        self.socket.close()
+
+
+# Returns an OSC string, null terminated and padded to a multiple of 4 bytes
+def osc_string(value):
+    return value + bytes(4 - len(value) % 4)
+
+
+# Sends every event to all outputs
+class NoteOutputs:
+    def __init__(self, outputs):
+        self.outputs = outputs
+
+    def note_on(self, note, velocity, timestamp):
+        for output in self.outputs:
+            output.note_on(note, velocity, timestamp)
+
+    def note_off(self, note, timestamp):
+        for output in self.outputs:
+            output.note_off(note, timestamp)
+
+    def pitch_bend(self, value, timestamp):
+        for output in self.outputs:
+            output.pitch_bend(value, timestamp)
+
+    def control_change(self, controller, value, timestamp):
+        for output in self.outputs:
+            output.control_change(controller, value, timestamp)
+
+    def close(self):
+        for output in self.outputs:
+            output.close()
@@ -0,0 +1,34 @@
+import numpy as np
+
+averaging_array = np.ones(10)
+
+down = True # Current state
+
+# Pluck transitions returned by pluck_detect()
+PLUCK_UP = 1
+PLUCK_DOWN = 2
+
+# Tracks the hand distance of the pluck sensor and returns PLUCK_DOWN when the
+# hand moves down towards the sensor, PLUCK_UP when it moves away again and
+# None otherwise
+def pluck_detect(dis):
+    global averaging_array
+    global down
+
+    averaging_array = averaging_array[1:averaging_array.size]
+    averaging_array = np.append(averaging_array,dis)
+    
+    amp = 0
+    for i in range(0, averaging_array.size - 2):
+        amp = amp + averaging_array[i + 1] - averaging_array[i]
+    amp=0.1*amp
+
+    if (amp > 3 and amp < 60) and down:
+        down = False
+        return PLUCK_UP
+
+    elif (amp < -2 and amp > -20) and not down:
+        down = True
+        return PLUCK_DOWN
+
+    return None
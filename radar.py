@@ -1,14 +1,26 @@
 from acconeer.exptool import configs, utils
 from acconeer.exptool.clients import SocketClient, SPIClient, UARTClient
 
-import os
 import multiprocessing
-import matplotlib.pyplot as plt
+import time
 import numpy as np
 from sound import *
+from synth import PolySynth, NoteScheduler, AudioClock
+from note_output import MidiOutput, OscOutput, NoteOutputs, note_from_freq, bend_from_freq
 
 def main():
-    args = utils.ExampleArgumentParser().parse_args()
+    parser = utils.ExampleArgumentParser()
+    parser.add_argument("--poly", action="store_true",
+                        help="play notes on the polyphonic synthesizer")
+    parser.add_argument("--midi", action="store_true",
+                        help="send notes to a virtual ALSA sequencer MIDI port")
+    parser.add_argument("--osc", metavar="HOST:PORT",
+                        help="send notes as OSC over UDP")
+    parser.add_argument("--output-latency", type=float, default=0.0,
+                        help="schedule MIDI and OSC events this many s after sweep capture")
+    parser.add_argument("--synth-latency", type=float, default=0.05,
+                        help="play notes on the polyphonic synthesizer this many s after sweep capture")
+    args = parser.parse_args()
     utils.config_logging(args)
 
     if args.socket_addr:
@@ -54,6 +66,28 @@ def main():
     # audio output separately. the intrerrupt_handler is passed in
     # so that the processes are stopped when a user hits Ctrl-C.
     
+    if args.poly or args.midi or args.osc:
+        # Note events are detected directly in the data handler. The polyphonic
+        # synthesizer renders and plays short blocks in its own process.
+        events = multiprocessing.Queue() if args.poly else None
+
+        processes = [multiprocessing.Process(target=note_handler, args=(
+            client, interrupt_handler, events, args))]
+        if args.poly:
+            scheduler = NoteScheduler(PolySynth(), args.synth_latency)
+            processes.append(multiprocessing.Process(target=synth_play, args=(
+                interrupt_handler, events, scheduler)))
+
+        for p in processes:
+            p.start()
+
+        for p in processes:
+            p.join()
+
+        print("Disconnecting...")
+        client.disconnect()
+        return
+
     with multiprocessing.Manager() as manager:
         
         shared_value = manager.Value('d', 0)   # Shared variable to control the determined frequency.
@@ -92,6 +126,108 @@ def data_handler(client, interrupt_handler, shared_value, shared_amp):
             shared_amp.value = np.argmax(data[1])
 
 
+# Opens the MIDI and OSC outputs selected on the command line
+def open_note_outputs(args):
+    outputs = []
+    if args.midi:
+        outputs.append(MidiOutput(latency=args.output_latency))
+    if args.osc:
+        host, port = args.osc.rsplit(":", 1)
+        outputs.append(OscOutput(host, int(port), latency=args.output_latency))
+    return NoteOutputs(outputs)
+
+
+# Function for data processing with note events.
+# A note is started when the hand plucks down towards the second sensor and
+# released when it moves up again. Notes go to the polyphonic synthesizer, each
+# on its own voice, and to the MIDI and OSC outputs. While a note is held, moving
+# the first hand bends it and the distance of the second hand is sent as the
+# modulation controller. Events are timestamped with the sweep capture time.
+def note_handler(client, interrupt_handler, events, args):
+    outputs = open_note_outputs(args)
+    note = 0
+    midi_note = None
+    bend = 0
+    modulation = None
+
+    while not interrupt_handler.got_signal:
+        info, data = client.get_next()
+        timestamp = time.time()
+
+        freq = freqMapper(len(data[0]), np.argmax(data[0]))
+        if np.max(data[1]) <= 150:
+            continue
+
+        dis = np.argmax(data[1])
+        transition = pluck_detect(dis)
+        if transition == PLUCK_DOWN:
+            note += 1
+            if events is not None:
+                events.put((timestamp, ("on", note, freq)))
+            if midi_note is not None:
+                outputs.note_off(midi_note, timestamp)
+            midi_note = note_from_freq(freq)
+            if bend != 0:
+                bend = 0
+                outputs.pitch_bend(bend, timestamp)
+            outputs.note_on(midi_note, 100, timestamp)
+        elif transition == PLUCK_UP:
+            if events is not None:
+                events.put((timestamp, ("off", note)))
+            if midi_note is not None:
+                outputs.note_off(midi_note, timestamp)
+                midi_note = None
+        elif midi_note is not None:
+            new_bend = bend_from_freq(midi_note, freq)
+            if new_bend != bend:
+                bend = new_bend
+                outputs.pitch_bend(bend, timestamp)
+
+        new_modulation = min(127, int(128 * dis / len(data[1])))
+        if new_modulation != modulation:
+            modulation = new_modulation
+            outputs.control_change(1, modulation, timestamp)
+
+    outputs.close()
+
+
+# Plays the rendered blocks of the polyphonic synthesizer through the audio
+# outport, or through output, a blocking stream with write() and
+# get_output_latency(). Note events go through the jitter buffer of the scheduler
+# that applies each at the sample played its latency after the sweep was captured.
+# The achieved timing, against the time the stream plays each written block, is
+# printed every report_interval s while notes are played, and at the end.
+def synth_play(interrupt_handler, events, scheduler, output=None, report_interval=30):
+    if output is None:
+        output = stream
+    clock = AudioClock()
+    block_time = clock.update(time.time() + output.get_output_latency())
+    reported = scheduler.event_count
+    report_time = time.time() + report_interval
+
+    while not interrupt_handler.got_signal:
+        while not events.empty():
+            timestamp, event = events.get()
+            scheduler.push(timestamp, event)
+
+        output.write(scheduler.render(block_time).tobytes())
+
+        # Once a blocking write returns, the next sample to be written plays after the
+        # output latency, so the block just written starts one block duration earlier
+        played = time.time() + output.get_output_latency()
+        scheduler.played(played - clock.block_duration)
+        clock.advance()
+        block_time = clock.update(played)
+
+        if time.time() >= report_time:
+            if scheduler.event_count != reported:
+                print(scheduler.report())
+                reported = scheduler.event_count
+            report_time += report_interval
+
+    print(scheduler.report())
+
+
 # Generates a sound wave out of a determined frequency 
 # sound_generator() is called from sound.py
 def tune_gen(interrupt_handler, shared_value, shared_amp, shared_wave): 
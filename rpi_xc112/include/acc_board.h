@@ -24,6 +24,74 @@ extern void (*acc_board_hibernate_exit_func)(acc_sensor_id_t sensor);
 #define ACC_BOARD_DEFAULT_SPI_SPEED	5000000
 
 
+/**
+ * @brief First key used in the key-value store for persisted SPI speeds, the key of a sensor is
+ * ACC_BOARD_SPI_SPEED_KV_KEY_BASE + sensor id
+ */
+#define ACC_BOARD_SPI_SPEED_KV_KEY_BASE 0x5d00
+
+
+/**
+ * @brief Statistics of the transfers to one sensor
+ */
+typedef struct
+{
+	/** Number of transfers */
+	uint32_t transfer_count;
+	/** Number of transfers that failed and were retried at a lower speed */
+	uint32_t failure_count;
+	/** Number of bytes transferred */
+	uint64_t byte_count;
+	/** Time spent in the SPI driver in microseconds */
+	uint64_t time_us;
+	/** Time waiting for the SPI bus while other sensors transferred, in microseconds */
+	uint64_t bus_wait_us;
+} acc_board_transfer_statistics_t;
+
+
+/**
+ * @brief How acc_board_wait_for_sensor_interrupt waits for the interrupt of a sensor
+ */
+typedef enum
+{
+	/** Block on a semaphore signalled by the GPIO interrupt thread */
+	ACC_BOARD_INTERRUPT_WAIT_BLOCK,
+	/** Spin on a flag set by the GPIO interrupt thread for a budget tuned from the interrupt interval, then block */
+	ACC_BOARD_INTERRUPT_WAIT_SPIN_THEN_BLOCK
+} acc_board_interrupt_wait_mode_t;
+
+
+/**
+ * @brief Statistics of the interrupt waits of one sensor
+ *
+ * The latency is the time from the GPIO interrupt thread seeing the interrupt to the wait
+ * returning. It is only measured for interrupts that arrive during the wait.
+ */
+typedef struct
+{
+	/** Number of waits that returned an interrupt */
+	uint32_t wait_count;
+	/** Number of waits that timed out */
+	uint32_t timeout_count;
+	/** Number of interrupts taken while spinning */
+	uint32_t spin_count;
+	/** Number of waits that blocked */
+	uint32_t block_count;
+	/** Time spent spinning in microseconds, including spins that ended in blocking */
+	uint64_t spin_time_us;
+	/** Sum of the latencies of the interrupts taken while spinning in microseconds */
+	uint64_t spin_latency_us;
+	/** Sum of the latencies of the interrupts taken after blocking in microseconds */
+	uint64_t block_latency_us;
+	/** Highest latency in microseconds */
+	uint32_t latency_max_us;
+	/** Estimated interval between interrupts in microseconds, 0 until two interrupts are seen */
+	uint32_t interval_us;
+	/** The spin budget of the last wait in microseconds */
+	uint32_t spin_budget_us;
+} acc_board_interrupt_statistics_t;
+
+
 /**
  * @brief Initialize board
  *
@@ -120,4 +188,128 @@ extern bool acc_board_set_ref_freq(float ref_freq);
  */
 extern void acc_board_sensor_transfer(acc_sensor_id_t sensor_id, uint8_t *buffer, size_t buffer_length);
 
+
+/**
+ * @brief Set the SPI clock speed used for transfers to a sensor
+ *
+ * The speed is not persisted, see acc_board_store_sensor_spi_speed.
+ *
+ * @param[in] sensor The sensor
+ * @param[in] speed The clock speed in Hz
+ * @return True if successful, false otherwise
+ */
+extern bool acc_board_set_sensor_spi_speed(acc_sensor_id_t sensor, uint32_t speed);
+
+
+/**
+ * @brief Get the SPI clock speed used for transfers to a sensor
+ *
+ * @param[in] sensor The sensor
+ * @return The clock speed in Hz, 0 if the sensor does not exist
+ */
+extern uint32_t acc_board_get_sensor_spi_speed(acc_sensor_id_t sensor);
+
+
+/**
+ * @brief Lower the SPI clock speed of a sensor after a communication error
+ *
+ * Called by acc_board_sensor_transfer when the SPI driver fails a transfer. Transfers
+ * corrupted by a too high speed do not fail in the driver, they are found by sensor level
+ * checks, see acc_spi_calibration_check. The speed is not persisted, see
+ * acc_board_store_sensor_spi_speed.
+ *
+ * @param[in] sensor The sensor
+ * @return True if the speed was lowered, false if it already is the lowest speed
+ */
+extern bool acc_board_sensor_spi_speed_fallback(acc_sensor_id_t sensor);
+
+
+/**
+ * @brief Persist the SPI clock speed of a sensor
+ *
+ * Persisted speeds are applied by acc_board_init.
+ *
+ * @param[in] sensor The sensor
+ * @return True if successful, false if the key-value store is not available
+ */
+extern bool acc_board_store_sensor_spi_speed(acc_sensor_id_t sensor);
+
+
+/**
+ * @brief Get the transfer statistics of a sensor
+ *
+ * @param[in] sensor The sensor
+ * @param[out] statistics The statistics since the last reset
+ */
+extern void acc_board_get_sensor_transfer_statistics(acc_sensor_id_t sensor, acc_board_transfer_statistics_t *statistics);
+
+
+/**
+ * @brief Reset the transfer statistics of a sensor
+ *
+ * @param[in] sensor The sensor
+ */
+extern void acc_board_reset_sensor_transfer_statistics(acc_sensor_id_t sensor);
+
+
+/**
+ * @brief Set how the interrupts of a sensor are waited for
+ *
+ * In ACC_BOARD_INTERRUPT_WAIT_SPIN_THEN_BLOCK the wait spins until shortly after the next interrupt
+ * is expected, from the interval between the earlier interrupts, but never longer than spin_max_us.
+ * When the interrupt is further away than that the wait blocks at once. Spinning saves the wakeup of
+ * the waiting thread at the cost of a busy CPU, and is refused on single core systems where it would
+ * hold off the GPIO interrupt thread.
+ *
+ * @param[in] sensor The sensor
+ * @param[in] mode The wait mode
+ * @param[in] spin_max_us The longest spin in microseconds, ignored in ACC_BOARD_INTERRUPT_WAIT_BLOCK
+ * @return True if successful, false otherwise
+ */
+extern bool acc_board_set_sensor_interrupt_wait_mode(acc_sensor_id_t sensor, acc_board_interrupt_wait_mode_t mode,
+                                                     uint32_t spin_max_us);
+
+
+/**
+ * @brief Get an eventfd that becomes readable when the sensor interrupts
+ *
+ * The eventfd is created at the first call, and from then on the GPIO interrupt thread adds
+ * one to it for each interrupt besides the usual signalling. It lets an event loop wait for
+ * several sensors, and other file descriptors, with epoll or poll in one thread, and call
+ * get_next of a sensor when it has interrupted, so that the wait for the interrupt inside
+ * get_next returns at once. The counter may include interrupts that were already taken by a
+ * wait, use acc_board_get_sensor_interrupt_pending to tell. The eventfd is non-blocking and
+ * owned by the board, it must not be closed.
+ *
+ * @param[in] sensor The sensor
+ * @return The eventfd, -1 if it could not be created
+ */
+extern int acc_board_get_sensor_interrupt_fd(acc_sensor_id_t sensor);
+
+
+/**
+ * @brief Get the number of interrupts of a sensor that no wait has taken yet
+ *
+ * @param[in] sensor The sensor
+ * @return The number of pending interrupts
+ */
+extern uint32_t acc_board_get_sensor_interrupt_pending(acc_sensor_id_t sensor);
+
+
+/**
+ * @brief Get the interrupt wait statistics of a sensor
+ *
+ * @param[in] sensor The sensor
+ * @param[out] statistics The statistics since the last reset
+ */
+extern void acc_board_get_sensor_interrupt_statistics(acc_sensor_id_t sensor, acc_board_interrupt_statistics_t *statistics);
+
+
+/**
+ * @brief Reset the interrupt wait statistics of a sensor
+ *
+ * @param[in] sensor The sensor
+ */
+extern void acc_board_reset_sensor_interrupt_statistics(acc_sensor_id_t sensor);
+
 #endif
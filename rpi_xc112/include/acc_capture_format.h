@@ -0,0 +1,118 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_CAPTURE_FORMAT_H_
+#define ACC_CAPTURE_FORMAT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Capture_Format Capture Format
+ *
+ * @brief Binary format of recorded sweeps
+ *
+ * A capture file is a header of ACC_CAPTURE_FORMAT_HEADER_SIZE bytes followed by the sweeps,
+ * each sweep values_per_sweep values of the value type. All fields and values are little
+ * endian. Complex data is stored as interleaved real and imaginary values, values_per_sweep
+ * then counts both.
+ *
+ * Header layout, offsets in bytes:
+ *
+ *     0  magic "ACCB"
+ *     4  uint16 version
+ *     6  uint16 header size
+ *     8  uint16 value type
+ *    10  uint16 flags
+ *    12  uint32 values per sweep
+ *    16  uint64 sweep count
+ *    24  float  start of the range in meters, 0 if unknown
+ *    28  float  length of the range in meters, 0 if unknown
+ *    32  float  update rate in Hz, 0 if unknown
+ *    36  uint32 sensor id, 0 if unknown
+ *    40  reserved, zero
+ *
+ * @{
+ */
+
+
+#define ACC_CAPTURE_FORMAT_VERSION     1
+#define ACC_CAPTURE_FORMAT_HEADER_SIZE 64
+
+/**
+ * @brief Flag set for interleaved complex data
+ */
+#define ACC_CAPTURE_FORMAT_FLAG_COMPLEX 0x0001
+
+
+/**
+ * @brief Value types
+ */
+typedef enum
+{
+	ACC_CAPTURE_FORMAT_VALUE_UINT16  = 1,
+	ACC_CAPTURE_FORMAT_VALUE_FLOAT32 = 2,
+} acc_capture_format_value_type_enum_t;
+typedef uint16_t acc_capture_format_value_type_t;
+
+
+/**
+ * @brief Capture header
+ */
+typedef struct
+{
+	acc_capture_format_value_type_t value_type;
+	uint16_t                        flags;
+	uint32_t                        values_per_sweep;
+	uint64_t                        sweep_count;
+	float                           start_m;
+	float                           length_m;
+	float                           update_rate;
+	uint32_t                        sensor;
+} acc_capture_format_header_t;
+
+
+/**
+ * @brief Get the size of a value
+ *
+ * @param[in] value_type The value type
+ * @return Size of one value in bytes, 0 for an unknown type
+ */
+extern size_t acc_capture_format_value_size(acc_capture_format_value_type_t value_type);
+
+
+/**
+ * @brief Encode a header
+ *
+ * @param[in] header The header
+ * @param[out] buffer ACC_CAPTURE_FORMAT_HEADER_SIZE bytes
+ */
+extern void acc_capture_format_header_encode(const acc_capture_format_header_t *header, uint8_t *buffer);
+
+
+/**
+ * @brief Decode a header
+ *
+ * @param[out] header The header
+ * @param[in] buffer The start of a capture file
+ * @param[in] size Size of the buffer in bytes
+ * @return True if the buffer starts with a valid header, false otherwise
+ */
+extern bool acc_capture_format_header_decode(acc_capture_format_header_t *header, const uint8_t *buffer, size_t size);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,174 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_CAPTURE_WRITER_H_
+#define ACC_CAPTURE_WRITER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Capture_Writer Capture Writer
+ *
+ * @brief Writer of long captures that keeps storage stalls away from the acquisition
+ *
+ * Data is copied into one of a fixed number of aligned blocks. A full block is written to the
+ * file in the background with O_DIRECT, bypassing the page cache and its writeback, while the
+ * caller fills the next block. The caller only waits when all blocks are in flight, which is
+ * counted as a stall.
+ *
+ * The blocks are written through io_uring when the kernel supports it, otherwise by a pool of
+ * threads doing pwrite. The file is preallocated with fallocate ahead of the writes, so the
+ * file system does not allocate blocks while writing. File systems without O_DIRECT get
+ * buffered writes and file systems without fallocate get no preallocation.
+ *
+ * The latency from data being written to the writer until its block is on disk is measured
+ * for the oldest data of each block. With io_uring the completions are seen on the next call
+ * to the writer, so the latency is only resolved to the interval between calls.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Capture writer backends
+ */
+typedef enum
+{
+	/** io_uring if supported by the kernel, otherwise threads */
+	ACC_CAPTURE_WRITER_BACKEND_AUTO,
+	ACC_CAPTURE_WRITER_BACKEND_IO_URING,
+	ACC_CAPTURE_WRITER_BACKEND_THREADS,
+} acc_capture_writer_backend_enum_t;
+typedef uint32_t acc_capture_writer_backend_t;
+
+
+/**
+ * @brief Capture writer configuration
+ */
+typedef struct
+{
+	acc_capture_writer_backend_t backend;
+	/** Size of each block, rounded up to a multiple of 4096 bytes */
+	size_t                       block_size;
+	/** Number of blocks, the blocks in flight are at most this number */
+	uint16_t                     buffer_count;
+	/** Number of threads of the threads backend */
+	uint16_t                     thread_count;
+	/** Bytes to allocate ahead of the writes, 0 for no preallocation */
+	uint64_t                     preallocate_size;
+	/** False to write through the page cache */
+	bool                         direct;
+} acc_capture_writer_configuration_t;
+
+
+/**
+ * @brief Capture writer statistics
+ */
+typedef struct
+{
+	/** The backend in use, io_uring or threads */
+	acc_capture_writer_backend_t backend;
+	/** True if the file is written with O_DIRECT */
+	bool                         direct;
+	/** Number of bytes written to the writer */
+	uint64_t                     bytes;
+	/** Number of blocks written to the file */
+	uint32_t                     block_count;
+	/** Number of writes that waited for a block to be written */
+	uint32_t                     stall_count;
+	/** Longest time of a call to acc_capture_writer_write */
+	uint32_t                     max_write_time_us;
+	/** Longest time from data being written to the writer until it was on disk */
+	uint32_t                     max_latency_us;
+	/** Longest time for the storage to write a block */
+	uint32_t                     max_io_time_us;
+} acc_capture_writer_statistics_t;
+
+
+/**
+ * @brief Capture writer handle
+ */
+typedef struct acc_capture_writer *acc_capture_writer_t;
+
+
+/**
+ * @brief Get the default configuration
+ *
+ * Eight blocks of 256 KiB, two threads if io_uring is not supported, and 64 MiB preallocated
+ * at a time with O_DIRECT.
+ *
+ * @param[out] configuration The default configuration
+ */
+extern void acc_capture_writer_configuration_default(acc_capture_writer_configuration_t *configuration);
+
+
+/**
+ * @brief Create a capture writer, the file is created or truncated
+ *
+ * @param[in] file_path The path of the capture file
+ * @param[in] configuration The configuration
+ * @return Capture writer handle, NULL if creation failed
+ */
+extern acc_capture_writer_t acc_capture_writer_create(const char *file_path,
+                                                      const acc_capture_writer_configuration_t *configuration);
+
+
+/**
+ * @brief Write the remaining data, truncate the file to the written size and destroy the writer
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] writer The writer to destroy, will be set to NULL
+ * @return True if all data was written, false if an error has occurred
+ */
+extern bool acc_capture_writer_destroy(acc_capture_writer_t *writer);
+
+
+/**
+ * @brief Write data to the capture
+ *
+ * @param[in] writer The writer
+ * @param[in] data The data
+ * @param[in] size Number of bytes of data
+ * @return True if successful, false if this or an earlier write to the file failed
+ */
+extern bool acc_capture_writer_write(acc_capture_writer_t writer, const void *data, size_t size);
+
+
+/**
+ * @brief Wait until all full blocks are written to the file
+ *
+ * The last block is not written until it is full or the writer is destroyed.
+ *
+ * @param[in] writer The writer
+ * @return True if successful, false if a write to the file has failed
+ */
+extern bool acc_capture_writer_wait(acc_capture_writer_t writer);
+
+
+/**
+ * @brief Get the statistics of a capture writer
+ *
+ * @param[in] writer The writer
+ * @param[out] statistics The statistics
+ */
+extern void acc_capture_writer_get_statistics(acc_capture_writer_t writer, acc_capture_writer_statistics_t *statistics);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
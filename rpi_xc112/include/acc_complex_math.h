@@ -0,0 +1,182 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_COMPLEX_MATH_H_
+#define ACC_COMPLEX_MATH_H_
+
+#include <complex.h>
+#include <stdint.h>
+
+#include "acc_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Complex_Math Complex Math
+ *
+ * @brief Array kernels for IQ data, replacing cabsf and cargf per point
+ *
+ * Each kernel processes a whole sweep, of float complex points from acc_service_iq_get_next
+ * or int16 complex points from acc_service_iq_get_next_by_reference. When the compiler
+ * targets NEON, four points are processed per instruction, with the remaining points and
+ * other targets using the scalar code. Both compute the same approximations.
+ *
+ * The phase is an odd polynomial approximation of atan on [0, 1] after reducing the point
+ * to the first octant, with the polynomial order selected by the accuracy. The maximum
+ * errors, measured against atan2 by acc_complex_math_benchmark, are listed per accuracy.
+ * The phase of zero is 0 and phases are in [-pi, pi].
+ *
+ * The magnitude is the square root of the squared magnitude, without the overflow protection
+ * of cabsf that sweep values never need. On 32-bit ARM, whose NEON lacks square root and
+ * division, the square root and the division of the octant reduction use reciprocal
+ * estimates refined by Newton-Raphson steps, giving a relative error of a few float ulp.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Phase accuracies
+ */
+typedef enum
+{
+	/** Maximum error 5e-3 radians */
+	ACC_COMPLEX_MATH_ACCURACY_LOW,
+	/** Maximum error 1e-4 radians */
+	ACC_COMPLEX_MATH_ACCURACY_MEDIUM,
+	/** Maximum error 5e-7 radians, close to float resolution */
+	ACC_COMPLEX_MATH_ACCURACY_HIGH
+} acc_complex_math_accuracy_enum_t;
+typedef uint32_t acc_complex_math_accuracy_t;
+
+
+/**
+ * @brief Magnitude of each point
+ *
+ * @param[in] data Points
+ * @param[out] magnitude length values
+ * @param[in] length Number of points
+ */
+extern void acc_complex_math_magnitude(const float complex *data, float *magnitude, uint16_t length);
+
+
+/**
+ * @brief Magnitude of each int16 point
+ *
+ * @param[in] data Points
+ * @param[out] magnitude length values
+ * @param[in] length Number of points
+ */
+extern void acc_complex_math_magnitude_int16(const acc_int16_complex_t *data, float *magnitude, uint16_t length);
+
+
+/**
+ * @brief Squared magnitude of each point
+ *
+ * @param[in] data Points
+ * @param[out] squared_magnitude length values
+ * @param[in] length Number of points
+ */
+extern void acc_complex_math_squared_magnitude(const float complex *data, float *squared_magnitude, uint16_t length);
+
+
+/**
+ * @brief Squared magnitude of each int16 point, exact
+ *
+ * @param[in] data Points
+ * @param[out] squared_magnitude length values
+ * @param[in] length Number of points
+ */
+extern void acc_complex_math_squared_magnitude_int16(const acc_int16_complex_t *data, uint32_t *squared_magnitude,
+                                                     uint16_t length);
+
+
+/**
+ * @brief Phase of each point
+ *
+ * @param[in] data Points
+ * @param[out] phase length values in radians
+ * @param[in] length Number of points
+ * @param[in] accuracy The accuracy of the phase
+ */
+extern void acc_complex_math_phase(const float complex *data, float *phase, uint16_t length, acc_complex_math_accuracy_t accuracy);
+
+
+/**
+ * @brief Phase of each int16 point
+ *
+ * @param[in] data Points
+ * @param[out] phase length values in radians
+ * @param[in] length Number of points
+ * @param[in] accuracy The accuracy of the phase
+ */
+extern void acc_complex_math_phase_int16(const acc_int16_complex_t *data, float *phase, uint16_t length,
+                                         acc_complex_math_accuracy_t accuracy);
+
+
+/**
+ * @brief Multiply each point with the conjugate of the corresponding reference point
+ *
+ * The result may be one of the inputs.
+ *
+ * @param[in] data Points
+ * @param[in] reference Reference points
+ * @param[out] result length values of data * conj(reference)
+ * @param[in] length Number of points
+ */
+extern void acc_complex_math_conjugate_multiply(const float complex *data, const float complex *reference, float complex *result,
+                                                uint16_t length);
+
+
+/**
+ * @brief Multiply each int16 point with the conjugate of the corresponding reference point
+ *
+ * @param[in] data Points
+ * @param[in] reference Reference points
+ * @param[out] result length values of data * conj(reference)
+ * @param[in] length Number of points
+ */
+extern void acc_complex_math_conjugate_multiply_int16(const acc_int16_complex_t *data, const acc_int16_complex_t *reference,
+                                                      float complex *result, uint16_t length);
+
+
+/**
+ * @brief Phase change of each point from the previous sweep
+ *
+ * The phase of data * conj(previous), which is wrapped to [-pi, pi] without unwrapping.
+ *
+ * @param[in] data Points of the latest sweep
+ * @param[in] previous Points of the previous sweep
+ * @param[out] phase_difference length values in radians
+ * @param[in] length Number of points
+ * @param[in] accuracy The accuracy of the phase
+ */
+extern void acc_complex_math_phase_difference(const float complex *data, const float complex *previous, float *phase_difference,
+                                              uint16_t length, acc_complex_math_accuracy_t accuracy);
+
+
+/**
+ * @brief Phase change of each int16 point from the previous sweep
+ *
+ * @param[in] data Points of the latest sweep
+ * @param[in] previous Points of the previous sweep
+ * @param[out] phase_difference length values in radians
+ * @param[in] length Number of points
+ * @param[in] accuracy The accuracy of the phase
+ */
+extern void acc_complex_math_phase_difference_int16(const acc_int16_complex_t *data, const acc_int16_complex_t *previous,
+                                                    float *phase_difference, uint16_t length, acc_complex_math_accuracy_t accuracy);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -56,6 +56,18 @@ extern acc_detector_distance_basic_handle_t acc_detector_distance_basic_create(a
 extern void acc_detector_distance_basic_destroy(acc_detector_distance_basic_handle_t *handle);
 
 
+/**
+ * @brief Filter the envelope over time with a sliding median before looking for the reflection
+ *
+ * Removes impulsive interference and single sweep spikes that would make the reflection jump.
+ *
+ * @param[in] handle The detector handle
+ * @param[in] window_length Number of sweeps in the median window, 0 disables the filter
+ * @return True if successful, false otherwise
+ */
+extern bool acc_detector_distance_basic_median_filter_set(acc_detector_distance_basic_handle_t handle, uint16_t window_length);
+
+
 /**
  * @brief Get a reflection from the distance basic detector
  *
@@ -0,0 +1,234 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_DETECTOR_GESTURE_H_
+#define ACC_DETECTOR_GESTURE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Gesture Gesture Detector
+ * @ingroup Detectors
+ *
+ * @brief Gesture detector processing API description
+ *
+ * The gesture detector works on envelope or sparse frames delivered by the application.
+ * Compact features are extracted from each frame and kept in a fixed window of frames.
+ * The window is classified with a fixed point decision tree compiled into a constant table.
+ * No memory is allocated, all state lives in a buffer provided by the application.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Number of frames in the classification window
+ */
+#define ACC_DETECTOR_GESTURE_WINDOW_LENGTH 64
+
+/**
+ * @brief Fixed point format of positions, velocities and spreads, given as fractions of the range
+ */
+#define ACC_DETECTOR_GESTURE_Q 12
+
+
+/**
+ * @brief Gestures
+ */
+typedef enum
+{
+	ACC_DETECTOR_GESTURE_NONE,
+	ACC_DETECTOR_GESTURE_TAP,
+	ACC_DETECTOR_GESTURE_SWIPE_TOWARD,
+	ACC_DETECTOR_GESTURE_SWIPE_AWAY,
+	ACC_DETECTOR_GESTURE_HOLD,
+	ACC_DETECTOR_GESTURE_WAVE,
+	ACC_DETECTOR_GESTURE_COUNT
+} acc_detector_gesture_enum_t;
+typedef uint32_t acc_detector_gesture_t;
+
+
+/**
+ * @brief Window features used by the classifier
+ */
+typedef enum
+{
+	/** Number of frames in the window where a hand is present */
+	ACC_DETECTOR_GESTURE_FEATURE_PRESENCE,
+	/** Number of consecutive frames up to now where a hand is present */
+	ACC_DETECTOR_GESTURE_FEATURE_PRESENT_RUN,
+	/** Position of the last present frame minus the first one */
+	ACC_DETECTOR_GESTURE_FEATURE_NET_DISPLACEMENT,
+	/** Max minus min position of present frames */
+	ACC_DETECTOR_GESTURE_FEATURE_POSITION_RANGE,
+	/** Mean absolute velocity of present frames */
+	ACC_DETECTOR_GESTURE_FEATURE_MEAN_SPEED,
+	/** Number of direction changes of the movement */
+	ACC_DETECTOR_GESTURE_FEATURE_DIRECTION_CHANGES,
+	/** Mean spread of present frames */
+	ACC_DETECTOR_GESTURE_FEATURE_MEAN_SPREAD,
+	/** Base 2 logarithm of the max frame energy in Q4 */
+	ACC_DETECTOR_GESTURE_FEATURE_LOG_ENERGY,
+	ACC_DETECTOR_GESTURE_FEATURE_COUNT
+} acc_detector_gesture_feature_enum_t;
+
+
+/**
+ * @brief Gesture detector configuration
+ */
+typedef struct
+{
+	/** Amplitude below which data is treated as noise */
+	uint16_t noise_floor;
+	/** Minimum frame energy above the noise floor for a hand to be present */
+	uint32_t presence_energy;
+	/** Minimum velocity in Q12 fractions of the range per frame counted as movement */
+	uint16_t velocity_deadband;
+} acc_detector_gesture_configuration_t;
+
+
+/**
+ * @brief Features of one frame
+ */
+typedef struct
+{
+	/** True if a hand is present in the frame */
+	bool     present;
+	/** Position of the peak in Q12 fractions of the range */
+	uint16_t position;
+	/** Position change since the previous frame in Q12 fractions of the range */
+	int16_t  velocity;
+	/** Spread of the reflection around the peak in Q12 fractions of the range */
+	uint16_t spread;
+	/** Sum of amplitudes above the noise floor */
+	uint32_t energy;
+} acc_detector_gesture_frame_features_t;
+
+
+/**
+ * @brief Gesture detector result
+ */
+typedef struct
+{
+	/** Classification of the current window */
+	acc_detector_gesture_t                gesture;
+	/** A new gesture started with this frame, ACC_DETECTOR_GESTURE_NONE otherwise */
+	acc_detector_gesture_t                event;
+	/** Features of the frame */
+	acc_detector_gesture_frame_features_t frame;
+} acc_detector_gesture_result_t;
+
+
+/**
+ * @brief Gesture detector handle
+ */
+typedef struct acc_detector_gesture_handle *acc_detector_gesture_handle_t;
+
+
+/**
+ * @brief Get default configuration
+ *
+ * @param[out] configuration The configuration to fill with default values
+ */
+extern void acc_detector_gesture_configuration_default(acc_detector_gesture_configuration_t *configuration);
+
+
+/**
+ * @brief Get the size of the buffer used in acc_detector_gesture_init()
+ *
+ * @param[in] data_length Number of points in each frame
+ * @return The size of the buffer needed
+ */
+extern size_t acc_detector_gesture_get_size(uint16_t data_length);
+
+
+/**
+ * @brief Init a gesture detector instance
+ *
+ * @param[in, out] buffer The buffer used for all state, at least acc_detector_gesture_get_size() bytes long and
+ *                        suitably aligned for any built-in type. Must remain valid as long as the handle is used.
+ * @param[in] configuration The configuration to use
+ * @param[in] data_length Number of points in each frame
+ * @return A handle, or NULL if buffer or configuration was NULL or data_length was less than 2
+ */
+extern acc_detector_gesture_handle_t acc_detector_gesture_init(void                                       *buffer,
+                                                               const acc_detector_gesture_configuration_t *configuration,
+                                                               uint16_t                                   data_length);
+
+
+/**
+ * @brief Process an envelope frame
+ *
+ * @param[in] handle The handle
+ * @param[in] envelope_data Envelope data, data_length points
+ * @param[out] result The result
+ * @return True if successful, false otherwise
+ */
+extern bool acc_detector_gesture_next_envelope(acc_detector_gesture_handle_t handle,
+                                               const uint16_t                *envelope_data,
+                                               acc_detector_gesture_result_t *result);
+
+
+/**
+ * @brief Process a sparse frame
+ *
+ * The amplitude of each point is the mean absolute deviation over the sweeps in the frame,
+ * so static reflections are suppressed and moving hands stand out.
+ *
+ * @param[in] handle The handle
+ * @param[in] sparse_data Sparse data, sweeps_per_frame sweeps of data_length points each
+ * @param[in] sweeps_per_frame Number of sweeps in the frame
+ * @param[out] result The result
+ * @return True if successful, false otherwise
+ */
+extern bool acc_detector_gesture_next_sparse(acc_detector_gesture_handle_t handle,
+                                             const uint16_t                *sparse_data,
+                                             uint16_t                      sweeps_per_frame,
+                                             acc_detector_gesture_result_t *result);
+
+
+/**
+ * @brief Get the window features of the latest frame
+ *
+ * This is the input of the classifier, intended for exporting training data.
+ *
+ * @param[in] handle The handle
+ * @param[out] features ACC_DETECTOR_GESTURE_FEATURE_COUNT feature values
+ */
+extern void acc_detector_gesture_features_get(acc_detector_gesture_handle_t handle, int32_t *features);
+
+
+/**
+ * @brief Classify a window feature vector with the compiled model
+ *
+ * @param[in] features ACC_DETECTOR_GESTURE_FEATURE_COUNT feature values
+ * @return The gesture
+ */
+extern acc_detector_gesture_t acc_detector_gesture_classify(const int32_t *features);
+
+
+/**
+ * @brief Get the name of a gesture
+ *
+ * @param[in] gesture The gesture
+ * @return Name of the gesture
+ */
+extern const char *acc_detector_gesture_name(acc_detector_gesture_t gesture);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_DEVICE_MEMORY_KV_H_
+#define ACC_DEVICE_MEMORY_KV_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Default start address of the key-value region
+ *
+ * The first bytes of the board EEPROM hold the board data string, the key-value
+ * store is placed page aligned after it.
+ */
+#define ACC_DEVICE_MEMORY_KV_DEFAULT_START 0x100
+
+/**
+ * @brief Maximum number of keys that can be stored at the same time
+ */
+#define ACC_DEVICE_MEMORY_KV_MAX_KEYS 64
+
+/**
+ * @brief Maximum size in bytes of a single value
+ */
+#define ACC_DEVICE_MEMORY_KV_VALUE_MAX 1024
+
+
+/**
+ * @brief Key-value store statistics
+ */
+typedef struct
+{
+	/** Size of the key-value region in bytes */
+	size_t   region_size;
+	/** Number of bytes occupied by live records */
+	size_t   live_bytes;
+	/** Number of bytes between the oldest live record and the write position */
+	size_t   used_bytes;
+	/** Number of keys currently stored */
+	uint16_t key_count;
+	/** Number of records written since init, including records moved by compaction */
+	uint32_t records_written;
+	/** Number of records moved by compaction since init */
+	uint32_t records_moved;
+	/** Number of store requests skipped since the stored value was unchanged */
+	uint32_t writes_skipped;
+} acc_device_memory_kv_statistics_t;
+
+
+/**
+ * @brief Initialize the key-value store
+ *
+ * The records are read once and an index of all keys is built in RAM. After
+ * this no reads are needed to find a key, and loads read only the value itself.
+ * Until the log has wrapped around the region only the records up to the first
+ * erased page are read, after that the whole region is read.
+ *
+ * Records are appended to the region as a circular log, so writes are spread
+ * over all pages of the region. Space held by old records is reclaimed from the
+ * tail of the log, moving any record that is still live to the head.
+ *
+ * acc_device_memory_init must have been called before this function.
+ *
+ * @param[in] start_address Start address of the region in the memory device, page aligned
+ * @param[in] size Size of the region in bytes, a multiple of the 64 byte page, 0 means to the
+ *            end of the memory device
+ * @return True if successful, false otherwise
+ */
+extern bool acc_device_memory_kv_init(uint32_t start_address, size_t size);
+
+
+/**
+ * @brief Release the key-value store
+ */
+extern void acc_device_memory_kv_deinit(void);
+
+
+/**
+ * @brief Store a value
+ *
+ * Any previous value of the key is replaced. If the value is identical to the
+ * stored value nothing is written.
+ *
+ * @param[in] key The key to store the value under
+ * @param[in] value The value
+ * @param[in] length Length of the value in bytes, at most ACC_DEVICE_MEMORY_KV_VALUE_MAX
+ * @return True if successful, false otherwise
+ */
+extern bool acc_device_memory_kv_store(uint16_t key, const void *value, uint16_t length);
+
+
+/**
+ * @brief Load a value
+ *
+ * @param[in] key The key to load
+ * @param[out] value Buffer to receive the value
+ * @param[in] max_length Size of the value buffer in bytes
+ * @param[out] length The length of the value, may be NULL
+ * @return True if the key was found and the value fits in the buffer, false otherwise
+ */
+extern bool acc_device_memory_kv_load(uint16_t key, void *value, uint16_t max_length, uint16_t *length);
+
+
+/**
+ * @brief Get the length of a stored value
+ *
+ * @param[in] key The key
+ * @param[out] length The length of the value in bytes
+ * @return True if the key was found, false otherwise
+ */
+extern bool acc_device_memory_kv_get_length(uint16_t key, uint16_t *length);
+
+
+/**
+ * @brief Remove a value
+ *
+ * Removing a key that does not exist has no effect and returns true.
+ *
+ * @param[in] key The key to remove
+ * @return True if successful, false otherwise
+ */
+extern bool acc_device_memory_kv_remove(uint16_t key);
+
+
+/**
+ * @brief Get statistics of the key-value store
+ *
+ * @param[out] statistics The statistics
+ */
+extern void acc_device_memory_kv_get_statistics(acc_device_memory_kv_statistics_t *statistics);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
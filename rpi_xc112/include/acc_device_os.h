@@ -113,6 +113,196 @@ extern void *acc_os_mem_calloc_debug(size_t num, size_t size, const char *file,
 extern void acc_os_mem_free(void *ptr);
 
 
+/**
+ * @brief Allocate dynamic memory on behalf of RSS, used in the HAL
+ *
+ * Same as the platform allocator but seen by the steady state tripwire, with the
+ * calling address as call site.
+ *
+ * @param size The number of bytes to allocate
+ * @return Pointer to the allocated memory, or NULL if allocation failed
+ */
+extern void *acc_os_hal_mem_alloc(size_t size);
+
+
+/**
+ * @brief Free dynamic memory on behalf of RSS, used in the HAL
+ *
+ * @param ptr Pointer to the dynamic memory to free
+ */
+extern void acc_os_hal_mem_free(void *ptr);
+
+
+/**
+ * @brief Maximum number of memory accounts, further names are counted as "other"
+ */
+#define ACC_OS_MEMORY_ACCOUNTS_MAX 32
+
+
+/**
+ * @brief Maximum length of a reported memory account name, longer names are truncated
+ *
+ * Accounts are told apart by the whole name, two names that only differ after this length
+ * are reported with the same truncated name.
+ */
+#define ACC_OS_MEMORY_ACCOUNT_NAME_LENGTH_MAX 39
+
+
+/**
+ * @brief Maximum length of a thread name, as for pthread_setname_np
+ */
+#define ACC_OS_THREAD_NAME_LENGTH_MAX 15
+
+
+/**
+ * @brief Memory attributed to one service, detector or subsystem
+ */
+typedef struct
+{
+	char     name[ACC_OS_MEMORY_ACCOUNT_NAME_LENGTH_MAX + 1];
+	size_t   heap_bytes;
+	size_t   heap_peak_bytes;
+	uint32_t allocation_count;
+	size_t   mapped_bytes;
+} acc_os_memory_account_t;
+
+
+/**
+ * @brief Stack of a thread created with acc_os_thread_create
+ */
+typedef struct
+{
+	char   name[ACC_OS_THREAD_NAME_LENGTH_MAX + 1];
+	size_t stack_size;
+	size_t stack_high_water;
+	bool   running;
+} acc_os_thread_stack_t;
+
+
+/**
+ * @brief Begin attributing allocations of the calling thread to a named account
+ *
+ * Every acc_os_mem_alloc and every allocation made by RSS through the HAL is counted in an
+ * account, until it is freed. Outside a scope, acc_os_mem_alloc is counted in an account
+ * named by the source file of the call and RSS allocations in an account named "rss". A
+ * scope is typically put around the creation of a service or detector, with a name such as
+ * "envelope sensor 1", and is ended when the creation is done. Scopes can be nested.
+ *
+ * @param name Account name, copied when the account is created
+ * @return The scope to restore with acc_os_memory_scope_end
+ */
+extern uint16_t acc_os_memory_scope_begin(const char *name);
+
+
+/**
+ * @brief End a scope begun with acc_os_memory_scope_begin
+ *
+ * @param previous_scope The value returned by acc_os_memory_scope_begin
+ */
+extern void acc_os_memory_scope_end(uint16_t previous_scope);
+
+
+/**
+ * @brief Count memory mapped outside the heap, e.g. with mmap, in an account
+ *
+ * @param name Account name
+ * @param size Number of bytes mapped
+ */
+extern void acc_os_memory_mapped(const char *name, size_t size);
+
+
+/**
+ * @brief Count memory unmapped, reverting acc_os_memory_mapped
+ *
+ * @param name Account name
+ * @param size Number of bytes unmapped
+ */
+extern void acc_os_memory_unmapped(const char *name, size_t size);
+
+
+/**
+ * @brief Get the memory accounts
+ *
+ * @param[out] accounts Array for the accounts
+ * @param[in] max_count Length of the array
+ * @return Number of accounts written
+ */
+extern uint16_t acc_os_memory_get_accounts(acc_os_memory_account_t *accounts, uint16_t max_count);
+
+
+/**
+ * @brief Get the stack usage of the threads created with acc_os_thread_create
+ *
+ * The high water mark of a running thread is measured at the call, that of a thread that
+ * has exited is the one measured when it was cleaned up.
+ *
+ * @param[out] stacks Array for the threads
+ * @param[in] max_count Length of the array
+ * @return Number of threads written
+ */
+extern uint16_t acc_os_thread_stacks_get(acc_os_thread_stack_t *stacks, uint16_t max_count);
+
+
+/**
+ * @brief Print the memory accounts, the thread stacks and the totals
+ *
+ * The totals are the accounted heap, the mapped memory, the stacks of the threads and the
+ * heap of the process as seen by the platform, which also includes libc and the application.
+ */
+extern void acc_os_memory_report(void);
+
+
+/**
+ * @brief Arm the steady state allocation tripwire
+ *
+ * To be called when setup is done and the acquisition and processing loop starts. While
+ * armed, every call to the allocator is counted together with its call site: calls to
+ * acc_os_mem_alloc and acc_os_mem_free, allocations made by RSS through the HAL, and calls
+ * to the libc allocator when acc_os_malloc_interpose.o is linked in. Counts from a previous
+ * arming are cleared.
+ */
+extern void acc_os_steady_state_arm(void);
+
+
+/**
+ * @brief Disarm the steady state allocation tripwire
+ *
+ * @return Number of allocator calls while armed
+ */
+extern uint32_t acc_os_steady_state_disarm(void);
+
+
+/**
+ * @brief Print the call sites of the allocator calls made while armed
+ *
+ * The tripwire should be disarmed first, printing may itself allocate.
+ */
+extern void acc_os_steady_state_report(void);
+
+
+/**
+ * @brief Disarm the steady state allocation tripwire and report the call sites if it was tripped
+ *
+ * To be called when the acquisition and processing loop is done.
+ *
+ * @return Number of allocator calls while armed
+ */
+extern uint32_t acc_os_steady_state_check(void);
+
+
+/**
+ * @brief Record an allocator call, for allocator wrappers
+ *
+ * Does nothing unless armed. Does not allocate.
+ *
+ * @param file The file of the call site, or NULL if unknown
+ * @param line The line of the call site
+ * @param caller The calling address, used as call site if file is NULL
+ * @param is_free True for a free, false for an allocation
+ */
+extern void acc_os_steady_state_record(const char *file, uint16_t line, const void *caller, bool is_free);
+
+
 /**
  * @brief Return the unique thread ID for the current thread
  */
@@ -51,6 +51,7 @@ extern void			(*acc_device_spi_destroy_func)(acc_device_handle_t *handle);
 extern bool		(*acc_device_spi_transfer_func)(acc_device_handle_t handle, uint8_t *buffer, size_t buffer_size);
 extern bool		(*acc_device_spi_transfer_async_func)(acc_device_handle_t handle, uint8_t *buffer, bool rx, bool tx, size_t buffer_size, acc_device_spi_transfer_callback_t callback);
 extern uint8_t			(*acc_device_spi_get_bus_func)(acc_device_handle_t);
+extern bool			(*acc_device_spi_set_speed_func)(acc_device_handle_t handle, uint32_t speed);
 
 
 /**
@@ -78,6 +79,19 @@ extern void acc_device_spi_destroy(acc_device_handle_t *handle);
 extern uint_fast8_t acc_device_spi_get_bus(acc_device_handle_t handle);
 
 
+/**
+ * @brief Change the clock speed of the device
+ *
+ * Applies to the following transfers. The driver may round the speed down to a speed
+ * the controller supports.
+ *
+ * @param handle SPI device handle
+ * @param speed The clock speed in Hz
+ * @return True if successful, false if the driver cannot change the speed
+ */
+extern bool acc_device_spi_set_speed(acc_device_handle_t handle, uint32_t speed);
+
+
 /**
  * @brief Reserve SPI bus
  *
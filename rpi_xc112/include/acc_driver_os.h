@@ -7,6 +7,7 @@
 #include <stdbool.h>
 
 #include "acc_app_integration.h"
+#include "acc_device_os.h"
 
 // These functions are to be used by drivers only, do not use them directly
 extern void                                (*acc_device_os_init_func)(void);
@@ -26,6 +27,7 @@ extern void                                (*acc_device_os_mutex_destroy_func)(a
 extern acc_app_integration_thread_handle_t (*acc_device_os_thread_create_func)(void (*func)(void *param), void *param, const char *name);
 extern void                                (*acc_device_os_thread_exit_func)(void);
 extern void                                (*acc_device_os_thread_cleanup_func)(acc_app_integration_thread_handle_t handle);
+extern uint16_t                            (*acc_device_os_thread_stacks_get_func)(acc_os_thread_stack_t *stacks, uint16_t max_count);
 extern acc_app_integration_semaphore_t     (*acc_device_os_semaphore_create_func)(void);
 extern bool                                (*acc_device_os_semaphore_wait_func)(acc_app_integration_semaphore_t sem, uint16_t timeout_ms);
 extern void                                (*acc_device_os_semaphore_signal_func)(acc_app_integration_semaphore_t sem);
@@ -4,6 +4,8 @@
 #ifndef ACC_DRIVER_OS_LINUX_H_
 #define ACC_DRIVER_OS_LINUX_H_
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -15,6 +17,14 @@ extern "C" {
 extern void acc_driver_os_linux_register(void);
 
 
+/**
+ * @brief Set the stack size of the threads created after the call
+ *
+ * @param stack_size Stack size in bytes, rounded up to whole pages
+ */
+extern void acc_driver_os_linux_set_thread_stack_size(size_t stack_size);
+
+
 #ifdef __cplusplus
 }
 #endif
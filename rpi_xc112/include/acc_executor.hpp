@@ -0,0 +1,571 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_EXECUTOR_HPP_
+#define ACC_EXECUTOR_HPP_
+
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "acc_rss.hpp"
+
+extern "C" {
+#include "acc_board.h"
+}
+
+
+/**
+ * @defgroup Executor Coroutine Executor
+ * @ingroup Cpp
+ *
+ * @brief Single-threaded C++20 coroutine executor for acquisition from several sensors
+ *
+ * Each sensor pipeline is a coroutine, an acc::task, that awaits the next sweep of its
+ * sensor with co_await stream.next_sweep(). The coroutine is suspended until the sensor
+ * interrupts, which the board signals on an eventfd, see acc_board_get_sensor_interrupt_fd.
+ * One acc::executor waits for the eventfds of all sensors with epoll and resumes the
+ * coroutine of each sensor that has interrupted. get_next then finds the interrupt pending
+ * and returns after the transfer, without blocking on the interrupt.
+ *
+ * Other file descriptors, such as sockets and timerfds for network and audio, are awaited in
+ * the same thread with acc::fd_watch.
+ *
+ * @code
+ * acc::task pipeline(acc::sensor_stream<acc::envelope> &stream)
+ * {
+ *         for (;;)
+ *         {
+ *                 acc::span<const uint16_t> envelope = co_await stream.next_sweep();
+ *
+ *                 if (envelope.empty())
+ *                 {
+ *                         co_return;
+ *                 }
+ *
+ *                 process(envelope);
+ *         }
+ * }
+ *
+ * acc::executor executor;
+ *
+ * for (auto &stream : streams)
+ * {
+ *         executor.spawn(pipeline(stream));
+ * }
+ *
+ * executor.run();
+ * @endcode
+ *
+ * A get_next that needs more than one interrupt, for example with stitching, still waits for
+ * the remaining interrupts inside get_next. Tasks are resumed in the executor thread only,
+ * and nothing is allocated after the tasks are spawned.
+ *
+ * @{
+ */
+
+
+namespace acc
+{
+
+
+class executor;
+
+
+/**
+ * @brief Coroutine run by an executor, destroyed when it returns
+ */
+class task
+{
+	public:
+		struct promise_type
+		{
+			struct final_awaiter
+			{
+				bool await_ready() noexcept
+				{
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+
+				void await_resume() noexcept
+				{
+				}
+			};
+
+			executor *owner = nullptr;
+
+			task get_return_object() noexcept
+			{
+				return task(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+
+			std::suspend_always initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			final_awaiter final_suspend() noexcept
+			{
+				return {};
+			}
+
+			void return_void() noexcept
+			{
+			}
+
+			void unhandled_exception() noexcept
+			{
+				std::terminate();
+			}
+		};
+
+		task(task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr))
+		{
+		}
+
+		task &operator=(task &&other) noexcept
+		{
+			std::swap(handle_, other.handle_);
+			return *this;
+		}
+
+		task(const task &)            = delete;
+		task &operator=(const task &) = delete;
+
+		~task()
+		{
+			// Only a task that was never spawned still owns its coroutine
+			if (handle_)
+			{
+				handle_.destroy();
+			}
+		}
+
+	private:
+		friend class executor;
+
+		explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle)
+		{
+		}
+
+		std::coroutine_handle<promise_type> handle_;
+};
+
+
+/**
+ * @brief Single-threaded executor that resumes tasks when their file descriptors are readable
+ */
+class executor
+{
+	public:
+		/**
+		 * @brief A file descriptor registered with the executor, awaited by at most one task at a time
+		 */
+		struct watch
+		{
+			int                     fd = -1;
+			std::coroutine_handle<> waiter;
+		};
+
+		executor() : epoll_fd_(epoll_create1(EPOLL_CLOEXEC))
+		{
+		}
+
+		~executor()
+		{
+			reap();
+
+			// Tasks still suspended after stop
+			for (std::coroutine_handle<task::promise_type> handle : tasks_)
+			{
+				handle.destroy();
+			}
+
+			if (epoll_fd_ >= 0)
+			{
+				close(epoll_fd_);
+			}
+		}
+
+		executor(const executor &)            = delete;
+		executor &operator=(const executor &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return epoll_fd_ >= 0;
+		}
+
+		/**
+		 * @brief Hand a task to the executor, it is started by run
+		 */
+		void spawn(task &&spawned)
+		{
+			std::coroutine_handle<task::promise_type> handle = std::exchange(spawned.handle_, nullptr);
+
+			handle.promise().owner = this;
+			tasks_.push_back(handle);
+			ready_.push_back(handle);
+
+			// Reserved here so that finishing tasks does not allocate
+			finished_.reserve(tasks_.size());
+		}
+
+		/**
+		 * @brief Run the tasks until all have returned or stop is called
+		 *
+		 * @return False if waiting for the file descriptors failed
+		 */
+		bool run()
+		{
+			epoll_event events[EVENTS_MAX];
+
+			stopped_ = false;
+
+			while (!tasks_.empty() && !stopped_)
+			{
+				// Spawned tasks that have not started
+				while (!ready_.empty() && !stopped_)
+				{
+					std::coroutine_handle<> handle = ready_.back();
+
+					ready_.pop_back();
+					handle.resume();
+				}
+
+				reap();
+
+				if (tasks_.empty() || stopped_)
+				{
+					break;
+				}
+
+				int count = epoll_wait(epoll_fd_, events, EVENTS_MAX, -1);
+
+				if (count < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					return false;
+				}
+
+				wakeup_count_++;
+
+				for (int i = 0; i < count; i++)
+				{
+					watch                   *watched = static_cast<watch *>(events[i].data.ptr);
+					std::coroutine_handle<> waiter   = std::exchange(watched->waiter, nullptr);
+
+					if (waiter)
+					{
+						waiter.resume();
+					}
+				}
+
+				reap();
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Make run return after the task that is running now suspends
+		 */
+		void stop() noexcept
+		{
+			stopped_ = true;
+		}
+
+		/**
+		 * @brief Number of times run has woken up from epoll
+		 */
+		uint64_t wakeup_count() const noexcept
+		{
+			return wakeup_count_;
+		}
+
+		bool add(watch &watched)
+		{
+			epoll_event event = {};
+
+			// One-shot, each await arms the file descriptor again
+			event.events   = EPOLLONESHOT;
+			event.data.ptr = &watched;
+
+			return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, watched.fd, &event) == 0;
+		}
+
+		void remove(watch &watched)
+		{
+			epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, watched.fd, nullptr);
+		}
+
+		bool arm(watch &watched, std::coroutine_handle<> waiter)
+		{
+			epoll_event event = {};
+
+			event.events   = EPOLLIN | EPOLLONESHOT;
+			event.data.ptr = &watched;
+			watched.waiter = waiter;
+
+			if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, watched.fd, &event) != 0)
+			{
+				watched.waiter = nullptr;
+				return false;
+			}
+
+			return true;
+		}
+
+	private:
+		friend struct task::promise_type::final_awaiter;
+
+		static constexpr int EVENTS_MAX = 16;
+
+		void finished(std::coroutine_handle<task::promise_type> handle) noexcept
+		{
+			finished_.push_back(handle);
+		}
+
+		void reap() noexcept
+		{
+			for (std::coroutine_handle<task::promise_type> handle : finished_)
+			{
+				for (std::size_t i = 0; i < tasks_.size(); i++)
+				{
+					if (tasks_[i] == handle)
+					{
+						tasks_[i] = tasks_.back();
+						tasks_.pop_back();
+						break;
+					}
+				}
+
+				handle.destroy();
+			}
+
+			finished_.clear();
+		}
+
+		int                                                     epoll_fd_;
+		std::vector<std::coroutine_handle<task::promise_type> > tasks_;
+		std::vector<std::coroutine_handle<task::promise_type> > finished_;
+		std::vector<std::coroutine_handle<> >                   ready_;
+		uint64_t                                                wakeup_count_ = 0;
+		bool                                                    stopped_      = false;
+};
+
+
+inline void task::promise_type::final_awaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+{
+	// Destroyed by the executor once the coroutine that resumed it has returned
+	handle.promise().owner->finished(handle);
+}
+
+
+/**
+ * @brief A file descriptor awaited for readability by a task, such as a socket or a timerfd
+ */
+class fd_watch
+{
+	public:
+		fd_watch(executor &owner, int fd) : owner_(owner)
+		{
+			watch_.fd = fd;
+			added_    = fd >= 0 && owner_.add(watch_);
+		}
+
+		~fd_watch()
+		{
+			if (added_)
+			{
+				owner_.remove(watch_);
+			}
+		}
+
+		fd_watch(const fd_watch &)            = delete;
+		fd_watch &operator=(const fd_watch &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return added_;
+		}
+
+		int fd() const noexcept
+		{
+			return watch_.fd;
+		}
+
+		/**
+		 * @brief Suspend until the file descriptor is readable
+		 *
+		 * Resumes with false if the file descriptor could not be armed.
+		 */
+		auto readable() noexcept
+		{
+			struct awaiter
+			{
+				fd_watch &watched;
+				bool     armed;
+
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				bool await_suspend(std::coroutine_handle<> handle) noexcept
+				{
+					armed = watched.owner_.arm(watched.watch_, handle);
+					return armed;
+				}
+
+				bool await_resume() const noexcept
+				{
+					return armed;
+				}
+			};
+
+			return awaiter{*this, false};
+		}
+
+	private:
+		template<typename Type>
+		friend class sensor_stream;
+
+		executor        &owner_;
+		executor::watch watch_;
+		bool            added_;
+};
+
+
+/**
+ * @brief The sweeps of a service, awaited on the interrupts of its sensor
+ *
+ * The service must be activated before the first sweep is awaited.
+ */
+template<typename Type>
+class sensor_stream
+{
+	public:
+		using element_type     = typename Type::element_type;
+		using result_info_type = typename Type::result_info_type;
+
+		sensor_stream(executor &owner, service<Type> &service, acc_sensor_id_t sensor) :
+			service_(service), sensor_(sensor), watch_(owner, acc_board_get_sensor_interrupt_fd(sensor))
+		{
+		}
+
+		sensor_stream(const sensor_stream &)            = delete;
+		sensor_stream &operator=(const sensor_stream &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return static_cast<bool>(watch_) && static_cast<bool>(service_);
+		}
+
+		/**
+		 * @brief Suspend until the sensor interrupts, then get the next sweep by reference
+		 *
+		 * @return The sweep, valid until the next call, empty on failure
+		 */
+		auto next_sweep(result_info_type *result_info = nullptr) noexcept
+		{
+			return sweep_awaiter<false>{*this, span<element_type>(), result_info, true};
+		}
+
+		/**
+		 * @brief Suspend until the sensor interrupts, then copy the next sweep into a buffer
+		 *
+		 * For service types without a by-reference get_next.
+		 *
+		 * @return The part of the buffer holding the sweep, empty on failure
+		 */
+		auto next_sweep(span<element_type> buffer, result_info_type *result_info = nullptr) noexcept
+		{
+			return sweep_awaiter<true>{*this, buffer, result_info, true};
+		}
+
+	private:
+		template<bool Copy>
+		struct sweep_awaiter
+		{
+			sensor_stream      &stream;
+			span<element_type> buffer;
+			result_info_type   *result_info;
+			bool               armed;
+
+			bool await_ready() const noexcept
+			{
+				return acc_board_get_sensor_interrupt_pending(stream.sensor_) > 0;
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle) noexcept
+			{
+				// Counts of interrupts that a wait has already taken only cause a spurious wakeup
+				stream.drain();
+
+				if (acc_board_get_sensor_interrupt_pending(stream.sensor_) > 0)
+				{
+					return false;
+				}
+
+				armed = stream.watch_.owner_.arm(stream.watch_.watch_, handle);
+				return armed;
+			}
+
+			auto await_resume() noexcept
+			{
+				using result_type = std::conditional_t<Copy, span<element_type>, span<const element_type> >;
+
+				if (!armed)
+				{
+					return result_type();
+				}
+
+				stream.drain();
+
+				if constexpr (Copy)
+				{
+					return stream.service_.get_next(buffer, result_info);
+				}
+				else
+				{
+					return stream.service_.get_next_by_reference(result_info);
+				}
+			}
+		};
+
+		void drain() noexcept
+		{
+			uint64_t count;
+
+			while (read(watch_.fd(), &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count)))
+			{
+			}
+		}
+
+		service<Type>   &service_;
+		acc_sensor_id_t sensor_;
+		fd_watch        watch_;
+};
+
+
+}
+
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,95 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_FILTER_PERCENTILE_H_
+#define ACC_FILTER_PERCENTILE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Percentile_Filter Percentile Filter
+ *
+ * @brief Sliding window median and percentile filter over time for envelope data
+ *
+ * Each point of the sweep is filtered over the latest window_length sweeps, which removes
+ * impulsive interference and single sweep spikes that the exponential running average
+ * only smears out. The window of each point is kept as a max-heap of the values up to the
+ * percentile and a min-heap of the values above it, so the cost per point is O(log window_length)
+ * regardless of the signal. The state of all points is held in one contiguous block
+ * allocated at creation.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Maximum window length in sweeps
+ */
+#define ACC_FILTER_PERCENTILE_WINDOW_LENGTH_MAX 1024
+
+
+/**
+ * @brief Percentile filter handle
+ */
+typedef struct acc_filter_percentile_handle *acc_filter_percentile_handle_t;
+
+
+/**
+ * @brief Create a percentile filter
+ *
+ * @param[in] data_length Number of points in each sweep
+ * @param[in] window_length Number of sweeps in the window, 1 to ACC_FILTER_PERCENTILE_WINDOW_LENGTH_MAX
+ * @param[in] percentile The percentile 0 to 100 to output, 50 gives the median
+ * @return Filter handle, NULL if creation failed
+ */
+extern acc_filter_percentile_handle_t acc_filter_percentile_create(uint16_t data_length, uint16_t window_length,
+                                                                   uint8_t percentile);
+
+
+/**
+ * @brief Destroy a percentile filter
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] handle The filter handle to destroy, will be set to NULL
+ */
+extern void acc_filter_percentile_destroy(acc_filter_percentile_handle_t *handle);
+
+
+/**
+ * @brief Filter a sweep
+ *
+ * The window is filled with the first sweep after creation or reset.
+ *
+ * @param[in] handle The filter handle
+ * @param[in] input Sweep of data_length points
+ * @param[out] output Filtered sweep of data_length points, may be the same as input
+ * @return True if successful, false otherwise
+ */
+extern bool acc_filter_percentile_process(acc_filter_percentile_handle_t handle, const uint16_t *input, uint16_t *output);
+
+
+/**
+ * @brief Clear the window
+ *
+ * @param[in] handle The filter handle
+ */
+extern void acc_filter_percentile_reset(acc_filter_percentile_handle_t handle);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
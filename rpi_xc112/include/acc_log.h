@@ -38,6 +38,13 @@
 #define PRINTF_ATTRIBUTE_CHECK(a, b)
 #endif
 
+/**
+ * @brief Perform any init of log module
+ *
+ * Called by acc_log if needed, call it during setup to keep allocations out of steady state.
+ */
+extern void acc_log_init(void);
+
 extern void acc_log(acc_log_level_t level, const char *module, const char *format, ...) PRINTF_ATTRIBUTE_CHECK(3, 4);
 
 #endif
@@ -0,0 +1,211 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_OCCUPANCY_GRID_H_
+#define ACC_OCCUPANCY_GRID_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_detector_obstacle_processing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Occupancy_Grid Occupancy Grid
+ *
+ * @brief Local 2-D occupancy map built from obstacle detector output
+ *
+ * Obstacles from acc_detector_obstacle_get_next are placed in the plane from the platform
+ * pose, their distance and the angle given by their radial velocity and the platform speed.
+ * The obstacles are taken as stationary, so one at an angle from the direction of travel
+ * approaches the sensor at speed * cos(angle), radial velocities are positive towards the
+ * sensor. The cells along the ray from the sensor to each obstacle are updated towards free
+ * and the cell of the obstacle towards occupied.
+ *
+ * Cells hold saturating int8 log-odds. The grid is stored in tiles of 16 x 16 cells so a ray
+ * touches few cache lines, and the tiles are indexed modulo the grid size so the map can
+ * follow a moving platform: recentering only clears the tiles that scroll in. Memory is
+ * one byte per cell and the update time is proportional to the ray lengths in cells.
+ *
+ * The pose and speed are converted to fixed point once per update. The obstacles are then
+ * placed with integer math only: the cosine of the angle is the ratio of radial velocity and
+ * speed in Q15, the sine its integer square root complement, and positions are in cells with
+ * 8 fraction bits.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Occupancy grid configuration
+ */
+typedef struct
+{
+	/** Side length of a cell */
+	float    cell_size_m;
+	/** Width of the grid in cells, rounded up to whole tiles */
+	uint16_t width_cells;
+	/** Height of the grid in cells, rounded up to whole tiles */
+	uint16_t height_cells;
+	/** Log-odds added to the cell of an obstacle */
+	int8_t   hit_log_odds;
+	/** Log-odds added to the cells between the sensor and an obstacle, negative */
+	int8_t   miss_log_odds;
+	/** Lower limit of the log-odds of a cell */
+	int8_t   min_log_odds;
+	/** Upper limit of the log-odds of a cell */
+	int8_t   max_log_odds;
+	/** True if the sensor faces the right side of the direction of travel, false for the left side */
+	bool     right_side;
+} acc_occupancy_grid_configuration_t;
+
+
+/**
+ * @brief Platform pose in map coordinates
+ */
+typedef struct
+{
+	float x_m;
+	float y_m;
+	/** Direction of travel, counterclockwise from the x axis */
+	float heading_rad;
+} acc_occupancy_grid_pose_t;
+
+
+/**
+ * @brief Occupancy grid metadata
+ */
+typedef struct
+{
+	/** Map x coordinate of the first column */
+	float    origin_x_m;
+	/** Map y coordinate of the first row */
+	float    origin_y_m;
+	float    cell_size_m;
+	uint16_t width_cells;
+	uint16_t height_cells;
+} acc_occupancy_grid_metadata_t;
+
+
+/**
+ * @brief Occupancy grid handle
+ */
+typedef struct acc_occupancy_grid_handle *acc_occupancy_grid_handle_t;
+
+
+/**
+ * @brief Get the default configuration, a 12.8 m square grid of 5 cm cells
+ *
+ * @param[out] configuration The default configuration
+ */
+extern void acc_occupancy_grid_configuration_default(acc_occupancy_grid_configuration_t *configuration);
+
+
+/**
+ * @brief Create an occupancy grid centered on the map origin, with all cells unknown
+ *
+ * @param[in] configuration The configuration
+ * @return Occupancy grid handle, NULL if creation failed
+ */
+extern acc_occupancy_grid_handle_t acc_occupancy_grid_create(const acc_occupancy_grid_configuration_t *configuration);
+
+
+/**
+ * @brief Destroy an occupancy grid
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] handle The handle to destroy, will be set to NULL
+ */
+extern void acc_occupancy_grid_destroy(acc_occupancy_grid_handle_t *handle);
+
+
+/**
+ * @brief Convert the radial velocities of a batch of obstacles to angles
+ *
+ * The angle is counted from the direction of travel towards the side the sensor faces,
+ * from 0 for an obstacle ahead to 180 degrees for an obstacle behind.
+ *
+ * @param[in] handle The handle
+ * @param[in] speed The platform speed
+ * @param[in] obstacles The obstacles
+ * @param[in] count Number of obstacles
+ * @param[out] degrees count angles
+ * @return True if successful, false if the speed is zero and the angles are unknown
+ */
+extern bool acc_occupancy_grid_angles_get(acc_occupancy_grid_handle_t handle, float speed, const acc_obstacle_t *obstacles,
+                                          uint16_t count, float *degrees);
+
+
+/**
+ * @brief Fuse obstacles into the grid
+ *
+ * The angles of the obstacles are unknown when the platform is not moving, the grid is then
+ * left unchanged. Rays that leave the grid are cut at its border.
+ *
+ * @param[in] handle The handle
+ * @param[in] pose The pose of the platform when the obstacles were detected
+ * @param[in] speed The platform speed
+ * @param[in] obstacle_data Obstacles from acc_detector_obstacle_get_next
+ * @return True if successful, false otherwise
+ */
+extern bool acc_occupancy_grid_update(acc_occupancy_grid_handle_t handle, const acc_occupancy_grid_pose_t *pose, float speed,
+                                      const acc_detector_obstacle_t *obstacle_data);
+
+
+/**
+ * @brief Move the grid to be centered near a position
+ *
+ * The grid moves in whole tiles. Cells that stay inside the grid are kept, cells that
+ * enter it are unknown.
+ *
+ * @param[in] handle The handle
+ * @param[in] x_m Map x coordinate
+ * @param[in] y_m Map y coordinate
+ */
+extern void acc_occupancy_grid_recenter(acc_occupancy_grid_handle_t handle, float x_m, float y_m);
+
+
+/**
+ * @brief Get occupancy grid metadata
+ *
+ * @param[in] handle The handle
+ * @param[out] metadata Metadata results are provided in this parameter
+ */
+extern void acc_occupancy_grid_get_metadata(acc_occupancy_grid_handle_t handle, acc_occupancy_grid_metadata_t *metadata);
+
+
+/**
+ * @brief Get the log-odds of the cell at a position
+ *
+ * @param[in] handle The handle
+ * @param[in] x_m Map x coordinate
+ * @param[in] y_m Map y coordinate
+ * @return Log-odds of the cell, 0 if the position is outside the grid
+ */
+extern int8_t acc_occupancy_grid_log_odds_get(acc_occupancy_grid_handle_t handle, float x_m, float y_m);
+
+
+/**
+ * @brief Copy the grid as rows of log-odds
+ *
+ * @param[in] handle The handle
+ * @param[out] cells width_cells * height_cells log-odds, row by row from the origin
+ */
+extern void acc_occupancy_grid_copy(acc_occupancy_grid_handle_t handle, int8_t *cells);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1056 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_RSS_HPP_
+#define ACC_RSS_HPP_
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus > 201703L && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#endif
+#endif
+
+extern "C" {
+#include "acc_definitions.h"
+#include "acc_detector_distance_basic.h"
+#include "acc_detector_distance_peak.h"
+#include "acc_detector_presence.h"
+#include "acc_hal_definitions.h"
+#include "acc_rss.h"
+#include "acc_service.h"
+#include "acc_service_envelope.h"
+#include "acc_service_iq.h"
+#include "acc_service_power_bins.h"
+#include "acc_service_sparse.h"
+}
+
+
+/**
+ * @defgroup Cpp C++ API
+ *
+ * @brief Header-only C++17 wrapper over the RSS, service and detector APIs
+ *
+ * RSS activation, configurations, services and detectors are move-only types that release
+ * their handle when they go out of scope, a service is deactivated before it is destroyed.
+ * Creation can fail like in the C API, each type converts to false when it holds no handle.
+ *
+ * Services are templated on the service type, acc::envelope, acc::iq, acc::iq_int16,
+ * acc::power_bins or acc::sparse, which gives the element type of the data. A service can
+ * only be created from a configuration of the same type, and get_next only takes buffers of
+ * the right element type. get_next_by_reference returns a view of the buffer of the service
+ * without copying, valid until the next call, and for_each hands each sweep to a callable
+ * without allocating.
+ *
+ * @code
+ * acc::rss rss(hal);
+ * acc::configuration<acc::envelope> configuration;
+ *
+ * configuration.sensor(1).range(0.2f, 0.5f).update_rate(100.0f);
+ *
+ * acc::service<acc::envelope> service(configuration);
+ *
+ * if (!rss || !service || !service.activate())
+ * {
+ *         return EXIT_FAILURE;
+ * }
+ *
+ * service.for_each([&](acc::span<const uint16_t> envelope, const acc_service_envelope_result_info_t &)
+ * {
+ *         return process(envelope);
+ * });
+ * @endcode
+ *
+ * The obstacle detector is not wrapped, its headers use the C99 complex type.
+ *
+ * @{
+ */
+
+
+namespace acc
+{
+
+
+#if defined(__cpp_lib_span)
+
+template<typename T>
+using span = std::span<T>;
+
+#else
+
+/**
+ * @brief Non-owning view of contiguous elements, std::span for C++17
+ */
+template<typename T>
+class span
+{
+	public:
+		using element_type = T;
+		using value_type   = std::remove_cv_t<T>;
+		using size_type    = std::size_t;
+		using pointer      = T *;
+		using reference    = T &;
+		using iterator     = T *;
+
+		constexpr span() noexcept = default;
+
+		constexpr span(T *data, size_type size) noexcept : data_(data), size_(size)
+		{
+		}
+
+		template<std::size_t N>
+		constexpr span(T (&array)[N]) noexcept : data_(array), size_(N)
+		{
+		}
+
+		template<typename Container,
+		         typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<Container &>().data()), T *> > >
+		constexpr span(Container &container) noexcept : data_(container.data()), size_(container.size())
+		{
+		}
+
+		template<typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]> > >
+		constexpr span(const span<U> &other) noexcept : data_(other.data()), size_(other.size())
+		{
+		}
+
+		constexpr pointer data() const noexcept
+		{
+			return data_;
+		}
+
+		constexpr size_type size() const noexcept
+		{
+			return size_;
+		}
+
+		constexpr bool empty() const noexcept
+		{
+			return size_ == 0;
+		}
+
+		constexpr reference operator[](size_type index) const noexcept
+		{
+			return data_[index];
+		}
+
+		constexpr iterator begin() const noexcept
+		{
+			return data_;
+		}
+
+		constexpr iterator end() const noexcept
+		{
+			return data_ + size_;
+		}
+
+		constexpr span first(size_type count) const noexcept
+		{
+			return span(data_, count);
+		}
+
+		constexpr span subspan(size_type offset, size_type count) const noexcept
+		{
+			return span(data_ + offset, count);
+		}
+
+	private:
+		T         *data_ = nullptr;
+		size_type size_  = 0;
+};
+
+#endif
+
+
+/**
+ * @brief Activation of RSS, deactivated when destroyed
+ */
+class rss
+{
+	public:
+		explicit rss(acc_hal_t &hal) : active_(acc_rss_activate(&hal))
+		{
+		}
+
+		~rss()
+		{
+			if (active_)
+			{
+				acc_rss_deactivate();
+			}
+		}
+
+		rss(rss &&other) noexcept : active_(std::exchange(other.active_, false))
+		{
+		}
+
+		rss &operator=(rss &&other) noexcept
+		{
+			std::swap(active_, other.active_);
+			return *this;
+		}
+
+		rss(const rss &)            = delete;
+		rss &operator=(const rss &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return active_;
+		}
+
+	private:
+		bool active_;
+};
+
+
+/**
+ * @brief Envelope service, amplitude of each distance
+ */
+struct envelope
+{
+	using element_type     = uint16_t;
+	using metadata_type    = acc_service_envelope_metadata_t;
+	using result_info_type = acc_service_envelope_result_info_t;
+
+	static acc_service_configuration_t configuration_create()
+	{
+		return acc_service_envelope_configuration_create();
+	}
+
+	static void configuration_destroy(acc_service_configuration_t *configuration)
+	{
+		acc_service_envelope_configuration_destroy(configuration);
+	}
+
+	static void get_metadata(acc_service_handle_t handle, metadata_type *metadata)
+	{
+		acc_service_envelope_get_metadata(handle, metadata);
+	}
+
+	static bool get_next(acc_service_handle_t handle, element_type *data, uint16_t length, result_info_type *result_info)
+	{
+		return acc_service_envelope_get_next(handle, data, length, result_info);
+	}
+
+	static bool get_next_by_reference(acc_service_handle_t handle, element_type **data, result_info_type *result_info)
+	{
+		return acc_service_envelope_get_next_by_reference(handle, data, result_info);
+	}
+
+	static uint16_t data_length(const metadata_type &metadata)
+	{
+		return metadata.data_length;
+	}
+};
+
+
+/**
+ * @brief IQ service with float complex output, which has no by-reference get_next
+ */
+struct iq
+{
+	using element_type     = std::complex<float>;
+	using metadata_type    = acc_service_iq_metadata_t;
+	using result_info_type = acc_service_iq_result_info_t;
+
+	static acc_service_configuration_t configuration_create()
+	{
+		acc_service_configuration_t configuration = acc_service_iq_configuration_create();
+
+		if (configuration != nullptr)
+		{
+			acc_service_iq_output_format_set(configuration, ACC_SERVICE_IQ_OUTPUT_FORMAT_FLOAT_COMPLEX);
+		}
+
+		return configuration;
+	}
+
+	static void configuration_destroy(acc_service_configuration_t *configuration)
+	{
+		acc_service_iq_configuration_destroy(configuration);
+	}
+
+	static void get_metadata(acc_service_handle_t handle, metadata_type *metadata)
+	{
+		acc_service_iq_get_metadata(handle, metadata);
+	}
+
+	static bool get_next(acc_service_handle_t handle, element_type *data, uint16_t length, result_info_type *result_info)
+	{
+		// std::complex<float> has the layout of the C99 float complex
+		return acc_service_iq_get_next(handle, data, length, result_info);
+	}
+
+	static uint16_t data_length(const metadata_type &metadata)
+	{
+		return metadata.data_length;
+	}
+};
+
+
+/**
+ * @brief IQ service with int16 complex output
+ */
+struct iq_int16
+{
+	using element_type     = acc_int16_complex_t;
+	using metadata_type    = acc_service_iq_metadata_t;
+	using result_info_type = acc_service_iq_result_info_t;
+
+	static acc_service_configuration_t configuration_create()
+	{
+		acc_service_configuration_t configuration = acc_service_iq_configuration_create();
+
+		if (configuration != nullptr)
+		{
+			acc_service_iq_output_format_set(configuration, ACC_SERVICE_IQ_OUTPUT_FORMAT_INT16_COMPLEX);
+		}
+
+		return configuration;
+	}
+
+	static void configuration_destroy(acc_service_configuration_t *configuration)
+	{
+		acc_service_iq_configuration_destroy(configuration);
+	}
+
+	static void get_metadata(acc_service_handle_t handle, metadata_type *metadata)
+	{
+		acc_service_iq_get_metadata(handle, metadata);
+	}
+
+	static bool get_next(acc_service_handle_t handle, element_type *data, uint16_t length, result_info_type *result_info)
+	{
+		return acc_service_iq_get_next(handle, data, length, result_info);
+	}
+
+	static bool get_next_by_reference(acc_service_handle_t handle, element_type **data, result_info_type *result_info)
+	{
+		return acc_service_iq_get_next_by_reference(handle, data, result_info);
+	}
+
+	static uint16_t data_length(const metadata_type &metadata)
+	{
+		return metadata.data_length;
+	}
+};
+
+
+/**
+ * @brief Power bins service, mean amplitude of each range bin
+ */
+struct power_bins
+{
+	using element_type     = uint16_t;
+	using metadata_type    = acc_service_power_bins_metadata_t;
+	using result_info_type = acc_service_power_bins_result_info_t;
+
+	static acc_service_configuration_t configuration_create()
+	{
+		return acc_service_power_bins_configuration_create();
+	}
+
+	static void configuration_destroy(acc_service_configuration_t *configuration)
+	{
+		acc_service_power_bins_configuration_destroy(configuration);
+	}
+
+	static void get_metadata(acc_service_handle_t handle, metadata_type *metadata)
+	{
+		acc_service_power_bins_get_metadata(handle, metadata);
+	}
+
+	static bool get_next(acc_service_handle_t handle, element_type *data, uint16_t length, result_info_type *result_info)
+	{
+		return acc_service_power_bins_get_next(handle, data, length, result_info);
+	}
+
+	static bool get_next_by_reference(acc_service_handle_t handle, element_type **data, result_info_type *result_info)
+	{
+		return acc_service_power_bins_get_next_by_reference(handle, data, result_info);
+	}
+
+	static uint16_t data_length(const metadata_type &metadata)
+	{
+		return metadata.bin_count;
+	}
+};
+
+
+/**
+ * @brief Sparse service, the sweeps of a frame one after another
+ */
+struct sparse
+{
+	using element_type     = uint16_t;
+	using metadata_type    = acc_service_sparse_metadata_t;
+	using result_info_type = acc_service_sparse_result_info_t;
+
+	static acc_service_configuration_t configuration_create()
+	{
+		return acc_service_sparse_configuration_create();
+	}
+
+	static void configuration_destroy(acc_service_configuration_t *configuration)
+	{
+		acc_service_sparse_configuration_destroy(configuration);
+	}
+
+	static void get_metadata(acc_service_handle_t handle, metadata_type *metadata)
+	{
+		acc_service_sparse_get_metadata(handle, metadata);
+	}
+
+	static bool get_next(acc_service_handle_t handle, element_type *data, uint16_t length, result_info_type *result_info)
+	{
+		return acc_service_sparse_get_next(handle, data, length, result_info);
+	}
+
+	static bool get_next_by_reference(acc_service_handle_t handle, element_type **data, result_info_type *result_info)
+	{
+		return acc_service_sparse_get_next_by_reference(handle, data, result_info);
+	}
+
+	static uint16_t data_length(const metadata_type &metadata)
+	{
+		return metadata.data_length;
+	}
+};
+
+
+/**
+ * @brief Service configuration of a service type, destroyed with it
+ *
+ * The common settings are chained, the settings of a service type are made with the C API
+ * on get().
+ */
+template<typename Type>
+class configuration
+{
+	public:
+		configuration() : configuration_(Type::configuration_create())
+		{
+		}
+
+		~configuration()
+		{
+			if (configuration_ != nullptr)
+			{
+				Type::configuration_destroy(&configuration_);
+			}
+		}
+
+		configuration(configuration &&other) noexcept : configuration_(std::exchange(other.configuration_, nullptr))
+		{
+		}
+
+		configuration &operator=(configuration &&other) noexcept
+		{
+			std::swap(configuration_, other.configuration_);
+			return *this;
+		}
+
+		configuration(const configuration &)            = delete;
+		configuration &operator=(const configuration &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return configuration_ != nullptr;
+		}
+
+		acc_service_configuration_t get() const noexcept
+		{
+			return configuration_;
+		}
+
+		configuration &sensor(acc_sensor_id_t sensor)
+		{
+			acc_service_sensor_set(configuration_, sensor);
+			return *this;
+		}
+
+		configuration &range(float start_m, float length_m)
+		{
+			acc_service_requested_start_set(configuration_, start_m);
+			acc_service_requested_length_set(configuration_, length_m);
+			return *this;
+		}
+
+		configuration &update_rate(float update_rate)
+		{
+			acc_service_repetition_mode_streaming_set(configuration_, update_rate);
+			return *this;
+		}
+
+		configuration &on_demand()
+		{
+			acc_service_repetition_mode_on_demand_set(configuration_);
+			return *this;
+		}
+
+		configuration &profile(acc_service_profile_t profile)
+		{
+			acc_service_profile_set(configuration_, profile);
+			return *this;
+		}
+
+		configuration &receiver_gain(float gain)
+		{
+			acc_service_receiver_gain_set(configuration_, gain);
+			return *this;
+		}
+
+		configuration &power_save_mode(acc_power_save_mode_t power_save_mode)
+		{
+			acc_service_power_save_mode_set(configuration_, power_save_mode);
+			return *this;
+		}
+
+	private:
+		acc_service_configuration_t configuration_;
+};
+
+
+/**
+ * @brief Service of a service type, deactivated and destroyed with it
+ */
+template<typename Type>
+class service
+{
+	public:
+		using element_type     = typename Type::element_type;
+		using metadata_type    = typename Type::metadata_type;
+		using result_info_type = typename Type::result_info_type;
+
+		explicit service(const configuration<Type> &configuration) : handle_(nullptr), metadata_()
+		{
+			if (configuration)
+			{
+				handle_ = acc_service_create(configuration.get());
+			}
+
+			if (handle_ != nullptr)
+			{
+				Type::get_metadata(handle_, &metadata_);
+			}
+		}
+
+		~service()
+		{
+			if (handle_ != nullptr)
+			{
+				if (active_)
+				{
+					acc_service_deactivate(handle_);
+				}
+
+				acc_service_destroy(&handle_);
+			}
+		}
+
+		service(service &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)), metadata_(other.metadata_),
+			active_(std::exchange(other.active_, false))
+		{
+		}
+
+		service &operator=(service &&other) noexcept
+		{
+			std::swap(handle_, other.handle_);
+			std::swap(metadata_, other.metadata_);
+			std::swap(active_, other.active_);
+			return *this;
+		}
+
+		service(const service &)            = delete;
+		service &operator=(const service &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return handle_ != nullptr;
+		}
+
+		acc_service_handle_t get() const noexcept
+		{
+			return handle_;
+		}
+
+		const metadata_type &metadata() const noexcept
+		{
+			return metadata_;
+		}
+
+		/**
+		 * @brief Number of elements of each result
+		 */
+		std::size_t data_length() const noexcept
+		{
+			return Type::data_length(metadata_);
+		}
+
+		bool activate()
+		{
+			if (!active_)
+			{
+				active_ = acc_service_activate(handle_);
+			}
+
+			return active_;
+		}
+
+		bool deactivate()
+		{
+			if (active_)
+			{
+				active_ = !acc_service_deactivate(handle_);
+			}
+
+			return !active_;
+		}
+
+		/**
+		 * @brief Copy the next result into a buffer of at least data_length elements
+		 *
+		 * @return The part of the buffer holding the result, empty on failure
+		 */
+		span<element_type> get_next(span<element_type> buffer, result_info_type *result_info = nullptr)
+		{
+			std::size_t length = data_length();
+
+			if (buffer.size() < length || !Type::get_next(handle_, buffer.data(), static_cast<uint16_t>(length), result_info))
+			{
+				return span<element_type>();
+			}
+
+			return buffer.first(length);
+		}
+
+		/**
+		 * @brief View the next result in the buffer of the service, valid until the next call
+		 *
+		 * @return The result, empty on failure
+		 */
+		span<const element_type> get_next_by_reference(result_info_type *result_info = nullptr)
+		{
+			static_assert(has_get_next_by_reference<Type>::value, "The service type has no by-reference get_next");
+
+			element_type *data = nullptr;
+
+			if (!Type::get_next_by_reference(handle_, &data, result_info) || data == nullptr)
+			{
+				return span<const element_type>();
+			}
+
+			return span<const element_type>(data, data_length());
+		}
+
+		/**
+		 * @brief Hand each result to a callable until it returns false or get_next fails
+		 *
+		 * The callable is called with span<const element_type> and const result_info_type &.
+		 * Results are viewed by reference, or copied into the given buffer for service types
+		 * without a by-reference get_next. Nothing is allocated.
+		 *
+		 * @return False if get_next failed, true if the callable stopped the loop
+		 */
+		template<typename Process>
+		bool for_each(Process &&process, span<element_type> buffer = span<element_type>())
+		{
+			static_assert(std::is_invocable_r_v<bool, Process &, span<const element_type>, const result_info_type &>,
+			              "The callable must take the result and the result info and return bool");
+
+			result_info_type result_info;
+
+			for (;;)
+			{
+				span<const element_type> data;
+
+				if constexpr (has_get_next_by_reference<Type>::value)
+				{
+					(void)buffer;
+					data = get_next_by_reference(&result_info);
+				}
+				else
+				{
+					data = get_next(buffer, &result_info);
+				}
+
+				if (data.empty())
+				{
+					return false;
+				}
+
+				if (!process(data, static_cast<const result_info_type &>(result_info)))
+				{
+					return true;
+				}
+			}
+		}
+
+	private:
+		template<typename T, typename = void>
+		struct has_get_next_by_reference : std::false_type
+		{
+		};
+
+		template<typename T>
+		struct has_get_next_by_reference<T, std::void_t<decltype(&T::get_next_by_reference)> > : std::true_type
+		{
+		};
+
+		acc_service_handle_t handle_;
+		metadata_type        metadata_;
+		bool                 active_ = false;
+};
+
+
+/**
+ * @brief Configuration of the distance peak detector
+ */
+class distance_peak_configuration
+{
+	public:
+		distance_peak_configuration() : configuration_(acc_detector_distance_peak_configuration_create())
+		{
+		}
+
+		~distance_peak_configuration()
+		{
+			if (configuration_ != nullptr)
+			{
+				acc_detector_distance_peak_configuration_destroy(&configuration_);
+			}
+		}
+
+		distance_peak_configuration(distance_peak_configuration &&other) noexcept :
+			configuration_(std::exchange(other.configuration_, nullptr))
+		{
+		}
+
+		distance_peak_configuration &operator=(distance_peak_configuration &&other) noexcept
+		{
+			std::swap(configuration_, other.configuration_);
+			return *this;
+		}
+
+		distance_peak_configuration(const distance_peak_configuration &)            = delete;
+		distance_peak_configuration &operator=(const distance_peak_configuration &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return configuration_ != nullptr;
+		}
+
+		acc_detector_distance_peak_configuration_t get() const noexcept
+		{
+			return configuration_;
+		}
+
+	private:
+		acc_detector_distance_peak_configuration_t configuration_;
+};
+
+
+/**
+ * @brief Distance peak detector, deactivated and destroyed with it
+ */
+class distance_peak
+{
+	public:
+		using reflection_type  = acc_detector_distance_peak_reflection_t;
+		using result_info_type = acc_detector_distance_peak_result_info_t;
+
+		explicit distance_peak(const distance_peak_configuration &configuration) : handle_(nullptr)
+		{
+			if (configuration)
+			{
+				handle_ = acc_detector_distance_peak_create(configuration.get());
+			}
+		}
+
+		~distance_peak()
+		{
+			if (handle_ != nullptr)
+			{
+				if (active_)
+				{
+					acc_detector_distance_peak_deactivate(handle_);
+				}
+
+				acc_detector_distance_peak_destroy(&handle_);
+			}
+		}
+
+		distance_peak(distance_peak &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)),
+			active_(std::exchange(other.active_, false))
+		{
+		}
+
+		distance_peak &operator=(distance_peak &&other) noexcept
+		{
+			std::swap(handle_, other.handle_);
+			std::swap(active_, other.active_);
+			return *this;
+		}
+
+		distance_peak(const distance_peak &)            = delete;
+		distance_peak &operator=(const distance_peak &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return handle_ != nullptr;
+		}
+
+		acc_detector_distance_peak_handle_t get() const noexcept
+		{
+			return handle_;
+		}
+
+		bool activate()
+		{
+			if (!active_)
+			{
+				active_ = acc_detector_distance_peak_activate(handle_);
+			}
+
+			return active_;
+		}
+
+		bool deactivate()
+		{
+			if (active_)
+			{
+				active_ = !acc_detector_distance_peak_deactivate(handle_);
+			}
+
+			return !active_;
+		}
+
+		/**
+		 * @brief Get the next reflections
+		 *
+		 * @return The part of the buffer holding the reflections found, empty if none or on failure
+		 */
+		span<reflection_type> get_next(span<reflection_type> reflections, result_info_type *result_info = nullptr)
+		{
+			result_info_type info;
+			uint16_t         count = static_cast<uint16_t>(reflections.size());
+
+			if (!acc_detector_distance_peak_get_next(handle_, reflections.data(), &count,
+			                                         result_info != nullptr ? result_info : &info))
+			{
+				return span<reflection_type>();
+			}
+
+			return reflections.first(count);
+		}
+
+	private:
+		acc_detector_distance_peak_handle_t handle_;
+		bool                                active_ = false;
+};
+
+
+/**
+ * @brief Configuration of the presence detector
+ */
+class presence_configuration
+{
+	public:
+		presence_configuration() : configuration_(acc_detector_presence_configuration_create())
+		{
+		}
+
+		~presence_configuration()
+		{
+			if (configuration_ != nullptr)
+			{
+				acc_detector_presence_configuration_destroy(&configuration_);
+			}
+		}
+
+		presence_configuration(presence_configuration &&other) noexcept :
+			configuration_(std::exchange(other.configuration_, nullptr))
+		{
+		}
+
+		presence_configuration &operator=(presence_configuration &&other) noexcept
+		{
+			std::swap(configuration_, other.configuration_);
+			return *this;
+		}
+
+		presence_configuration(const presence_configuration &)            = delete;
+		presence_configuration &operator=(const presence_configuration &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return configuration_ != nullptr;
+		}
+
+		acc_detector_presence_configuration_t get() const noexcept
+		{
+			return configuration_;
+		}
+
+	private:
+		acc_detector_presence_configuration_t configuration_;
+};
+
+
+/**
+ * @brief Presence detector, deactivated and destroyed with it
+ */
+class presence
+{
+	public:
+		using result_type = acc_detector_presence_result_t;
+
+		explicit presence(const presence_configuration &configuration) : handle_(nullptr)
+		{
+			if (configuration)
+			{
+				handle_ = acc_detector_presence_create(configuration.get());
+			}
+		}
+
+		~presence()
+		{
+			if (handle_ != nullptr)
+			{
+				if (active_)
+				{
+					acc_detector_presence_deactivate(handle_);
+				}
+
+				acc_detector_presence_destroy(&handle_);
+			}
+		}
+
+		presence(presence &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)),
+			active_(std::exchange(other.active_, false))
+		{
+		}
+
+		presence &operator=(presence &&other) noexcept
+		{
+			std::swap(handle_, other.handle_);
+			std::swap(active_, other.active_);
+			return *this;
+		}
+
+		presence(const presence &)            = delete;
+		presence &operator=(const presence &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return handle_ != nullptr;
+		}
+
+		acc_detector_presence_handle_t get() const noexcept
+		{
+			return handle_;
+		}
+
+		bool activate()
+		{
+			if (!active_)
+			{
+				active_ = acc_detector_presence_activate(handle_);
+			}
+
+			return active_;
+		}
+
+		bool deactivate()
+		{
+			if (active_)
+			{
+				active_ = !acc_detector_presence_deactivate(handle_);
+			}
+
+			return !active_;
+		}
+
+		bool get_next(result_type &result)
+		{
+			return acc_detector_presence_get_next(handle_, &result);
+		}
+
+	private:
+		acc_detector_presence_handle_t handle_;
+		bool                           active_ = false;
+};
+
+
+/**
+ * @brief Distance basic detector, destroyed with it
+ */
+class distance_basic
+{
+	public:
+		using reflection_type = acc_detector_distance_basic_reflection_t;
+
+		distance_basic(acc_sensor_id_t sensor, float range_start_m, float range_length_m) :
+			handle_(acc_detector_distance_basic_create(sensor, range_start_m, range_length_m))
+		{
+		}
+
+		~distance_basic()
+		{
+			if (handle_ != nullptr)
+			{
+				acc_detector_distance_basic_destroy(&handle_);
+			}
+		}
+
+		distance_basic(distance_basic &&other) noexcept : handle_(std::exchange(other.handle_, nullptr))
+		{
+		}
+
+		distance_basic &operator=(distance_basic &&other) noexcept
+		{
+			std::swap(handle_, other.handle_);
+			return *this;
+		}
+
+		distance_basic(const distance_basic &)            = delete;
+		distance_basic &operator=(const distance_basic &) = delete;
+
+		explicit operator bool() const noexcept
+		{
+			return handle_ != nullptr;
+		}
+
+		acc_detector_distance_basic_handle_t get() const noexcept
+		{
+			return handle_;
+		}
+
+		bool median_filter(uint16_t window_length)
+		{
+			return acc_detector_distance_basic_median_filter_set(handle_, window_length);
+		}
+
+		reflection_type get_reflection()
+		{
+			return acc_detector_distance_basic_get_reflection(handle_);
+		}
+
+	private:
+		acc_detector_distance_basic_handle_t handle_;
+};
+
+
+}
+
+
+/**
+ * @}
+ */
+
+#endif
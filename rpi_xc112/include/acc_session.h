@@ -0,0 +1,155 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_SESSION_H_
+#define ACC_SESSION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions.h"
+#include "acc_service.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Session Multi-sensor Session
+ *
+ * @brief Bring up the services of several sensors at once
+ *
+ * Creating and activating a service powers up and calibrates its sensor, which mostly is
+ * waiting for the sensor. A session creates and activates the services of all its sensors in
+ * a thread per sensor, so that the waits of the sensors overlap and the startup takes about
+ * as long as for the slowest sensor. The sensors share the SPI bus, which the board locks for
+ * each transfer, and the board power, which the board locks when a sensor is started or
+ * stopped.
+ *
+ * RSS keeps the state of a service in its handle and reaches the sensor only through the HAL,
+ * whose functions take the sensor as argument. The calls of different sensors therefore only
+ * meet in the HAL, which this board makes safe to call for different sensors at once: the SPI
+ * bus is locked per transfer, the power sequencing under a mutex, each sensor has its own
+ * interrupt semaphore, and the allocator and the log are thread safe. This is the same
+ * property that lets an application run get_next for each sensor in its own thread. A session
+ * never calls RSS concurrently for the same sensor.
+ *
+ * The timeline of each sensor, when its service was created and activated and how much of
+ * the time it transferred or waited for the bus, is kept for acc_session_print_timeline.
+ *
+ * RSS must be activated before a session is created.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Maximum number of sensors of a session
+ */
+#define ACC_SESSION_SENSOR_COUNT_MAX 4
+
+
+/**
+ * @brief Bring-up of one sensor, the times are from the start of acc_session_create
+ */
+typedef struct
+{
+	acc_sensor_id_t sensor;
+	/** True if the service was created and activated */
+	bool            success;
+	uint32_t        create_start_us;
+	uint32_t        create_end_us;
+	uint32_t        activate_start_us;
+	uint32_t        activate_end_us;
+	/** Number of SPI transfers to the sensor during the bring-up */
+	uint32_t        transfer_count;
+	/** Time of the transfers in the SPI driver */
+	uint32_t        transfer_time_us;
+	/** Time waiting for the SPI bus while other sensors transferred */
+	uint32_t        bus_wait_us;
+} acc_session_timeline_t;
+
+
+/**
+ * @brief Session handle
+ */
+typedef struct acc_session *acc_session_t;
+
+
+/**
+ * @brief Create and activate a service for each configuration
+ *
+ * The sensor of each service is the sensor of its configuration, the sensors must differ.
+ * When a service can not be created or activated, the services of the other sensors are
+ * deactivated and destroyed, and NULL is returned.
+ *
+ * @param[in] configurations The service configurations, of any service type, each for a sensor of the board
+ * @param[in] count The number of configurations, at most ACC_SESSION_SENSOR_COUNT_MAX
+ * @param[in] parallel False to bring up the sensors one after another
+ * @return Session handle, NULL if any sensor could not be brought up
+ */
+extern acc_session_t acc_session_create(const acc_service_configuration_t *configurations, uint_fast8_t count,
+                                        bool parallel);
+
+
+/**
+ * @brief Deactivate and destroy the services and the session
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] session The session to destroy, will be set to NULL
+ */
+extern void acc_session_destroy(acc_session_t *session);
+
+
+/**
+ * @brief Get the service of a sensor of the session
+ *
+ * @param[in] session The session
+ * @param[in] index The index of the configuration given to acc_session_create
+ * @return The activated service
+ */
+extern acc_service_handle_t acc_session_get_service(acc_session_t session, uint_fast8_t index);
+
+
+/**
+ * @brief Get the bring-up timeline of a sensor of the session
+ *
+ * @param[in] session The session
+ * @param[in] index The index of the configuration given to acc_session_create
+ * @param[out] timeline The timeline
+ */
+extern void acc_session_get_timeline(acc_session_t session, uint_fast8_t index, acc_session_timeline_t *timeline);
+
+
+/**
+ * @brief Get the time from the start of acc_session_create until all sensors were activated
+ *
+ * @param[in] session The session
+ * @return The startup time in microseconds
+ */
+extern uint32_t acc_session_get_startup_time_us(acc_session_t session);
+
+
+/**
+ * @brief Print the timeline of each sensor of the session
+ *
+ * A row per sensor with the times of the create and activate phases, the transfer and bus wait
+ * times, and a bar of the phases on a common time axis.
+ *
+ * @param[in] session The session
+ */
+extern void acc_session_print_timeline(acc_session_t session);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_SLIDING_DFT_H_
+#define ACC_SLIDING_DFT_H_
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Sliding_DFT Sliding DFT
+ *
+ * @brief Spectra over a long window of sweeps, per range bin, updated with every sweep
+ *
+ * For slow motion such as breathing, each range bin is a signal over time sampled at the sweep
+ * rate. The sliding DFT keeps the DFT of the latest window_length sweeps for a few frequency
+ * bins of interest, for every range bin. Each sweep updates each frequency bin with the
+ * difference between the new sample and the sample leaving the window, so the cost per sweep
+ * does not depend on the window length. Bin k of the window is the frequency
+ * k * update_rate / window_length Hz.
+ *
+ * The sums are kept with the phase of absolute time, Goertzel style, so the rounding errors
+ * only add up instead of being rotated and scaled every sweep. They are still float sums
+ * updated forever, so every range bin is periodically re-anchored: its sums are recomputed
+ * exactly from the window of sweeps. The cost of re-anchoring is spread over the sweeps.
+ *
+ * The sums of one frequency bin are contiguous over the range bins, so the update of a sweep
+ * is a few loops over the range bins with the same twiddle factor, which the compiler
+ * vectorizes.
+ *
+ * The window of sweeps is kept, 2 bytes per point for envelope and 8 bytes per point for IQ.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Maximum number of frequency bins
+ */
+#define ACC_SLIDING_DFT_FREQUENCY_BINS_MAX 32
+
+
+/**
+ * @brief Input types
+ */
+typedef enum
+{
+	ACC_SLIDING_DFT_INPUT_ENVELOPE,
+	ACC_SLIDING_DFT_INPUT_IQ
+} acc_sliding_dft_input_enum_t;
+typedef uint32_t acc_sliding_dft_input_t;
+
+
+/**
+ * @brief Sliding DFT configuration
+ */
+typedef struct
+{
+	/** Type of the sweeps */
+	acc_sliding_dft_input_t input;
+	/** Number of points in each sweep */
+	uint16_t                data_length;
+	/** Number of sweeps in the window */
+	uint16_t                window_length;
+	/** The frequency bins of interest, each less than window_length */
+	uint16_t                frequency_bins[ACC_SLIDING_DFT_FREQUENCY_BINS_MAX];
+	/** Number of frequency bins */
+	uint8_t                 frequency_bin_count;
+	/** Number of sweeps in which every range bin is re-anchored once, 0 to never re-anchor */
+	uint16_t                reanchor_interval;
+} acc_sliding_dft_configuration_t;
+
+
+/**
+ * @brief Sliding DFT handle
+ */
+typedef struct acc_sliding_dft_handle *acc_sliding_dft_handle_t;
+
+
+/**
+ * @brief Create a sliding DFT
+ *
+ * @param[in] configuration The configuration
+ * @return Sliding DFT handle, NULL if creation failed
+ */
+extern acc_sliding_dft_handle_t acc_sliding_dft_create(const acc_sliding_dft_configuration_t *configuration);
+
+
+/**
+ * @brief Destroy a sliding DFT
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] handle The handle to destroy, will be set to NULL
+ */
+extern void acc_sliding_dft_destroy(acc_sliding_dft_handle_t *handle);
+
+
+/**
+ * @brief Process an envelope sweep
+ *
+ * @param[in] handle The handle, created for envelope input
+ * @param[in] data Sweep of data_length points
+ * @return True if successful, false otherwise
+ */
+extern bool acc_sliding_dft_process_envelope(acc_sliding_dft_handle_t handle, const uint16_t *data);
+
+
+/**
+ * @brief Process an IQ sweep
+ *
+ * @param[in] handle The handle, created for IQ input
+ * @param[in] data Sweep of data_length points
+ * @return True if successful, false otherwise
+ */
+extern bool acc_sliding_dft_process_iq(acc_sliding_dft_handle_t handle, const float complex *data);
+
+
+/**
+ * @brief Process an IQ sweep from acc_service_iq_get_next_by_reference
+ *
+ * @param[in] handle The handle, created for IQ input
+ * @param[in] data Sweep of data_length points
+ * @return True if successful, false otherwise
+ */
+extern bool acc_sliding_dft_process_iq_int16(acc_sliding_dft_handle_t handle, const acc_int16_complex_t *data);
+
+
+/**
+ * @brief Get the spectrum of a frequency bin for all range bins
+ *
+ * The spectrum is normalized by the window length and its phase is relative to the oldest
+ * sweep of the window.
+ *
+ * @param[in] handle The handle
+ * @param[in] frequency_bin_index Index of the frequency bin in the configuration
+ * @param[out] spectrum data_length values
+ * @return True if successful, false if the index is invalid or the window is not yet full
+ */
+extern bool acc_sliding_dft_get_spectrum(acc_sliding_dft_handle_t handle, uint8_t frequency_bin_index, float complex *spectrum);
+
+
+/**
+ * @brief Get the magnitude of a frequency bin for all range bins
+ *
+ * The magnitude is normalized by the window length, a sinusoid of amplitude a at the bin
+ * frequency gives a / 2.
+ *
+ * @param[in] handle The handle
+ * @param[in] frequency_bin_index Index of the frequency bin in the configuration
+ * @param[out] magnitude data_length values
+ * @return True if successful, false if the index is invalid or the window is not yet full
+ */
+extern bool acc_sliding_dft_get_magnitude(acc_sliding_dft_handle_t handle, uint8_t frequency_bin_index, float *magnitude);
+
+
+/**
+ * @brief Empty the window, the next sweep starts a new one
+ *
+ * @param[in] handle The handle
+ */
+extern void acc_sliding_dft_reset(acc_sliding_dft_handle_t handle);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
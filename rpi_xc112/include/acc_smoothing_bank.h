@@ -0,0 +1,165 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_SMOOTHING_BANK_H_
+#define ACC_SMOOTHING_BANK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Smoothing_Bank Smoothing Bank
+ *
+ * @brief Several smoothing levels of envelope data computed from one acquisition
+ *
+ * The running average of the envelope service is fixed per service, so consumers that want
+ * different amounts of smoothing would need separate services and sweeps. The smoothing bank
+ * instead applies a set of fixed point exponential and boxcar smoothers with different time
+ * constants to each raw sweep. The state of all levels is interleaved per point so a sweep is
+ * smoothed at every level in a single pass. Consumers subscribe to the level they need and
+ * are called with its output after each sweep.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Maximum number of smoothing levels
+ */
+#define ACC_SMOOTHING_BANK_LEVELS_MAX 8
+
+/**
+ * @brief Maximum number of subscribers
+ */
+#define ACC_SMOOTHING_BANK_SUBSCRIBERS_MAX 8
+
+/**
+ * @brief Maximum boxcar length in sweeps
+ */
+#define ACC_SMOOTHING_BANK_BOXCAR_LENGTH_MAX 256
+
+
+/**
+ * @brief Smoother types
+ */
+typedef enum
+{
+	/** Exponential smoothing, y += (x - y) / length */
+	ACC_SMOOTHING_BANK_EXPONENTIAL,
+	/** Mean of the latest length sweeps */
+	ACC_SMOOTHING_BANK_BOXCAR
+} acc_smoothing_bank_type_enum_t;
+typedef uint32_t acc_smoothing_bank_type_t;
+
+
+/**
+ * @brief Smoothing level configuration
+ */
+typedef struct
+{
+	/** Type of smoother */
+	acc_smoothing_bank_type_t type;
+	/** Time constant in sweeps for exponential smoothing, window length in sweeps for boxcar */
+	uint16_t                  length;
+} acc_smoothing_bank_level_t;
+
+
+/**
+ * @brief Smoothing bank handle
+ */
+typedef struct acc_smoothing_bank_handle *acc_smoothing_bank_handle_t;
+
+
+/**
+ * @brief Callback with the output of a smoothing level
+ *
+ * The data is valid until the next sweep is processed.
+ *
+ * @param[in] data Smoothed sweep
+ * @param[in] data_length Number of points in the sweep
+ * @param[in] client_data The client data given when subscribing
+ */
+typedef void (*acc_smoothing_bank_callback_t)(const uint16_t *data, uint16_t data_length, void *client_data);
+
+
+/**
+ * @brief Create a smoothing bank
+ *
+ * @param[in] data_length Number of points in each sweep
+ * @param[in] levels Configuration of each level
+ * @param[in] level_count Number of levels, at most ACC_SMOOTHING_BANK_LEVELS_MAX
+ * @return Smoothing bank handle, NULL if creation failed
+ */
+extern acc_smoothing_bank_handle_t acc_smoothing_bank_create(uint16_t data_length, const acc_smoothing_bank_level_t *levels,
+                                                             uint8_t level_count);
+
+
+/**
+ * @brief Destroy a smoothing bank
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] handle The handle to destroy, will be set to NULL
+ */
+extern void acc_smoothing_bank_destroy(acc_smoothing_bank_handle_t *handle);
+
+
+/**
+ * @brief Subscribe to the output of a smoothing level
+ *
+ * @param[in] handle The handle
+ * @param[in] level Index of the level
+ * @param[in] callback Called with the output of the level after each processed sweep
+ * @param[in] client_data Passed to the callback
+ * @return True if successful, false otherwise
+ */
+extern bool acc_smoothing_bank_subscribe(acc_smoothing_bank_handle_t handle, uint8_t level, acc_smoothing_bank_callback_t callback,
+                                         void *client_data);
+
+
+/**
+ * @brief Process a raw sweep
+ *
+ * All levels are updated and the subscribers are called. The smoothers start from the first
+ * sweep after creation or reset.
+ *
+ * @param[in] handle The handle
+ * @param[in] data Raw sweep of data_length points
+ * @return True if successful, false otherwise
+ */
+extern bool acc_smoothing_bank_process(acc_smoothing_bank_handle_t handle, const uint16_t *data);
+
+
+/**
+ * @brief Get the latest output of a smoothing level
+ *
+ * @param[in] handle The handle
+ * @param[in] level Index of the level
+ * @return The smoothed sweep, valid until the next sweep is processed, NULL if level is invalid
+ */
+extern const uint16_t *acc_smoothing_bank_get(acc_smoothing_bank_handle_t handle, uint8_t level);
+
+
+/**
+ * @brief Restart all smoothers from the next sweep
+ *
+ * @param[in] handle The handle
+ */
+extern void acc_smoothing_bank_reset(acc_smoothing_bank_handle_t handle);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
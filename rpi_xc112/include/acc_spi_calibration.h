@@ -0,0 +1,144 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_SPI_CALIBRATION_H_
+#define ACC_SPI_CALIBRATION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup SPI_Calibration SPI Calibration
+ *
+ * @brief Selection of the fastest reliable SPI clock speed of a sensor
+ *
+ * The SPI clock a sensor can run at depends on the cable length and the housing. The
+ * calibration probes increasing speeds. At each speed the communication tests of the
+ * assembly test are repeated, which write registers of the sensor and read them back through
+ * acc_board_sensor_transfer, and an envelope service is run to measure the time spent
+ * transferring one sweep. The probing stops at the first speed that fails.
+ *
+ * The selected speed is the fastest speed that passed, lowered by a number of steps as
+ * margin. It is applied to the board and can be persisted in the key-value store, from where
+ * acc_board_init applies it on the next start.
+ *
+ * A speed that passed may turn out to be too high later on, as the temperature changes. Such
+ * transfers are corrupted rather than failed, so the board can not tell. They show as a
+ * service that fails to be created, activated or to get the next sweep, after which
+ * acc_spi_calibration_check lowers the speed until the communication tests pass again.
+ *
+ * RSS must be activated, and the sensor must not be used by any service while calibrating.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Maximum number of probed speeds
+ */
+#define ACC_SPI_CALIBRATION_STEP_COUNT_MAX 16
+
+
+/**
+ * @brief Calibration configuration
+ */
+typedef struct
+{
+	/** Speeds to probe in Hz, increasing */
+	const uint32_t *speeds;
+	/** Number of speeds */
+	uint16_t       speed_count;
+	/** Number of communication test runs at each speed, all must pass */
+	uint16_t       repetitions;
+	/** Number of sweeps the transfer time is averaged over, 0 to not measure */
+	uint16_t       sweep_count;
+	/** Number of speed steps below the fastest passed speed to select */
+	uint16_t       margin_steps;
+} acc_spi_calibration_configuration_t;
+
+
+/**
+ * @brief Result of one probed speed
+ */
+typedef struct
+{
+	uint32_t speed;
+	bool     passed;
+	/** Mean time spent in SPI transfers per sweep, 0 if not measured */
+	uint32_t sweep_transfer_time_us;
+	/** Mean number of bytes transferred per sweep, 0 if not measured */
+	uint32_t sweep_transfer_bytes;
+} acc_spi_calibration_step_t;
+
+
+/**
+ * @brief Calibration result
+ */
+typedef struct
+{
+	/** Selected speed in Hz, 0 if no speed passed */
+	uint32_t                   speed;
+	/** Number of probed speeds */
+	uint16_t                   step_count;
+	acc_spi_calibration_step_t steps[ACC_SPI_CALIBRATION_STEP_COUNT_MAX];
+} acc_spi_calibration_result_t;
+
+
+/**
+ * @brief Get the default configuration
+ *
+ * Probes 5 MHz to 50 MHz, with 5 repetitions, 10 sweeps and one step of margin.
+ *
+ * @param[out] configuration The default configuration
+ */
+extern void acc_spi_calibration_configuration_default(acc_spi_calibration_configuration_t *configuration);
+
+
+/**
+ * @brief Calibrate the SPI speed of a sensor
+ *
+ * The selected speed is applied to the board. If no speed passes the speed of the sensor is
+ * left unchanged.
+ *
+ * @param[in] sensor The sensor
+ * @param[in] configuration The configuration
+ * @param[out] result The result
+ * @return True if a speed was selected, false otherwise
+ */
+extern bool acc_spi_calibration_run(acc_sensor_id_t sensor, const acc_spi_calibration_configuration_t *configuration,
+                                    acc_spi_calibration_result_t *result);
+
+
+/**
+ * @brief Check the communication with a sensor, lowering its SPI speed until it passes
+ *
+ * The communication tests of the assembly test are run the given number of times. While
+ * any fails the speed of the sensor is lowered with acc_board_sensor_spi_speed_fallback and
+ * the tests are run again. A speed that was lowered is persisted, outside of any transfer.
+ *
+ * Run it before the services of the sensor are created, or after a service failed and was
+ * destroyed. The sensor must not be used by any service meanwhile.
+ *
+ * @param[in] sensor The sensor
+ * @param[in] repetitions Number of communication test runs, all must pass
+ * @return True if the tests passed, false if they fail at the lowest speed
+ */
+extern bool acc_spi_calibration_check(acc_sensor_id_t sensor, uint16_t repetitions);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
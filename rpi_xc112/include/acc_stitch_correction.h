@@ -0,0 +1,261 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_STITCH_CORRECTION_H_
+#define ACC_STITCH_CORRECTION_H_
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acc_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Stitch_Correction Stitch Correction
+ *
+ * @brief Correction of amplitude steps at the seams of stitched envelope and IQ sweeps
+ *
+ * Sweeps longer than one segment are stitched together from several segments, reported as
+ * stitch_count in the service metadata. The segments can have slightly different gain and
+ * noise floor, which shows up as amplitude steps at the seams.
+ *
+ * The correction is learned from a calibration capture of a scene without targets. For each
+ * seam the mean and deviation over time of the points on both sides are matched, giving a gain
+ * and offset that map the segment after the seam onto the one before it. The first segment is
+ * the reference. A per point gain and offset table is computed from the seams, and correction
+ * is a single pass of multiply and add over the sweep.
+ *
+ * The seams can be saved and restored, either in the key-value store on the board EEPROM
+ * or in a caller provided buffer, so a calibration is reused for the same configuration
+ * online and for recorded captures.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Maximum number of stitches
+ */
+#define ACC_STITCH_CORRECTION_STITCH_COUNT_MAX 32
+
+/**
+ * @brief First key used in the key-value store, keys are ACC_STITCH_CORRECTION_KV_KEY_BASE to +255
+ */
+#define ACC_STITCH_CORRECTION_KV_KEY_BASE 0x5c00
+
+
+/**
+ * @brief Correction of one seam, applied as value * gain + offset to the following segments
+ */
+typedef struct
+{
+	/** Index of the first point after the seam */
+	uint16_t index;
+	/** Gain relative to the segment before the seam */
+	float    gain;
+	/** Offset relative to the segment before the seam */
+	float    offset;
+} acc_stitch_correction_seam_t;
+
+
+/**
+ * @brief Stitch correction handle
+ */
+typedef struct acc_stitch_correction_handle *acc_stitch_correction_handle_t;
+
+
+/**
+ * @brief Get an identity of a service configuration
+ *
+ * Saved corrections are only restored for the same configuration identity.
+ *
+ * @param[in] start_m Start of sweep from the service metadata
+ * @param[in] length_m Length of sweep from the service metadata
+ * @param[in] data_length Data length from the service metadata
+ * @param[in] stitch_count Stitch count from the service metadata
+ * @param[in] profile The service profile
+ * @return Configuration identity
+ */
+extern uint32_t acc_stitch_correction_configuration_id(float start_m, float length_m, uint16_t data_length,
+                                                       uint16_t stitch_count, uint32_t profile);
+
+
+/**
+ * @brief Create a stitch correction
+ *
+ * The correction is initially the identity.
+ *
+ * @param[in] data_length Number of points in each sweep
+ * @param[in] stitch_count Number of stitches, at most ACC_STITCH_CORRECTION_STITCH_COUNT_MAX
+ * @param[in] configuration_id Identity of the service configuration
+ * @return Stitch correction handle, NULL if creation failed
+ */
+extern acc_stitch_correction_handle_t acc_stitch_correction_create(uint16_t data_length, uint16_t stitch_count,
+                                                                   uint32_t configuration_id);
+
+
+/**
+ * @brief Destroy a stitch correction
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] handle The handle to destroy, will be set to NULL
+ */
+extern void acc_stitch_correction_destroy(acc_stitch_correction_handle_t *handle);
+
+
+/**
+ * @brief Add an envelope sweep of the calibration capture
+ *
+ * @param[in] handle The handle
+ * @param[in] envelope_data Envelope sweep of data_length points
+ * @return True if successful, false otherwise
+ */
+extern bool acc_stitch_correction_calibration_add_envelope(acc_stitch_correction_handle_t handle, const uint16_t *envelope_data);
+
+
+/**
+ * @brief Add an IQ sweep of the calibration capture
+ *
+ * For IQ data only the gain is learned since an offset has no meaning for complex values.
+ *
+ * @param[in] handle The handle
+ * @param[in] iq_data IQ sweep of data_length points
+ * @return True if successful, false otherwise
+ */
+extern bool acc_stitch_correction_calibration_add_iq(acc_stitch_correction_handle_t handle, const float complex *iq_data);
+
+
+/**
+ * @brief Compute the correction from the added calibration sweeps
+ *
+ * Seams are searched for near the positions given by dividing the sweep into stitch_count + 1
+ * equally long segments.
+ *
+ * @param[in] handle The handle
+ * @return True if successful, false if too few calibration sweeps were added
+ */
+extern bool acc_stitch_correction_calibration_finish(acc_stitch_correction_handle_t handle);
+
+
+/**
+ * @brief Get the seams of the correction
+ *
+ * @param[in] handle The handle
+ * @param[out] seams stitch_count seams
+ */
+extern void acc_stitch_correction_seams_get(acc_stitch_correction_handle_t handle, acc_stitch_correction_seam_t *seams);
+
+
+/**
+ * @brief Set the seams of the correction
+ *
+ * @param[in] handle The handle
+ * @param[in] seams stitch_count seams, with increasing index
+ * @return True if successful, false otherwise
+ */
+extern bool acc_stitch_correction_seams_set(acc_stitch_correction_handle_t handle, const acc_stitch_correction_seam_t *seams);
+
+
+/**
+ * @brief Correct an envelope sweep
+ *
+ * @param[in] handle The handle
+ * @param[in] input Envelope sweep of data_length points
+ * @param[out] output Corrected sweep, may be the same as input
+ */
+extern void acc_stitch_correction_apply_envelope(acc_stitch_correction_handle_t handle, const uint16_t *input, uint16_t *output);
+
+
+/**
+ * @brief Correct an IQ sweep in float complex format
+ *
+ * @param[in] handle The handle
+ * @param[in] input IQ sweep of data_length points
+ * @param[out] output Corrected sweep, may be the same as input
+ */
+extern void acc_stitch_correction_apply_iq(acc_stitch_correction_handle_t handle, const float complex *input,
+                                           float complex *output);
+
+
+/**
+ * @brief Correct an IQ sweep in acc_int16_complex_t format
+ *
+ * @param[in] handle The handle
+ * @param[in] input IQ sweep of data_length points
+ * @param[out] output Corrected sweep, may be the same as input
+ */
+extern void acc_stitch_correction_apply_iq_int16(acc_stitch_correction_handle_t handle, const acc_int16_complex_t *input,
+                                                 acc_int16_complex_t *output);
+
+
+/**
+ * @brief Get the size of a serialized correction
+ *
+ * @param[in] stitch_count Number of stitches
+ * @return Size in bytes
+ */
+extern size_t acc_stitch_correction_serialized_size(uint16_t stitch_count);
+
+
+/**
+ * @brief Serialize the correction to a buffer
+ *
+ * @param[in] handle The handle
+ * @param[out] buffer Buffer of at least acc_stitch_correction_serialized_size() bytes
+ * @param[in] size Size of buffer in bytes
+ * @return True if successful, false otherwise
+ */
+extern bool acc_stitch_correction_serialize(acc_stitch_correction_handle_t handle, void *buffer, size_t size);
+
+
+/**
+ * @brief Restore the correction from a serialized buffer
+ *
+ * @param[in] handle The handle
+ * @param[in] buffer The serialized correction
+ * @param[in] size Size of buffer in bytes
+ * @return True if successful, false if the buffer is invalid or made for another configuration
+ */
+extern bool acc_stitch_correction_deserialize(acc_stitch_correction_handle_t handle, const void *buffer, size_t size);
+
+
+/**
+ * @brief Save the correction in the key-value store
+ *
+ * Each configuration identity has its own key, a correction saved for another configuration
+ * is kept. acc_device_memory_kv_init must have been called before this function.
+ *
+ * @param[in] handle The handle
+ * @return True if successful, false otherwise
+ */
+extern bool acc_stitch_correction_store(acc_stitch_correction_handle_t handle);
+
+
+/**
+ * @brief Restore the correction for the configuration from the key-value store
+ *
+ * acc_device_memory_kv_init must have been called before this function.
+ *
+ * @param[in] handle The handle
+ * @return True if a correction for the configuration was found, false if the configuration must be calibrated
+ */
+extern bool acc_stitch_correction_restore(acc_stitch_correction_handle_t handle);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,177 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_SWEEP_OUTPUT_H_
+#define ACC_SWEEP_OUTPUT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Sweep_Output Sweep Output
+ *
+ * @brief Output of formatted sweeps to a file descriptor without stdio copies
+ *
+ * Sweeps are formatted directly into page aligned buffers from a pool, reserved with
+ * acc_sweep_output_reserve, and the filled part of a buffer is handed to the file
+ * descriptor by acc_sweep_output_flush or when the buffer is full.
+ *
+ * The way data is handed over depends on the file descriptor:
+ * - A pipe gets the pages of the buffer with vmsplice, the data is not copied.
+ * - A regular file or a socket gets the pages through a private pipe, vmsplice into the pipe
+ *   and splice from it.
+ * - Anything else, or a file descriptor where splicing fails, gets the data with write. A
+ *   failure to splice switches the output to write for good.
+ *
+ * Pages handed over by vmsplice are referenced by the kernel until the reader has consumed
+ * them, and a reader that splices them further may keep them referenced longer. A buffer
+ * spliced to a pipe or a socket is therefore never written again: when the output moves on to
+ * the next buffer of the pool, the pages of the spliced buffer are dropped with madvise and
+ * replaced by new zero pages on the next use. Since the pages are never reused whole pages are
+ * gifted to the kernel. Splicing to a regular file copies the data to the page cache, so those
+ * buffers are reused as they are.
+ *
+ * The page faults of the new pages cost about as much as the copy that splicing saves, and the
+ * formatting of the sweeps costs far more than both, see source/acc_sweep_output_benchmark.c.
+ * Splicing mainly helps when the sweeps are large and the reader passes them on with splice.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Output methods
+ */
+typedef enum
+{
+	ACC_SWEEP_OUTPUT_METHOD_WRITE,
+	ACC_SWEEP_OUTPUT_METHOD_VMSPLICE,
+	ACC_SWEEP_OUTPUT_METHOD_SPLICE,
+} acc_sweep_output_method_enum_t;
+typedef uint32_t acc_sweep_output_method_t;
+
+
+/**
+ * @brief Sweep output configuration
+ */
+typedef struct
+{
+	/** Size of each buffer in the pool, rounded up to whole pages, the largest reservation */
+	size_t   buffer_size;
+	/** Number of buffers in the pool */
+	uint16_t buffer_count;
+	/** False to always use write */
+	bool     allow_splice;
+} acc_sweep_output_configuration_t;
+
+
+/**
+ * @brief Sweep output statistics
+ */
+typedef struct
+{
+	acc_sweep_output_method_t method;
+	/** Number of bytes handed over */
+	uint64_t                  bytes;
+	/** Number of bytes handed over with vmsplice or splice */
+	uint64_t                  spliced_bytes;
+	/** Number of hand-overs */
+	uint32_t                  flush_count;
+	/** Number of buffers whose pages were dropped after splicing */
+	uint32_t                  retired_count;
+} acc_sweep_output_statistics_t;
+
+
+/**
+ * @brief Sweep output handle
+ */
+typedef struct acc_sweep_output *acc_sweep_output_t;
+
+
+/**
+ * @brief Get the default configuration, four buffers of 64 KiB with splicing allowed
+ *
+ * @param[out] configuration The default configuration
+ */
+extern void acc_sweep_output_configuration_default(acc_sweep_output_configuration_t *configuration);
+
+
+/**
+ * @brief Create a sweep output
+ *
+ * The file descriptor stays owned by the caller and must stay open until the output is
+ * destroyed.
+ *
+ * @param[in] fd The file descriptor to output to
+ * @param[in] configuration The configuration
+ * @return Sweep output handle, NULL if creation failed
+ */
+extern acc_sweep_output_t acc_sweep_output_create(int fd, const acc_sweep_output_configuration_t *configuration);
+
+
+/**
+ * @brief Flush and destroy a sweep output
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] output The output to destroy, will be set to NULL
+ * @return True if all data was handed over, false if an error has occurred
+ */
+extern bool acc_sweep_output_destroy(acc_sweep_output_t *output);
+
+
+/**
+ * @brief Reserve space for formatting
+ *
+ * The space is valid until the next call to any other function of the output.
+ *
+ * @param[in] output The output
+ * @param[in] size The largest number of bytes that will be formatted
+ * @return Pointer to the space, NULL if size is larger than the buffer size
+ */
+extern char *acc_sweep_output_reserve(acc_sweep_output_t output, size_t size);
+
+
+/**
+ * @brief Commit formatted bytes
+ *
+ * @param[in] output The output
+ * @param[in] size Number of bytes formatted in the reserved space
+ */
+extern void acc_sweep_output_commit(acc_sweep_output_t output, size_t size);
+
+
+/**
+ * @brief Hand the committed bytes over to the file descriptor
+ *
+ * @param[in] output The output
+ * @return True if successful, false if this or an earlier hand-over failed
+ */
+extern bool acc_sweep_output_flush(acc_sweep_output_t output);
+
+
+/**
+ * @brief Get the statistics of a sweep output
+ *
+ * @param[in] output The output
+ * @param[out] statistics The statistics
+ */
+extern void acc_sweep_output_get_statistics(acc_sweep_output_t output, acc_sweep_output_statistics_t *statistics);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
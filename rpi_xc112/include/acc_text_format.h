@@ -0,0 +1,94 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_TEXT_FORMAT_H_
+#define ACC_TEXT_FORMAT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Text_Format Text Format
+ *
+ * @brief Formatting of sweep values into text without printf
+ *
+ * Each function writes one value at the given position, without a terminating null, and
+ * returns the position after it, so a whole sweep is formatted into one line buffer by
+ * chaining the calls. The caller makes sure the buffer has room for the maximum length of
+ * each value.
+ *
+ * Integers are converted two digits per step from a table of digit pairs, giving the same
+ * text as printf %u. Floats are either formatted as PRIfloat with ACC_LOG_FLOAT_TO_INTEGER,
+ * the same text as the log and the data logger, or with the fewest significant digits that
+ * read back as the same float.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Maximum length of an uint32_t value
+ */
+#define ACC_TEXT_FORMAT_UINT32_LENGTH_MAX 10
+
+/**
+ * @brief Maximum length of a float value in the PRIfloat format
+ */
+#define ACC_TEXT_FORMAT_PRIFLOAT_LENGTH_MAX 19
+
+/**
+ * @brief Maximum length of a float value with the fewest digits
+ */
+#define ACC_TEXT_FORMAT_FLOAT_LENGTH_MAX 15
+
+
+/**
+ * @brief Format an unsigned integer, as printf %u
+ *
+ * @param[out] buffer Position to write at
+ * @param[in] value The value
+ * @return Position after the value
+ */
+extern char *acc_text_format_uint32(char *buffer, uint32_t value);
+
+
+/**
+ * @brief Format a float as "%" PRIfloat with ACC_LOG_FLOAT_TO_INTEGER
+ *
+ * A sign character, space or minus, the integer part and six decimals. The integer part is
+ * converted to 32 bits, as unsigned long on the target.
+ *
+ * @param[out] buffer Position to write at
+ * @param[in] value The value
+ * @return Position after the value
+ */
+extern char *acc_text_format_prifloat(char *buffer, float value);
+
+
+/**
+ * @brief Format a float with the fewest significant digits that read back as the same float
+ *
+ * The text is the same as printf %.*g with the lowest precision, at most 9, for which strtof
+ * returns the value. That is the shortest round trip text except for a few values just above
+ * a power of two, where a text of the same length closer to a boundary would also read back.
+ *
+ * @param[out] buffer Position to write at
+ * @param[in] value The value
+ * @return Position after the value
+ */
+extern char *acc_text_format_float(char *buffer, float value);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,153 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_TRACE_H_
+#define ACC_TRACE_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Trace Trace
+ *
+ * @brief Static tracepoints of the acquisition path
+ *
+ * The tracepoints mark the sensor interrupt, the semaphore signal and wait, the SPI
+ * transfer, the chip select and the service get_next calls of the data logger, so that
+ * stalls in the application can be lined up with the SPI, GPIO and scheduler events of
+ * the kernel. The board marks each sensor interrupt and the wait that takes it with the
+ * sensor, sensor_interrupt and sensor_interrupt_taken, also when the wait spins instead
+ * of blocking on the semaphore.
+ *
+ * Without ACC_TRACE, which is defined when building with ACC_CFG_TRACE=1, the tracepoints
+ * compile to nothing. With ACC_TRACE each tracepoint is:
+ *
+ * - A USDT probe in the provider acc, when <sys/sdt.h> is available. A probe is a single
+ *   nop until a tracer such as perf or bpftrace attaches to it.
+ * - A write to the ftrace trace_marker, when enabled with acc_trace_marker_open or by
+ *   setting the environment variable ACC_TRACE_MARKER before acc_os_init. When not
+ *   enabled the cost is one predicted branch.
+ *
+ * The markers are written as "acc:<probe> <arguments>" and end up in the ftrace buffer
+ * among the kernel events. trace_timeline.py in the top directory records both and prints
+ * one timeline.
+ *
+ * @{
+ */
+
+
+#if defined(ACC_TRACE)
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define ACC_TRACE_USDT
+#endif
+#endif
+
+#if defined(ACC_TRACE_USDT)
+#define ACC_TRACE_PROBE0(probe)             STAP_PROBE(acc, probe)
+#define ACC_TRACE_PROBE1(probe, arg1)       STAP_PROBE1(acc, probe, arg1)
+#define ACC_TRACE_PROBE2(probe, arg1, arg2) STAP_PROBE2(acc, probe, arg1, arg2)
+#else
+#define ACC_TRACE_PROBE0(probe)             ((void)0)
+#define ACC_TRACE_PROBE1(probe, arg1)       ((void)0)
+#define ACC_TRACE_PROBE2(probe, arg1, arg2) ((void)0)
+#endif
+
+
+/**
+ * @brief File descriptor of the trace_marker, -1 when the markers are not enabled
+ */
+extern int acc_trace_marker_fd;
+
+
+/**
+ * @brief Write a marker, use the ACC_TRACE macros instead
+ *
+ * @param[in] probe The name of the tracepoint
+ * @param[in] arg_count The number of arguments, 0 to 2
+ * @param[in] arg1 The first argument
+ * @param[in] arg2 The second argument
+ */
+extern void acc_trace_marker_write(const char *probe, int arg_count, long arg1, long arg2);
+
+
+#define ACC_TRACE_MARKER(probe, arg_count, arg1, arg2) \
+	do \
+	{ \
+		if (__builtin_expect(acc_trace_marker_fd >= 0, 0)) \
+		{ \
+			acc_trace_marker_write(#probe, arg_count, (long)(arg1), (long)(arg2)); \
+		} \
+	} while (0)
+
+#define ACC_TRACE0(probe) \
+	do \
+	{ \
+		ACC_TRACE_PROBE0(probe); \
+		ACC_TRACE_MARKER(probe, 0, 0, 0); \
+	} while (0)
+
+#define ACC_TRACE1(probe, arg1) \
+	do \
+	{ \
+		ACC_TRACE_PROBE1(probe, arg1); \
+		ACC_TRACE_MARKER(probe, 1, arg1, 0); \
+	} while (0)
+
+#define ACC_TRACE2(probe, arg1, arg2) \
+	do \
+	{ \
+		ACC_TRACE_PROBE2(probe, arg1, arg2); \
+		ACC_TRACE_MARKER(probe, 2, arg1, arg2); \
+	} while (0)
+
+#else
+
+#define ACC_TRACE0(probe)             ((void)0)
+#define ACC_TRACE1(probe, arg1)       ((void)sizeof(arg1))
+#define ACC_TRACE2(probe, arg1, arg2) ((void)sizeof(arg1), (void)sizeof(arg2))
+
+#endif
+
+
+/**
+ * @brief Enable the trace_marker writes
+ *
+ * The trace_marker is looked for in /sys/kernel/tracing and /sys/kernel/debug/tracing,
+ * which needs root or the tracefs permissions to be relaxed.
+ *
+ * @return True if the markers are enabled, false if the trace_marker could not be opened or
+ *         the tracepoints are not built in
+ */
+extern bool acc_trace_marker_open(void);
+
+
+/**
+ * @brief Disable the trace_marker writes
+ */
+extern void acc_trace_marker_close(void);
+
+
+/**
+ * @brief Enable the trace_marker writes if the environment variable ACC_TRACE_MARKER is set
+ *
+ * Called by acc_os_init.
+ */
+extern void acc_trace_init(void);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#ifndef ACC_VIRTUAL_SERVICE_H_
+#define ACC_VIRTUAL_SERVICE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_service.h"
+#include "acc_service_envelope.h"
+#include "acc_service_power_bins.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup Virtual_Service Virtual Services
+ *
+ * @brief Several outputs derived on the host from one physical acquisition
+ *
+ * Each service created with acc_service_create makes its own sweeps, so running a power bins
+ * and an envelope service on the same sensor doubles the sensor time and the SPI traffic.
+ * A virtual service source wraps one physical envelope or IQ service, and any number of
+ * virtual power bins and envelope services are derived from its sweeps: power bins with an
+ * arbitrary bin layout, sub-range windows and decimated envelopes.
+ *
+ * The virtual services have get_next and get_metadata functions with the same signatures as
+ * the corresponding physical services. A get_next call acquires a new physical sweep only if
+ * the calling virtual service has already consumed the latest one, so consumers reading
+ * their virtual services once per loop share one sweep per loop. A consumer that falls
+ * behind gets missed_data set in its result info.
+ *
+ * The amplitude of each physical sweep is reduced once to a prefix sum, from which every bin
+ * and decimated point is a difference and a multiplication by a precomputed reciprocal.
+ *
+ * The physical service is created, activated, deactivated and destroyed by the application
+ * as usual. Virtual services must be destroyed before their source.
+ *
+ * @{
+ */
+
+
+/**
+ * @brief Virtual service source handle
+ */
+typedef struct acc_virtual_service_source *acc_virtual_service_source_t;
+
+
+/**
+ * @brief Virtual service handle
+ */
+typedef struct acc_virtual_service_handle *acc_virtual_service_handle_t;
+
+
+/**
+ * @brief Create a virtual service source from an envelope service
+ *
+ * @param[in] service An envelope service
+ * @return Virtual service source, NULL if creation failed
+ */
+extern acc_virtual_service_source_t acc_virtual_service_source_create_envelope(acc_service_handle_t service);
+
+
+/**
+ * @brief Create a virtual service source from an IQ service
+ *
+ * The IQ service must use the ACC_SERVICE_IQ_OUTPUT_FORMAT_INT16_COMPLEX output format.
+ * The derived outputs are computed from the amplitude of the IQ data.
+ *
+ * @param[in] service An IQ service
+ * @return Virtual service source, NULL if creation failed
+ */
+extern acc_virtual_service_source_t acc_virtual_service_source_create_iq(acc_service_handle_t service);
+
+
+/**
+ * @brief Destroy a virtual service source
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] source The source to destroy, will be set to NULL
+ */
+extern void acc_virtual_service_source_destroy(acc_virtual_service_source_t *source);
+
+
+/**
+ * @brief Create a virtual power bins service
+ *
+ * Bin i covers the points from bin_edges_m[i] up to bin_edges_m[i + 1] and its value is
+ * the mean amplitude of those points. Each bin must cover at least one point of the
+ * source sweep.
+ *
+ * @param[in] source The source
+ * @param[in] bin_edges_m bin_count + 1 increasing bin edges in meters
+ * @param[in] bin_count Number of bins
+ * @return Virtual service handle, NULL if creation failed
+ */
+extern acc_virtual_service_handle_t acc_virtual_service_power_bins_create(acc_virtual_service_source_t source,
+                                                                          const float                  *bin_edges_m,
+                                                                          uint16_t                     bin_count);
+
+
+/**
+ * @brief Create a virtual envelope service
+ *
+ * The window is clipped to the source sweep. Each output point is the mean of
+ * downsampling_factor consecutive source points.
+ *
+ * @param[in] source The source
+ * @param[in] start_m Start of the window
+ * @param[in] length_m Length of the window
+ * @param[in] downsampling_factor Number of source points per output point
+ * @return Virtual service handle, NULL if creation failed
+ */
+extern acc_virtual_service_handle_t acc_virtual_service_envelope_create(acc_virtual_service_source_t source, float start_m,
+                                                                        float length_m, uint16_t downsampling_factor);
+
+
+/**
+ * @brief Destroy a virtual service
+ *
+ * The handle reference is set to NULL after destruction.
+ * If NULL is sent in, nothing happens.
+ *
+ * @param[in] handle The handle to destroy, will be set to NULL
+ */
+extern void acc_virtual_service_destroy(acc_virtual_service_handle_t *handle);
+
+
+/**
+ * @brief Get metadata of a virtual power bins service
+ *
+ * step_length_m is the mean bin length.
+ *
+ * @param[in] handle The handle
+ * @param[out] metadata Metadata results are provided in this parameter
+ */
+extern void acc_virtual_service_power_bins_get_metadata(acc_virtual_service_handle_t handle,
+                                                        acc_service_power_bins_metadata_t *metadata);
+
+
+/**
+ * @brief Retrieve the next result from a virtual power bins service
+ *
+ * @param[in] handle The handle
+ * @param[out] data Power bins result
+ * @param[in] data_length The length of the buffer provided for the result
+ * @param[out] result_info Power bins result info, sending in NULL is ok
+ * @return True if successful, false otherwise
+ */
+extern bool acc_virtual_service_power_bins_get_next(acc_virtual_service_handle_t handle, uint16_t *data, uint16_t data_length,
+                                                    acc_service_power_bins_result_info_t *result_info);
+
+
+/**
+ * @brief Get metadata of a virtual envelope service
+ *
+ * @param[in] handle The handle
+ * @param[out] metadata Metadata results are provided in this parameter
+ */
+extern void acc_virtual_service_envelope_get_metadata(acc_virtual_service_handle_t handle, acc_service_envelope_metadata_t *metadata);
+
+
+/**
+ * @brief Retrieve the next result from a virtual envelope service
+ *
+ * @param[in] handle The handle
+ * @param[out] data Envelope result
+ * @param[in] data_length The length of the buffer provided for the result
+ * @param[out] result_info Envelope result info, sending in NULL is ok
+ * @return True if successful, false otherwise
+ */
+extern bool acc_virtual_service_envelope_get_next(acc_virtual_service_handle_t handle, uint16_t *data, uint16_t data_length,
+                                                  acc_service_envelope_result_info_t *result_info);
+
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,11 +1,17 @@
 // Copyright (c) Acconeer AB, 2018-2019
 // All rights reserved
 
+#define _POSIX_C_SOURCE 199309L
+
 #include <ctype.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "acc_board.h"
 #include "acc_definitions.h"
@@ -14,9 +20,11 @@
 #include "acc_device_i2c.h"
 #include "acc_device_os.h"
 #include "acc_device_spi.h"
+#include "acc_trace.h"
 
 #if defined(TARGET_OS_linux)
 #include "acc_device_memory.h"
+#include "acc_device_memory_kv.h"
 #include "acc_driver_24cxx.h"
 #include "acc_driver_gpio_linux_sysfs.h"
 #include "acc_driver_i2c_linux.h"
@@ -60,6 +68,16 @@
 #define ACC_BOARD_BUS       (0)        /**< @brief The SPI bus of this board */
 #define ACC_BOARD_CS        (0)        /**< @brief The SPI device of the board */
 
+#define SPI_SPEED_MIN          ACC_BOARD_DEFAULT_SPI_SPEED /**< @brief Lowest speed a fallback goes to */
+#define SPI_SPEED_MAX          (62500000)                  /**< @brief Half the SPI controller clock */
+#define SPI_SPEED_FALLBACK_NUM (3)                         /**< @brief A fallback lowers the speed to 3/4 */
+#define SPI_SPEED_FALLBACK_DEN (4)
+
+#define INTERRUPT_SPIN_MARGIN_US     (20)      /**< @brief Spin this long past the expected interrupt, plus the jitter */
+#define INTERRUPT_INTERVAL_MAX_US    (1000000) /**< @brief Longer intervals are gaps, not the sweep rate */
+#define INTERRUPT_INTERVAL_WEIGHT    (3)       /**< @brief The interval estimate moves 1/8 towards each interval */
+#define INTERRUPT_JITTER_WEIGHT      (2)       /**< @brief The jitter estimate moves 1/4 towards each deviation */
+
 /**
  * @brief Number of GPIO pins
  */
@@ -101,28 +119,160 @@ static acc_device_handle_t             spi_handle;
 static gpio_t                          gpios[GPIO_PIN_COUNT];
 static acc_app_integration_semaphore_t isr_semaphores[SENSOR_COUNT];
 
+/**
+ * @brief Lock of the board power and the sensor states when sensors are started and stopped
+ *
+ * Sensors can be started from several threads at once, see acc_session.h.
+ */
+static acc_app_integration_mutex_t power_mutex;
+
+/**
+ * @brief SPI speed of each sensor, and the speed last given to the SPI driver
+ *
+ * All sensors share one SPI device, the speed is changed when the bus is taken by a sensor
+ * with another speed than the previous one.
+ */
+static uint32_t sensor_spi_speed[SENSOR_COUNT] = {ACC_BOARD_SPI_SPEED, ACC_BOARD_SPI_SPEED, ACC_BOARD_SPI_SPEED, ACC_BOARD_SPI_SPEED};
+static uint32_t applied_spi_speed              = ACC_BOARD_SPI_SPEED;
+static bool     kv_available                   = false;
+
+static acc_board_transfer_statistics_t transfer_statistics[SENSOR_COUNT];
+
+
+/**
+ * @brief Interrupt wait state of a sensor
+ *
+ * The interrupt thread counts the interrupt in pending and only signals the semaphore when the
+ * waiter has announced that it blocks, so a spinning waiter takes the interrupt from pending
+ * without any system call. A signal can be left on the semaphore when the waiter takes the
+ * interrupt from pending after announcing that it blocks, the wait ignores such signals.
+ */
+typedef struct
+{
+	uint32_t                         pending;
+	uint32_t                         waiter_blocked;
+	uint32_t                         interrupt_time_us;
+	acc_board_interrupt_wait_mode_t  mode;
+	uint32_t                         spin_max_us;
+	uint32_t                         last_interrupt_time_us;
+	bool                             last_interrupt_valid;
+	uint32_t                         interval_us;
+	uint32_t                         jitter_us;
+	acc_board_interrupt_statistics_t statistics;
+	bool                             statistics_lock;
+} interrupt_wait_t;
+
+static interrupt_wait_t interrupt_waits[SENSOR_COUNT];
+
+/**
+ * @brief eventfd of each sensor written by the interrupt thread, -1 until requested
+ */
+static int interrupt_event_fds[SENSOR_COUNT] = {-1, -1, -1, -1};
+
+
+/**
+ * @brief Private function to get a monotonic time in microseconds
+ */
+static uint64_t get_time_us(void);
+
+
+/**
+ * @brief Private function to take one pending interrupt
+ *
+ * @param[in] wait The interrupt wait state of the sensor
+ * @return True if an interrupt was pending
+ */
+static bool take_interrupt(interrupt_wait_t *wait);
+
+
+/**
+ * @brief Private function to get the spin budget of a wait from the interrupt interval
+ *
+ * @param[in] wait The interrupt wait state of the sensor
+ * @param[in] now_us The start of the wait
+ * @return The spin budget in microseconds, 0 if the wait should block at once
+ */
+static uint32_t get_spin_budget_us(const interrupt_wait_t *wait, uint32_t now_us);
+
+
+/**
+ * @brief Private function to update the interval estimate and the statistics after a wait
+ *
+ * @param[in] wait The interrupt wait state of the sensor
+ * @param[in] start_us The start of the wait
+ * @param[in] end_us The end of the wait
+ * @param[in] spin_us The time spent spinning
+ * @param[in] spin_budget_us The spin budget of the wait
+ * @param[in] blocked True if the wait blocked
+ * @param[in] taken True if an interrupt was taken, false on timeout
+ */
+static void update_interrupt_wait(interrupt_wait_t *wait, uint32_t start_us, uint32_t end_us, uint32_t spin_us,
+                                  uint32_t spin_budget_us, bool blocked, bool taken);
+
+
+/**
+ * @brief Private function to hint the CPU that the caller is spinning
+ */
+static inline void cpu_relax(void)
+{
+#if defined(__arm__) || defined(__aarch64__)
+	__asm__ __volatile__ ("yield");
+#elif defined(__i386__) || defined(__x86_64__)
+	__asm__ __volatile__ ("pause");
+#endif
+}
+
+
+static void sensor_interrupt(uint_fast8_t index)
+{
+	interrupt_wait_t *wait = &interrupt_waits[index];
+
+	ACC_TRACE1(sensor_interrupt, index + 1);
+
+	__atomic_store_n(&wait->interrupt_time_us, (uint32_t)get_time_us(), __ATOMIC_RELAXED);
+	__atomic_add_fetch(&wait->pending, 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&wait->waiter_blocked, __ATOMIC_SEQ_CST) != 0)
+	{
+		acc_os_semaphore_signal_from_interrupt(isr_semaphores[index]);
+	}
+
+	int event_fd = __atomic_load_n(&interrupt_event_fds[index], __ATOMIC_ACQUIRE);
+
+	if (event_fd >= 0)
+	{
+		uint64_t count = 1;
+
+		// Only fails when the counter would overflow, the eventfd is then readable anyway
+		if (write(event_fd, &count, sizeof(count)) < 0)
+		{
+			return;
+		}
+	}
+}
+
 
 static void isr_sensor1(void)
 {
-	acc_os_semaphore_signal_from_interrupt(isr_semaphores[0]);
+	sensor_interrupt(0);
 }
 
 
 static void isr_sensor2(void)
 {
-	acc_os_semaphore_signal_from_interrupt(isr_semaphores[1]);
+	sensor_interrupt(1);
 }
 
 
 static void isr_sensor3(void)
 {
-	acc_os_semaphore_signal_from_interrupt(isr_semaphores[2]);
+	sensor_interrupt(2);
 }
 
 
 static void isr_sensor4(void)
 {
-	acc_os_semaphore_signal_from_interrupt(isr_semaphores[3]);
+	sensor_interrupt(3);
 }
 
 
@@ -153,12 +303,25 @@ static bool setup_isr(void)
 
 static void deinit(void)
 {
+	if (power_mutex != NULL)
+	{
+		acc_os_mutex_destroy(power_mutex);
+		power_mutex = NULL;
+	}
+
 	for (uint_fast8_t i = 0; i < SENSOR_COUNT; i++)
 	{
 		if (isr_semaphores[i] != NULL)
 		{
 			acc_os_semaphore_destroy(isr_semaphores[i]);
 		}
+
+		int event_fd = __atomic_exchange_n(&interrupt_event_fds[i], -1, __ATOMIC_ACQ_REL);
+
+		if (event_fd >= 0)
+		{
+			close(event_fd);
+		}
 	}
 }
 
@@ -179,6 +342,12 @@ static acc_device_handle_t device_handle_i2c_1;
 static bool any_sensor_active(void);
 
 
+/**
+ * @brief Private function to apply the persisted SPI speeds
+ */
+static void restore_sensor_spi_speeds(void);
+
+
 bool acc_board_gpio_init(void)
 {
 	static bool           init_done  = false;
@@ -279,7 +448,9 @@ bool acc_board_init(void)
 
 	spi_handle = acc_device_spi_create(&configuration);
 
-	if (!setup_isr())
+	power_mutex = acc_os_mutex_create();
+
+	if (power_mutex == NULL || !setup_isr())
 	{
 		deinit();
 		return false;
@@ -330,6 +501,8 @@ bool acc_board_init(void)
 		{
 			fprintf(stdout, "%s: Warning: Board data could not be read from EEPROM.\n", __func__);
 		}
+
+		restore_sensor_spi_speeds();
 	}
 	else
 	{
@@ -362,8 +535,11 @@ void acc_board_start_sensor(acc_sensor_id_t sensor)
 {
 	acc_sensor_pins_t *p_sensor = &sensor_pins[sensor - 1];
 
+	acc_os_mutex_lock(power_mutex);
+
 	if (p_sensor->state != SENSOR_DISABLED)
 	{
+		acc_os_mutex_unlock(power_mutex);
 		return;
 	}
 
@@ -373,15 +549,17 @@ void acc_board_start_sensor(acc_sensor_id_t sensor)
 
 		if (!acc_device_gpio_write(PIN_PMU_EN, PIN_HIGH))
 		{
+			acc_os_mutex_unlock(power_mutex);
 			fprintf(stderr, "%s: Unable to activate global PMU_EN for sensor %" PRIsensor_id ".\n", __func__, sensor);
 			return;
 		}
 
-		// Wait for the board to power up
+		// Wait for the board to power up, sensors started by other threads wait for the lock
 		acc_os_sleep_ms(5);
 
 		if (!acc_device_gpio_write(PIN_ENABLE_N, PIN_LOW))
 		{
+			acc_os_mutex_unlock(power_mutex);
 			fprintf(stderr, "%s: Unable to activate global ENABLE_N for sensor %" PRIsensor_id ".\n", __func__, sensor);
 			return;
 		}
@@ -391,16 +569,28 @@ void acc_board_start_sensor(acc_sensor_id_t sensor)
 
 	if (!acc_device_gpio_write(p_sensor->enable_pin, PIN_HIGH))
 	{
+		acc_os_mutex_unlock(power_mutex);
 		fprintf(stderr, "%s: Unable to activate enable_pin for sensor %" PRIsensor_id ".\n", __func__, sensor);
 		return;
 	}
 
+	p_sensor->state = SENSOR_ENABLED;
+
+	acc_os_mutex_unlock(power_mutex);
+
+	// The sensors started by other threads power up at the same time
 	acc_os_sleep_ms(5);
 
 	// Clear pending interrupts
+	interrupt_wait_t *wait = &interrupt_waits[sensor - 1];
+
+	__atomic_store_n(&wait->pending, 0, __ATOMIC_SEQ_CST);
 	while (acc_os_semaphore_wait(isr_semaphores[sensor - 1], 0));
 
-	p_sensor->state = SENSOR_ENABLED;
+	// The interval of the previous run does not hold for the next one
+	wait->last_interrupt_valid = false;
+	wait->interval_us          = 0;
+	wait->jitter_us            = 0;
 }
 
 
@@ -408,6 +598,8 @@ void acc_board_stop_sensor(acc_sensor_id_t sensor)
 {
 	acc_sensor_pins_t *p_sensor = &sensor_pins[sensor - 1];
 
+	acc_os_mutex_lock(power_mutex);
+
 	if (p_sensor->state != SENSOR_DISABLED)
 	{
 		// "unselect" spi slave select
@@ -415,6 +607,7 @@ void acc_board_stop_sensor(acc_sensor_id_t sensor)
 		{
 			if (!acc_device_gpio_write(p_sensor->slave_select_pin, PIN_HIGH))
 			{
+				acc_os_mutex_unlock(power_mutex);
 				fprintf(stderr, "%s: Unable to deactivate slave_select_pin for sensor %" PRIsensor_id ".\n", __func__, sensor);
 				return;
 			}
@@ -425,6 +618,7 @@ void acc_board_stop_sensor(acc_sensor_id_t sensor)
 		{
 			// Set the state to enabled since it is not selected and failed to disable
 			p_sensor->state = SENSOR_ENABLED;
+			acc_os_mutex_unlock(power_mutex);
 			fprintf(stderr, "%s: Unable to deactivate enable_pin for sensor %" PRIsensor_id ".\n", __func__, sensor);
 			return;
 		}
@@ -439,6 +633,8 @@ void acc_board_stop_sensor(acc_sensor_id_t sensor)
 		acc_device_gpio_write(PIN_PMU_EN, PIN_LOW);
 	}
 
+	acc_os_mutex_unlock(power_mutex);
+
 	// Wait after power off to leave the sensor in a known state
 	// in case the application intends to enable the sensor directly
 	acc_os_sleep_ms(5);
@@ -449,6 +645,8 @@ bool acc_board_chip_select(acc_sensor_id_t sensor, uint_fast8_t cs_assert)
 {
 	acc_sensor_pins_t *p_sensor = &sensor_pins[sensor - 1];
 
+	ACC_TRACE2(chip_select, sensor, cs_assert);
+
 	if (cs_assert)
 	{
 		if (p_sensor->state == SENSOR_ENABLED)
@@ -524,7 +722,58 @@ uint32_t acc_board_get_sensor_count(void)
 
 bool acc_board_wait_for_sensor_interrupt(acc_sensor_id_t sensor_id, uint32_t timeout_ms)
 {
-	return acc_os_semaphore_wait(isr_semaphores[sensor_id - 1], timeout_ms);
+	interrupt_wait_t *wait          = &interrupt_waits[sensor_id - 1];
+	uint32_t         start_us       = (uint32_t)get_time_us();
+	uint32_t         now_us         = start_us;
+	uint32_t         spin_budget_us = 0;
+	bool             blocked        = false;
+	bool             taken          = take_interrupt(wait);
+
+	if (!taken && wait->mode == ACC_BOARD_INTERRUPT_WAIT_SPIN_THEN_BLOCK)
+	{
+		spin_budget_us = get_spin_budget_us(wait, start_us);
+
+		while (!taken && now_us - start_us < spin_budget_us)
+		{
+			cpu_relax();
+			taken  = take_interrupt(wait);
+			now_us = (uint32_t)get_time_us();
+		}
+	}
+
+	uint32_t spin_us = now_us - start_us;
+
+	if (!taken)
+	{
+		blocked = true;
+		__atomic_store_n(&wait->waiter_blocked, 1, __ATOMIC_SEQ_CST);
+
+		// Signals left from earlier waits wake up the semaphore without a pending interrupt
+		while (!(taken = take_interrupt(wait)))
+		{
+			uint32_t elapsed_ms = (now_us - start_us) / 1000;
+
+			if (elapsed_ms >= timeout_ms || !acc_os_semaphore_wait(isr_semaphores[sensor_id - 1], timeout_ms - elapsed_ms))
+			{
+				taken = take_interrupt(wait);
+				break;
+			}
+
+			now_us = (uint32_t)get_time_us();
+		}
+
+		__atomic_store_n(&wait->waiter_blocked, 0, __ATOMIC_SEQ_CST);
+	}
+
+	// A spinning wait takes the interrupt without a semaphore, so the take is traced on both paths
+	if (taken)
+	{
+		ACC_TRACE2(sensor_interrupt_taken, sensor_id, blocked);
+	}
+
+	update_interrupt_wait(wait, start_us, (uint32_t)get_time_us(), spin_us, spin_budget_us, blocked, taken);
+
+	return taken;
 }
 
 
@@ -544,23 +793,406 @@ bool acc_board_set_ref_freq(float ref_freq)
 
 void acc_board_sensor_transfer(acc_sensor_id_t sensor_id, uint8_t *buffer, size_t buffer_length)
 {
-	uint_fast8_t bus = acc_device_spi_get_bus(spi_handle);
+	acc_board_transfer_statistics_t *statistics = &transfer_statistics[sensor_id - 1];
+	uint_fast8_t                    bus         = acc_device_spi_get_bus(spi_handle);
+	uint64_t                        lock_us     = get_time_us();
 
 	acc_device_spi_lock(bus);
 
+	// Time the bus was held by transfers to other sensors
+	statistics->bus_wait_us += get_time_us() - lock_us;
+
 	if (!acc_board_chip_select(sensor_id, 1))
 	{
 		acc_device_spi_unlock(bus);
 		return;
 	}
 
-	if (!acc_device_spi_transfer(spi_handle, buffer, buffer_length))
+	bool success = false;
+
+	// A failed transfer is retried once at a lower speed. The speed is not persisted here, that
+	// would write the key-value store with the bus locked.
+	for (uint_fast8_t attempt = 0; attempt < 2 && !success; attempt++)
+	{
+		if (sensor_spi_speed[sensor_id - 1] != applied_spi_speed)
+		{
+			if (acc_device_spi_set_speed(spi_handle, sensor_spi_speed[sensor_id - 1]))
+			{
+				applied_spi_speed = sensor_spi_speed[sensor_id - 1];
+			}
+		}
+
+		uint64_t start_us = get_time_us();
+
+		success = acc_device_spi_transfer(spi_handle, buffer, buffer_length);
+
+		statistics->time_us += get_time_us() - start_us;
+
+		if (!success)
+		{
+			statistics->failure_count++;
+
+			if (!acc_board_sensor_spi_speed_fallback(sensor_id))
+			{
+				break;
+			}
+		}
+	}
+
+	if (!success)
 	{
 		acc_device_spi_unlock(bus);
 		return;
 	}
 
+	statistics->transfer_count++;
+	statistics->byte_count += buffer_length;
+
 	acc_board_chip_select(sensor_id, 0);
 
 	acc_device_spi_unlock(bus);
+}
+
+
+bool acc_board_set_sensor_spi_speed(acc_sensor_id_t sensor, uint32_t speed)
+{
+	if (sensor < 1 || sensor > SENSOR_COUNT || speed == 0 || speed > SPI_SPEED_MAX)
+	{
+		return false;
+	}
+
+	sensor_spi_speed[sensor - 1] = speed;
+
+	return true;
+}
+
+
+uint32_t acc_board_get_sensor_spi_speed(acc_sensor_id_t sensor)
+{
+	if (sensor < 1 || sensor > SENSOR_COUNT)
+	{
+		return 0;
+	}
+
+	return sensor_spi_speed[sensor - 1];
+}
+
+
+bool acc_board_sensor_spi_speed_fallback(acc_sensor_id_t sensor)
+{
+	if (sensor < 1 || sensor > SENSOR_COUNT || sensor_spi_speed[sensor - 1] <= SPI_SPEED_MIN)
+	{
+		return false;
+	}
+
+	uint32_t speed = (uint32_t)(((uint64_t)sensor_spi_speed[sensor - 1] * SPI_SPEED_FALLBACK_NUM) / SPI_SPEED_FALLBACK_DEN);
+
+	if (speed < SPI_SPEED_MIN)
+	{
+		speed = SPI_SPEED_MIN;
+	}
+
+	fprintf(stderr, "%s: SPI speed of sensor %" PRIsensor_id " lowered from %u Hz to %u Hz.\n", __func__, sensor,
+	        (unsigned int)sensor_spi_speed[sensor - 1], (unsigned int)speed);
+
+	sensor_spi_speed[sensor - 1] = speed;
+
+	return true;
+}
+
+
+bool acc_board_store_sensor_spi_speed(acc_sensor_id_t sensor)
+{
+	if (!kv_available || sensor < 1 || sensor > SENSOR_COUNT)
+	{
+		return false;
+	}
+
+	uint8_t  value[4];
+	uint32_t speed = sensor_spi_speed[sensor - 1];
+
+	for (uint_fast8_t i = 0; i < sizeof(value); i++)
+	{
+		value[i] = (uint8_t)(speed >> (8 * i));
+	}
+
+	return acc_device_memory_kv_store(ACC_BOARD_SPI_SPEED_KV_KEY_BASE + sensor, value, sizeof(value));
+}
+
+
+void acc_board_get_sensor_transfer_statistics(acc_sensor_id_t sensor, acc_board_transfer_statistics_t *statistics)
+{
+	uint_fast8_t bus = acc_device_spi_get_bus(spi_handle);
+
+	acc_device_spi_lock(bus);
+	*statistics = transfer_statistics[sensor - 1];
+	acc_device_spi_unlock(bus);
+}
+
+
+void acc_board_reset_sensor_transfer_statistics(acc_sensor_id_t sensor)
+{
+	uint_fast8_t bus = acc_device_spi_get_bus(spi_handle);
+
+	acc_device_spi_lock(bus);
+	memset(&transfer_statistics[sensor - 1], 0, sizeof(transfer_statistics[sensor - 1]));
+	acc_device_spi_unlock(bus);
+}
+
+
+bool acc_board_set_sensor_interrupt_wait_mode(acc_sensor_id_t sensor, acc_board_interrupt_wait_mode_t mode,
+                                              uint32_t spin_max_us)
+{
+	if (sensor < 1 || sensor > SENSOR_COUNT)
+	{
+		return false;
+	}
+
+	if (mode == ACC_BOARD_INTERRUPT_WAIT_SPIN_THEN_BLOCK && sysconf(_SC_NPROCESSORS_ONLN) < 2)
+	{
+		fprintf(stderr, "%s: Spinning needs more than one CPU, the interrupt thread would not run.\n", __func__);
+		return false;
+	}
+
+	interrupt_waits[sensor - 1].spin_max_us = spin_max_us;
+	interrupt_waits[sensor - 1].mode        = mode;
+
+	return true;
+}
+
+
+int acc_board_get_sensor_interrupt_fd(acc_sensor_id_t sensor)
+{
+	if (sensor < 1 || sensor > SENSOR_COUNT)
+	{
+		return -1;
+	}
+
+	int event_fd = __atomic_load_n(&interrupt_event_fds[sensor - 1], __ATOMIC_ACQUIRE);
+
+	if (event_fd >= 0)
+	{
+		return event_fd;
 	}
+
+	event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (event_fd < 0)
+	{
+		fprintf(stderr, "%s: Unable to create eventfd for sensor %" PRIsensor_id ".\n", __func__, sensor);
+		return -1;
+	}
+
+	int expected = -1;
+
+	if (!__atomic_compare_exchange_n(&interrupt_event_fds[sensor - 1], &expected, event_fd, false, __ATOMIC_ACQ_REL,
+	                                 __ATOMIC_ACQUIRE))
+	{
+		// Created by another thread at the same time
+		close(event_fd);
+		event_fd = expected;
+	}
+
+	return event_fd;
+}
+
+
+uint32_t acc_board_get_sensor_interrupt_pending(acc_sensor_id_t sensor)
+{
+	return __atomic_load_n(&interrupt_waits[sensor - 1].pending, __ATOMIC_SEQ_CST);
+}
+
+
+void acc_board_get_sensor_interrupt_statistics(acc_sensor_id_t sensor, acc_board_interrupt_statistics_t *statistics)
+{
+	interrupt_wait_t *wait = &interrupt_waits[sensor - 1];
+
+	while (__atomic_test_and_set(&wait->statistics_lock, __ATOMIC_ACQUIRE))
+	{
+		cpu_relax();
+	}
+
+	*statistics = wait->statistics;
+
+	__atomic_clear(&wait->statistics_lock, __ATOMIC_RELEASE);
+}
+
+
+void acc_board_reset_sensor_interrupt_statistics(acc_sensor_id_t sensor)
+{
+	interrupt_wait_t *wait = &interrupt_waits[sensor - 1];
+
+	while (__atomic_test_and_set(&wait->statistics_lock, __ATOMIC_ACQUIRE))
+	{
+		cpu_relax();
+	}
+
+	memset(&wait->statistics, 0, sizeof(wait->statistics));
+
+	__atomic_clear(&wait->statistics_lock, __ATOMIC_RELEASE);
+}
+
+
+bool take_interrupt(interrupt_wait_t *wait)
+{
+	uint32_t pending = __atomic_load_n(&wait->pending, __ATOMIC_SEQ_CST);
+
+	while (pending > 0)
+	{
+		if (__atomic_compare_exchange_n(&wait->pending, &pending, pending - 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+uint32_t get_spin_budget_us(const interrupt_wait_t *wait, uint32_t now_us)
+{
+	if (!wait->last_interrupt_valid || wait->interval_us == 0)
+	{
+		return 0;
+	}
+
+	uint32_t margin_us = INTERRUPT_SPIN_MARGIN_US + 2 * wait->jitter_us;
+	uint32_t since_us  = now_us - wait->last_interrupt_time_us;
+	uint32_t budget_us = margin_us;
+
+	if (since_us < wait->interval_us)
+	{
+		budget_us += wait->interval_us - since_us;
+	}
+
+	if (budget_us > wait->spin_max_us)
+	{
+		// Blocking is cheaper than spinning until the interrupt is due
+		return since_us < wait->interval_us ? 0 : wait->spin_max_us;
+	}
+
+	return budget_us;
+}
+
+
+void update_interrupt_wait(interrupt_wait_t *wait, uint32_t start_us, uint32_t end_us, uint32_t spin_us,
+                           uint32_t spin_budget_us, bool blocked, bool taken)
+{
+	uint32_t interrupt_time_us = __atomic_load_n(&wait->interrupt_time_us, __ATOMIC_RELAXED);
+	bool     interrupt_in_wait = taken && (int32_t)(interrupt_time_us - start_us) >= 0;
+	uint32_t latency_us        = end_us - interrupt_time_us;
+
+	if (taken)
+	{
+		uint32_t interval_us = interrupt_time_us - wait->last_interrupt_time_us;
+
+		if (wait->last_interrupt_valid && interval_us > 0 && interval_us < INTERRUPT_INTERVAL_MAX_US)
+		{
+			if (wait->interval_us == 0)
+			{
+				wait->interval_us = interval_us;
+			}
+			else
+			{
+				int32_t deviation_us = (int32_t)(interval_us - wait->interval_us);
+				int32_t jitter_us    = deviation_us < 0 ? -deviation_us : deviation_us;
+
+				wait->interval_us = (uint32_t)((int32_t)wait->interval_us + deviation_us / (1 << INTERRUPT_INTERVAL_WEIGHT));
+				wait->jitter_us   = (uint32_t)((int32_t)wait->jitter_us +
+				                               (jitter_us - (int32_t)wait->jitter_us) / (1 << INTERRUPT_JITTER_WEIGHT));
+			}
+		}
+
+		wait->last_interrupt_time_us = interrupt_time_us;
+		wait->last_interrupt_valid   = true;
+	}
+
+	while (__atomic_test_and_set(&wait->statistics_lock, __ATOMIC_ACQUIRE))
+	{
+		cpu_relax();
+	}
+
+	acc_board_interrupt_statistics_t *statistics = &wait->statistics;
+
+	if (taken)
+	{
+		statistics->wait_count++;
+	}
+	else
+	{
+		statistics->timeout_count++;
+	}
+
+	if (blocked)
+	{
+		statistics->block_count++;
+	}
+	else if (taken && spin_budget_us > 0)
+	{
+		statistics->spin_count++;
+	}
+
+	statistics->spin_time_us  += spin_us;
+	statistics->interval_us    = wait->interval_us;
+	statistics->spin_budget_us = spin_budget_us;
+
+	if (interrupt_in_wait)
+	{
+		if (blocked)
+		{
+			statistics->block_latency_us += latency_us;
+		}
+		else
+		{
+			statistics->spin_latency_us += latency_us;
+		}
+
+		if (latency_us > statistics->latency_max_us)
+		{
+			statistics->latency_max_us = latency_us;
+		}
+	}
+
+	__atomic_clear(&wait->statistics_lock, __ATOMIC_RELEASE);
+}
+
+
+void restore_sensor_spi_speeds(void)
+{
+	if (!acc_device_memory_kv_init(ACC_DEVICE_MEMORY_KV_DEFAULT_START, 0))
+	{
+		fprintf(stdout, "%s: Warning: Key-value store not available, SPI speeds are not persisted.\n", __func__);
+		return;
+	}
+
+	kv_available = true;
+
+	for (acc_sensor_id_t sensor = 1; sensor <= SENSOR_COUNT; sensor++)
+	{
+		uint8_t  value[4];
+		uint16_t length;
+
+		if (!acc_device_memory_kv_load(ACC_BOARD_SPI_SPEED_KV_KEY_BASE + sensor, value, sizeof(value), &length) ||
+		    length != sizeof(value))
+		{
+			continue;
+		}
+
+		uint32_t speed = (uint32_t)value[0] | ((uint32_t)value[1] << 8) | ((uint32_t)value[2] << 16) | ((uint32_t)value[3] << 24);
+
+		if (acc_board_set_sensor_spi_speed(sensor, speed))
+		{
+			fprintf(stdout, "%s: SPI speed of sensor %" PRIsensor_id " is %u Hz.\n", __func__, sensor, (unsigned int)speed);
+		}
+	}
+}
+
+
+uint64_t get_time_us(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (uint64_t)time_ts.tv_sec * 1000000 + (uint64_t)time_ts.tv_nsec / 1000;
+}
@@ -0,0 +1,974 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#define _FILE_OFFSET_BITS 64
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "acc_capture_format.h"
+
+
+/**
+ * @brief Conversion of text captures to the binary capture format
+ *
+ * Converts captures written by the data logger, one sweep per line with tab separated
+ * values, and comma separated files as written by numpy, to the format of
+ * acc_capture_format.h. Lines that are empty or start with '#' are skipped, every other line
+ * must have as many values as the first one.
+ *
+ * The file is memory mapped a window at a time, so files larger than the address space can be
+ * converted. Each window is split into line aligned chunks that are parsed in parallel, and
+ * the parsed chunks are written in order. Numbers are parsed eight digits at a time in a
+ * 64-bit word: one mask finds the length of the digit run and three multiplications combine
+ * the digits.
+ *
+ * Without metadata in the text, the range, update rate and sensor are given on the command line.
+ */
+
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The digit parser and the capture format assume a little endian target"
+#endif
+
+#define CHUNK_SIZE          (4 * 1024 * 1024)
+#define MAX_THREAD_COUNT    16
+#define MAX_SIGNIFICANT     19
+#define OUTPUT_BUFFER_SIZE  (1024 * 1024)
+
+#define ONES      0x0101010101010101ULL
+#define ZEROS     (0x30 * ONES)
+
+
+typedef struct
+{
+	char                            **input_paths;
+	int                             input_count;
+	char                            *output_path;
+	unsigned int                    thread_count;
+	acc_capture_format_value_type_t value_type;
+	bool                            complex;
+	float                           start_m;
+	float                           length_m;
+	float                           update_rate;
+	uint32_t                        sensor;
+} input_t;
+
+
+/**
+ * @brief A line aligned part of a window, parsed by one thread
+ */
+typedef struct
+{
+	const char                      *begin;
+	const char                      *end;
+	const char                      *read_end;
+	acc_capture_format_value_type_t value_type;
+	uint32_t                        values_per_sweep;
+	void                            *values;
+	size_t                          capacity;
+	uint64_t                        sweep_count;
+	const char                      *error_position;
+	const char                      *error_message;
+} chunk_t;
+
+
+static bool parse_options(int argc, char *argv[], input_t *input);
+
+
+static bool convert(const char *input_path, const char *output_path, const input_t *input);
+
+
+static double get_time(void);
+
+
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+
+
+/**
+ * @brief Powers of ten that are exact in a double
+ */
+static const double pow10_double[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const uint64_t pow10_u64[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL
+};
+
+
+int main(int argc, char *argv[])
+{
+	input_t input;
+
+	memset(&input, 0, sizeof(input));
+
+	if (!parse_options(argc, argv, &input))
+	{
+		return EXIT_FAILURE;
+	}
+
+	bool status = true;
+
+	for (int i = 0; i < input.input_count && status; i++)
+	{
+		char *output_path = input.output_path;
+
+		if (output_path == NULL)
+		{
+			size_t length = strlen(input.input_paths[i]);
+
+			output_path = malloc(length + sizeof(".acb"));
+			if (output_path == NULL)
+			{
+				return EXIT_FAILURE;
+			}
+
+			memcpy(output_path, input.input_paths[i], length);
+
+			char *extension = strrchr(output_path, '.');
+			char *directory = strrchr(output_path, '/');
+
+			if (extension == NULL || (directory != NULL && extension < directory))
+			{
+				extension = output_path + length;
+			}
+
+			strcpy(extension, ".acb");
+		}
+
+		status = convert(input.input_paths[i], output_path, &input);
+
+		if (output_path != input.output_path)
+		{
+			free(output_path);
+		}
+	}
+
+	return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/**
+ * @brief Number of leading digit characters in eight bytes of text
+ *
+ * A byte is a digit if it is '0' to '9' after clearing 0x30. Adding 0x76 sets the top bit
+ * of the bytes that are 10 or larger, bytes that already have the top bit set are non-digits
+ * too. Carries only reach bytes after the first non-digit.
+ */
+static inline unsigned int swar_digit_count(uint64_t word)
+{
+	uint64_t digits = word ^ ZEROS;
+	uint64_t mask   = ((digits + 0x76 * ONES) | digits) & (0x80 * ONES);
+
+	return (mask == 0) ? 8 : (unsigned int)__builtin_ctzll(mask) >> 3;
+}
+
+
+/**
+ * @brief Value of the count leading digits in eight bytes of text
+ *
+ * The digits are shifted to the top so the bytes below them act as leading zeros, then
+ * pairs, quads and the two halves are combined.
+ */
+static inline uint32_t swar_digit_value(uint64_t word, unsigned int count)
+{
+	uint64_t digits = (word ^ ZEROS) << (8 * (8 - count));
+
+	digits = (digits * 10) + (digits >> 8);
+	digits = (((digits & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+	          (((digits >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+	return (uint32_t)digits;
+}
+
+
+/**
+ * @brief Parse a run of digits
+ *
+ * At most MAX_SIGNIFICANT digits are accumulated, the count of further digits is added to
+ * dropped.
+ *
+ * @param[in] position First character
+ * @param[in] read_end End of the readable memory
+ * @param[in,out] mantissa The accumulated value
+ * @param[in,out] significant Number of accumulated digits
+ * @param[out] dropped Number of digits that did not fit
+ * @return Position after the digits
+ */
+static inline const char *parse_digits(const char *position, const char *read_end, uint64_t *mantissa,
+                                       unsigned int *significant, unsigned int *dropped)
+{
+	*dropped = 0;
+
+	while (read_end - position >= 8 && *significant + 8 <= MAX_SIGNIFICANT)
+	{
+		uint64_t word;
+
+		memcpy(&word, position, sizeof(word));
+
+		unsigned int count = swar_digit_count(word);
+
+		if (count == 0)
+		{
+			return position;
+		}
+
+		*mantissa     = *mantissa * pow10_u64[count] + swar_digit_value(word, count);
+		*significant += count;
+		position     += count;
+
+		if (count < 8)
+		{
+			return position;
+		}
+	}
+
+	while (position < read_end && (unsigned int)(*position - '0') < 10)
+	{
+		if (*significant < MAX_SIGNIFICANT)
+		{
+			*mantissa = *mantissa * 10 + (unsigned int)(*position - '0');
+			(*significant)++;
+		}
+		else
+		{
+			(*dropped)++;
+		}
+
+		position++;
+	}
+
+	return position;
+}
+
+
+static inline bool is_delimiter(char character)
+{
+	return character == '\t' || character == ',' || character == ' ' || character == ';' || character == '\r';
+}
+
+
+/**
+ * @brief Parse an unsigned integer of at most 65535
+ *
+ * @return Position after the value, NULL if it is not such an integer
+ */
+static const char *parse_uint16(const char *position, const char *line_end, const char *read_end, uint16_t *value)
+{
+	uint64_t     mantissa    = 0;
+	unsigned int significant = 0;
+	unsigned int dropped;
+
+	const char *end = parse_digits(position, read_end, &mantissa, &significant, &dropped);
+
+	if (end == position || dropped > 0 || mantissa > UINT16_MAX || (end < line_end && !is_delimiter(*end)))
+	{
+		return NULL;
+	}
+
+	*value = (uint16_t)mantissa;
+
+	return end;
+}
+
+
+/**
+ * @brief Parse a decimal number with optional sign, fraction and exponent
+ *
+ * @return Position after the value, NULL if it is not a number
+ */
+static const char *parse_float(const char *position, const char *line_end, const char *read_end, float *value)
+{
+	bool negative = false;
+
+	if (position < line_end && (*position == '-' || *position == '+'))
+	{
+		negative = *position == '-';
+		position++;
+	}
+
+	uint64_t     mantissa    = 0;
+	unsigned int significant = 0;
+	unsigned int dropped;
+	int32_t      exponent    = 0;
+	const char   *start      = position;
+
+	position  = parse_digits(position, read_end, &mantissa, &significant, &dropped);
+	exponent += (int32_t)dropped;
+
+	bool has_digits = position != start;
+
+	if (position < line_end && *position == '.')
+	{
+		position++;
+		start = position;
+
+		unsigned int integer_significant = significant;
+
+		position   = parse_digits(position, read_end, &mantissa, &significant, &dropped);
+		exponent  -= (int32_t)(significant - integer_significant);
+		has_digits = has_digits || position != start;
+	}
+
+	if (!has_digits)
+	{
+		return NULL;
+	}
+
+	if (position < line_end && (*position == 'e' || *position == 'E'))
+	{
+		bool    exponent_negative = false;
+		int32_t exponent_value    = 0;
+
+		position++;
+
+		if (position < line_end && (*position == '-' || *position == '+'))
+		{
+			exponent_negative = *position == '-';
+			position++;
+		}
+
+		start = position;
+
+		while (position < line_end && (unsigned int)(*position - '0') < 10)
+		{
+			if (exponent_value < 10000)
+			{
+				exponent_value = exponent_value * 10 + (*position - '0');
+			}
+
+			position++;
+		}
+
+		if (position == start)
+		{
+			return NULL;
+		}
+
+		exponent += exponent_negative ? -exponent_value : exponent_value;
+	}
+
+	if (position < line_end && !is_delimiter(*position))
+	{
+		return NULL;
+	}
+
+	const int32_t max_exact = (int32_t)(sizeof(pow10_double) / sizeof(pow10_double[0])) - 1;
+	double        result    = (double)mantissa;
+
+	while (exponent > max_exact && result != 0.0)
+	{
+		result   *= pow10_double[max_exact];
+		exponent -= max_exact;
+	}
+
+	while (exponent < -max_exact && result != 0.0)
+	{
+		result   /= pow10_double[max_exact];
+		exponent += max_exact;
+	}
+
+	if (exponent > 0 && exponent <= max_exact)
+	{
+		result *= pow10_double[exponent];
+	}
+	else if (exponent < 0 && exponent >= -max_exact)
+	{
+		result /= pow10_double[-exponent];
+	}
+
+	*value = (float)(negative ? -result : result);
+
+	return position;
+}
+
+
+static const char *skip_delimiters(const char *position, const char *line_end)
+{
+	while (position < line_end && is_delimiter(*position))
+	{
+		position++;
+	}
+
+	return position;
+}
+
+
+/**
+ * @brief Parse the lines of a chunk into its value buffer
+ */
+static void *parse_chunk(void *argument)
+{
+	chunk_t    *chunk    = argument;
+	const char *position = chunk->begin;
+	uint16_t   *out_u16  = chunk->values;
+	float      *out_f32  = chunk->values;
+
+	chunk->sweep_count    = 0;
+	chunk->error_position = NULL;
+
+	while (position < chunk->end)
+	{
+		const char *line_end = memchr(position, '\n', (size_t)(chunk->end - position));
+
+		if (line_end == NULL)
+		{
+			line_end = chunk->end;
+		}
+
+		const char *line  = position;
+		uint32_t   count  = 0;
+
+		position = skip_delimiters(position, line_end);
+
+		if (position < line_end && *position == '#')
+		{
+			position = line_end;
+		}
+
+		while (position < line_end)
+		{
+			if (count == chunk->values_per_sweep)
+			{
+				chunk->error_position = line;
+				chunk->error_message  = "more values than the first line";
+				return NULL;
+			}
+
+			const char *end;
+
+			if (chunk->value_type == ACC_CAPTURE_FORMAT_VALUE_UINT16)
+			{
+				end = parse_uint16(position, line_end, chunk->read_end, &out_u16[count]);
+			}
+			else
+			{
+				end = parse_float(position, line_end, chunk->read_end, &out_f32[count]);
+			}
+
+			if (end == NULL)
+			{
+				chunk->error_position = position;
+				chunk->error_message  = (chunk->value_type == ACC_CAPTURE_FORMAT_VALUE_UINT16) ?
+				                        "not an integer from 0 to 65535, convert with --type f32" : "not a number";
+				return NULL;
+			}
+
+			count++;
+			position = skip_delimiters(end, line_end);
+		}
+
+		if (count > 0)
+		{
+			if (count != chunk->values_per_sweep)
+			{
+				chunk->error_position = line;
+				chunk->error_message  = "fewer values than the first line";
+				return NULL;
+			}
+
+			chunk->sweep_count++;
+			out_u16 += count;
+			out_f32 += count;
+		}
+
+		position = line_end + 1;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief Find the layout of the sweeps from the first line with values
+ *
+ * @return True if a line with values was found
+ */
+static bool inspect_first_line(const char *begin, const char *end, uint32_t *values_per_sweep, bool *integers)
+{
+	const char *position = begin;
+
+	while (position < end)
+	{
+		const char *line_end = memchr(position, '\n', (size_t)(end - position));
+
+		if (line_end == NULL)
+		{
+			line_end = end;
+		}
+
+		uint32_t count = 0;
+
+		*integers = true;
+		position  = skip_delimiters(position, line_end);
+
+		if (position < line_end && *position == '#')
+		{
+			position = line_end;
+		}
+
+		while (position < line_end)
+		{
+			uint16_t   integer;
+			float      number;
+			const char *next = parse_uint16(position, line_end, line_end, &integer);
+
+			if (next == NULL)
+			{
+				*integers = false;
+				next      = parse_float(position, line_end, line_end, &number);
+
+				if (next == NULL)
+				{
+					return false;
+				}
+			}
+
+			count++;
+			position = skip_delimiters(next, line_end);
+		}
+
+		if (count > 0)
+		{
+			*values_per_sweep = count;
+			return true;
+		}
+
+		position = line_end + 1;
+	}
+
+	return false;
+}
+
+
+/**
+ * @brief Split a region at line starts, parse the parts in parallel and write them in order
+ */
+static bool convert_region(const char *begin, const char *end, const char *read_end, chunk_t *chunks, unsigned int chunk_count,
+                           FILE *output, uint64_t *sweep_count, double *parse_time, const char **error_position)
+{
+	pthread_t    threads[MAX_THREAD_COUNT];
+	bool         started[MAX_THREAD_COUNT];
+	const size_t length     = (size_t)(end - begin);
+	const char   *position  = begin;
+	size_t       value_size = acc_capture_format_value_size(chunks[0].value_type);
+
+	for (unsigned int i = 0; i < chunk_count; i++)
+	{
+		const char *chunk_end = (i == chunk_count - 1) ? end : begin + length / chunk_count * (i + 1);
+
+		if (chunk_end <= position)
+		{
+			chunk_end = position;
+		}
+		else if (chunk_end < end)
+		{
+			const char *newline = memchr(chunk_end - 1, '\n', (size_t)(end - chunk_end + 1));
+
+			chunk_end = (newline != NULL) ? newline + 1 : end;
+		}
+
+		// Every value takes at least two characters, including its delimiter
+		size_t capacity = (size_t)(chunk_end - position) / 2 + 1;
+
+		if (capacity > chunks[i].capacity)
+		{
+			void *values = realloc(chunks[i].values, capacity * value_size);
+
+			if (values == NULL)
+			{
+				fprintf(stderr, "Out of memory\n");
+				return false;
+			}
+
+			chunks[i].values   = values;
+			chunks[i].capacity = capacity;
+		}
+
+		chunks[i].begin    = position;
+		chunks[i].end      = chunk_end;
+		chunks[i].read_end = read_end;
+		position           = chunk_end;
+	}
+
+	double start = get_time();
+
+	for (unsigned int i = 1; i < chunk_count; i++)
+	{
+		started[i] = (chunks[i].begin < chunks[i].end) && pthread_create(&threads[i], NULL, parse_chunk, &chunks[i]) == 0;
+
+		if (!started[i])
+		{
+			parse_chunk(&chunks[i]);
+		}
+	}
+
+	parse_chunk(&chunks[0]);
+
+	for (unsigned int i = 1; i < chunk_count; i++)
+	{
+		if (started[i])
+		{
+			pthread_join(threads[i], NULL);
+		}
+	}
+
+	*parse_time += get_time() - start;
+
+	for (unsigned int i = 0; i < chunk_count; i++)
+	{
+		if (chunks[i].error_position != NULL)
+		{
+			*error_position = chunks[i].error_position;
+			fprintf(stderr, "Invalid line, %s\n", chunks[i].error_message);
+			return false;
+		}
+
+		size_t count = (size_t)chunks[i].sweep_count * chunks[i].values_per_sweep;
+
+		if (fwrite(chunks[i].values, value_size, count, output) != count)
+		{
+			fprintf(stderr, "Failed to write output: %s\n", strerror(errno));
+			return false;
+		}
+
+		*sweep_count += chunks[i].sweep_count;
+	}
+
+	return true;
+}
+
+bool convert(const char *input_path, const char *output_path, const input_t *input)
+{
+	int fd = open(input_path, O_RDONLY);
+
+	if (fd < 0)
+	{
+		fprintf(stderr, "Failed to open %s: %s\n", input_path, strerror(errno));
+		return false;
+	}
+
+	struct stat file_stat;
+
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		fprintf(stderr, "%s is empty\n", input_path);
+		close(fd);
+		return false;
+	}
+
+	FILE *output = fopen(output_path, "wb");
+
+	if (output == NULL)
+	{
+		fprintf(stderr, "Failed to open %s: %s\n", output_path, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	setvbuf(output, output_buffer, _IOFBF, sizeof(output_buffer));
+
+	const uint64_t file_size   = (uint64_t)file_stat.st_size;
+	const uint64_t page_size   = (uint64_t)sysconf(_SC_PAGESIZE);
+	const size_t   window_size = (size_t)input->thread_count * CHUNK_SIZE;
+
+	chunk_t                     chunks[MAX_THREAD_COUNT];
+	acc_capture_format_header_t header;
+	uint8_t                     header_buffer[ACC_CAPTURE_FORMAT_HEADER_SIZE];
+	uint64_t                    offset      = 0;
+	double                      parse_time  = 0.0;
+	double                      start       = get_time();
+	bool                        status      = true;
+
+	memset(chunks, 0, sizeof(chunks));
+	memset(&header, 0, sizeof(header));
+	header.value_type  = input->value_type;
+	header.flags       = input->complex ? ACC_CAPTURE_FORMAT_FLAG_COMPLEX : 0;
+	header.start_m     = input->start_m;
+	header.length_m    = input->length_m;
+	header.update_rate = input->update_rate;
+	header.sensor      = input->sensor;
+
+	while (status && offset < file_size)
+	{
+		uint64_t map_offset = offset & ~(page_size - 1);
+		uint64_t map_length = (offset - map_offset) + window_size;
+
+		if (map_length > file_size - map_offset)
+		{
+			map_length = file_size - map_offset;
+		}
+
+		char *map = mmap(NULL, (size_t)map_length, PROT_READ, MAP_PRIVATE, fd, (off_t)map_offset);
+
+		if (map == MAP_FAILED)
+		{
+			fprintf(stderr, "Failed to map %s: %s\n", input_path, strerror(errno));
+			status = false;
+			break;
+		}
+
+		madvise(map, (size_t)map_length, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+		const char *begin    = map + (offset - map_offset);
+		const char *read_end = map + map_length;
+		const char *end      = read_end;
+
+		if (map_offset + map_length < file_size)
+		{
+			const char *newline = memrchr(begin, '\n', (size_t)(read_end - begin));
+
+			if (newline == NULL)
+			{
+				fprintf(stderr, "Line at byte %llu is longer than %u bytes\n", (unsigned long long)offset,
+				        (unsigned int)window_size);
+				munmap(map, (size_t)map_length);
+				status = false;
+				break;
+			}
+
+			end = newline + 1;
+		}
+
+		if (header.values_per_sweep == 0)
+		{
+			bool integers;
+
+			if (!inspect_first_line(begin, end, &header.values_per_sweep, &integers))
+			{
+				fprintf(stderr, "%s has no sweeps\n", input_path);
+				munmap(map, (size_t)map_length);
+				status = false;
+				break;
+			}
+
+			if (header.value_type == 0)
+			{
+				header.value_type = integers ? ACC_CAPTURE_FORMAT_VALUE_UINT16 : ACC_CAPTURE_FORMAT_VALUE_FLOAT32;
+			}
+
+			if (input->complex && (header.values_per_sweep % 2) != 0)
+			{
+				fprintf(stderr, "Complex sweeps must have an even number of values\n");
+				munmap(map, (size_t)map_length);
+				status = false;
+				break;
+			}
+
+			for (unsigned int i = 0; i < input->thread_count; i++)
+			{
+				chunks[i].value_type       = header.value_type;
+				chunks[i].values_per_sweep = header.values_per_sweep;
+			}
+
+			acc_capture_format_header_encode(&header, header_buffer);
+			status = fwrite(header_buffer, 1, sizeof(header_buffer), output) == sizeof(header_buffer);
+		}
+
+		const char *error_position = NULL;
+
+		status = status && convert_region(begin, end, read_end, chunks, input->thread_count, output, &header.sweep_count,
+		                                  &parse_time, &error_position);
+
+		if (error_position != NULL)
+		{
+			fprintf(stderr, "%s: error at byte %llu\n", input_path, (unsigned long long)(map_offset + (uint64_t)(error_position - map)));
+		}
+
+		offset += (uint64_t)(end - begin);
+		munmap(map, (size_t)map_length);
+	}
+
+	for (unsigned int i = 0; i < MAX_THREAD_COUNT; i++)
+	{
+		free(chunks[i].values);
+	}
+
+	close(fd);
+
+	if (status)
+	{
+		acc_capture_format_header_encode(&header, header_buffer);
+		status = fseek(output, 0, SEEK_SET) == 0 && fwrite(header_buffer, 1, sizeof(header_buffer), output) == sizeof(header_buffer);
+	}
+
+	status = (fclose(output) == 0) && status;
+
+	double elapsed = get_time() - start;
+
+	if (!status)
+	{
+		fprintf(stderr, "Failed to convert %s\n", input_path);
+		remove(output_path);
+		return false;
+	}
+
+	double megabytes = (double)file_size / 1e6;
+
+	fprintf(stderr, "%s: %llu sweeps of %u %s values, %.1f MB in %.3f s, %.1f MB/s (parsing %.1f MB/s on %u threads)\n",
+	        output_path, (unsigned long long)header.sweep_count, (unsigned int)header.values_per_sweep,
+	        (header.value_type == ACC_CAPTURE_FORMAT_VALUE_UINT16) ? "u16" : "f32", megabytes, elapsed,
+	        (elapsed > 0.0) ? megabytes / elapsed : 0.0, (parse_time > 0.0) ? megabytes / parse_time : 0.0,
+	        input->thread_count);
+
+	return true;
+}
+
+
+double get_time(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (double)time_ts.tv_sec + (double)time_ts.tv_nsec / 1e9;
+}
+
+
+static void print_usage(void)
+{
+	printf("Usage: acc_capture_convert_tool [OPTION]... FILE...\n\n");
+	printf("Converts tab or comma separated captures to the binary capture format\n\n");
+	printf("-h, --help                this help\n");
+	printf("-o, --out                 path to out file, default FILE with extension .acb, only with one FILE\n");
+	printf("-j, --threads             number of parser threads, default number of cores\n");
+	printf("-t, --type                value type u16 or f32, default u16 if the first line is integers\n");
+	printf("-c, --complex             values are pairs of real and imaginary parts, as IQ data\n");
+	printf("-b, --range-start         start of the range in meters, stored as metadata\n");
+	printf("-e, --range-end           end of the range in meters, stored as metadata\n");
+	printf("-f, --frequency           update rate in Hz, stored as metadata\n");
+	printf("-s, --sensor-id           sensor id, stored as metadata\n");
+}
+
+
+bool parse_options(int argc, char *argv[], input_t *input)
+{
+	static struct option long_options[] =
+	{
+		{"out",         required_argument,  0, 'o'},
+		{"threads",     required_argument,  0, 'j'},
+		{"type",        required_argument,  0, 't'},
+		{"complex",     no_argument,        0, 'c'},
+		{"range-start", required_argument,  0, 'b'},
+		{"range-end",   required_argument,  0, 'e'},
+		{"frequency",   required_argument,  0, 'f'},
+		{"sensor-id",   required_argument,  0, 's'},
+		{"help",        no_argument,        0, 'h'},
+		{NULL,          0,                  NULL, 0}
+	};
+
+	int16_t character_code;
+	int32_t option_index = 0;
+	float   end_m        = 0.0f;
+	long    cores        = sysconf(_SC_NPROCESSORS_ONLN);
+
+	input->thread_count = (cores < 1) ? 1 : (cores > MAX_THREAD_COUNT) ? MAX_THREAD_COUNT : (unsigned int)cores;
+
+	while ((character_code = getopt_long(argc, argv, "o:j:t:cb:e:f:s:h?", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 'o':
+			{
+				input->output_path = optarg;
+				break;
+			}
+			case 'j':
+			{
+				int threads = atoi(optarg);
+
+				if (threads < 1 || threads > MAX_THREAD_COUNT)
+				{
+					fprintf(stderr, "Thread count must be 1 to %u\n", (unsigned int)MAX_THREAD_COUNT);
+					return false;
+				}
+
+				input->thread_count = (unsigned int)threads;
+				break;
+			}
+			case 't':
+			{
+				if (strcmp(optarg, "u16") == 0)
+				{
+					input->value_type = ACC_CAPTURE_FORMAT_VALUE_UINT16;
+				}
+				else if (strcmp(optarg, "f32") == 0)
+				{
+					input->value_type = ACC_CAPTURE_FORMAT_VALUE_FLOAT32;
+				}
+				else
+				{
+					print_usage();
+					return false;
+				}
+
+				break;
+			}
+			case 'c':
+			{
+				input->complex = true;
+				break;
+			}
+			case 'b':
+			{
+				input->start_m = strtof(optarg, NULL);
+				break;
+			}
+			case 'e':
+			{
+				end_m = strtof(optarg, NULL);
+				break;
+			}
+			case 'f':
+			{
+				input->update_rate = strtof(optarg, NULL);
+				break;
+			}
+			case 's':
+			{
+				input->sensor = (uint32_t)atoi(optarg);
+				break;
+			}
+			case 'h':
+			case '?':
+			default:
+			{
+				print_usage();
+				return false;
+			}
+		}
+	}
+
+	if (end_m > input->start_m)
+	{
+		input->length_m = end_m - input->start_m;
+	}
+
+	input->input_paths = &argv[optind];
+	input->input_count = argc - optind;
+
+	if (input->input_count == 0 || (input->output_path != NULL && input->input_count > 1))
+	{
+		print_usage();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,125 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "acc_capture_format.h"
+
+
+static const uint8_t magic[4] = {'A', 'C', 'C', 'B'};
+
+
+static void put_u16(uint8_t *buffer, uint16_t value);
+static void put_u32(uint8_t *buffer, uint32_t value);
+static void put_float(uint8_t *buffer, float value);
+static uint16_t get_u16(const uint8_t *buffer);
+static uint32_t get_u32(const uint8_t *buffer);
+static float get_float(const uint8_t *buffer);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+size_t acc_capture_format_value_size(acc_capture_format_value_type_t value_type)
+{
+	switch (value_type)
+	{
+		case ACC_CAPTURE_FORMAT_VALUE_UINT16:
+			return sizeof(uint16_t);
+		case ACC_CAPTURE_FORMAT_VALUE_FLOAT32:
+			return sizeof(float);
+		default:
+			return 0;
+	}
+}
+
+
+void acc_capture_format_header_encode(const acc_capture_format_header_t *header, uint8_t *buffer)
+{
+	memset(buffer, 0, ACC_CAPTURE_FORMAT_HEADER_SIZE);
+	memcpy(buffer, magic, sizeof(magic));
+	put_u16(buffer + 4, ACC_CAPTURE_FORMAT_VERSION);
+	put_u16(buffer + 6, ACC_CAPTURE_FORMAT_HEADER_SIZE);
+	put_u16(buffer + 8, header->value_type);
+	put_u16(buffer + 10, header->flags);
+	put_u32(buffer + 12, header->values_per_sweep);
+	put_u32(buffer + 16, (uint32_t)header->sweep_count);
+	put_u32(buffer + 20, (uint32_t)(header->sweep_count >> 32));
+	put_float(buffer + 24, header->start_m);
+	put_float(buffer + 28, header->length_m);
+	put_float(buffer + 32, header->update_rate);
+	put_u32(buffer + 36, header->sensor);
+}
+
+
+bool acc_capture_format_header_decode(acc_capture_format_header_t *header, const uint8_t *buffer, size_t size)
+{
+	if (size < ACC_CAPTURE_FORMAT_HEADER_SIZE || memcmp(buffer, magic, sizeof(magic)) != 0 ||
+	    get_u16(buffer + 4) != ACC_CAPTURE_FORMAT_VERSION || get_u16(buffer + 6) != ACC_CAPTURE_FORMAT_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	header->value_type       = get_u16(buffer + 8);
+	header->flags            = get_u16(buffer + 10);
+	header->values_per_sweep = get_u32(buffer + 12);
+	header->sweep_count      = (uint64_t)get_u32(buffer + 16) | ((uint64_t)get_u32(buffer + 20) << 32);
+	header->start_m          = get_float(buffer + 24);
+	header->length_m         = get_float(buffer + 28);
+	header->update_rate      = get_float(buffer + 32);
+	header->sensor           = get_u32(buffer + 36);
+
+	return acc_capture_format_value_size(header->value_type) > 0;
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+void put_u16(uint8_t *buffer, uint16_t value)
+{
+	buffer[0] = value & 0xff;
+	buffer[1] = value >> 8;
+}
+
+
+void put_u32(uint8_t *buffer, uint32_t value)
+{
+	put_u16(buffer, value & 0xffff);
+	put_u16(buffer + 2, value >> 16);
+}
+
+
+void put_float(uint8_t *buffer, float value)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	put_u32(buffer, bits);
+}
+
+
+uint16_t get_u16(const uint8_t *buffer)
+{
+	return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+
+uint32_t get_u32(const uint8_t *buffer)
+{
+	return get_u16(buffer) | ((uint32_t)get_u16(buffer + 2) << 16);
+}
+
+
+float get_float(const uint8_t *buffer)
+{
+	uint32_t bits = get_u32(buffer);
+	float    value;
+
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
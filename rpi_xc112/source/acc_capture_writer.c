@@ -0,0 +1,1098 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#include "acc_capture_writer.h"
+
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "capture_writer"
+
+#define MAGIC_NUMBER (0xACC0CA97)
+
+// IORING_FEAT_RW_CUR_POS came with the same kernel headers as IORING_OP_FALLOCATE
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define HAVE_IO_URING 1
+#else
+#define HAVE_IO_URING 0
+#endif
+
+#define ALIGNMENT                4096
+#define DEFAULT_BLOCK_SIZE       (256 * 1024)
+#define DEFAULT_BUFFER_COUNT     8
+#define DEFAULT_THREAD_COUNT     2
+#define DEFAULT_PREALLOCATE_SIZE (64 * 1024 * 1024)
+#define MAX_THREAD_COUNT         8
+
+
+typedef enum
+{
+	BLOCK_FREE,
+	BLOCK_IN_FLIGHT,
+	BLOCK_DONE
+} block_state_t;
+
+
+typedef struct
+{
+	uint8_t       *data;
+	size_t        fill;
+	size_t        length;
+	size_t        done;
+	uint64_t      offset;
+	struct iovec  iov;
+	uint64_t      first_write_us;
+	uint64_t      submit_us;
+	uint64_t      complete_us;
+	int           error;
+	block_state_t state;
+} block_t;
+
+
+#if HAVE_IO_URING
+typedef struct
+{
+	int                 fd;
+	uint32_t            entries;
+	uint32_t            *sq_tail;
+	uint32_t            *sq_mask;
+	uint32_t            *sq_array;
+	uint32_t            *cq_head;
+	uint32_t            *cq_tail;
+	uint32_t            *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void                *sq_ring;
+	size_t              sq_ring_size;
+	void                *cq_ring;
+	size_t              cq_ring_size;
+	size_t              sqes_size;
+	bool                fixed_buffers;
+	bool                fallocate_supported;
+} uring_t;
+#endif
+
+
+typedef struct acc_capture_writer
+{
+	uint32_t                        magic_number;
+	int                             fd;
+	size_t                          block_size;
+	uint16_t                        buffer_count;
+	uint8_t                         *pool;
+	block_t                         *blocks;
+	uint16_t                        current;
+	uint64_t                        next_offset;
+	uint64_t                        allocated_size;
+	uint64_t                        preallocate_size;
+	bool                            fallocate_pending;
+	int                             fallocate_error;
+	bool                            failed;
+	acc_capture_writer_statistics_t statistics;
+#if HAVE_IO_URING
+	uring_t                         uring;
+#endif
+	pthread_t                       threads[MAX_THREAD_COUNT];
+	uint16_t                        thread_count;
+	pthread_mutex_t                 mutex;
+	pthread_cond_t                  job_cond;
+	pthread_cond_t                  done_cond;
+	uint16_t                        *queue;
+	uint16_t                        queue_head;
+	uint16_t                        queue_count;
+	bool                            stop;
+} acc_capture_writer_internal_t;
+
+
+static bool handle_valid(acc_capture_writer_t writer);
+static bool backend_running(acc_capture_writer_t writer);
+static uint64_t get_time_us(void);
+static bool start_threads(acc_capture_writer_t writer, uint16_t thread_count);
+static void stop_threads(acc_capture_writer_t writer);
+static void *worker_thread(void *arg);
+static int run_job(acc_capture_writer_t writer, uint16_t job);
+static void submit_block(acc_capture_writer_t writer, uint16_t index);
+static void submit_fallocate(acc_capture_writer_t writer);
+static void submit_job(acc_capture_writer_t writer, uint16_t job);
+static bool wait_for_block(acc_capture_writer_t writer, block_t *block);
+static void wait_for_fallocate(acc_capture_writer_t writer);
+static void collect_completions(acc_capture_writer_t writer);
+static void retire_block(acc_capture_writer_t writer, block_t *block);
+static void update_maximum(uint32_t *maximum, uint64_t value);
+
+#if HAVE_IO_URING
+static bool uring_start(acc_capture_writer_t writer);
+static void uring_stop(acc_capture_writer_t writer);
+static void uring_submit_write(acc_capture_writer_t writer, uint16_t index);
+static void uring_submit_fallocate(acc_capture_writer_t writer);
+static void uring_enter(acc_capture_writer_t writer, uint32_t to_submit, uint32_t min_complete);
+static void uring_reap(acc_capture_writer_t writer);
+#endif
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+void acc_capture_writer_configuration_default(acc_capture_writer_configuration_t *configuration)
+{
+	configuration->backend          = ACC_CAPTURE_WRITER_BACKEND_AUTO;
+	configuration->block_size       = DEFAULT_BLOCK_SIZE;
+	configuration->buffer_count     = DEFAULT_BUFFER_COUNT;
+	configuration->thread_count     = DEFAULT_THREAD_COUNT;
+	configuration->preallocate_size = DEFAULT_PREALLOCATE_SIZE;
+	configuration->direct           = true;
+}
+
+
+acc_capture_writer_t acc_capture_writer_create(const char *file_path, const acc_capture_writer_configuration_t *configuration)
+{
+	if (file_path == NULL || configuration->block_size == 0 || configuration->buffer_count == 0 ||
+	    configuration->thread_count == 0 || configuration->thread_count > MAX_THREAD_COUNT)
+	{
+		ACC_LOG_ERROR("Invalid configuration");
+		return NULL;
+	}
+
+	acc_capture_writer_t writer = acc_os_mem_alloc(sizeof(*writer));
+
+	if (writer == NULL)
+	{
+		return NULL;
+	}
+
+	memset(writer, 0, sizeof(*writer));
+
+	writer->magic_number     = MAGIC_NUMBER;
+	writer->block_size       = (configuration->block_size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+	writer->buffer_count     = configuration->buffer_count;
+	writer->preallocate_size = (configuration->preallocate_size + ALIGNMENT - 1) & ~(uint64_t)(ALIGNMENT - 1);
+	writer->pool             = MAP_FAILED;
+
+	writer->statistics.direct = configuration->direct;
+	writer->fd                = open(file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | (configuration->direct ? O_DIRECT : 0),
+	                                 0666);
+
+	if (writer->fd < 0 && configuration->direct && errno == EINVAL)
+	{
+		ACC_LOG_DEBUG("O_DIRECT not supported, writing through the page cache");
+		writer->statistics.direct = false;
+		writer->fd                = open(file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	}
+
+	if (writer->fd < 0)
+	{
+		ACC_LOG_ERROR("Failed to open %s: %s", file_path, strerror(errno));
+		acc_os_mem_free(writer);
+		return NULL;
+	}
+
+	if (writer->preallocate_size > 0)
+	{
+		// The size is kept, so that the file only shows written data
+		if (fallocate(writer->fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)writer->preallocate_size) == 0)
+		{
+			writer->allocated_size = writer->preallocate_size;
+		}
+		else
+		{
+			ACC_LOG_DEBUG("fallocate not supported: %s", strerror(errno));
+			writer->preallocate_size = 0;
+		}
+	}
+
+	writer->pool   = mmap(NULL, writer->block_size * writer->buffer_count, PROT_READ | PROT_WRITE,
+	                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	writer->blocks = acc_os_mem_alloc(sizeof(*writer->blocks) * writer->buffer_count);
+	writer->queue  = acc_os_mem_alloc(sizeof(*writer->queue) * (writer->buffer_count + 1U));
+
+	if (writer->pool != MAP_FAILED)
+	{
+		acc_os_memory_mapped(REL_FILE_PATH, writer->block_size * writer->buffer_count);
+	}
+
+	if (writer->pool == MAP_FAILED || writer->blocks == NULL || writer->queue == NULL)
+	{
+		ACC_LOG_ERROR("Failed to allocate blocks");
+		acc_capture_writer_destroy(&writer);
+		return NULL;
+	}
+
+	memset(writer->blocks, 0, sizeof(*writer->blocks) * writer->buffer_count);
+
+	for (uint16_t i = 0; i < writer->buffer_count; i++)
+	{
+		writer->blocks[i].data = writer->pool + (size_t)i * writer->block_size;
+	}
+
+	bool started = false;
+
+#if HAVE_IO_URING
+	if (configuration->backend != ACC_CAPTURE_WRITER_BACKEND_THREADS)
+	{
+		started = uring_start(writer);
+	}
+#endif
+
+	if (!started)
+	{
+		if (configuration->backend == ACC_CAPTURE_WRITER_BACKEND_IO_URING)
+		{
+			ACC_LOG_DEBUG("io_uring not supported, writing with threads");
+		}
+
+		started = start_threads(writer, configuration->thread_count);
+	}
+
+	if (!started)
+	{
+		ACC_LOG_ERROR("Failed to start writing");
+		acc_capture_writer_destroy(&writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+
+bool acc_capture_writer_destroy(acc_capture_writer_t *writer)
+{
+	bool success = true;
+
+	if (writer != NULL && *writer != NULL)
+	{
+		acc_capture_writer_t w = *writer;
+
+		if (handle_valid(w))
+		{
+			if (backend_running(w))
+			{
+				block_t *block = &w->blocks[w->current];
+
+				if (block->fill > 0 && block->length == 0 && !w->failed)
+				{
+					// O_DIRECT writes whole aligned blocks, the padding is truncated below
+					size_t length = (block->fill + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+					memset(block->data + block->fill, 0, length - block->fill);
+					block->length = length;
+					submit_block(w, w->current);
+				}
+
+				for (uint16_t i = 0; i < w->buffer_count; i++)
+				{
+					wait_for_block(w, &w->blocks[i]);
+				}
+
+				wait_for_fallocate(w);
+			}
+
+			stop_threads(w);
+#if HAVE_IO_URING
+			uring_stop(w);
+#endif
+
+			if (ftruncate(w->fd, (off_t)w->statistics.bytes) != 0)
+			{
+				ACC_LOG_ERROR("Failed to truncate capture: %s", strerror(errno));
+				w->failed = true;
+			}
+
+			if (close(w->fd) != 0)
+			{
+				w->failed = true;
+			}
+
+			success = !w->failed;
+
+			if (w->pool != MAP_FAILED)
+			{
+				munmap(w->pool, w->block_size * w->buffer_count);
+				acc_os_memory_unmapped(REL_FILE_PATH, w->block_size * w->buffer_count);
+			}
+
+			if (w->blocks != NULL)
+			{
+				acc_os_mem_free(w->blocks);
+			}
+
+			if (w->queue != NULL)
+			{
+				acc_os_mem_free(w->queue);
+			}
+
+			w->magic_number = 0;
+			acc_os_mem_free(w);
+		}
+
+		*writer = NULL;
+	}
+
+	return success;
+}
+
+
+bool acc_capture_writer_write(acc_capture_writer_t writer, const void *data, size_t size)
+{
+	if (!handle_valid(writer))
+	{
+		return false;
+	}
+
+	uint64_t      start_us = get_time_us();
+	const uint8_t *source  = data;
+
+#if HAVE_IO_URING
+	if (writer->uring.fd > 0)
+	{
+		uring_reap(writer);
+	}
+#endif
+
+	while (size > 0 && !writer->failed)
+	{
+		block_t *block = &writer->blocks[writer->current];
+
+		// A block with a length has been submitted, it is reused when written
+		if (block->length != 0 && wait_for_block(writer, block))
+		{
+			writer->statistics.stall_count++;
+		}
+
+		if (block->fill == 0)
+		{
+			block->first_write_us = start_us;
+		}
+
+		size_t chunk = writer->block_size - block->fill;
+
+		if (chunk > size)
+		{
+			chunk = size;
+		}
+
+		memcpy(block->data + block->fill, source, chunk);
+		block->fill                += chunk;
+		source                     += chunk;
+		size                       -= chunk;
+		writer->statistics.bytes   += chunk;
+
+		if (block->fill == writer->block_size)
+		{
+			block->length = writer->block_size;
+			submit_block(writer, writer->current);
+			writer->current = (uint16_t)((writer->current + 1) % writer->buffer_count);
+		}
+	}
+
+	update_maximum(&writer->statistics.max_write_time_us, get_time_us() - start_us);
+
+	return !writer->failed;
+}
+
+
+bool acc_capture_writer_wait(acc_capture_writer_t writer)
+{
+	if (!handle_valid(writer))
+	{
+		return false;
+	}
+
+	for (uint16_t i = 0; i < writer->buffer_count; i++)
+	{
+		if (writer->blocks[i].length != 0)
+		{
+			wait_for_block(writer, &writer->blocks[i]);
+		}
+	}
+
+	return !writer->failed;
+}
+
+
+void acc_capture_writer_get_statistics(acc_capture_writer_t writer, acc_capture_writer_statistics_t *statistics)
+{
+	if (handle_valid(writer))
+	{
+		collect_completions(writer);
+		*statistics = writer->statistics;
+	}
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+bool handle_valid(acc_capture_writer_t writer)
+{
+	if (writer == NULL || writer->magic_number != MAGIC_NUMBER)
+	{
+		ACC_LOG_ERROR("Invalid handle");
+		return false;
+	}
+
+	return true;
+}
+
+
+bool backend_running(acc_capture_writer_t writer)
+{
+#if HAVE_IO_URING
+	if (writer->uring.fd > 0)
+	{
+		return true;
+	}
+#endif
+
+	return writer->thread_count > 0;
+}
+
+
+uint64_t get_time_us(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (uint64_t)time_ts.tv_sec * 1000000 + (uint64_t)time_ts.tv_nsec / 1000;
+}
+
+
+bool start_threads(acc_capture_writer_t writer, uint16_t thread_count)
+{
+	if (pthread_mutex_init(&writer->mutex, NULL) != 0)
+	{
+		return false;
+	}
+
+	pthread_cond_init(&writer->job_cond, NULL);
+	pthread_cond_init(&writer->done_cond, NULL);
+
+	writer->statistics.backend = ACC_CAPTURE_WRITER_BACKEND_THREADS;
+
+	for (uint16_t i = 0; i < thread_count; i++)
+	{
+		if (pthread_create(&writer->threads[i], NULL, worker_thread, writer) != 0)
+		{
+			break;
+		}
+
+		writer->thread_count++;
+	}
+
+	return writer->thread_count > 0;
+}
+
+
+void stop_threads(acc_capture_writer_t writer)
+{
+	if (writer->thread_count == 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&writer->mutex);
+	writer->stop = true;
+	pthread_cond_broadcast(&writer->job_cond);
+	pthread_mutex_unlock(&writer->mutex);
+
+	for (uint16_t i = 0; i < writer->thread_count; i++)
+	{
+		pthread_join(writer->threads[i], NULL);
+	}
+
+	writer->thread_count = 0;
+	pthread_cond_destroy(&writer->done_cond);
+	pthread_cond_destroy(&writer->job_cond);
+	pthread_mutex_destroy(&writer->mutex);
+}
+
+
+void *worker_thread(void *arg)
+{
+	acc_capture_writer_t writer = arg;
+
+	pthread_mutex_lock(&writer->mutex);
+
+	while (true)
+	{
+		while (writer->queue_count == 0 && !writer->stop)
+		{
+			pthread_cond_wait(&writer->job_cond, &writer->mutex);
+		}
+
+		if (writer->queue_count == 0)
+		{
+			break;
+		}
+
+		uint16_t job = writer->queue[writer->queue_head];
+
+		writer->queue_head = (uint16_t)((writer->queue_head + 1) % (writer->buffer_count + 1U));
+		writer->queue_count--;
+
+		pthread_mutex_unlock(&writer->mutex);
+
+		int      error       = run_job(writer, job);
+		uint64_t complete_us = get_time_us();
+
+		pthread_mutex_lock(&writer->mutex);
+
+		if (job == writer->buffer_count)
+		{
+			writer->fallocate_error   = error;
+			writer->fallocate_pending = false;
+		}
+		else
+		{
+			writer->blocks[job].error       = error;
+			writer->blocks[job].complete_us = complete_us;
+			writer->blocks[job].state       = BLOCK_DONE;
+		}
+
+		pthread_cond_broadcast(&writer->done_cond);
+	}
+
+	pthread_mutex_unlock(&writer->mutex);
+
+	return NULL;
+}
+
+
+/**
+ * @brief Run a job of the threads backend, a block index or buffer_count for fallocate
+ *
+ * @return 0 if successful, otherwise an errno value
+ */
+int run_job(acc_capture_writer_t writer, uint16_t job)
+{
+	if (job == writer->buffer_count)
+	{
+		off_t offset = (off_t)(writer->allocated_size - writer->preallocate_size);
+
+		return (fallocate(writer->fd, FALLOC_FL_KEEP_SIZE, offset, (off_t)writer->preallocate_size) == 0) ? 0 : errno;
+	}
+
+	block_t *block = &writer->blocks[job];
+
+	while (block->done < block->length)
+	{
+		ssize_t result = pwrite(writer->fd, block->data + block->done, block->length - block->done,
+		                        (off_t)(block->offset + block->done));
+
+		if (result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (result <= 0)
+		{
+			return (result < 0) ? errno : EIO;
+		}
+
+		block->done += (size_t)result;
+	}
+
+	return 0;
+}
+
+
+void submit_block(acc_capture_writer_t writer, uint16_t index)
+{
+	block_t *block = &writer->blocks[index];
+
+	block->offset       = writer->next_offset;
+	block->done         = 0;
+	block->error        = 0;
+	block->submit_us    = get_time_us();
+	block->state        = BLOCK_IN_FLIGHT;
+	writer->next_offset += block->length;
+
+	submit_job(writer, index);
+
+	// Allocate the next part of the file while there is still half a preallocation left
+	if (writer->preallocate_size > 0 && writer->next_offset + writer->preallocate_size / 2 > writer->allocated_size)
+	{
+		submit_fallocate(writer);
+	}
+}
+
+
+void submit_fallocate(acc_capture_writer_t writer)
+{
+	// The worker threads finish a preallocation under the mutex
+	if (writer->thread_count > 0)
+	{
+		pthread_mutex_lock(&writer->mutex);
+	}
+
+	bool pending = writer->fallocate_pending;
+	int  error   = writer->fallocate_error;
+
+	if (!pending && error == 0)
+	{
+		writer->fallocate_pending = true;
+	}
+
+	if (writer->thread_count > 0)
+	{
+		pthread_mutex_unlock(&writer->mutex);
+	}
+
+	if (pending)
+	{
+		return;
+	}
+
+	if (error != 0)
+	{
+		ACC_LOG_DEBUG("Preallocation stopped: %s", strerror(error));
+		writer->preallocate_size = 0;
+		return;
+	}
+
+	writer->allocated_size += writer->preallocate_size;
+
+#if HAVE_IO_URING
+	if (writer->uring.fd > 0)
+	{
+		uring_submit_fallocate(writer);
+		return;
+	}
+#endif
+
+	submit_job(writer, writer->buffer_count);
+}
+
+
+void submit_job(acc_capture_writer_t writer, uint16_t job)
+{
+#if HAVE_IO_URING
+	if (writer->uring.fd > 0)
+	{
+		uring_submit_write(writer, job);
+		return;
+	}
+#endif
+
+	pthread_mutex_lock(&writer->mutex);
+	writer->queue[(writer->queue_head + writer->queue_count) % (writer->buffer_count + 1U)] = job;
+	writer->queue_count++;
+	pthread_cond_signal(&writer->job_cond);
+	pthread_mutex_unlock(&writer->mutex);
+}
+
+
+/**
+ * @brief Wait until a block is no longer in flight and retire it
+ *
+ * @return True if the block was in flight
+ */
+bool wait_for_block(acc_capture_writer_t writer, block_t *block)
+{
+	bool waited = false;
+
+#if HAVE_IO_URING
+	if (writer->uring.fd > 0)
+	{
+		uring_reap(writer);
+
+		while (block->state == BLOCK_IN_FLIGHT)
+		{
+			waited = true;
+			uring_enter(writer, 0, 1);
+			uring_reap(writer);
+		}
+
+		retire_block(writer, block);
+		return waited;
+	}
+#endif
+
+	if (writer->thread_count > 0)
+	{
+		pthread_mutex_lock(&writer->mutex);
+
+		while (block->state == BLOCK_IN_FLIGHT)
+		{
+			waited = true;
+			pthread_cond_wait(&writer->done_cond, &writer->mutex);
+		}
+
+		pthread_mutex_unlock(&writer->mutex);
+	}
+
+	retire_block(writer, block);
+
+	return waited;
+}
+
+
+void wait_for_fallocate(acc_capture_writer_t writer)
+{
+#if HAVE_IO_URING
+	if (writer->uring.fd > 0)
+	{
+		while (writer->fallocate_pending)
+		{
+			uring_enter(writer, 0, 1);
+			uring_reap(writer);
+		}
+
+		return;
+	}
+#endif
+
+	if (writer->thread_count > 0)
+	{
+		pthread_mutex_lock(&writer->mutex);
+
+		while (writer->fallocate_pending)
+		{
+			pthread_cond_wait(&writer->done_cond, &writer->mutex);
+		}
+
+		pthread_mutex_unlock(&writer->mutex);
+	}
+}
+
+
+/**
+ * @brief Retire all blocks that have been written, without waiting
+ */
+void collect_completions(acc_capture_writer_t writer)
+{
+#if HAVE_IO_URING
+	if (writer->uring.fd > 0)
+	{
+		uring_reap(writer);
+	}
+#endif
+
+	if (writer->thread_count > 0)
+	{
+		pthread_mutex_lock(&writer->mutex);
+	}
+
+	for (uint16_t i = 0; i < writer->buffer_count; i++)
+	{
+		retire_block(writer, &writer->blocks[i]);
+	}
+
+	if (writer->thread_count > 0)
+	{
+		pthread_mutex_unlock(&writer->mutex);
+	}
+}
+
+
+void retire_block(acc_capture_writer_t writer, block_t *block)
+{
+	if (block->state != BLOCK_DONE)
+	{
+		return;
+	}
+
+	if (block->error != 0)
+	{
+		ACC_LOG_ERROR("Failed to write capture: %s", strerror(block->error));
+		writer->failed = true;
+	}
+
+	update_maximum(&writer->statistics.max_latency_us, block->complete_us - block->first_write_us);
+	update_maximum(&writer->statistics.max_io_time_us, block->complete_us - block->submit_us);
+	writer->statistics.block_count++;
+
+	block->fill   = 0;
+	block->length = 0;
+	block->state  = BLOCK_FREE;
+}
+
+
+void update_maximum(uint32_t *maximum, uint64_t value)
+{
+	if (value > *maximum)
+	{
+		*maximum = (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
+	}
+}
+
+
+#if HAVE_IO_URING
+/**
+ * @brief Set up an io_uring with room for all blocks and a fallocate, and register the blocks
+ */
+bool uring_start(acc_capture_writer_t writer)
+{
+	struct io_uring_params params;
+	uring_t                *uring = &writer->uring;
+
+	memset(&params, 0, sizeof(params));
+
+	int fd = (int)syscall(__NR_io_uring_setup, writer->buffer_count + 1U, &params);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	uring->fd                  = fd;
+	uring->entries             = params.sq_entries;
+	uring->sq_ring_size        = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	uring->cq_ring_size        = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	uring->sqes_size           = params.sq_entries * sizeof(struct io_uring_sqe);
+	uring->fallocate_supported = true;
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (uring->cq_ring_size > uring->sq_ring_size)
+		{
+			uring->sq_ring_size = uring->cq_ring_size;
+		}
+
+		uring->cq_ring_size = uring->sq_ring_size;
+	}
+
+	uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	uring->cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? uring->sq_ring :
+	                 mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+	if (uring->sq_ring == MAP_FAILED || uring->cq_ring == MAP_FAILED || uring->sqes == MAP_FAILED)
+	{
+		uring_stop(writer);
+		return false;
+	}
+
+	uint8_t *sq_ring = uring->sq_ring;
+	uint8_t *cq_ring = uring->cq_ring;
+
+	uring->sq_tail  = (uint32_t *)(void *)(sq_ring + params.sq_off.tail);
+	uring->sq_mask  = (uint32_t *)(void *)(sq_ring + params.sq_off.ring_mask);
+	uring->sq_array = (uint32_t *)(void *)(sq_ring + params.sq_off.array);
+	uring->cq_head  = (uint32_t *)(void *)(cq_ring + params.cq_off.head);
+	uring->cq_tail  = (uint32_t *)(void *)(cq_ring + params.cq_off.tail);
+	uring->cq_mask  = (uint32_t *)(void *)(cq_ring + params.cq_off.ring_mask);
+	uring->cqes     = (struct io_uring_cqe *)(void *)(cq_ring + params.cq_off.cqes);
+
+	// Fixed buffers save mapping the pages on every write, the memlock limit may not allow them
+	struct iovec iovecs[writer->buffer_count];
+
+	for (uint16_t i = 0; i < writer->buffer_count; i++)
+	{
+		iovecs[i].iov_base = writer->blocks[i].data;
+		iovecs[i].iov_len  = writer->block_size;
+	}
+
+	uring->fixed_buffers = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs, writer->buffer_count) == 0;
+
+	writer->statistics.backend = ACC_CAPTURE_WRITER_BACKEND_IO_URING;
+
+	return true;
+}
+
+
+void uring_stop(acc_capture_writer_t writer)
+{
+	uring_t *uring = &writer->uring;
+
+	if (uring->fd <= 0)
+	{
+		return;
+	}
+
+	if (uring->sqes != NULL && uring->sqes != MAP_FAILED)
+	{
+		munmap(uring->sqes, uring->sqes_size);
+	}
+
+	if (uring->cq_ring != NULL && uring->cq_ring != MAP_FAILED && uring->cq_ring != uring->sq_ring)
+	{
+		munmap(uring->cq_ring, uring->cq_ring_size);
+	}
+
+	if (uring->sq_ring != NULL && uring->sq_ring != MAP_FAILED)
+	{
+		munmap(uring->sq_ring, uring->sq_ring_size);
+	}
+
+	close(uring->fd);
+	memset(uring, 0, sizeof(*uring));
+}
+
+
+static struct io_uring_sqe *uring_get_sqe(acc_capture_writer_t writer)
+{
+	uring_t  *uring = &writer->uring;
+	uint32_t tail   = *uring->sq_tail;
+	uint32_t index  = tail & *uring->sq_mask;
+
+	// Every entry is submitted right away, so the kernel has consumed the entry at the tail
+	uring->sq_array[index] = index;
+
+	struct io_uring_sqe *sqe = &uring->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+
+	return sqe;
+}
+
+
+static void uring_push_sqe(acc_capture_writer_t writer)
+{
+	uring_t *uring = &writer->uring;
+
+	__atomic_store_n(uring->sq_tail, *uring->sq_tail + 1, __ATOMIC_RELEASE);
+	uring_enter(writer, 1, 0);
+}
+
+
+void uring_submit_write(acc_capture_writer_t writer, uint16_t index)
+{
+	block_t             *block = &writer->blocks[index];
+	struct io_uring_sqe *sqe   = uring_get_sqe(writer);
+
+	sqe->fd        = writer->fd;
+	sqe->off       = block->offset + block->done;
+	sqe->user_data = index;
+
+	if (writer->uring.fixed_buffers)
+	{
+		sqe->opcode    = IORING_OP_WRITE_FIXED;
+		sqe->addr      = (uint64_t)(uintptr_t)(block->data + block->done);
+		sqe->len       = (uint32_t)(block->length - block->done);
+		sqe->buf_index = index;
+	}
+	else
+	{
+		block->iov.iov_base = block->data + block->done;
+		block->iov.iov_len  = block->length - block->done;
+		sqe->opcode         = IORING_OP_WRITEV;
+		sqe->addr           = (uint64_t)(uintptr_t)&block->iov;
+		sqe->len            = 1;
+	}
+
+	uring_push_sqe(writer);
+}
+
+
+void uring_submit_fallocate(acc_capture_writer_t writer)
+{
+	if (!writer->uring.fallocate_supported)
+	{
+		off_t offset = (off_t)(writer->allocated_size - writer->preallocate_size);
+
+		writer->fallocate_error   = (fallocate(writer->fd, FALLOC_FL_KEEP_SIZE, offset, (off_t)writer->preallocate_size) == 0) ? 0 : errno;
+		writer->fallocate_pending = false;
+		return;
+	}
+
+	struct io_uring_sqe *sqe = uring_get_sqe(writer);
+
+	sqe->opcode    = IORING_OP_FALLOCATE;
+	sqe->fd        = writer->fd;
+	sqe->off       = writer->allocated_size - writer->preallocate_size;
+	sqe->addr      = writer->preallocate_size;
+	sqe->len       = FALLOC_FL_KEEP_SIZE;
+	sqe->user_data = writer->buffer_count;
+
+	uring_push_sqe(writer);
+}
+
+
+void uring_enter(acc_capture_writer_t writer, uint32_t to_submit, uint32_t min_complete)
+{
+	unsigned int flags = (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0;
+
+	while (syscall(__NR_io_uring_enter, writer->uring.fd, to_submit, min_complete, flags, NULL, 0) < 0)
+	{
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		{
+			ACC_LOG_ERROR("io_uring_enter failed: %s", strerror(errno));
+			writer->failed = true;
+			return;
+		}
+	}
+}
+
+
+void uring_reap(acc_capture_writer_t writer)
+{
+	uring_t  *uring = &writer->uring;
+	uint32_t head   = *uring->cq_head;
+	uint32_t tail   = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+	{
+		return;
+	}
+
+	uint64_t complete_us = get_time_us();
+
+	for (; head != tail; head++)
+	{
+		struct io_uring_cqe *cqe = &uring->cqes[head & *uring->cq_mask];
+
+		if (cqe->user_data == writer->buffer_count)
+		{
+			if (cqe->res == -EINVAL && uring->fallocate_supported)
+			{
+				// Kernels before 5.6 have no fallocate in io_uring
+				uring->fallocate_supported = false;
+				uring_submit_fallocate(writer);
+			}
+			else
+			{
+				writer->fallocate_error   = (cqe->res < 0) ? -cqe->res : 0;
+				writer->fallocate_pending = false;
+			}
+
+			continue;
+		}
+
+		block_t *block = &writer->blocks[cqe->user_data];
+
+		if (cqe->res > 0)
+		{
+			block->done += (size_t)cqe->res;
+
+			if (block->done < block->length)
+			{
+				uring_submit_write(writer, (uint16_t)cqe->user_data);
+				continue;
+			}
+		}
+
+		block->error       = (cqe->res < 0) ? -cqe->res : ((cqe->res == 0) ? EIO : 0);
+		block->complete_us = complete_us;
+		block->state       = BLOCK_DONE;
+	}
+
+	__atomic_store_n(uring->cq_head, tail, __ATOMIC_RELEASE);
+}
+
+
+#endif
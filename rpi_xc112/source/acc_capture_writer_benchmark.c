@@ -0,0 +1,373 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "acc_capture_writer.h"
+#include "acc_device_os.h"
+#include "acc_driver_os_linux.h"
+
+
+/**
+ * @brief Benchmark of capture writing, buffered write compared with the capture writer backends
+ *
+ * Sweeps of a fixed size are written to a file, as fast as possible or at a given sweep rate.
+ * For each way of writing, the throughput, the longest time a sweep write blocked the
+ * acquisition and, for the capture writer, the longest time from a sweep being written until
+ * it was on disk are reported. The buffered write leaves the data in the page cache, its time
+ * to sync the file at the end is reported instead.
+ */
+
+
+#define DEFAULT_SWEEP_SIZE  8192
+#define DEFAULT_SWEEP_COUNT 20000
+
+
+typedef enum
+{
+	METHOD_BUFFERED,
+	METHOD_THREADS,
+	METHOD_IO_URING,
+	METHOD_COUNT
+} method_t;
+
+
+typedef struct
+{
+	char     *file_path;
+	size_t   sweep_size;
+	uint32_t sweep_count;
+	float    frequency;
+	size_t   block_size;
+	uint16_t buffer_count;
+	int      method;
+} input_t;
+
+
+static const char *method_names[METHOD_COUNT] = {"buffered", "threads", "io_uring"};
+
+
+static bool parse_options(int argc, char *argv[], input_t *input);
+
+
+static bool run(const input_t *input, method_t method, const uint8_t *sweep);
+
+
+int main(int argc, char *argv[])
+{
+	input_t input;
+
+	if (!parse_options(argc, argv, &input))
+	{
+		return EXIT_FAILURE;
+	}
+
+	// The capture writer allocates and logs through the OS layer
+	acc_driver_os_linux_register();
+	acc_os_init();
+
+	uint8_t *sweep = malloc(input.sweep_size);
+
+	if (sweep == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < input.sweep_size; i++)
+	{
+		sweep[i] = (uint8_t)('0' + (i * 7919) % 10);
+	}
+
+	printf("%u sweeps of %zu bytes", (unsigned int)input.sweep_count, input.sweep_size);
+
+	if (input.frequency > 0.0f)
+	{
+		printf(" at %u Hz", (unsigned int)input.frequency);
+	}
+
+	printf(" to %s\n", input.file_path);
+	printf("%-9s %-7s %10s %14s %16s %8s %10s\n", "method", "direct", "MB/s", "max write ms", "max on disk ms", "stalls",
+	       "sync ms");
+
+	bool success = true;
+
+	for (method_t method = METHOD_BUFFERED; method < METHOD_COUNT && success; method++)
+	{
+		if (input.method < 0 || input.method == (int)method)
+		{
+			success = run(&input, method, sweep);
+		}
+	}
+
+	free(sweep);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static uint64_t get_time_us(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (uint64_t)time_ts.tv_sec * 1000000 + (uint64_t)time_ts.tv_nsec / 1000;
+}
+
+
+static void wait_until(uint64_t time_us)
+{
+	struct timespec time_ts;
+
+	time_ts.tv_sec  = (time_t)(time_us / 1000000);
+	time_ts.tv_nsec = (long)(time_us % 1000000) * 1000;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time_ts, NULL) == EINTR)
+	{
+	}
+}
+
+
+bool run(const input_t *input, method_t method, const uint8_t *sweep)
+{
+	acc_capture_writer_t            writer = NULL;
+	acc_capture_writer_statistics_t statistics;
+	int                             fd           = -1;
+	uint64_t                        max_write_us = 0;
+	uint64_t                        sync_us      = 0;
+	uint64_t                        period_us    = (input->frequency > 0.0f) ? (uint64_t)(1e6f / input->frequency) : 0;
+	bool                            success      = true;
+
+	memset(&statistics, 0, sizeof(statistics));
+
+	if (method == METHOD_BUFFERED)
+	{
+		fd = open(input->file_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	}
+	else
+	{
+		acc_capture_writer_configuration_t configuration;
+
+		acc_capture_writer_configuration_default(&configuration);
+		configuration.backend = (method == METHOD_THREADS) ? ACC_CAPTURE_WRITER_BACKEND_THREADS : ACC_CAPTURE_WRITER_BACKEND_IO_URING;
+
+		if (input->block_size > 0)
+		{
+			configuration.block_size = input->block_size;
+		}
+
+		if (input->buffer_count > 0)
+		{
+			configuration.buffer_count = input->buffer_count;
+		}
+
+		writer = acc_capture_writer_create(input->file_path, &configuration);
+
+		// The writer logs the cause, errno is not set by a failed allocation
+		if (writer == NULL)
+		{
+			fprintf(stderr, "acc_capture_writer_create() failed for %s\n", input->file_path);
+			return false;
+		}
+	}
+
+	if (method == METHOD_BUFFERED && fd < 0)
+	{
+		fprintf(stderr, "Failed to open %s: %s\n", input->file_path, strerror(errno));
+		return false;
+	}
+
+	uint64_t start_us = get_time_us();
+
+	for (uint32_t n = 0; n < input->sweep_count && success; n++)
+	{
+		if (period_us > 0)
+		{
+			wait_until(start_us + n * period_us);
+		}
+
+		uint64_t write_start_us = get_time_us();
+
+		if (writer != NULL)
+		{
+			success = acc_capture_writer_write(writer, sweep, input->sweep_size);
+		}
+		else
+		{
+			success = write(fd, sweep, input->sweep_size) == (ssize_t)input->sweep_size;
+		}
+
+		uint64_t write_us = get_time_us() - write_start_us;
+
+		if (write_us > max_write_us)
+		{
+			max_write_us = write_us;
+		}
+	}
+
+	uint64_t sync_start_us = get_time_us();
+
+	if (writer != NULL)
+	{
+		success = acc_capture_writer_wait(writer) && success;
+		acc_capture_writer_get_statistics(writer, &statistics);
+		success = acc_capture_writer_destroy(&writer) && success;
+	}
+	else
+	{
+		success = fdatasync(fd) == 0 && success;
+		success = close(fd) == 0 && success;
+	}
+
+	sync_us = get_time_us() - sync_start_us;
+
+	double seconds   = (double)(get_time_us() - start_us) / 1e6;
+	double megabytes = (double)input->sweep_size * input->sweep_count / 1e6;
+
+	if (!success)
+	{
+		fprintf(stderr, "%s writing failed\n", method_names[method]);
+		return false;
+	}
+
+	if (method != METHOD_BUFFERED)
+	{
+		if (method == METHOD_IO_URING && statistics.backend != ACC_CAPTURE_WRITER_BACKEND_IO_URING)
+		{
+			printf("%-9s io_uring not supported\n", method_names[method]);
+			return true;
+		}
+
+		printf("%-9s %-7s %10.1f %14.2f %16.2f %8u %10.2f\n", method_names[method], statistics.direct ? "yes" : "no",
+		       megabytes / seconds, (double)max_write_us / 1e3, (double)statistics.max_latency_us / 1e3,
+		       (unsigned int)statistics.stall_count, (double)sync_us / 1e3);
+	}
+	else
+	{
+		printf("%-9s %-7s %10.1f %14.2f %16s %8s %10.2f\n", method_names[method], "no", megabytes / seconds,
+		       (double)max_write_us / 1e3, "-", "-", (double)sync_us / 1e3);
+	}
+
+	return true;
+}
+
+
+static void print_usage(void)
+{
+	printf("Usage: acc_capture_writer_benchmark [OPTION]... FILE\n\n");
+	printf("Compares buffered writing of sweeps with the capture writer\n\n");
+	printf("-h, --help                this help\n");
+	printf("-s, --sweep-size          bytes per sweep, default %u\n", (unsigned int)DEFAULT_SWEEP_SIZE);
+	printf("-c, --sweep-count         number of sweeps, default %u\n", (unsigned int)DEFAULT_SWEEP_COUNT);
+	printf("-f, --frequency           sweep rate, default as fast as possible\n");
+	printf("-z, --block-size          capture writer block size in bytes\n");
+	printf("-n, --buffer-count        capture writer number of blocks\n");
+	printf("-m, --method              only run this method, buffered, threads or io_uring\n");
+}
+
+
+bool parse_options(int argc, char *argv[], input_t *input)
+{
+	static struct option long_options[] =
+	{
+		{"sweep-size",   required_argument,  0, 's'},
+		{"sweep-count",  required_argument,  0, 'c'},
+		{"frequency",    required_argument,  0, 'f'},
+		{"block-size",   required_argument,  0, 'z'},
+		{"buffer-count", required_argument,  0, 'n'},
+		{"method",       required_argument,  0, 'm'},
+		{"help",         no_argument,        0, 'h'},
+		{NULL,           0,                  NULL, 0}
+	};
+
+	int16_t character_code;
+	int32_t option_index = 0;
+
+	input->file_path    = NULL;
+	input->sweep_size   = DEFAULT_SWEEP_SIZE;
+	input->sweep_count  = DEFAULT_SWEEP_COUNT;
+	input->frequency    = 0.0f;
+	input->block_size   = 0;
+	input->buffer_count = 0;
+	input->method       = -1;
+
+	while ((character_code = getopt_long(argc, argv, "s:c:f:z:n:m:h?", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 's':
+			{
+				input->sweep_size = (size_t)atol(optarg);
+				break;
+			}
+			case 'c':
+			{
+				input->sweep_count = (uint32_t)atol(optarg);
+				break;
+			}
+			case 'f':
+			{
+				input->frequency = strtof(optarg, NULL);
+				break;
+			}
+			case 'z':
+			{
+				input->block_size = (size_t)atol(optarg);
+				break;
+			}
+			case 'n':
+			{
+				input->buffer_count = (uint16_t)atoi(optarg);
+				break;
+			}
+			case 'm':
+			{
+				for (int method = 0; method < METHOD_COUNT; method++)
+				{
+					if (strcmp(optarg, method_names[method]) == 0)
+					{
+						input->method = method;
+					}
+				}
+
+				if (input->method < 0)
+				{
+					fprintf(stderr, "Unknown method %s\n", optarg);
+					return false;
+				}
+
+				break;
+			}
+			case 'h':
+			case '?':
+			default:
+			{
+				print_usage();
+				return false;
+			}
+		}
+	}
+
+	if (optind != argc - 1 || input->sweep_size == 0)
+	{
+		print_usage();
+		return false;
+	}
+
+	input->file_path = argv[optind];
+
+	return true;
+}
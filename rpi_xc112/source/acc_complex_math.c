@@ -0,0 +1,460 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <complex.h>
+#include <math.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "acc_complex_math.h"
+
+
+#define PI      (3.14159265358979324f)
+#define HALF_PI (1.57079632679489662f)
+
+
+/**
+ * @brief Coefficients of x * P(x^2) approximating atan(x) on [0, 1], fitted for minimal maximum error
+ */
+static const float atan_low[2]    = {9.723936874e-01f, -1.919470362e-01f};
+static const float atan_medium[4] = {9.992138026e-01f, -3.211748643e-01f, 1.462642027e-01f, -3.898633598e-02f};
+static const float atan_high[8]   = {9.999993356e-01f, -3.332986076e-01f, 1.994656541e-01f, -1.390862825e-01f,
+	                             9.642193791e-02f, -5.591227583e-02f, 2.186292082e-02f, -4.054556507e-03f};
+
+
+static inline float atan_unit(float t, acc_complex_math_accuracy_t accuracy);
+static inline float phase(float real, float imag, acc_complex_math_accuracy_t accuracy);
+
+
+#if defined(__ARM_NEON)
+static inline float32x4_t divide_neon(float32x4_t numerator, float32x4_t denominator);
+static inline float32x4_t sqrt_neon(float32x4_t value);
+static inline float32x4_t atan_unit_neon(float32x4_t t, acc_complex_math_accuracy_t accuracy);
+static inline float32x4_t phase_neon(float32x4_t real, float32x4_t imag, acc_complex_math_accuracy_t accuracy);
+static inline float32x4x2_t load_int16_neon(const acc_int16_complex_t *data);
+#endif
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+void acc_complex_math_magnitude(const float complex *data, float *magnitude, uint16_t length)
+{
+	const float *values = (const float *)data;
+	uint16_t    i       = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t point = vld2q_f32(values + 2 * i);
+
+		vst1q_f32(magnitude + i, sqrt_neon(vmlaq_f32(vmulq_f32(point.val[0], point.val[0]), point.val[1], point.val[1])));
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		float real = values[2 * i];
+		float imag = values[2 * i + 1];
+
+		magnitude[i] = sqrtf(real * real + imag * imag);
+	}
+}
+
+
+void acc_complex_math_magnitude_int16(const acc_int16_complex_t *data, float *magnitude, uint16_t length)
+{
+	uint16_t i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t point = load_int16_neon(data + i);
+
+		vst1q_f32(magnitude + i, sqrt_neon(vmlaq_f32(vmulq_f32(point.val[0], point.val[0]), point.val[1], point.val[1])));
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		float real = data[i].real;
+		float imag = data[i].imag;
+
+		magnitude[i] = sqrtf(real * real + imag * imag);
+	}
+}
+
+
+void acc_complex_math_squared_magnitude(const float complex *data, float *squared_magnitude, uint16_t length)
+{
+	const float *values = (const float *)data;
+	uint16_t    i       = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t point = vld2q_f32(values + 2 * i);
+
+		vst1q_f32(squared_magnitude + i, vmlaq_f32(vmulq_f32(point.val[0], point.val[0]), point.val[1], point.val[1]));
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		float real = values[2 * i];
+		float imag = values[2 * i + 1];
+
+		squared_magnitude[i] = real * real + imag * imag;
+	}
+}
+
+
+void acc_complex_math_squared_magnitude_int16(const acc_int16_complex_t *data, uint32_t *squared_magnitude,
+                                              uint16_t length)
+{
+	uint16_t i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		int16x4x2_t point = vld2_s16((const int16_t *)(data + i));
+
+		// Each square is at most 2^30, their sum fits unsigned 32 bits
+		uint32x4_t real = vreinterpretq_u32_s32(vmull_s16(point.val[0], point.val[0]));
+		uint32x4_t imag = vreinterpretq_u32_s32(vmull_s16(point.val[1], point.val[1]));
+
+		vst1q_u32(squared_magnitude + i, vaddq_u32(real, imag));
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		int32_t real = data[i].real;
+		int32_t imag = data[i].imag;
+
+		squared_magnitude[i] = (uint32_t)(real * real) + (uint32_t)(imag * imag);
+	}
+}
+
+
+void acc_complex_math_phase(const float complex *data, float *phase_values, uint16_t length, acc_complex_math_accuracy_t accuracy)
+{
+	const float *values = (const float *)data;
+	uint16_t    i       = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t point = vld2q_f32(values + 2 * i);
+
+		vst1q_f32(phase_values + i, phase_neon(point.val[0], point.val[1], accuracy));
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		phase_values[i] = phase(values[2 * i], values[2 * i + 1], accuracy);
+	}
+}
+
+
+void acc_complex_math_phase_int16(const acc_int16_complex_t *data, float *phase_values, uint16_t length,
+                                  acc_complex_math_accuracy_t accuracy)
+{
+	uint16_t i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t point = load_int16_neon(data + i);
+
+		vst1q_f32(phase_values + i, phase_neon(point.val[0], point.val[1], accuracy));
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		phase_values[i] = phase(data[i].real, data[i].imag, accuracy);
+	}
+}
+
+
+void acc_complex_math_conjugate_multiply(const float complex *data, const float complex *reference, float complex *result,
+                                         uint16_t length)
+{
+	const float *values           = (const float *)data;
+	const float *reference_values = (const float *)reference;
+	float       *result_values    = (float *)result;
+	uint16_t    i                 = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t a = vld2q_f32(values + 2 * i);
+		float32x4x2_t b = vld2q_f32(reference_values + 2 * i);
+		float32x4x2_t product;
+
+		product.val[0] = vmlaq_f32(vmulq_f32(a.val[0], b.val[0]), a.val[1], b.val[1]);
+		product.val[1] = vmlsq_f32(vmulq_f32(a.val[1], b.val[0]), a.val[0], b.val[1]);
+		vst2q_f32(result_values + 2 * i, product);
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		float a_real = values[2 * i];
+		float a_imag = values[2 * i + 1];
+		float b_real = reference_values[2 * i];
+		float b_imag = reference_values[2 * i + 1];
+
+		result_values[2 * i]     = a_real * b_real + a_imag * b_imag;
+		result_values[2 * i + 1] = a_imag * b_real - a_real * b_imag;
+	}
+}
+
+
+void acc_complex_math_conjugate_multiply_int16(const acc_int16_complex_t *data, const acc_int16_complex_t *reference,
+                                               float complex *result, uint16_t length)
+{
+	float    *result_values = (float *)result;
+	uint16_t i              = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t a = load_int16_neon(data + i);
+		float32x4x2_t b = load_int16_neon(reference + i);
+		float32x4x2_t product;
+
+		product.val[0] = vmlaq_f32(vmulq_f32(a.val[0], b.val[0]), a.val[1], b.val[1]);
+		product.val[1] = vmlsq_f32(vmulq_f32(a.val[1], b.val[0]), a.val[0], b.val[1]);
+		vst2q_f32(result_values + 2 * i, product);
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		float a_real = data[i].real;
+		float a_imag = data[i].imag;
+		float b_real = reference[i].real;
+		float b_imag = reference[i].imag;
+
+		result_values[2 * i]     = a_real * b_real + a_imag * b_imag;
+		result_values[2 * i + 1] = a_imag * b_real - a_real * b_imag;
+	}
+}
+
+
+void acc_complex_math_phase_difference(const float complex *data, const float complex *previous, float *phase_difference,
+                                       uint16_t length, acc_complex_math_accuracy_t accuracy)
+{
+	const float *values          = (const float *)data;
+	const float *previous_values = (const float *)previous;
+	uint16_t    i                = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t a    = vld2q_f32(values + 2 * i);
+		float32x4x2_t b    = vld2q_f32(previous_values + 2 * i);
+		float32x4_t   real = vmlaq_f32(vmulq_f32(a.val[0], b.val[0]), a.val[1], b.val[1]);
+		float32x4_t   imag = vmlsq_f32(vmulq_f32(a.val[1], b.val[0]), a.val[0], b.val[1]);
+
+		vst1q_f32(phase_difference + i, phase_neon(real, imag, accuracy));
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		float a_real = values[2 * i];
+		float a_imag = values[2 * i + 1];
+		float b_real = previous_values[2 * i];
+		float b_imag = previous_values[2 * i + 1];
+
+		phase_difference[i] = phase(a_real * b_real + a_imag * b_imag, a_imag * b_real - a_real * b_imag, accuracy);
+	}
+}
+
+
+void acc_complex_math_phase_difference_int16(const acc_int16_complex_t *data, const acc_int16_complex_t *previous,
+                                             float *phase_difference, uint16_t length, acc_complex_math_accuracy_t accuracy)
+{
+	uint16_t i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= length; i += 4)
+	{
+		float32x4x2_t a    = load_int16_neon(data + i);
+		float32x4x2_t b    = load_int16_neon(previous + i);
+		float32x4_t   real = vmlaq_f32(vmulq_f32(a.val[0], b.val[0]), a.val[1], b.val[1]);
+		float32x4_t   imag = vmlsq_f32(vmulq_f32(a.val[1], b.val[0]), a.val[0], b.val[1]);
+
+		vst1q_f32(phase_difference + i, phase_neon(real, imag, accuracy));
+	}
+#endif
+
+	for (; i < length; i++)
+	{
+		float a_real = data[i].real;
+		float a_imag = data[i].imag;
+		float b_real = previous[i].real;
+		float b_imag = previous[i].imag;
+
+		phase_difference[i] = phase(a_real * b_real + a_imag * b_imag, a_imag * b_real - a_real * b_imag, accuracy);
+	}
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+float atan_unit(float t, acc_complex_math_accuracy_t accuracy)
+{
+	float t2 = t * t;
+	float p;
+
+	switch (accuracy)
+	{
+		case ACC_COMPLEX_MATH_ACCURACY_LOW:
+			p = atan_low[1] * t2 + atan_low[0];
+			break;
+		case ACC_COMPLEX_MATH_ACCURACY_MEDIUM:
+			p = ((atan_medium[3] * t2 + atan_medium[2]) * t2 + atan_medium[1]) * t2 + atan_medium[0];
+			break;
+		default:
+			p = atan_high[7];
+
+			for (int16_t k = 6; k >= 0; k--)
+			{
+				p = p * t2 + atan_high[k];
+			}
+
+			break;
+	}
+
+	return p * t;
+}
+
+
+/**
+ * @brief The phase, from atan of the first octant reflected to the octant of the point
+ */
+float phase(float real, float imag, acc_complex_math_accuracy_t accuracy)
+{
+	float x       = fabsf(real);
+	float y       = fabsf(imag);
+	float minimum = (x < y) ? x : y;
+	float maximum = (x < y) ? y : x;
+	float angle   = atan_unit((maximum > 0.0f) ? minimum / maximum : 0.0f, accuracy);
+
+	if (y > x)
+	{
+		angle = HALF_PI - angle;
+	}
+
+	if (real < 0.0f)
+	{
+		angle = PI - angle;
+	}
+
+	return (imag < 0.0f) ? -angle : angle;
+}
+
+
+#if defined(__ARM_NEON)
+float32x4_t divide_neon(float32x4_t numerator, float32x4_t denominator)
+{
+#if defined(__aarch64__)
+	return vdivq_f32(numerator, denominator);
+#else
+	float32x4_t reciprocal = vrecpeq_f32(denominator);
+
+	reciprocal = vmulq_f32(vrecpsq_f32(denominator, reciprocal), reciprocal);
+	reciprocal = vmulq_f32(vrecpsq_f32(denominator, reciprocal), reciprocal);
+
+	return vmulq_f32(numerator, reciprocal);
+#endif
+}
+
+
+float32x4_t sqrt_neon(float32x4_t value)
+{
+#if defined(__aarch64__)
+	return vsqrtq_f32(value);
+#else
+	float32x4_t reciprocal = vrsqrteq_f32(value);
+
+	reciprocal = vmulq_f32(vrsqrtsq_f32(vmulq_f32(value, reciprocal), reciprocal), reciprocal);
+	reciprocal = vmulq_f32(vrsqrtsq_f32(vmulq_f32(value, reciprocal), reciprocal), reciprocal);
+
+	// The estimate of 0 is infinity, keep 0 instead of 0 * infinity
+	return vbslq_f32(vceqq_f32(value, vdupq_n_f32(0.0f)), value, vmulq_f32(value, reciprocal));
+#endif
+}
+
+
+float32x4_t atan_unit_neon(float32x4_t t, acc_complex_math_accuracy_t accuracy)
+{
+	float32x4_t t2 = vmulq_f32(t, t);
+	float32x4_t p;
+
+	switch (accuracy)
+	{
+		case ACC_COMPLEX_MATH_ACCURACY_LOW:
+			p = vmlaq_n_f32(vdupq_n_f32(atan_low[0]), t2, atan_low[1]);
+			break;
+		case ACC_COMPLEX_MATH_ACCURACY_MEDIUM:
+			p = vmlaq_n_f32(vdupq_n_f32(atan_medium[2]), t2, atan_medium[3]);
+			p = vmlaq_f32(vdupq_n_f32(atan_medium[1]), p, t2);
+			p = vmlaq_f32(vdupq_n_f32(atan_medium[0]), p, t2);
+			break;
+		default:
+			p = vdupq_n_f32(atan_high[7]);
+
+			for (int16_t k = 6; k >= 0; k--)
+			{
+				p = vmlaq_f32(vdupq_n_f32(atan_high[k]), p, t2);
+			}
+
+			break;
+	}
+
+	return vmulq_f32(p, t);
+}
+
+
+float32x4_t phase_neon(float32x4_t real, float32x4_t imag, acc_complex_math_accuracy_t accuracy)
+{
+	const float32x4_t zero    = vdupq_n_f32(0.0f);
+	float32x4_t       x       = vabsq_f32(real);
+	float32x4_t       y       = vabsq_f32(imag);
+	float32x4_t       maximum = vmaxq_f32(x, y);
+	float32x4_t       t       = divide_neon(vminq_f32(x, y), maximum);
+
+	t = vbslq_f32(vceqq_f32(maximum, zero), zero, t);
+
+	float32x4_t angle = atan_unit_neon(t, accuracy);
+
+	angle = vbslq_f32(vcgtq_f32(y, x), vsubq_f32(vdupq_n_f32(HALF_PI), angle), angle);
+	angle = vbslq_f32(vcltq_f32(real, zero), vsubq_f32(vdupq_n_f32(PI), angle), angle);
+
+	return vbslq_f32(vcltq_f32(imag, zero), vnegq_f32(angle), angle);
+}
+
+
+float32x4x2_t load_int16_neon(const acc_int16_complex_t *data)
+{
+	int16x4x2_t   point = vld2_s16((const int16_t *)data);
+	float32x4x2_t result;
+
+	result.val[0] = vcvtq_f32_s32(vmovl_s16(point.val[0]));
+	result.val[1] = vcvtq_f32_s32(vmovl_s16(point.val[1]));
+
+	return result;
+}
+
+
+#endif
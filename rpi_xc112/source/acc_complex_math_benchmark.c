@@ -0,0 +1,501 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <complex.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "acc_complex_math.h"
+
+
+/**
+ * @brief Accuracy check and benchmark of the complex math kernels against libm
+ *
+ * Random points over a wide range of magnitudes, the axes, the diagonals, zero and the
+ * extremes of int16 are processed by each kernel and compared with libm in double precision.
+ * The maximum error of each kernel is printed next to its limit and the program fails if a
+ * limit is exceeded. Then sweeps are processed repeatedly to compare the time per point of
+ * the kernels with cabsf and cargf per point.
+ */
+
+
+#define DEFAULT_POINT_COUNT 1024
+#define DEFAULT_REPETITIONS 2000
+#define CHECK_POINT_COUNT   65003
+
+#define MAGNITUDE_LIMIT         (2e-6)
+#define MULTIPLY_LIMIT          (2e-6)
+#define PHASE_DIFFERENCE_MARGIN (1e-6)
+
+
+typedef struct
+{
+	uint16_t point_count;
+	uint32_t repetitions;
+} input_t;
+
+
+static const char   *accuracy_names[] = {"low", "medium", "high"};
+static const double phase_limits[]    = {5e-3, 1e-4, 5e-7};
+
+
+static bool parse_options(int argc, char *argv[], input_t *input);
+
+
+static bool check_accuracy(void);
+
+
+static void benchmark(const input_t *input);
+
+
+int main(int argc, char *argv[])
+{
+	input_t input;
+
+	if (!parse_options(argc, argv, &input))
+	{
+		return EXIT_FAILURE;
+	}
+
+	bool success = check_accuracy();
+
+	benchmark(&input);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static double random_uniform(void)
+{
+	return (double)rand() / RAND_MAX;
+}
+
+
+static void fill_points(float complex *points, acc_int16_complex_t *points_int16, uint16_t count)
+{
+	static const float special[][2] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {-1.0f, 0.0f}, {0.0f, 1.0f}, {0.0f, -1.0f},
+	                                   {1.0f, 1.0f}, {-1.0f, 1.0f}, {1.0f, -1.0f}, {-1.0f, -1.0f}, {3.0f, 3.0f}};
+	const uint16_t     special_count = sizeof(special) / sizeof(special[0]);
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		double real;
+		double imag;
+
+		if (i < special_count)
+		{
+			real = special[i][0];
+			imag = special[i][1];
+		}
+		else
+		{
+			double magnitude = pow(10.0, -3.0 + 8.0 * random_uniform());
+			double angle     = 2.0 * M_PI * random_uniform();
+
+			real = magnitude * cos(angle);
+			imag = magnitude * sin(angle);
+		}
+
+		points[i] = (float)real + (float)imag * I;
+
+		points_int16[i].real = (int16_t)((i < special_count) ? real * 32767.0 : (double)(rand() % 65536 - 32768));
+		points_int16[i].imag = (int16_t)((i < special_count) ? imag * 32767.0 : (double)(rand() % 65536 - 32768));
+	}
+
+	points_int16[0].real = -32768;
+	points_int16[0].imag = -32768;
+}
+
+
+static double phase_error(float phase, double reference)
+{
+	// The phase of a negative real point is pi or -pi
+	return fabs(remainder((double)phase - reference, 2.0 * M_PI));
+}
+
+
+static bool report(const char *name, double error, double limit)
+{
+	bool pass = error <= limit;
+
+	printf("%-36s %12.3e %12.3e %s\n", name, error, limit, pass ? "ok" : "FAILED");
+
+	return pass;
+}
+
+
+bool check_accuracy(void)
+{
+	const uint16_t count = CHECK_POINT_COUNT;
+
+	float complex       *a             = malloc(sizeof(*a) * count);
+	float complex       *b             = malloc(sizeof(*b) * count);
+	float complex       *product       = malloc(sizeof(*product) * count);
+	acc_int16_complex_t *a_int16       = malloc(sizeof(*a_int16) * count);
+	acc_int16_complex_t *b_int16       = malloc(sizeof(*b_int16) * count);
+	float               *values        = malloc(sizeof(*values) * count);
+	uint32_t            *values_uint32 = malloc(sizeof(*values_uint32) * count);
+	bool                success        = true;
+
+	if (a == NULL || b == NULL || product == NULL || a_int16 == NULL || b_int16 == NULL || values == NULL || values_uint32 == NULL)
+	{
+		fprintf(stderr, "Failed to allocate memory\n");
+		return false;
+	}
+
+	srand(1);
+	fill_points(a, a_int16, count);
+	fill_points(b, b_int16, count);
+
+	printf("%-36s %12s %12s\n", "kernel", "max error", "limit");
+
+	// A count that is not a multiple of four points also exercises the scalar code
+	acc_complex_math_magnitude(a, values, count);
+
+	double error = 0.0;
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		double reference = cabs((double complex)a[i]);
+		double relative  = (reference > 0.0) ? fabs((double)values[i] - reference) / reference : fabs((double)values[i]);
+
+		error = fmax(error, relative);
+	}
+
+	success = report("magnitude (relative)", error, MAGNITUDE_LIMIT) && success;
+
+	acc_complex_math_magnitude_int16(a_int16, values, count);
+	error = 0.0;
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		double reference = hypot(a_int16[i].real, a_int16[i].imag);
+		double relative  = (reference > 0.0) ? fabs((double)values[i] - reference) / reference : fabs((double)values[i]);
+
+		error = fmax(error, relative);
+	}
+
+	success = report("magnitude int16 (relative)", error, MAGNITUDE_LIMIT) && success;
+
+	acc_complex_math_squared_magnitude(a, values, count);
+	error = 0.0;
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		double reference = creal(a[i]) * creal(a[i]) + cimag(a[i]) * cimag(a[i]);
+		double relative  = (reference > 0.0) ? fabs((double)values[i] - reference) / reference : fabs((double)values[i]);
+
+		error = fmax(error, relative);
+	}
+
+	success = report("squared magnitude (relative)", error, MAGNITUDE_LIMIT) && success;
+
+	acc_complex_math_squared_magnitude_int16(a_int16, values_uint32, count);
+	error = 0.0;
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		double reference = (double)a_int16[i].real * a_int16[i].real + (double)a_int16[i].imag * a_int16[i].imag;
+
+		error = fmax(error, fabs((double)values_uint32[i] - reference));
+	}
+
+	success = report("squared magnitude int16 (absolute)", error, 0.0) && success;
+
+	acc_complex_math_conjugate_multiply(a, b, product, count);
+	error = 0.0;
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		double complex reference = (double complex)a[i] * conj((double complex)b[i]);
+		double         scale     = cabs((double complex)a[i]) * cabs((double complex)b[i]);
+
+		error = fmax(error, (scale > 0.0) ? cabs((double complex)product[i] - reference) / scale : 0.0);
+	}
+
+	success = report("conjugate multiply (relative)", error, MULTIPLY_LIMIT) && success;
+
+	acc_complex_math_conjugate_multiply_int16(a_int16, b_int16, product, count);
+	error = 0.0;
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		double complex a_point   = a_int16[i].real + a_int16[i].imag * I;
+		double complex b_point   = b_int16[i].real + b_int16[i].imag * I;
+		double complex reference = a_point * conj(b_point);
+		double         scale     = cabs(a_point) * cabs(b_point);
+
+		error = fmax(error, (scale > 0.0) ? cabs((double complex)product[i] - reference) / scale : 0.0);
+	}
+
+	success = report("conjugate multiply int16 (relative)", error, MULTIPLY_LIMIT) && success;
+
+	for (acc_complex_math_accuracy_t accuracy = ACC_COMPLEX_MATH_ACCURACY_LOW; accuracy <= ACC_COMPLEX_MATH_ACCURACY_HIGH;
+	     accuracy++)
+	{
+		char   name[64];
+		double limit = phase_limits[accuracy];
+
+		acc_complex_math_phase(a, values, count, accuracy);
+		error = 0.0;
+
+		for (uint16_t i = 0; i < count; i++)
+		{
+			error = fmax(error, phase_error(values[i], carg((double complex)a[i])));
+		}
+
+		snprintf(name, sizeof(name), "phase %s", accuracy_names[accuracy]);
+		success = report(name, error, limit) && success;
+
+		acc_complex_math_phase_int16(a_int16, values, count, accuracy);
+		error = 0.0;
+
+		for (uint16_t i = 0; i < count; i++)
+		{
+			error = fmax(error, phase_error(values[i], atan2(a_int16[i].imag, a_int16[i].real)));
+		}
+
+		snprintf(name, sizeof(name), "phase int16 %s", accuracy_names[accuracy]);
+		success = report(name, error, limit) && success;
+
+		// The product is rounded to float before its phase, which adds to the error
+		acc_complex_math_phase_difference(a, b, values, count, accuracy);
+		error = 0.0;
+
+		for (uint16_t i = 0; i < count; i++)
+		{
+			error = fmax(error, phase_error(values[i], carg((double complex)a[i] * conj((double complex)b[i]))));
+		}
+
+		snprintf(name, sizeof(name), "phase difference %s", accuracy_names[accuracy]);
+		success = report(name, error, limit + PHASE_DIFFERENCE_MARGIN) && success;
+
+		acc_complex_math_phase_difference_int16(a_int16, b_int16, values, count, accuracy);
+		error = 0.0;
+
+		for (uint16_t i = 0; i < count; i++)
+		{
+			double complex a_point = a_int16[i].real + a_int16[i].imag * I;
+			double complex b_point = b_int16[i].real + b_int16[i].imag * I;
+
+			error = fmax(error, phase_error(values[i], carg(a_point * conj(b_point))));
+		}
+
+		snprintf(name, sizeof(name), "phase difference int16 %s", accuracy_names[accuracy]);
+		success = report(name, error, limit + PHASE_DIFFERENCE_MARGIN) && success;
+	}
+
+	free(a);
+	free(b);
+	free(product);
+	free(a_int16);
+	free(b_int16);
+	free(values);
+	free(values_uint32);
+
+	return success;
+}
+
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (uint64_t)time_ts.tv_sec * 1000000000 + (uint64_t)time_ts.tv_nsec;
+}
+
+
+static void print_time(const char *name, uint64_t start_ns, const input_t *input, const float *values)
+{
+	double ns = (double)(get_time_ns() - start_ns) / ((double)input->point_count * input->repetitions);
+
+	// Printing a value keeps the computation from being optimized away
+	printf("%-36s %10.2f ns/point (%g)\n", name, ns, (double)values[input->point_count / 2]);
+}
+
+
+void benchmark(const input_t *input)
+{
+	const uint16_t      n      = input->point_count;
+	float complex       *a     = malloc(sizeof(*a) * n);
+	float complex       *b     = malloc(sizeof(*b) * n);
+	acc_int16_complex_t *a16   = malloc(sizeof(*a16) * n);
+	acc_int16_complex_t *b16   = malloc(sizeof(*b16) * n);
+	float               *value = malloc(sizeof(*value) * n);
+
+	if (a == NULL || b == NULL || a16 == NULL || b16 == NULL || value == NULL)
+	{
+		fprintf(stderr, "Failed to allocate memory\n");
+		return;
+	}
+
+	fill_points(a, a16, n);
+	fill_points(b, b16, n);
+
+	printf("\n%u repetitions of %u points\n", (unsigned int)input->repetitions, (unsigned int)n);
+
+	uint64_t start_ns = get_time_ns();
+
+	for (uint32_t r = 0; r < input->repetitions; r++)
+	{
+		for (uint16_t i = 0; i < n; i++)
+		{
+			value[i] = cabsf(a[i]);
+		}
+	}
+
+	print_time("cabsf", start_ns, input, value);
+
+	start_ns = get_time_ns();
+
+	for (uint32_t r = 0; r < input->repetitions; r++)
+	{
+		acc_complex_math_magnitude(a, value, n);
+	}
+
+	print_time("magnitude", start_ns, input, value);
+
+	start_ns = get_time_ns();
+
+	for (uint32_t r = 0; r < input->repetitions; r++)
+	{
+		acc_complex_math_magnitude_int16(a16, value, n);
+	}
+
+	print_time("magnitude int16", start_ns, input, value);
+
+	start_ns = get_time_ns();
+
+	for (uint32_t r = 0; r < input->repetitions; r++)
+	{
+		for (uint16_t i = 0; i < n; i++)
+		{
+			value[i] = cargf(a[i]);
+		}
+	}
+
+	print_time("cargf", start_ns, input, value);
+
+	for (acc_complex_math_accuracy_t accuracy = ACC_COMPLEX_MATH_ACCURACY_LOW; accuracy <= ACC_COMPLEX_MATH_ACCURACY_HIGH;
+	     accuracy++)
+	{
+		char name[64];
+
+		start_ns = get_time_ns();
+
+		for (uint32_t r = 0; r < input->repetitions; r++)
+		{
+			acc_complex_math_phase(a, value, n, accuracy);
+		}
+
+		snprintf(name, sizeof(name), "phase %s", accuracy_names[accuracy]);
+		print_time(name, start_ns, input, value);
+	}
+
+	start_ns = get_time_ns();
+
+	for (uint32_t r = 0; r < input->repetitions; r++)
+	{
+		for (uint16_t i = 0; i < n; i++)
+		{
+			value[i] = cargf(a[i] * conjf(b[i]));
+		}
+	}
+
+	print_time("cargf(a * conjf(b))", start_ns, input, value);
+
+	start_ns = get_time_ns();
+
+	for (uint32_t r = 0; r < input->repetitions; r++)
+	{
+		acc_complex_math_phase_difference(a, b, value, n, ACC_COMPLEX_MATH_ACCURACY_HIGH);
+	}
+
+	print_time("phase difference high", start_ns, input, value);
+
+	start_ns = get_time_ns();
+
+	for (uint32_t r = 0; r < input->repetitions; r++)
+	{
+		acc_complex_math_phase_difference_int16(a16, b16, value, n, ACC_COMPLEX_MATH_ACCURACY_HIGH);
+	}
+
+	print_time("phase difference int16 high", start_ns, input, value);
+
+	free(a);
+	free(b);
+	free(a16);
+	free(b16);
+	free(value);
+}
+
+
+static void print_usage(void)
+{
+	printf("Usage: acc_complex_math_benchmark [OPTION]...\n\n");
+	printf("Checks the accuracy of the complex math kernels and compares their speed with libm\n\n");
+	printf("-h, --help                this help\n");
+	printf("-n, --point-count         points per sweep, default %u\n", (unsigned int)DEFAULT_POINT_COUNT);
+	printf("-r, --repetitions         sweeps per kernel, default %u\n", (unsigned int)DEFAULT_REPETITIONS);
+}
+
+
+bool parse_options(int argc, char *argv[], input_t *input)
+{
+	static struct option long_options[] =
+	{
+		{"point-count", required_argument,  0, 'n'},
+		{"repetitions", required_argument,  0, 'r'},
+		{"help",        no_argument,        0, 'h'},
+		{NULL,          0,                  NULL, 0}
+	};
+
+	int16_t character_code;
+	int32_t option_index = 0;
+
+	input->point_count = DEFAULT_POINT_COUNT;
+	input->repetitions = DEFAULT_REPETITIONS;
+
+	while ((character_code = getopt_long(argc, argv, "n:r:h?", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 'n':
+			{
+				input->point_count = (uint16_t)atoi(optarg);
+				break;
+			}
+			case 'r':
+			{
+				input->repetitions = (uint32_t)atol(optarg);
+				break;
+			}
+			case 'h':
+			case '?':
+			default:
+			{
+				print_usage();
+				return false;
+			}
+		}
+	}
+
+	if (input->point_count == 0 || input->repetitions == 0)
+	{
+		print_usage();
+		return false;
+	}
+
+	return true;
+}
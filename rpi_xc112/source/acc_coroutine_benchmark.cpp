@@ -0,0 +1,659 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "acc_executor.hpp"
+#include "acc_rss.hpp"
+
+extern "C" {
+#include "acc_driver_hal.h"
+}
+
+
+/**
+ * @brief Benchmark of multi-sensor acquisition, a thread per sensor compared with one coroutine executor
+ *
+ * Each sensor runs the envelope service in streaming mode at the same update rate. With threads,
+ * each sensor has a thread that blocks in get_next. With the executor, each sensor has a
+ * coroutine that awaits the interrupt of its sensor, and one thread runs them all, see
+ * acc_executor.hpp. Each sweep is followed by a fixed amount of busy processing.
+ *
+ * With --simulate no sensors are needed, each sensor is replaced by a periodic timer, a
+ * clock_nanosleep loop for the threads and a timerfd awaited with acc::fd_watch for the
+ * executor.
+ *
+ * For each way of running the sweep rate, the jitter of the time between the sweeps of a
+ * sensor, the CPU time per second, the voluntary and involuntary context switches per sweep and
+ * the number of threads of the process are reported.
+ */
+
+
+#define DEFAULT_SENSOR_COUNT 4
+#define DEFAULT_SWEEP_COUNT  1000
+#define DEFAULT_UPDATE_RATE  100.0f
+#define DEFAULT_RANGE_START  0.2f
+#define DEFAULT_RANGE_LENGTH 0.5f
+#define SENSOR_COUNT_MAX     4
+
+
+typedef enum
+{
+	MODE_THREADS,
+	MODE_COROUTINES,
+	MODE_COUNT
+} benchmark_mode_t;
+
+
+typedef struct
+{
+	acc_sensor_id_t sensors[SENSOR_COUNT_MAX];
+	uint_fast8_t    sensor_count;
+	uint32_t        sweep_count;
+	float           update_rate;
+	uint32_t        work_us;
+	bool            simulate;
+	int             mode;
+} input_t;
+
+
+typedef struct
+{
+	uint64_t              sweep_count;
+	uint64_t              failure_count;
+	std::vector<uint32_t> jitter_us;
+	uint64_t              last_sweep_us;
+} sensor_result_t;
+
+
+typedef struct
+{
+	double   wall_s;
+	double   cpu_s;
+	long     voluntary_switches;
+	long     involuntary_switches;
+	int      thread_count;
+	uint64_t wakeup_count;
+} run_result_t;
+
+
+static const char *mode_names[MODE_COUNT] = {"threads", "coroutines"};
+
+
+static void print_usage(void);
+
+
+static bool parse_options(int argc, char *argv[], input_t *input);
+
+
+/**
+ * @brief Run the acquisition from all sensors in one of the modes
+ *
+ * @param[in] input The options
+ * @param[in] mode Threads or coroutines
+ * @param[in] services The activated services, one per sensor, unused when simulating
+ * @param[out] results The result of each sensor
+ * @param[out] run_result The result of the run
+ * @return True if the run completed
+ */
+static bool run(const input_t *input, benchmark_mode_t mode, std::vector<acc::service<acc::envelope> > &services,
+                std::vector<sensor_result_t> &results, run_result_t *run_result);
+
+
+/**
+ * @brief Account one sweep of a sensor and do the processing
+ */
+static void process_sweep(const input_t *input, sensor_result_t *result);
+
+
+static uint64_t get_time_us(void);
+
+
+static void wait_until(uint64_t time_us);
+
+
+static int get_thread_count(void);
+
+
+int main(int argc, char *argv[])
+{
+	input_t input;
+
+	if (!parse_options(argc, argv, &input))
+	{
+		return EXIT_FAILURE;
+	}
+
+	std::unique_ptr<acc::rss>                  rss;
+	std::vector<acc::service<acc::envelope> > services;
+
+	if (!input.simulate)
+	{
+		if (!acc_driver_hal_init())
+		{
+			return EXIT_FAILURE;
+		}
+
+		acc_hal_t hal = acc_driver_hal_get_implementation();
+
+		rss = std::make_unique<acc::rss>(hal);
+
+		if (!*rss)
+		{
+			fprintf(stderr, "acc_rss_activate() failed\n");
+			return EXIT_FAILURE;
+		}
+
+		services.reserve(input.sensor_count);
+
+		for (uint_fast8_t i = 0; i < input.sensor_count; i++)
+		{
+			acc::configuration<acc::envelope> configuration;
+
+			configuration.sensor(input.sensors[i])
+			.range(DEFAULT_RANGE_START, DEFAULT_RANGE_LENGTH)
+			.update_rate(input.update_rate);
+
+			services.emplace_back(configuration);
+
+			if (!services.back() || !services.back().activate())
+			{
+				fprintf(stderr, "Could not create and activate the envelope service on sensor %u\n",
+				        (unsigned int)input.sensors[i]);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	printf("%u sensors, %u sweeps each at %.1f Hz, %u us processing per sweep%s\n", (unsigned int)input.sensor_count,
+	       (unsigned int)input.sweep_count, (double)input.update_rate, (unsigned int)input.work_us,
+	       input.simulate ? ", simulated" : "");
+	printf("%-10s %8s %9s %9s %9s %9s %10s %9s %9s %7s %8s\n", "mode", "sweeps", "sweeps/s", "p50 us", "p99 us",
+	       "max us", "cpu ms/s", "vcs/sweep", "ics/sweep", "threads", "wakeups");
+
+	for (int mode = MODE_THREADS; mode < MODE_COUNT; mode++)
+	{
+		if (input.mode >= 0 && input.mode != mode)
+		{
+			continue;
+		}
+
+		std::vector<sensor_result_t> results(input.sensor_count);
+		run_result_t                 run_result;
+
+		for (sensor_result_t &result : results)
+		{
+			result.sweep_count   = 0;
+			result.failure_count = 0;
+			result.last_sweep_us = 0;
+			result.jitter_us.reserve(input.sweep_count);
+		}
+
+		if (!run(&input, (benchmark_mode_t)mode, services, results, &run_result))
+		{
+			return EXIT_FAILURE;
+		}
+
+		std::vector<uint32_t> jitter_us;
+		uint64_t              sweep_count   = 0;
+		uint64_t              failure_count = 0;
+
+		for (const sensor_result_t &result : results)
+		{
+			jitter_us.insert(jitter_us.end(), result.jitter_us.begin(), result.jitter_us.end());
+			sweep_count   += result.sweep_count;
+			failure_count += result.failure_count;
+		}
+
+		std::sort(jitter_us.begin(), jitter_us.end());
+
+		uint32_t p50 = 0;
+		uint32_t p99 = 0;
+		uint32_t max = 0;
+
+		if (!jitter_us.empty())
+		{
+			p50 = jitter_us[jitter_us.size() / 2];
+			p99 = jitter_us[(jitter_us.size() * 99) / 100];
+			max = jitter_us.back();
+		}
+
+		double per_sweep = (sweep_count > 0) ? 1.0 / (double)sweep_count : 0.0;
+
+		printf("%-10s %8llu %9.1f %9u %9u %9u %10.2f %9.2f %9.2f %7d %8llu\n", mode_names[mode],
+		       (unsigned long long)sweep_count, (double)sweep_count / run_result.wall_s, (unsigned int)p50,
+		       (unsigned int)p99, (unsigned int)max, run_result.cpu_s * 1e3 / run_result.wall_s,
+		       (double)run_result.voluntary_switches * per_sweep, (double)run_result.involuntary_switches * per_sweep,
+		       run_result.thread_count, (unsigned long long)run_result.wakeup_count);
+
+		if (failure_count > 0)
+		{
+			printf("%llu sweeps failed\n", (unsigned long long)failure_count);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+
+/**
+ * @brief Pipeline of one sensor in the executor
+ */
+static acc::task sensor_pipeline(const input_t *input, acc::sensor_stream<acc::envelope> &stream,
+                                 sensor_result_t *result)
+{
+	for (uint32_t i = 0; i < input->sweep_count; i++)
+	{
+		acc::span<const uint16_t> envelope = co_await stream.next_sweep();
+
+		if (envelope.empty())
+		{
+			result->failure_count++;
+			co_return;
+		}
+
+		process_sweep(input, result);
+	}
+}
+
+
+/**
+ * @brief Pipeline of one simulated sensor in the executor
+ */
+static acc::task timer_pipeline(const input_t *input, acc::fd_watch &watch, sensor_result_t *result)
+{
+	for (uint32_t i = 0; i < input->sweep_count; i++)
+	{
+		uint64_t expirations;
+
+		if (!co_await watch.readable() || read(watch.fd(), &expirations, sizeof(expirations)) < 0)
+		{
+			result->failure_count++;
+			co_return;
+		}
+
+		process_sweep(input, result);
+	}
+}
+
+
+static bool run_threads(const input_t *input, std::vector<acc::service<acc::envelope> > &services,
+                        std::vector<sensor_result_t> &results, run_result_t *run_result)
+{
+	std::vector<std::thread> threads;
+	uint64_t                 period_us = (uint64_t)(1e6f / input->update_rate);
+	uint64_t                 start_us  = get_time_us();
+
+	threads.reserve(input->sensor_count);
+
+	for (uint_fast8_t i = 0; i < input->sensor_count; i++)
+	{
+		sensor_result_t *result = &results[i];
+
+		if (input->simulate)
+		{
+			threads.emplace_back([input, result, period_us, start_us]
+			{
+				uint64_t time_us = start_us;
+
+				for (uint32_t sweep = 0; sweep < input->sweep_count; sweep++)
+				{
+					time_us += period_us;
+					wait_until(time_us);
+					process_sweep(input, result);
+				}
+			});
+		}
+		else
+		{
+			acc::service<acc::envelope> *service = &services[i];
+
+			threads.emplace_back([input, result, service]
+			{
+				for (uint32_t sweep = 0; sweep < input->sweep_count; sweep++)
+				{
+					if (service->get_next_by_reference().empty())
+					{
+						result->failure_count++;
+						return;
+					}
+
+					process_sweep(input, result);
+				}
+			});
+		}
+	}
+
+	run_result->thread_count = get_thread_count();
+	run_result->wakeup_count = 0;
+
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+
+	return true;
+}
+
+
+static bool run_coroutines(const input_t *input, std::vector<acc::service<acc::envelope> > &services,
+                           std::vector<sensor_result_t> &results, run_result_t *run_result)
+{
+	acc::executor executor;
+
+	if (!executor)
+	{
+		fprintf(stderr, "Could not create the executor: %s\n", strerror(errno));
+		return false;
+	}
+
+	std::vector<std::unique_ptr<acc::sensor_stream<acc::envelope> > > streams;
+	std::vector<std::unique_ptr<acc::fd_watch> >                      watches;
+	std::vector<int>                                                  timer_fds;
+	bool                                                              success = true;
+
+	for (uint_fast8_t i = 0; i < input->sensor_count && success; i++)
+	{
+		if (input->simulate)
+		{
+			int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+			if (fd < 0)
+			{
+				success = false;
+				break;
+			}
+
+			timer_fds.push_back(fd);
+			watches.push_back(std::make_unique<acc::fd_watch>(executor, fd));
+			success = static_cast<bool>(*watches.back());
+			executor.spawn(timer_pipeline(input, *watches.back(), &results[i]));
+		}
+		else
+		{
+			streams.push_back(std::make_unique<acc::sensor_stream<acc::envelope> >(executor, services[i],
+			                                                                        input->sensors[i]));
+			success = static_cast<bool>(*streams.back());
+			executor.spawn(sensor_pipeline(input, *streams.back(), &results[i]));
+		}
+	}
+
+	if (success && input->simulate)
+	{
+		long              period_ns = (long)(1e9f / input->update_rate);
+		struct itimerspec timer     = {};
+
+		timer.it_interval.tv_sec  = period_ns / 1000000000;
+		timer.it_interval.tv_nsec = period_ns % 1000000000;
+		timer.it_value            = timer.it_interval;
+
+		// All timers start together, like the threads
+		for (int fd : timer_fds)
+		{
+			success = success && timerfd_settime(fd, 0, &timer, nullptr) == 0;
+		}
+	}
+
+	if (!success)
+	{
+		fprintf(stderr, "Could not set up the sensor streams: %s\n", strerror(errno));
+	}
+	else
+	{
+		run_result->thread_count = get_thread_count();
+		success                  = executor.run();
+		run_result->wakeup_count = executor.wakeup_count();
+	}
+
+	streams.clear();
+	watches.clear();
+
+	for (int fd : timer_fds)
+	{
+		close(fd);
+	}
+
+	return success;
+}
+
+
+bool run(const input_t *input, benchmark_mode_t mode, std::vector<acc::service<acc::envelope> > &services,
+         std::vector<sensor_result_t> &results, run_result_t *run_result)
+{
+	struct rusage usage_before;
+	struct rusage usage_after;
+
+	getrusage(RUSAGE_SELF, &usage_before);
+	uint64_t start_us = get_time_us();
+
+	bool success = (mode == MODE_THREADS) ? run_threads(input, services, results, run_result) :
+	               run_coroutines(input, services, results, run_result);
+
+	run_result->wall_s = (double)(get_time_us() - start_us) / 1e6;
+	getrusage(RUSAGE_SELF, &usage_after);
+
+	run_result->cpu_s =
+		(double)(usage_after.ru_utime.tv_sec - usage_before.ru_utime.tv_sec) +
+		(double)(usage_after.ru_utime.tv_usec - usage_before.ru_utime.tv_usec) / 1e6 +
+		(double)(usage_after.ru_stime.tv_sec - usage_before.ru_stime.tv_sec) +
+		(double)(usage_after.ru_stime.tv_usec - usage_before.ru_stime.tv_usec) / 1e6;
+	run_result->voluntary_switches   = usage_after.ru_nvcsw - usage_before.ru_nvcsw;
+	run_result->involuntary_switches = usage_after.ru_nivcsw - usage_before.ru_nivcsw;
+
+	return success;
+}
+
+
+void process_sweep(const input_t *input, sensor_result_t *result)
+{
+	uint64_t now_us    = get_time_us();
+	uint64_t period_us = (uint64_t)(1e6f / input->update_rate);
+
+	// Deviation of the time since the previous sweep from the update period
+	if (result->last_sweep_us != 0 && result->jitter_us.size() < result->jitter_us.capacity())
+	{
+		uint64_t interval_us = now_us - result->last_sweep_us;
+		uint64_t jitter_us   = (interval_us > period_us) ? interval_us - period_us : period_us - interval_us;
+
+		result->jitter_us.push_back((uint32_t)std::min<uint64_t>(jitter_us, UINT32_MAX));
+	}
+
+	result->last_sweep_us = now_us;
+	result->sweep_count++;
+
+	while (get_time_us() - now_us < input->work_us)
+	{
+	}
+}
+
+
+uint64_t get_time_us(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (uint64_t)time_ts.tv_sec * 1000000 + (uint64_t)time_ts.tv_nsec / 1000;
+}
+
+
+void wait_until(uint64_t time_us)
+{
+	struct timespec time_ts;
+
+	time_ts.tv_sec  = (time_t)(time_us / 1000000);
+	time_ts.tv_nsec = (long)(time_us % 1000000) * 1000;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time_ts, nullptr) == EINTR)
+	{
+	}
+}
+
+
+int get_thread_count(void)
+{
+	FILE *file         = fopen("/proc/self/status", "r");
+	int  thread_count  = 0;
+	char line[128];
+
+	if (file == nullptr)
+	{
+		return 0;
+	}
+
+	while (fgets(line, sizeof(line), file) != nullptr)
+	{
+		if (sscanf(line, "Threads: %d", &thread_count) == 1)
+		{
+			break;
+		}
+	}
+
+	fclose(file);
+
+	return thread_count;
+}
+
+
+void print_usage(void)
+{
+	printf("Usage: acc_coroutine_benchmark [OPTION]...\n\n");
+	printf("-s, --sensors          comma separated sensor ids, default 1,2,3,4\n");
+	printf("-c, --sweep-count      sweeps per sensor, default %u\n", (unsigned int)DEFAULT_SWEEP_COUNT);
+	printf("-f, --update-rate      update rate of each sensor [Hz], default %.0f\n", (double)DEFAULT_UPDATE_RATE);
+	printf("-w, --work             busy processing per sweep [us], default 0\n");
+	printf("-m, --mode             threads or coroutines, default both\n");
+	printf("-S, --simulate         replace the sensors with periodic timers\n");
+	printf("-h, --help             this help\n");
+}
+
+
+bool parse_options(int argc, char *argv[], input_t *input)
+{
+	static struct option long_options[] =
+	{
+		{"sensors",     required_argument,  0, 's'},
+		{"sweep-count", required_argument,  0, 'c'},
+		{"update-rate", required_argument,  0, 'f'},
+		{"work",        required_argument,  0, 'w'},
+		{"mode",        required_argument,  0, 'm'},
+		{"simulate",    no_argument,        0, 'S'},
+		{"help",        no_argument,        0, 'h'},
+		{NULL,          0,                  NULL, 0}
+	};
+
+	int16_t character_code;
+	int32_t option_index = 0;
+
+	for (uint_fast8_t i = 0; i < DEFAULT_SENSOR_COUNT; i++)
+	{
+		input->sensors[i] = (acc_sensor_id_t)(i + 1);
+	}
+
+	input->sensor_count = DEFAULT_SENSOR_COUNT;
+	input->sweep_count  = DEFAULT_SWEEP_COUNT;
+	input->update_rate  = DEFAULT_UPDATE_RATE;
+	input->work_us      = 0;
+	input->simulate     = false;
+	input->mode         = -1;
+
+	while ((character_code = getopt_long(argc, argv, "s:c:f:w:m:Sh?", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 's':
+			{
+				char *position = optarg;
+
+				input->sensor_count = 0;
+
+				while (*position != '\0' && input->sensor_count < SENSOR_COUNT_MAX)
+				{
+					long sensor = strtol(position, &position, 10);
+
+					if (sensor < 1 || sensor > SENSOR_COUNT_MAX || (*position != ',' && *position != '\0'))
+					{
+						fprintf(stderr, "Invalid sensor list %s\n", optarg);
+						return false;
+					}
+
+					input->sensors[input->sensor_count++] = (acc_sensor_id_t)sensor;
+
+					if (*position == ',')
+					{
+						position++;
+					}
+				}
+
+				break;
+			}
+			case 'c':
+			{
+				input->sweep_count = (uint32_t)atol(optarg);
+				break;
+			}
+			case 'f':
+			{
+				input->update_rate = strtof(optarg, NULL);
+				break;
+			}
+			case 'w':
+			{
+				input->work_us = (uint32_t)atol(optarg);
+				break;
+			}
+			case 'm':
+			{
+				for (int mode = 0; mode < MODE_COUNT; mode++)
+				{
+					if (strcmp(optarg, mode_names[mode]) == 0)
+					{
+						input->mode = mode;
+					}
+				}
+
+				if (input->mode < 0)
+				{
+					fprintf(stderr, "Unknown mode %s\n", optarg);
+					return false;
+				}
+
+				break;
+			}
+			case 'S':
+			{
+				input->simulate = true;
+				break;
+			}
+			case 'h':
+			case '?':
+			default:
+			{
+				print_usage();
+				return false;
+			}
+		}
+	}
+
+	if (optind != argc || input->sensor_count == 0 || input->sweep_count == 0 || input->update_rate <= 0.0f)
+	{
+		print_usage();
+		return false;
+	}
+
+	return true;
+}
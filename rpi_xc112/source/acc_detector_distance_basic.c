@@ -8,6 +8,7 @@
 
 #include "acc_definitions.h"
 #include "acc_device_os.h"
+#include "acc_filter_percentile.h"
 #include "acc_log.h"
 #include "acc_service.h"
 #include "acc_service_envelope.h"
@@ -22,12 +23,13 @@
 
 typedef struct acc_detector_distance_basic_handle
 {
-	uint32_t             magic_number;
-	acc_service_handle_t envelope_handle;
-	uint16_t             *envelope_data;
-	uint16_t             envelope_data_length;
-	float                distance_offset;
-	float                distance_slope;
+	uint32_t                       magic_number;
+	acc_service_handle_t           envelope_handle;
+	acc_filter_percentile_handle_t median_filter;
+	uint16_t                       *envelope_data;
+	uint16_t                       envelope_data_length;
+	float                          distance_offset;
+	float                          distance_slope;
 } acc_detector_distance_basic_handle_internal_t;
 
 
@@ -56,11 +58,15 @@ acc_detector_distance_basic_handle_t acc_detector_distance_basic_create(acc_sens
 	acc_service_receiver_gain_set(envelope_configuration, 0.82f);
 	acc_service_hw_accelerated_average_samples_set(envelope_configuration, 7);
 
+	// The envelope service created by RSS is counted as memory of the detector
+	uint16_t memory_scope = acc_os_memory_scope_begin(REL_FILE_PATH);
+
 	acc_detector_distance_basic_handle_internal_t *detector_handle = acc_os_mem_alloc(sizeof(*detector_handle));
 
 	if (detector_handle != NULL)
 	{
 		detector_handle->magic_number = MAGIC_NUMBER;
+		detector_handle->median_filter = NULL;
 		detector_handle->envelope_handle = acc_service_create(envelope_configuration);
 
 		if (detector_handle->envelope_handle != NULL)
@@ -98,6 +104,8 @@ acc_detector_distance_basic_handle_t acc_detector_distance_basic_create(acc_sens
 		ACC_LOG_ERROR("Distance basic detector not possible to allocate");
 	}
 
+	acc_os_memory_scope_end(memory_scope);
+
 	acc_service_envelope_configuration_destroy(&envelope_configuration);
 
 	return (acc_detector_distance_basic_handle_t)detector_handle;
@@ -111,6 +119,7 @@ void acc_detector_distance_basic_destroy(acc_detector_distance_basic_handle_t *h
 		if (handle_valid(*handle))
 		{
 			acc_service_deactivate((*handle)->envelope_handle);
+			acc_filter_percentile_destroy(&(*handle)->median_filter);
 			acc_os_mem_free((*handle)->envelope_data);
 			acc_service_destroy(&(*handle)->envelope_handle);
 			acc_os_mem_free(*handle);
@@ -120,6 +129,30 @@ void acc_detector_distance_basic_destroy(acc_detector_distance_basic_handle_t *h
 }
 
 
+bool acc_detector_distance_basic_median_filter_set(acc_detector_distance_basic_handle_t handle, uint16_t window_length)
+{
+	if (!handle_valid(handle))
+	{
+		return false;
+	}
+
+	acc_filter_percentile_destroy(&handle->median_filter);
+
+	if (window_length > 0)
+	{
+		handle->median_filter = acc_filter_percentile_create(handle->envelope_data_length, window_length, 50);
+
+		if (handle->median_filter == NULL)
+		{
+			ACC_LOG_ERROR("Distance basic detector median filter not possible to create");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 acc_detector_distance_basic_reflection_t acc_detector_distance_basic_get_reflection(acc_detector_distance_basic_handle_t handle)
 {
 	acc_detector_distance_basic_reflection_t reflection;
@@ -134,6 +167,11 @@ acc_detector_distance_basic_reflection_t acc_detector_distance_basic_get_reflect
 		acc_service_envelope_result_info_t result_info;
 		acc_service_envelope_get_next(handle->envelope_handle, envelope_data, envelope_data_length, &result_info);
 
+		if (handle->median_filter != NULL)
+		{
+			acc_filter_percentile_process(handle->median_filter, envelope_data, envelope_data);
+		}
+
 		uint16_t reflection_index = get_reflection_index(envelope_data, envelope_data_length);
 
 		reflection.amplitude = envelope_data[reflection_index];
@@ -0,0 +1,472 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "acc_detector_gesture.h"
+
+
+#define MODULE "detector_gesture"
+
+#define MAGIC_NUMBER (0xACC06E57)
+
+#define DEFAULT_NOISE_FLOOR       150
+#define DEFAULT_PRESENCE_ENERGY   2000
+#define DEFAULT_VELOCITY_DEADBAND 16
+
+/**
+ * @brief Minimum half width in points of the area around the peak used for position and spread
+ */
+#define PEAK_AREA_MIN_HALF_WIDTH 4
+
+
+typedef struct acc_detector_gesture_handle
+{
+	uint32_t                              magic_number;
+	acc_detector_gesture_configuration_t  configuration;
+	uint16_t                              data_length;
+	uint16_t                              window_head;
+	uint16_t                              window_count;
+	acc_detector_gesture_t                last_gesture;
+	acc_detector_gesture_frame_features_t window[ACC_DETECTOR_GESTURE_WINDOW_LENGTH];
+	int32_t                               features[ACC_DETECTOR_GESTURE_FEATURE_COUNT];
+	uint16_t                              *amplitude;
+} acc_detector_gesture_handle_internal_t;
+
+
+/**
+ * @brief Decision tree node
+ *
+ * Inner nodes go to the left child if the feature is less than or equal to the threshold,
+ * otherwise to the right child. Leaves have feature set to -1 and the gesture as threshold.
+ */
+typedef struct
+{
+	int8_t  feature;
+	uint8_t left;
+	uint8_t right;
+	int32_t threshold;
+} tree_node_t;
+
+#define LEAF(gesture) {-1, 0, 0, (gesture)}
+
+/**
+ * @brief The compiled model
+ *
+ * Thresholds are in the units of the features, positions and velocities in Q12 fractions
+ * of the range. The table can be replaced by a tree trained on exported features.
+ */
+static const tree_node_t tree[] =
+{
+	/*  0 */ {ACC_DETECTOR_GESTURE_FEATURE_PRESENCE, 1, 2, 3},
+	/*  1 */ LEAF(ACC_DETECTOR_GESTURE_NONE),
+	/*  2 */ {ACC_DETECTOR_GESTURE_FEATURE_DIRECTION_CHANGES, 4, 3, 2},
+	/*  3 */ {ACC_DETECTOR_GESTURE_FEATURE_POSITION_RANGE, 4, 5, 200},
+	/*  4 */ {ACC_DETECTOR_GESTURE_FEATURE_NET_DISPLACEMENT, 6, 7, -400},
+	/*  5 */ LEAF(ACC_DETECTOR_GESTURE_WAVE),
+	/*  6 */ LEAF(ACC_DETECTOR_GESTURE_SWIPE_TOWARD),
+	/*  7 */ {ACC_DETECTOR_GESTURE_FEATURE_NET_DISPLACEMENT, 8, 9, 400},
+	/*  8 */ {ACC_DETECTOR_GESTURE_FEATURE_PRESENT_RUN, 10, 11, 39},
+	/*  9 */ LEAF(ACC_DETECTOR_GESTURE_SWIPE_AWAY),
+	/* 10 */ {ACC_DETECTOR_GESTURE_FEATURE_PRESENT_RUN, 13, 12, 0},
+	/* 11 */ {ACC_DETECTOR_GESTURE_FEATURE_POSITION_RANGE, 14, 12, 150},
+	/* 12 */ LEAF(ACC_DETECTOR_GESTURE_NONE),
+	/* 13 */ {ACC_DETECTOR_GESTURE_FEATURE_PRESENCE, 15, 12, 24},
+	/* 14 */ LEAF(ACC_DETECTOR_GESTURE_HOLD),
+	/* 15 */ {ACC_DETECTOR_GESTURE_FEATURE_POSITION_RANGE, 16, 12, 300},
+	/* 16 */ LEAF(ACC_DETECTOR_GESTURE_TAP),
+};
+
+
+static const char *gesture_names[ACC_DETECTOR_GESTURE_COUNT] =
+{
+	"none",
+	"tap",
+	"swipe_toward",
+	"swipe_away",
+	"hold",
+	"wave"
+};
+
+
+static bool handle_valid(acc_detector_gesture_handle_t handle);
+static uint32_t isqrt(uint32_t value);
+static int32_t log2_q4(uint32_t value);
+static void extract_frame_features(acc_detector_gesture_handle_t handle, const uint16_t *amplitude,
+                                   acc_detector_gesture_frame_features_t *frame);
+static void update_window_features(acc_detector_gesture_handle_t handle);
+static bool process_amplitude(acc_detector_gesture_handle_t handle, const uint16_t *amplitude,
+                              acc_detector_gesture_result_t *result);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+void acc_detector_gesture_configuration_default(acc_detector_gesture_configuration_t *configuration)
+{
+	configuration->noise_floor       = DEFAULT_NOISE_FLOOR;
+	configuration->presence_energy   = DEFAULT_PRESENCE_ENERGY;
+	configuration->velocity_deadband = DEFAULT_VELOCITY_DEADBAND;
+}
+
+
+size_t acc_detector_gesture_get_size(uint16_t data_length)
+{
+	return sizeof(acc_detector_gesture_handle_internal_t) + sizeof(uint16_t) * data_length;
+}
+
+
+acc_detector_gesture_handle_t acc_detector_gesture_init(void                                       *buffer,
+                                                        const acc_detector_gesture_configuration_t *configuration,
+                                                        uint16_t                                   data_length)
+{
+	if (buffer == NULL || configuration == NULL || data_length < 2)
+	{
+		return NULL;
+	}
+
+	acc_detector_gesture_handle_internal_t *handle = buffer;
+
+	memset(handle, 0, sizeof(*handle));
+
+	handle->magic_number  = MAGIC_NUMBER;
+	handle->configuration = *configuration;
+	handle->data_length   = data_length;
+	handle->last_gesture  = ACC_DETECTOR_GESTURE_NONE;
+	handle->amplitude     = (uint16_t *)(handle + 1);
+
+	return handle;
+}
+
+
+bool acc_detector_gesture_next_envelope(acc_detector_gesture_handle_t handle,
+                                        const uint16_t                *envelope_data,
+                                        acc_detector_gesture_result_t *result)
+{
+	if (!handle_valid(handle) || envelope_data == NULL)
+	{
+		return false;
+	}
+
+	return process_amplitude(handle, envelope_data, result);
+}
+
+
+bool acc_detector_gesture_next_sparse(acc_detector_gesture_handle_t handle,
+                                      const uint16_t                *sparse_data,
+                                      uint16_t                      sweeps_per_frame,
+                                      acc_detector_gesture_result_t *result)
+{
+	if (!handle_valid(handle) || sparse_data == NULL || sweeps_per_frame == 0)
+	{
+		return false;
+	}
+
+	const uint16_t length = handle->data_length;
+
+	for (uint16_t point = 0; point < length; point++)
+	{
+		uint32_t sum = 0;
+
+		for (uint16_t sweep = 0; sweep < sweeps_per_frame; sweep++)
+		{
+			sum += sparse_data[sweep * length + point];
+		}
+
+		int32_t  mean      = sum / sweeps_per_frame;
+		uint32_t deviation = 0;
+
+		for (uint16_t sweep = 0; sweep < sweeps_per_frame; sweep++)
+		{
+			int32_t d = (int32_t)sparse_data[sweep * length + point] - mean;
+
+			deviation += (d < 0) ? -d : d;
+		}
+
+		deviation /= sweeps_per_frame;
+
+		handle->amplitude[point] = (deviation > UINT16_MAX) ? UINT16_MAX : deviation;
+	}
+
+	return process_amplitude(handle, handle->amplitude, result);
+}
+
+
+void acc_detector_gesture_features_get(acc_detector_gesture_handle_t handle, int32_t *features)
+{
+	if (handle_valid(handle) && features != NULL)
+	{
+		memcpy(features, handle->features, sizeof(handle->features));
+	}
+}
+
+
+acc_detector_gesture_t acc_detector_gesture_classify(const int32_t *features)
+{
+	const tree_node_t *node = &tree[0];
+
+	while (node->feature >= 0)
+	{
+		node = &tree[(features[node->feature] <= node->threshold) ? node->left : node->right];
+	}
+
+	return node->threshold;
+}
+
+
+const char *acc_detector_gesture_name(acc_detector_gesture_t gesture)
+{
+	return (gesture < ACC_DETECTOR_GESTURE_COUNT) ? gesture_names[gesture] : "unknown";
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+bool handle_valid(acc_detector_gesture_handle_t handle)
+{
+	return (handle != NULL) && (handle->magic_number == MAGIC_NUMBER);
+}
+
+
+uint32_t isqrt(uint32_t value)
+{
+	uint32_t result = 0;
+	uint32_t bit    = 1UL << 30;
+
+	while (bit > value)
+	{
+		bit >>= 2;
+	}
+
+	while (bit != 0)
+	{
+		if (value >= result + bit)
+		{
+			value  -= result + bit;
+			result  = (result >> 1) + bit;
+		}
+		else
+		{
+			result >>= 1;
+		}
+
+		bit >>= 2;
+	}
+
+	return result;
+}
+
+
+/**
+ * @brief Base 2 logarithm in Q4
+ */
+int32_t log2_q4(uint32_t value)
+{
+	if (value == 0)
+	{
+		return 0;
+	}
+
+	int32_t msb = 31 - __builtin_clz(value);
+	int32_t fraction = (msb >= 4) ? (int32_t)((value >> (msb - 4)) & 0xf) : (int32_t)((value << (4 - msb)) & 0xf);
+
+	return (msb << 4) | fraction;
+}
+
+
+void extract_frame_features(acc_detector_gesture_handle_t handle, const uint16_t *amplitude,
+                            acc_detector_gesture_frame_features_t *frame)
+{
+	const uint16_t floor  = handle->configuration.noise_floor;
+	const uint16_t length = handle->data_length;
+	uint32_t       energy = 0;
+	uint16_t       peak_amplitude = 0;
+	uint16_t       peak_index     = 0;
+
+	for (uint16_t i = 0; i < length; i++)
+	{
+		uint16_t a = amplitude[i];
+
+		if (a > floor)
+		{
+			energy += a - floor;
+		}
+
+		if (a > peak_amplitude)
+		{
+			peak_amplitude = a;
+			peak_index     = i;
+		}
+	}
+
+	memset(frame, 0, sizeof(*frame));
+	frame->energy  = energy;
+	frame->present = energy >= handle->configuration.presence_energy && peak_amplitude > floor;
+
+	if (!frame->present)
+	{
+		return;
+	}
+
+	uint16_t half_width = length / 8;
+
+	if (half_width < PEAK_AREA_MIN_HALF_WIDTH)
+	{
+		half_width = PEAK_AREA_MIN_HALF_WIDTH;
+	}
+
+	uint16_t lo = (peak_index > half_width) ? peak_index - half_width : 0;
+	uint16_t hi = (peak_index + half_width < length) ? peak_index + half_width : length - 1;
+	uint32_t sum_w   = 0;
+	uint64_t sum_wi  = 0;
+	uint64_t sum_wi2 = 0;
+
+	for (uint16_t i = lo; i <= hi; i++)
+	{
+		uint32_t w = (amplitude[i] > floor) ? (uint32_t)(amplitude[i] - floor) : 0;
+		uint32_t x = i - lo;
+
+		sum_w   += w;
+		sum_wi  += (uint64_t)w * x;
+		sum_wi2 += (uint64_t)w * x * x;
+	}
+
+	// Centroid and variance relative to lo, in Q8 and Q16 points
+	uint32_t mean_q8  = (uint32_t)((sum_wi << 8) / sum_w);
+	uint64_t m2_q16   = (sum_wi2 << 16) / sum_w;
+	uint64_t mean2    = (uint64_t)mean_q8 * mean_q8;
+	uint32_t var_q16  = (m2_q16 > mean2) ? (uint32_t)(m2_q16 - mean2) : 0;
+	uint32_t scale    = length - 1;
+	uint32_t position = (((uint32_t)lo << 8) + mean_q8) << (ACC_DETECTOR_GESTURE_Q - 8);
+
+	frame->position = position / scale;
+	frame->spread   = (isqrt(var_q16) << (ACC_DETECTOR_GESTURE_Q - 8)) / scale;
+}
+
+
+void update_window_features(acc_detector_gesture_handle_t handle)
+{
+	int32_t  *features       = handle->features;
+	uint16_t count           = handle->window_count;
+	uint16_t index           = (handle->window_head + ACC_DETECTOR_GESTURE_WINDOW_LENGTH - count) % ACC_DETECTOR_GESTURE_WINDOW_LENGTH;
+	int32_t  presence        = 0;
+	int32_t  present_run     = 0;
+	int32_t  first_position  = -1;
+	int32_t  last_position   = 0;
+	int32_t  min_position    = INT32_MAX;
+	int32_t  max_position    = 0;
+	int32_t  speed_sum       = 0;
+	int32_t  spread_sum      = 0;
+	int32_t  direction       = 0;
+	int32_t  direction_changes = 0;
+	uint32_t max_energy      = 0;
+	int32_t  deadband        = handle->configuration.velocity_deadband;
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		const acc_detector_gesture_frame_features_t *frame = &handle->window[index];
+
+		index = (index + 1) % ACC_DETECTOR_GESTURE_WINDOW_LENGTH;
+
+		if (frame->energy > max_energy)
+		{
+			max_energy = frame->energy;
+		}
+
+		if (!frame->present)
+		{
+			present_run = 0;
+			continue;
+		}
+
+		presence++;
+		present_run++;
+		last_position = frame->position;
+
+		if (first_position < 0)
+		{
+			first_position = frame->position;
+		}
+
+		if (frame->position < min_position)
+		{
+			min_position = frame->position;
+		}
+
+		if (frame->position > max_position)
+		{
+			max_position = frame->position;
+		}
+
+		speed_sum  += (frame->velocity < 0) ? -frame->velocity : frame->velocity;
+		spread_sum += frame->spread;
+
+		if (frame->velocity > deadband || frame->velocity < -deadband)
+		{
+			int32_t new_direction = (frame->velocity > 0) ? 1 : -1;
+
+			if (direction != 0 && new_direction != direction)
+			{
+				direction_changes++;
+			}
+
+			direction = new_direction;
+		}
+	}
+
+	features[ACC_DETECTOR_GESTURE_FEATURE_PRESENCE]          = presence;
+	features[ACC_DETECTOR_GESTURE_FEATURE_PRESENT_RUN]       = present_run;
+	features[ACC_DETECTOR_GESTURE_FEATURE_NET_DISPLACEMENT]  = (presence > 0) ? last_position - first_position : 0;
+	features[ACC_DETECTOR_GESTURE_FEATURE_POSITION_RANGE]    = (presence > 0) ? max_position - min_position : 0;
+	features[ACC_DETECTOR_GESTURE_FEATURE_MEAN_SPEED]        = (presence > 0) ? speed_sum / presence : 0;
+	features[ACC_DETECTOR_GESTURE_FEATURE_DIRECTION_CHANGES] = direction_changes;
+	features[ACC_DETECTOR_GESTURE_FEATURE_MEAN_SPREAD]       = (presence > 0) ? spread_sum / presence : 0;
+	features[ACC_DETECTOR_GESTURE_FEATURE_LOG_ENERGY]        = log2_q4(max_energy);
+}
+
+
+bool process_amplitude(acc_detector_gesture_handle_t handle, const uint16_t *amplitude,
+                       acc_detector_gesture_result_t *result)
+{
+	acc_detector_gesture_frame_features_t frame;
+	const acc_detector_gesture_frame_features_t *previous = NULL;
+
+	if (handle->window_count > 0)
+	{
+		previous = &handle->window[(handle->window_head + ACC_DETECTOR_GESTURE_WINDOW_LENGTH - 1) % ACC_DETECTOR_GESTURE_WINDOW_LENGTH];
+	}
+
+	extract_frame_features(handle, amplitude, &frame);
+
+	if (frame.present && previous != NULL && previous->present)
+	{
+		frame.velocity = (int16_t)((int32_t)frame.position - (int32_t)previous->position);
+	}
+
+	handle->window[handle->window_head] = frame;
+	handle->window_head                 = (handle->window_head + 1) % ACC_DETECTOR_GESTURE_WINDOW_LENGTH;
+
+	if (handle->window_count < ACC_DETECTOR_GESTURE_WINDOW_LENGTH)
+	{
+		handle->window_count++;
+	}
+
+	update_window_features(handle);
+
+	acc_detector_gesture_t gesture = acc_detector_gesture_classify(handle->features);
+
+	if (result != NULL)
+	{
+		result->gesture = gesture;
+		result->event   = (gesture != handle->last_gesture) ? gesture : ACC_DETECTOR_GESTURE_NONE;
+		result->frame   = frame;
+	}
+
+	handle->last_gesture = gesture;
+
+	return true;
+}
@@ -0,0 +1,266 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_detector_gesture.h"
+
+
+/**
+ * @brief Export gesture features from envelope captures
+ *
+ * Reads envelope data as written by the data logger, one sweep per line with tab separated
+ * values, runs the gesture detector on it and prints the window features of each frame as
+ * comma separated values together with a label. The output is intended as training data
+ * for the decision tree in acc_detector_gesture.c.
+ */
+
+
+#define MAX_DATA_LENGTH 2048
+#define MAX_LINE_LENGTH (MAX_DATA_LENGTH * 8)
+
+
+typedef struct
+{
+	const char                           *label;
+	const char                           *file_path;
+	bool                                 header;
+	acc_detector_gesture_configuration_t configuration;
+} input_t;
+
+
+static const char *feature_names[ACC_DETECTOR_GESTURE_FEATURE_COUNT] =
+{
+	"presence",
+	"present_run",
+	"net_displacement",
+	"position_range",
+	"mean_speed",
+	"direction_changes",
+	"mean_spread",
+	"log_energy"
+};
+
+
+static bool parse_options(int argc, char *argv[], input_t *input);
+
+
+static uint16_t parse_line(char *line, uint16_t *data);
+
+
+static char     line[MAX_LINE_LENGTH];
+static uint16_t envelope_data[MAX_DATA_LENGTH];
+
+
+int main(int argc, char *argv[])
+{
+	input_t input;
+
+	input.label     = "none";
+	input.file_path = NULL;
+	input.header    = true;
+	acc_detector_gesture_configuration_default(&input.configuration);
+
+	if (!parse_options(argc, argv, &input))
+	{
+		return EXIT_FAILURE;
+	}
+
+	FILE *file = stdin;
+
+	if (input.file_path != NULL)
+	{
+		file = fopen(input.file_path, "r");
+		if (file == NULL)
+		{
+			fprintf(stderr, "Failed to open %s\n", input.file_path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	acc_detector_gesture_handle_t handle      = NULL;
+	void                          *buffer     = NULL;
+	uint16_t                      data_length = 0;
+	uint32_t                      frame_index = 0;
+	bool                          status      = true;
+
+	if (input.header)
+	{
+		printf("frame,label");
+		for (uint16_t i = 0; i < ACC_DETECTOR_GESTURE_FEATURE_COUNT; i++)
+		{
+			printf(",%s", feature_names[i]);
+		}
+
+		printf(",prediction\n");
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		uint16_t length = parse_line(line, envelope_data);
+
+		if (length == 0)
+		{
+			continue;
+		}
+
+		if (handle == NULL)
+		{
+			data_length = length;
+			buffer      = malloc(acc_detector_gesture_get_size(data_length));
+			handle      = acc_detector_gesture_init(buffer, &input.configuration, data_length);
+
+			if (handle == NULL)
+			{
+				fprintf(stderr, "Failed to create gesture detector with data length %u\n", (unsigned int)data_length);
+				status = false;
+				break;
+			}
+		}
+		else if (length != data_length)
+		{
+			fprintf(stderr, "Line %u has %u points, expected %u\n", (unsigned int)(frame_index + 1), (unsigned int)length,
+			        (unsigned int)data_length);
+			status = false;
+			break;
+		}
+
+		acc_detector_gesture_result_t result;
+		int32_t                       features[ACC_DETECTOR_GESTURE_FEATURE_COUNT];
+
+		acc_detector_gesture_next_envelope(handle, envelope_data, &result);
+		acc_detector_gesture_features_get(handle, features);
+
+		printf("%u,%s", (unsigned int)frame_index, input.label);
+		for (uint16_t i = 0; i < ACC_DETECTOR_GESTURE_FEATURE_COUNT; i++)
+		{
+			printf(",%d", (int)features[i]);
+		}
+
+		printf(",%s\n", acc_detector_gesture_name(result.gesture));
+
+		frame_index++;
+	}
+
+	free(buffer);
+
+	if (file != stdin)
+	{
+		fclose(file);
+	}
+
+	return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static uint16_t parse_line(char *line, uint16_t *data)
+{
+	uint16_t length = 0;
+	char     *position = line;
+
+	while (length < MAX_DATA_LENGTH)
+	{
+		char          *end;
+		unsigned long value = strtoul(position, &end, 10);
+
+		if (end == position)
+		{
+			break;
+		}
+
+		data[length++] = (value > UINT16_MAX) ? UINT16_MAX : value;
+		position       = end;
+	}
+
+	return length;
+}
+
+
+static void print_usage(void)
+{
+	acc_detector_gesture_configuration_t configuration;
+
+	acc_detector_gesture_configuration_default(&configuration);
+
+	printf("Usage: acc_detector_gesture_export [OPTION]...\n\n");
+	printf("Reads envelope data logger output and prints gesture window features as CSV\n\n");
+	printf("-h, --help                this help\n");
+	printf("-f, --file                path to envelope data, default stdin\n");
+	printf("-l, --label               label of the gesture in the capture, default none\n");
+	printf("-n, --noise-floor         amplitude treated as noise, default %u\n", (unsigned int)configuration.noise_floor);
+	printf("-p, --presence-energy     frame energy for presence, default %u\n", (unsigned int)configuration.presence_energy);
+	printf("-d, --velocity-deadband   velocity counted as movement, default %u\n",
+	       (unsigned int)configuration.velocity_deadband);
+	printf("-x, --no-header           do not print the header row\n");
+}
+
+
+bool parse_options(int argc, char *argv[], input_t *input)
+{
+	static struct option long_options[] =
+	{
+		{"file",              required_argument,  0, 'f'},
+		{"label",             required_argument,  0, 'l'},
+		{"noise-floor",       required_argument,  0, 'n'},
+		{"presence-energy",   required_argument,  0, 'p'},
+		{"velocity-deadband", required_argument,  0, 'd'},
+		{"no-header",         no_argument,        0, 'x'},
+		{"help",              no_argument,        0, 'h'},
+		{NULL,                0,                  NULL, 0}
+	};
+
+	int16_t character_code;
+	int32_t option_index = 0;
+
+	while ((character_code = getopt_long(argc, argv, "f:l:n:p:d:xh?", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 'f':
+			{
+				input->file_path = optarg;
+				break;
+			}
+			case 'l':
+			{
+				input->label = optarg;
+				break;
+			}
+			case 'n':
+			{
+				input->configuration.noise_floor = atoi(optarg);
+				break;
+			}
+			case 'p':
+			{
+				input->configuration.presence_energy = strtoul(optarg, NULL, 10);
+				break;
+			}
+			case 'd':
+			{
+				input->configuration.velocity_deadband = atoi(optarg);
+				break;
+			}
+			case 'x':
+			{
+				input->header = false;
+				break;
+			}
+			case 'h':
+			case '?':
+			default:
+			{
+				print_usage();
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
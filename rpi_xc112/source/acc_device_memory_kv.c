@@ -0,0 +1,901 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_device_memory_kv.h"
+
+#include "acc_device_memory.h"
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "device_memory_kv"	/**< Module name */
+
+/**
+ * @brief Record layout
+ *
+ * Each record is a 16 byte header followed by the value, padded to a multiple of 4 bytes.
+ * All header fields are stored little endian.
+ *
+ *   0  magic
+ *   1  flags
+ *   2  key
+ *   4  length
+ *   6  crc16 of header (crc excluded) and value
+ *   8  sequence number
+ *  12  crc16 of value only, used to skip unchanged writes
+ *  14  reserved
+ */
+#define KV_MAGIC          0x4b
+#define KV_FLAG_TOMBSTONE 0x01
+#define KV_HEADER_SIZE    16
+#define KV_CRC_OFFSET     6
+#define KV_ALIGNMENT      4
+#define KV_PAGE_SIZE      64		/**< Write page size of the 24Cxx EEPROM */
+#define KV_RECORD_MAX     (KV_HEADER_SIZE + ACC_DEVICE_MEMORY_KV_VALUE_MAX)
+
+/**
+ * @brief Amount of log reclaimed in one compaction step
+ */
+#define KV_RECLAIM_CHUNK KV_PAGE_SIZE
+
+/**
+ * @brief Free space always kept in the log
+ *
+ * Live records moved in one compaction step never exceed one chunk plus one record,
+ * keeping this much free means a move never has to overwrite the record being moved.
+ */
+#define KV_RESERVE (KV_RECLAIM_CHUNK + KV_RECORD_MAX)
+
+/**
+ * @brief Space kept when admitting new data so that a key can always be removed
+ */
+#define KV_TOMBSTONE_ROOM (KV_HEADER_SIZE + KV_PAGE_SIZE)
+
+#define KV_ALIGN(x) (((x) + KV_ALIGNMENT - 1) & ~(uint32_t)(KV_ALIGNMENT - 1))
+#define KV_RECORD_SIZE(length) KV_ALIGN(KV_HEADER_SIZE + (uint32_t)(length))
+
+
+typedef struct
+{
+	uint16_t key;
+	uint16_t length;
+	uint16_t value_crc;
+	bool     tombstone;
+	uint32_t offset;
+	uint32_t sequence;
+} kv_entry_t;
+
+
+static acc_app_integration_mutex_t kv_mutex = NULL;
+static bool                        init_done = false;
+
+static uint32_t region_start;
+static uint32_t region_size;
+
+static uint32_t head;		/**< Offset where the next record is written */
+static uint32_t tail;		/**< Offset of the oldest part of the log that may hold live records */
+static uint32_t used;		/**< Number of bytes from tail to head */
+static uint32_t live_bytes;	/**< Number of bytes held by live records */
+static uint32_t next_sequence;
+
+static kv_entry_t entries[ACC_DEVICE_MEMORY_KV_MAX_KEYS];
+static uint16_t   entry_count;
+
+static uint8_t record_buffer[KV_RECORD_MAX + KV_ALIGNMENT];
+
+static uint32_t records_written;
+static uint32_t records_moved;
+static uint32_t writes_skipped;
+
+
+static uint16_t crc16_update(uint16_t crc, const uint8_t *data, size_t length)
+{
+	// CRC-16/CCITT-FALSE, polynomial 0x1021
+	for (size_t i = 0; i < length; i++)
+	{
+		crc ^= (uint16_t)data[i] << 8;
+
+		for (uint_fast8_t bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+	}
+
+	return crc;
+}
+
+
+static void put_u16(uint8_t *buffer, uint16_t value)
+{
+	buffer[0] = value & 0xff;
+	buffer[1] = value >> 8;
+}
+
+
+static void put_u32(uint8_t *buffer, uint32_t value)
+{
+	put_u16(buffer, value & 0xffff);
+	put_u16(buffer + 2, value >> 16);
+}
+
+
+static uint16_t get_u16(const uint8_t *buffer)
+{
+	return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+
+static uint32_t get_u32(const uint8_t *buffer)
+{
+	return get_u16(buffer) | ((uint32_t)get_u16(buffer + 2) << 16);
+}
+
+
+/**
+ * @brief Circular distance in the region from one offset to another
+ */
+static uint32_t distance(uint32_t from, uint32_t to)
+{
+	return (to >= from) ? (to - from) : (region_size - from + to);
+}
+
+
+static uint32_t advance(uint32_t offset, uint32_t amount)
+{
+	offset += amount;
+
+	return (offset >= region_size) ? (offset - region_size) : offset;
+}
+
+
+static bool region_read(uint32_t offset, void *buffer, size_t size)
+{
+	uint8_t *data  = buffer;
+	size_t  first = region_size - offset;
+
+	if (size == 0)
+	{
+		return true;
+	}
+
+	if (size <= first)
+	{
+		return acc_device_memory_read(region_start + offset, data, size);
+	}
+
+	return acc_device_memory_read(region_start + offset, data, first) &&
+	       acc_device_memory_read(region_start, data + first, size - first);
+}
+
+
+static bool region_write(uint32_t offset, const void *buffer, size_t size)
+{
+	const uint8_t *data  = buffer;
+	size_t        first = region_size - offset;
+
+	if (size == 0)
+	{
+		return true;
+	}
+
+	if (size <= first)
+	{
+		return acc_device_memory_write(region_start + offset, data, size);
+	}
+
+	return acc_device_memory_write(region_start + offset, data, first) &&
+	       acc_device_memory_write(region_start, data + first, size - first);
+}
+
+
+static kv_entry_t *find_entry(uint16_t key)
+{
+	for (uint16_t i = 0; i < entry_count; i++)
+	{
+		if (entries[i].key == key)
+		{
+			return &entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+static void remove_entry(kv_entry_t *entry)
+{
+	live_bytes -= KV_RECORD_SIZE(entry->length);
+	*entry      = entries[--entry_count];
+}
+
+
+/**
+ * @brief Finalize the header of the record in record_buffer and append it to the log
+ *
+ * The value must already be in place after the header. The caller must make sure that
+ * pad + record size bytes are free.
+ *
+ * The padding is erased rather than skipped. build_index tries every aligned offset, an old
+ * record left in the padding would otherwise outlive the newer records and tombstones of its
+ * key that the head overwrites later, and come back when the index is rebuilt.
+ *
+ * @param[in] key Record key
+ * @param[in] flags Record flags
+ * @param[in] length Value length
+ * @param[in] pad Number of bytes to erase before the record, less than a page
+ * @param[out] offset Offset the record was written at
+ * @return True if successful, false otherwise
+ */
+static bool append_record(uint16_t key, uint8_t flags, uint16_t length, uint32_t pad, uint32_t *offset)
+{
+	uint32_t record_size = KV_RECORD_SIZE(length);
+	uint32_t position    = advance(head, pad);
+	uint8_t  *header     = record_buffer;
+	uint8_t  erased[KV_PAGE_SIZE];
+
+	memset(record_buffer + KV_HEADER_SIZE + length, 0xff, record_size - KV_HEADER_SIZE - length);
+
+	header[0] = KV_MAGIC;
+	header[1] = flags;
+	put_u16(header + 2, key);
+	put_u16(header + 4, length);
+	put_u32(header + 8, next_sequence);
+	put_u16(header + 12, crc16_update(0xffff, record_buffer + KV_HEADER_SIZE, length));
+	put_u16(header + 14, 0xffff);
+
+	uint16_t crc = crc16_update(0xffff, header, KV_CRC_OFFSET);
+	crc = crc16_update(crc, header + KV_CRC_OFFSET + 2, KV_HEADER_SIZE - KV_CRC_OFFSET - 2 + length);
+	put_u16(header + KV_CRC_OFFSET, crc);
+
+	// The padding ends at a page boundary, so it is a page write of its own
+	memset(erased, 0xff, pad);
+
+	if (!region_write(head, erased, pad) || !region_write(position, record_buffer, record_size))
+	{
+		ACC_LOG_ERROR("Failed to write record for key %u", (unsigned int)key);
+		return false;
+	}
+
+	next_sequence++;
+	records_written++;
+
+	head  = advance(position, record_size);
+	used += pad + record_size;
+
+	*offset = position;
+
+	return true;
+}
+
+
+/**
+ * @brief Padding needed to keep a record within one EEPROM write page
+ *
+ * Records that fit in a page are not allowed to cross a page boundary, so that they are
+ * written with a single page write.
+ */
+static uint32_t page_padding(uint32_t record_size)
+{
+	if (record_size > KV_PAGE_SIZE)
+	{
+		return 0;
+	}
+
+	uint32_t page_offset = (region_start + head) % KV_PAGE_SIZE;
+
+	return (page_offset + record_size > KV_PAGE_SIZE) ? (KV_PAGE_SIZE - page_offset) : 0;
+}
+
+
+static bool move_entry(kv_entry_t *entry)
+{
+	if (!region_read(advance(entry->offset, KV_HEADER_SIZE), record_buffer + KV_HEADER_SIZE, entry->length))
+	{
+		return false;
+	}
+
+	if (crc16_update(0xffff, record_buffer + KV_HEADER_SIZE, entry->length) != entry->value_crc)
+	{
+		ACC_LOG_ERROR("Value of key %u is corrupt, dropping it", (unsigned int)entry->key);
+		remove_entry(entry);
+		return true;
+	}
+
+	if (!append_record(entry->key, 0, entry->length, 0, &entry->offset))
+	{
+		return false;
+	}
+
+	entry->sequence = next_sequence - 1;
+	records_moved++;
+
+	return true;
+}
+
+
+/**
+ * @brief Reclaim space from the tail of the log
+ *
+ * Dead space before the first live record is released without any memory access.
+ * Live records starting within one chunk from the tail are moved to the head.
+ *
+ * @return True if successful, false otherwise
+ */
+static bool reclaim_step(void)
+{
+	uint32_t first_live = used;
+
+	for (uint16_t i = 0; i < entry_count; i++)
+	{
+		uint32_t d = distance(tail, entries[i].offset);
+
+		if (d < first_live)
+		{
+			first_live = d;
+		}
+	}
+
+	if (first_live >= used)
+	{
+		tail = head;
+		used = 0;
+		return true;
+	}
+
+	tail  = advance(tail, first_live);
+	used -= first_live;
+
+	uint32_t   chunk = (used < KV_RECLAIM_CHUNK) ? used : KV_RECLAIM_CHUNK;
+	uint16_t   chunk_keys[ACC_DEVICE_MEMORY_KV_MAX_KEYS];
+	uint16_t   chunk_count = 0;
+	uint32_t   reclaimed   = chunk;
+
+	for (uint16_t i = 0; i < entry_count; i++)
+	{
+		uint32_t d = distance(tail, entries[i].offset);
+
+		if (d < chunk)
+		{
+			uint32_t end = d + KV_RECORD_SIZE(entries[i].length);
+
+			if (end > reclaimed)
+			{
+				reclaimed = end;
+			}
+
+			chunk_keys[chunk_count++] = entries[i].key;
+		}
+	}
+
+	for (uint16_t i = 0; i < chunk_count; i++)
+	{
+		kv_entry_t *entry = find_entry(chunk_keys[i]);
+
+		if (entry != NULL && !move_entry(entry))
+		{
+			return false;
+		}
+	}
+
+	tail  = advance(tail, reclaimed);
+	used -= reclaimed;
+
+	return true;
+}
+
+
+static bool ensure_free(uint32_t size)
+{
+	// Each step either releases dead space or rotates live records, one lap is always enough
+	uint32_t max_steps = region_size / KV_ALIGNMENT + ACC_DEVICE_MEMORY_KV_MAX_KEYS;
+
+	while (region_size - used < size + KV_RESERVE)
+	{
+		if (max_steps-- == 0 || !reclaim_step())
+		{
+			ACC_LOG_ERROR("Failed to reclaim space");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * @brief Read the log from the start of the region into an image of the region
+ *
+ * Records are read one after another from the start of the region until an erased header
+ * at a page boundary, the rest of the image is left erased. Until the log has wrapped this
+ * reads only the records and not the whole region over I2C. Erased headers inside a page
+ * are the padding before a record and are skipped to the next page.
+ *
+ * @param[out] image region_size bytes
+ * @return True if the end of the log was found, false if the whole region must be read
+ */
+static bool read_log(uint8_t *image)
+{
+	uint32_t offset = 0;
+
+	memset(image, 0xff, region_size);
+
+	while (offset + KV_HEADER_SIZE <= region_size)
+	{
+		uint8_t *header = image + offset;
+
+		if (!region_read(offset, header, KV_HEADER_SIZE))
+		{
+			return false;
+		}
+
+		if (header[0] == 0xff && memcmp(header, header + 1, KV_HEADER_SIZE - 1) == 0)
+		{
+			uint32_t page_offset = (region_start + offset) % KV_PAGE_SIZE;
+
+			if (page_offset == 0)
+			{
+				return true;
+			}
+
+			memset(header, 0xff, KV_HEADER_SIZE);
+			offset += KV_PAGE_SIZE - page_offset;
+			continue;
+		}
+
+		uint16_t length = get_u16(header + 4);
+
+		if (header[0] != KV_MAGIC || length > ACC_DEVICE_MEMORY_KV_VALUE_MAX || offset + KV_RECORD_SIZE(length) > region_size)
+		{
+			return false;
+		}
+
+		if (!region_read(offset + KV_HEADER_SIZE, header + KV_HEADER_SIZE, KV_RECORD_SIZE(length) - KV_HEADER_SIZE))
+		{
+			return false;
+		}
+
+		offset += KV_RECORD_SIZE(length);
+	}
+
+	return false;
+}
+
+
+/**
+ * @brief Build the index from an image of the whole region
+ *
+ * All aligned offsets are tried as record starts, a record is accepted if its crc is valid.
+ * The newest record of each key wins and the newest record overall gives the head of the log.
+ */
+static bool build_index(const uint8_t *image)
+{
+	uint32_t   max_candidates = region_size / KV_HEADER_SIZE;
+	kv_entry_t *candidates    = acc_os_mem_alloc(sizeof(*candidates) * max_candidates);
+	uint32_t   candidate_count = 0;
+	bool       found_any       = false;
+	uint32_t   max_sequence    = 0;
+	uint8_t    header[KV_HEADER_SIZE];
+
+	if (candidates == NULL)
+	{
+		return false;
+	}
+
+	head = 0;
+
+	for (uint32_t offset = 0; offset < region_size; offset += KV_ALIGNMENT)
+	{
+		if (image[offset] != KV_MAGIC)
+		{
+			continue;
+		}
+
+		for (uint32_t i = 0; i < KV_HEADER_SIZE; i++)
+		{
+			header[i] = image[advance(offset, i)];
+		}
+
+		uint16_t length = get_u16(header + 4);
+
+		if (length > ACC_DEVICE_MEMORY_KV_VALUE_MAX || KV_RECORD_SIZE(length) > region_size)
+		{
+			continue;
+		}
+
+		uint16_t crc       = crc16_update(0xffff, header, KV_CRC_OFFSET);
+		uint16_t value_crc = 0xffff;
+
+		crc = crc16_update(crc, header + KV_CRC_OFFSET + 2, KV_HEADER_SIZE - KV_CRC_OFFSET - 2);
+
+		for (uint32_t i = 0; i < length; i++)
+		{
+			uint8_t byte = image[advance(offset, KV_HEADER_SIZE + i)];
+
+			crc       = crc16_update(crc, &byte, 1);
+			value_crc = crc16_update(value_crc, &byte, 1);
+		}
+
+		if (crc != get_u16(header + KV_CRC_OFFSET) || value_crc != get_u16(header + 12))
+		{
+			continue;
+		}
+
+		kv_entry_t record =
+		{
+			.key       = get_u16(header + 2),
+			.length    = length,
+			.value_crc = value_crc,
+			.tombstone = (header[1] & KV_FLAG_TOMBSTONE) != 0,
+			.offset    = offset,
+			.sequence  = get_u32(header + 8)
+		};
+
+		if (!found_any || record.sequence > max_sequence)
+		{
+			found_any    = true;
+			max_sequence = record.sequence;
+			head         = advance(offset, KV_RECORD_SIZE(length));
+		}
+
+		uint32_t i;
+
+		for (i = 0; i < candidate_count; i++)
+		{
+			if (candidates[i].key == record.key)
+			{
+				break;
+			}
+		}
+
+		if (i == candidate_count)
+		{
+			candidate_count++;
+			candidates[i] = record;
+		}
+		else if (record.sequence > candidates[i].sequence)
+		{
+			candidates[i] = record;
+		}
+
+		offset += KV_RECORD_SIZE(length) - KV_ALIGNMENT;
+	}
+
+	next_sequence = found_any ? max_sequence + 1 : 0;
+	entry_count   = 0;
+	live_bytes    = 0;
+
+	for (uint32_t i = 0; i < candidate_count; i++)
+	{
+		if (candidates[i].tombstone)
+		{
+			continue;
+		}
+
+		if (entry_count == ACC_DEVICE_MEMORY_KV_MAX_KEYS)
+		{
+			ACC_LOG_ERROR("Too many keys in region");
+			acc_os_mem_free(candidates);
+			return false;
+		}
+
+		entries[entry_count++] = candidates[i];
+		live_bytes            += KV_RECORD_SIZE(candidates[i].length);
+	}
+
+	acc_os_mem_free(candidates);
+
+	// The oldest live record is the first one found going forward from the head
+	if (entry_count == 0)
+	{
+		tail = head;
+		used = 0;
+	}
+	else
+	{
+		uint32_t min_distance = region_size;
+
+		for (uint16_t i = 0; i < entry_count; i++)
+		{
+			uint32_t d = distance(head, entries[i].offset);
+
+			if (d < min_distance)
+			{
+				min_distance = d;
+				tail         = entries[i].offset;
+			}
+		}
+
+		used = region_size - min_distance;
+	}
+
+	return true;
+}
+
+
+bool acc_device_memory_kv_init(uint32_t start_address, size_t size)
+{
+	size_t memory_size;
+
+	if (init_done)
+	{
+		return true;
+	}
+
+	if (!acc_device_memory_get_size(&memory_size))
+	{
+		ACC_LOG_ERROR("Memory device not initialized");
+		return false;
+	}
+
+	if (size == 0 && start_address < memory_size)
+	{
+		size = memory_size - start_address;
+	}
+
+	// The page padding of records and the end of log search assume whole pages
+	if ((start_address % KV_PAGE_SIZE) != 0 || (size % KV_PAGE_SIZE) != 0 || start_address + size > memory_size ||
+	    size < 2 * (KV_RESERVE + KV_TOMBSTONE_ROOM))
+	{
+		ACC_LOG_ERROR("Invalid key-value region 0x%x, size %u", (unsigned int)start_address, (unsigned int)size);
+		return false;
+	}
+
+	if (kv_mutex == NULL)
+	{
+		kv_mutex = acc_os_mutex_create();
+
+		if (kv_mutex == NULL)
+		{
+			return false;
+		}
+	}
+
+	region_start = start_address;
+	region_size  = size;
+
+	uint8_t *image = acc_os_mem_alloc(region_size);
+
+	if (image == NULL)
+	{
+		return false;
+	}
+
+	bool status = (read_log(image) || acc_device_memory_read(region_start, image, region_size)) && build_index(image);
+
+	acc_os_mem_free(image);
+
+	if (!status)
+	{
+		ACC_LOG_ERROR("Failed to build key-value index");
+		return false;
+	}
+
+	records_written = 0;
+	records_moved   = 0;
+	writes_skipped  = 0;
+
+	ACC_LOG_VERBOSE("%u keys, %u of %u bytes live", (unsigned int)entry_count, (unsigned int)live_bytes, (unsigned int)region_size);
+
+	init_done = true;
+
+	return true;
+}
+
+
+void acc_device_memory_kv_deinit(void)
+{
+	if (!init_done)
+	{
+		return;
+	}
+
+	init_done = false;
+
+	acc_os_mutex_destroy(kv_mutex);
+	kv_mutex = NULL;
+}
+
+
+bool acc_device_memory_kv_store(uint16_t key, const void *value, uint16_t length)
+{
+	if (!init_done || length > ACC_DEVICE_MEMORY_KV_VALUE_MAX || (value == NULL && length > 0))
+	{
+		return false;
+	}
+
+	acc_os_mutex_lock(kv_mutex);
+
+	kv_entry_t *entry     = find_entry(key);
+	uint16_t   value_crc = crc16_update(0xffff, value, length);
+
+	if (entry != NULL && entry->length == length && entry->value_crc == value_crc)
+	{
+		// Most likely unchanged, a read is much cheaper than a write to confirm it
+		if (region_read(advance(entry->offset, KV_HEADER_SIZE), record_buffer, length) &&
+		    memcmp(record_buffer, value, length) == 0)
+		{
+			writes_skipped++;
+			acc_os_mutex_unlock(kv_mutex);
+			return true;
+		}
+	}
+
+	uint32_t record_size = KV_RECORD_SIZE(length);
+	uint32_t max_padding = (record_size <= KV_PAGE_SIZE) ? KV_PAGE_SIZE - KV_ALIGNMENT : 0;
+
+	if ((entry == NULL && entry_count == ACC_DEVICE_MEMORY_KV_MAX_KEYS) ||
+	    live_bytes + record_size + max_padding + KV_RESERVE + KV_TOMBSTONE_ROOM > region_size)
+	{
+		ACC_LOG_ERROR("Key-value store full");
+		acc_os_mutex_unlock(kv_mutex);
+		return false;
+	}
+
+	if (!ensure_free(record_size + max_padding))
+	{
+		acc_os_mutex_unlock(kv_mutex);
+		return false;
+	}
+
+	// Compaction may have moved entries around
+	entry = find_entry(key);
+
+	uint32_t offset;
+
+	memcpy(record_buffer + KV_HEADER_SIZE, value, length);
+
+	if (!append_record(key, 0, length, page_padding(record_size), &offset))
+	{
+		acc_os_mutex_unlock(kv_mutex);
+		return false;
+	}
+
+	if (entry == NULL)
+	{
+		entry = &entries[entry_count++];
+	}
+	else
+	{
+		live_bytes -= KV_RECORD_SIZE(entry->length);
+	}
+
+	entry->key       = key;
+	entry->length    = length;
+	entry->value_crc = value_crc;
+	entry->tombstone = false;
+	entry->offset    = offset;
+	entry->sequence  = next_sequence - 1;
+	live_bytes      += record_size;
+
+	acc_os_mutex_unlock(kv_mutex);
+
+	return true;
+}
+
+
+bool acc_device_memory_kv_load(uint16_t key, void *value, uint16_t max_length, uint16_t *length)
+{
+	if (!init_done || value == NULL)
+	{
+		return false;
+	}
+
+	acc_os_mutex_lock(kv_mutex);
+
+	kv_entry_t *entry  = find_entry(key);
+	bool       status = false;
+
+	if (entry != NULL && entry->length <= max_length)
+	{
+		status = (entry->length == 0) || region_read(advance(entry->offset, KV_HEADER_SIZE), value, entry->length);
+
+		if (status && crc16_update(0xffff, value, entry->length) != entry->value_crc)
+		{
+			ACC_LOG_ERROR("Value of key %u is corrupt", (unsigned int)key);
+			status = false;
+		}
+
+		if (status && length != NULL)
+		{
+			*length = entry->length;
+		}
+	}
+
+	acc_os_mutex_unlock(kv_mutex);
+
+	return status;
+}
+
+
+bool acc_device_memory_kv_get_length(uint16_t key, uint16_t *length)
+{
+	if (!init_done || length == NULL)
+	{
+		return false;
+	}
+
+	acc_os_mutex_lock(kv_mutex);
+
+	kv_entry_t *entry = find_entry(key);
+
+	if (entry != NULL)
+	{
+		*length = entry->length;
+	}
+
+	acc_os_mutex_unlock(kv_mutex);
+
+	return entry != NULL;
+}
+
+
+bool acc_device_memory_kv_remove(uint16_t key)
+{
+	if (!init_done)
+	{
+		return false;
+	}
+
+	acc_os_mutex_lock(kv_mutex);
+
+	if (find_entry(key) == NULL)
+	{
+		acc_os_mutex_unlock(kv_mutex);
+		return true;
+	}
+
+	uint32_t offset;
+
+	// A tombstone hides older records of the key when the index is rebuilt, it is never moved.
+	// Older records of the key lie behind it in the log, and as the head overwrites every byte
+	// in order, padding included, they are overwritten before it.
+	bool status = ensure_free(KV_TOMBSTONE_ROOM) &&
+	              append_record(key, KV_FLAG_TOMBSTONE, 0, page_padding(KV_RECORD_SIZE(0)), &offset);
+
+	if (status)
+	{
+		kv_entry_t *entry = find_entry(key);
+
+		if (entry != NULL)
+		{
+			remove_entry(entry);
+		}
+	}
+
+	acc_os_mutex_unlock(kv_mutex);
+
+	return status;
+}
+
+
+void acc_device_memory_kv_get_statistics(acc_device_memory_kv_statistics_t *statistics)
+{
+	if (statistics == NULL)
+	{
+		return;
+	}
+
+	memset(statistics, 0, sizeof(*statistics));
+
+	if (!init_done)
+	{
+		return;
+	}
+
+	acc_os_mutex_lock(kv_mutex);
+
+	statistics->region_size     = region_size;
+	statistics->live_bytes      = live_bytes;
+	statistics->used_bytes      = used;
+	statistics->key_count       = entry_count;
+	statistics->records_written = records_written;
+	statistics->records_moved   = records_moved;
+	statistics->writes_skipped  = writes_skipped;
+
+	acc_os_mutex_unlock(kv_mutex);
+}
@@ -1,16 +1,88 @@
 // Copyright (c) Acconeer AB, 2018-2019
 // All rights reserved
 
+#if defined(TARGET_OS_linux) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "acc_device_os.h"
 
 #include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
 
+#if defined(TARGET_OS_linux)
+#include <dlfcn.h>
+#endif
+
 #include "acc_app_integration.h"
 
+
+/**
+ * @brief Maximum number of distinct call sites recorded by the steady state tripwire
+ */
+#define STEADY_STATE_SITES_MAX 32
+
+
+/**
+ * @brief Size of the header in front of each allocation, keeps the alignment of the platform allocator
+ */
+#define ALLOCATION_HEADER_SIZE 16
+
+
+/**
+ * @brief Account for names beyond ACC_OS_MEMORY_ACCOUNTS_MAX
+ */
+#define MEMORY_ACCOUNT_OTHER 0
+
+
+/**
+ * @brief Scope of a thread that has not begun one
+ */
+#define MEMORY_SCOPE_NONE UINT16_MAX
+
+/**
+ * @brief Maximum length of the name an account is found by, as of a file name
+ */
+#define MEMORY_ACCOUNT_KEY_LENGTH_MAX 255
+
+
+typedef struct
+{
+	const char *file;
+	uint16_t   line;
+	bool       is_free;
+	const void *caller;
+	uint32_t   count;
+} steady_state_site_t;
+
+
+typedef struct
+{
+	size_t   size;
+	uint16_t account;
+} allocation_header_t;
+
+
 static bool init_done;
 
+static bool                steady_state_armed;
+static bool                steady_state_lock;
+static uint32_t            steady_state_calls;
+static uint16_t            steady_state_site_count;
+static steady_state_site_t steady_state_sites[STEADY_STATE_SITES_MAX];
+
+// Set while the platform allocator is called from this file, so an interposed libc allocator does not count the call twice
+static __thread bool inside_allocator;
+
+// Accounts are appended under the lock and never removed, so they can be searched without it
+static acc_os_memory_account_t memory_accounts[ACC_OS_MEMORY_ACCOUNTS_MAX] = {{.name = "other"}};
+// The untruncated names, so that names with a common prefix of the reported name length get an account each
+static char                    memory_account_keys[ACC_OS_MEMORY_ACCOUNTS_MAX][MEMORY_ACCOUNT_KEY_LENGTH_MAX + 1] = {"other"};
+static uint16_t                memory_account_count = 1;
+static bool                    memory_account_lock;
+static __thread uint16_t       memory_scope = MEMORY_SCOPE_NONE;
+
 void                                (*acc_device_os_init_func)(void) = NULL;
 void                                (*acc_device_os_stack_setup_func)(size_t stack_size) = NULL;
 size_t                              (*acc_device_os_stack_get_usage_func)(size_t stack_size) = NULL;
@@ -28,6 +100,7 @@ void                                (*acc_device_os_mutex_destroy_func)(acc_app_
 acc_app_integration_thread_handle_t (*acc_device_os_thread_create_func)(void (*func)(void *param), void *param, const char *name) = NULL;
 void                                (*acc_device_os_thread_exit_func)(void) = NULL;
 void                                (*acc_device_os_thread_cleanup_func)(acc_app_integration_thread_handle_t handle) = NULL;
+uint16_t                            (*acc_device_os_thread_stacks_get_func)(acc_os_thread_stack_t *stacks, uint16_t max_count) = NULL;
 acc_app_integration_semaphore_t     (*acc_device_os_semaphore_create_func)(void) = NULL;
 bool                                (*acc_device_os_semaphore_wait_func)(acc_app_integration_semaphore_t sem, uint16_t timeout_ms) = NULL;
 void                                (*acc_device_os_semaphore_signal_func)(acc_app_integration_semaphore_t sem) = NULL;
@@ -41,6 +114,15 @@ static bool heap_debug = false;
 #endif
 
 
+static uint16_t memory_account_find(const char *name);
+
+
+static void *accounted_alloc(size_t size, uint16_t account);
+
+
+static void accounted_free(void *ptr);
+
+
 void acc_os_init(void)
 {
 	if (init_done)
@@ -129,7 +211,16 @@ void *acc_os_mem_alloc_debug(size_t size, const char *file, uint16_t line)
 
 	if (init_done && acc_device_os_mem_alloc_func != NULL)
 	{
-		result = acc_device_os_mem_alloc_func(size);
+		acc_os_steady_state_record(file, line, NULL, false);
+
+		uint16_t account = memory_scope;
+
+		if (account == MEMORY_SCOPE_NONE)
+		{
+			account = (file != NULL) ? memory_account_find(file) : MEMORY_ACCOUNT_OTHER;
+		}
+
+		result = accounted_alloc(size, account);
 
 		if (heap_debug)
 		{
@@ -171,11 +262,311 @@ void acc_os_mem_free(void *ptr)
 			acc_os_debug_untrack_allocation(ptr);
 		}
 
-		acc_device_os_mem_free_func(ptr);
+		if (ptr != NULL)
+		{
+			acc_os_steady_state_record(NULL, 0, __builtin_return_address(0), true);
+		}
+
+		accounted_free(ptr);
+	}
+}
+
+
+void *acc_os_hal_mem_alloc(size_t size)
+{
+	static uint16_t rss_account = MEMORY_SCOPE_NONE;
+
+	void *result = NULL;
+
+	if (acc_device_os_mem_alloc_func != NULL)
+	{
+		acc_os_steady_state_record(NULL, 0, __builtin_return_address(0), false);
+
+		uint16_t account = memory_scope;
+
+		if (account == MEMORY_SCOPE_NONE)
+		{
+			if (rss_account == MEMORY_SCOPE_NONE)
+			{
+				rss_account = memory_account_find("rss");
+			}
+
+			account = rss_account;
+		}
+
+		result = accounted_alloc(size, account);
+	}
+
+	return result;
+}
+
+
+void acc_os_hal_mem_free(void *ptr)
+{
+	if (acc_device_os_mem_free_func != NULL)
+	{
+		if (ptr != NULL)
+		{
+			acc_os_steady_state_record(NULL, 0, __builtin_return_address(0), true);
+		}
+
+		accounted_free(ptr);
 	}
 }
 
 
+uint16_t acc_os_memory_scope_begin(const char *name)
+{
+	uint16_t previous_scope = memory_scope;
+
+	memory_scope = memory_account_find(name);
+
+	return previous_scope;
+}
+
+
+void acc_os_memory_scope_end(uint16_t previous_scope)
+{
+	memory_scope = previous_scope;
+}
+
+
+void acc_os_memory_mapped(const char *name, size_t size)
+{
+	__atomic_add_fetch(&memory_accounts[memory_account_find(name)].mapped_bytes, size, __ATOMIC_RELAXED);
+}
+
+
+void acc_os_memory_unmapped(const char *name, size_t size)
+{
+	__atomic_sub_fetch(&memory_accounts[memory_account_find(name)].mapped_bytes, size, __ATOMIC_RELAXED);
+}
+
+
+uint16_t acc_os_memory_get_accounts(acc_os_memory_account_t *accounts, uint16_t max_count)
+{
+	uint16_t count = __atomic_load_n(&memory_account_count, __ATOMIC_ACQUIRE);
+
+	if (count > max_count)
+	{
+		count = max_count;
+	}
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		const acc_os_memory_account_t *account = &memory_accounts[i];
+
+		memcpy(accounts[i].name, account->name, sizeof(accounts[i].name));
+		accounts[i].heap_bytes       = __atomic_load_n(&account->heap_bytes, __ATOMIC_RELAXED);
+		accounts[i].heap_peak_bytes  = __atomic_load_n(&account->heap_peak_bytes, __ATOMIC_RELAXED);
+		accounts[i].allocation_count = __atomic_load_n(&account->allocation_count, __ATOMIC_RELAXED);
+		accounts[i].mapped_bytes     = __atomic_load_n(&account->mapped_bytes, __ATOMIC_RELAXED);
+	}
+
+	return count;
+}
+
+
+uint16_t acc_os_thread_stacks_get(acc_os_thread_stack_t *stacks, uint16_t max_count)
+{
+	uint16_t result = 0;
+
+	if (init_done && acc_device_os_thread_stacks_get_func != NULL)
+	{
+		result = acc_device_os_thread_stacks_get_func(stacks, max_count);
+	}
+
+	return result;
+}
+
+
+void acc_os_memory_report(void)
+{
+	acc_os_memory_account_t accounts[ACC_OS_MEMORY_ACCOUNTS_MAX];
+	acc_os_thread_stack_t   stacks[16];
+	uint16_t                account_count = acc_os_memory_get_accounts(accounts, ACC_OS_MEMORY_ACCOUNTS_MAX);
+	uint16_t                stack_count   = acc_os_thread_stacks_get(stacks, sizeof(stacks) / sizeof(stacks[0]));
+	size_t                  heap_bytes    = 0;
+	size_t                  mapped_bytes  = 0;
+	size_t                  stack_bytes   = 0;
+	size_t                  stack_used    = 0;
+
+	fprintf(stderr, "Memory accounts:\n");
+	fprintf(stderr, "  %-39s %10s %10s %7s %10s\n", "account", "heap", "heap peak", "blocks", "mapped");
+
+	for (uint16_t i = 0; i < account_count; i++)
+	{
+		const acc_os_memory_account_t *account = &accounts[i];
+
+		if (account->heap_peak_bytes == 0 && account->mapped_bytes == 0)
+		{
+			continue;
+		}
+
+		fprintf(stderr, "  %-39s %10u %10u %7u %10u\n", account->name, (unsigned int)account->heap_bytes,
+		        (unsigned int)account->heap_peak_bytes, (unsigned int)account->allocation_count,
+		        (unsigned int)account->mapped_bytes);
+
+		heap_bytes   += account->heap_bytes;
+		mapped_bytes += account->mapped_bytes;
+	}
+
+	if (stack_count > 0)
+	{
+		fprintf(stderr, "Thread stacks:\n");
+		fprintf(stderr, "  %-39s %10s %10s\n", "thread", "size", "high water");
+	}
+
+	for (uint16_t i = 0; i < stack_count; i++)
+	{
+		const acc_os_thread_stack_t *stack = &stacks[i];
+
+		// Less than a quarter of the stack left is reported, the stack size should be raised
+		fprintf(stderr, "  %-39s %10u %10u%s%s\n", stack->name, (unsigned int)stack->stack_size,
+		        (unsigned int)stack->stack_high_water, stack->running ? "" : " (exited)",
+		        (stack->stack_high_water > stack->stack_size / 4 * 3) ? " (over 75%)" : "");
+
+		if (stack->running)
+		{
+			stack_bytes += stack->stack_size;
+			stack_used  += stack->stack_high_water;
+		}
+	}
+
+	fprintf(stderr, "Stack of the calling thread: %u bytes used\n", (unsigned int)acc_os_stack_get_usage(0));
+	fprintf(stderr, "Total: %u bytes heap in accounts, %u bytes mapped, %u bytes of thread stacks with %u used, "
+	        "%u bytes process heap\n", (unsigned int)heap_bytes, (unsigned int)mapped_bytes, (unsigned int)stack_bytes,
+	        (unsigned int)stack_used, (unsigned int)acc_os_heap_get_usage(0));
+}
+
+
+void acc_os_steady_state_arm(void)
+{
+	while (__atomic_test_and_set(&steady_state_lock, __ATOMIC_ACQUIRE))
+	{
+	}
+
+	steady_state_calls      = 0;
+	steady_state_site_count = 0;
+
+	__atomic_clear(&steady_state_lock, __ATOMIC_RELEASE);
+
+	__atomic_store_n(&steady_state_armed, true, __ATOMIC_RELEASE);
+}
+
+
+uint32_t acc_os_steady_state_disarm(void)
+{
+	__atomic_store_n(&steady_state_armed, false, __ATOMIC_RELEASE);
+
+	return __atomic_load_n(&steady_state_calls, __ATOMIC_ACQUIRE);
+}
+
+
+void acc_os_steady_state_report(void)
+{
+	uint32_t calls = __atomic_load_n(&steady_state_calls, __ATOMIC_ACQUIRE);
+
+	fprintf(stderr, "Steady state: %u allocator calls\n", (unsigned int)calls);
+
+	for (uint16_t i = 0; i < steady_state_site_count; i++)
+	{
+		const steady_state_site_t *site = &steady_state_sites[i];
+		const char                *kind = site->is_free ? "free" : "alloc";
+
+		if (site->file != NULL)
+		{
+			fprintf(stderr, "  %6u %-5s at %s:%u\n", (unsigned int)site->count, kind, site->file, (unsigned int)site->line);
+			continue;
+		}
+
+#if defined(TARGET_OS_linux)
+		Dl_info info;
+
+		if (dladdr(site->caller, &info) != 0 && info.dli_fname != NULL)
+		{
+			if (info.dli_sname != NULL)
+			{
+				fprintf(stderr, "  %6u %-5s from %s+0x%lx (%s)\n", (unsigned int)site->count, kind, info.dli_sname,
+				       (unsigned long)((const char *)site->caller - (const char *)info.dli_saddr), info.dli_fname);
+			}
+			else
+			{
+				fprintf(stderr, "  %6u %-5s from %s+0x%lx\n", (unsigned int)site->count, kind, info.dli_fname,
+				       (unsigned long)((const char *)site->caller - (const char *)info.dli_fbase));
+			}
+
+			continue;
+		}
+#endif
+
+		fprintf(stderr, "  %6u %-5s from %p\n", (unsigned int)site->count, kind, site->caller);
+	}
+
+	if (calls > 0 && steady_state_site_count == STEADY_STATE_SITES_MAX)
+	{
+		fprintf(stderr, "  (only the first %u call sites are listed)\n", (unsigned int)STEADY_STATE_SITES_MAX);
+	}
+}
+
+
+uint32_t acc_os_steady_state_check(void)
+{
+	uint32_t calls = acc_os_steady_state_disarm();
+
+	if (calls > 0)
+	{
+		acc_os_steady_state_report();
+	}
+
+	return calls;
+}
+
+
+void acc_os_steady_state_record(const char *file, uint16_t line, const void *caller, bool is_free)
+{
+	if (!__atomic_load_n(&steady_state_armed, __ATOMIC_ACQUIRE) || inside_allocator)
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&steady_state_calls, 1, __ATOMIC_RELAXED);
+
+	while (__atomic_test_and_set(&steady_state_lock, __ATOMIC_ACQUIRE))
+	{
+	}
+
+	uint16_t i;
+
+	for (i = 0; i < steady_state_site_count; i++)
+	{
+		steady_state_site_t *site = &steady_state_sites[i];
+
+		if (site->is_free == is_free && site->line == line && site->caller == caller &&
+		    (site->file == file || (site->file != NULL && file != NULL && strcmp(site->file, file) == 0)))
+		{
+			site->count++;
+			break;
+		}
+	}
+
+	if (i == steady_state_site_count && i < STEADY_STATE_SITES_MAX)
+	{
+		steady_state_site_t *site = &steady_state_sites[i];
+
+		site->file    = file;
+		site->line    = line;
+		site->is_free = is_free;
+		site->caller  = caller;
+		site->count   = 1;
+
+		steady_state_site_count++;
+	}
+
+	__atomic_clear(&steady_state_lock, __ATOMIC_RELEASE);
+}
+
+
 acc_app_integration_thread_id_t acc_os_get_thread_id(void)
 {
 	acc_app_integration_thread_id_t result = {0};
@@ -336,3 +727,102 @@ bool acc_os_multithread_support(void)
 
 	return result;
 }
+
+
+uint16_t memory_account_find(const char *name)
+{
+	uint16_t count = __atomic_load_n(&memory_account_count, __ATOMIC_ACQUIRE);
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		if (strncmp(memory_account_keys[i], name, MEMORY_ACCOUNT_KEY_LENGTH_MAX) == 0)
+		{
+			return i;
+		}
+	}
+
+	while (__atomic_test_and_set(&memory_account_lock, __ATOMIC_ACQUIRE))
+	{
+	}
+
+	// Another thread may have added it meanwhile
+	uint16_t i;
+
+	for (i = count; i < memory_account_count; i++)
+	{
+		if (strncmp(memory_account_keys[i], name, MEMORY_ACCOUNT_KEY_LENGTH_MAX) == 0)
+		{
+			break;
+		}
+	}
+
+	if (i == memory_account_count)
+	{
+		if (i < ACC_OS_MEMORY_ACCOUNTS_MAX)
+		{
+			strncpy(memory_account_keys[i], name, MEMORY_ACCOUNT_KEY_LENGTH_MAX);
+			strncpy(memory_accounts[i].name, name, ACC_OS_MEMORY_ACCOUNT_NAME_LENGTH_MAX);
+			__atomic_store_n(&memory_account_count, i + 1, __ATOMIC_RELEASE);
+		}
+		else
+		{
+			i = MEMORY_ACCOUNT_OTHER;
+		}
+	}
+
+	__atomic_clear(&memory_account_lock, __ATOMIC_RELEASE);
+
+	return i;
+}
+
+
+void *accounted_alloc(size_t size, uint16_t account)
+{
+	inside_allocator = true;
+	uint8_t *block = acc_device_os_mem_alloc_func(ALLOCATION_HEADER_SIZE + size);
+	inside_allocator = false;
+
+	if (block == NULL)
+	{
+		return NULL;
+	}
+
+	allocation_header_t     *header  = (allocation_header_t *)(void *)block;
+	acc_os_memory_account_t *counter = &memory_accounts[account];
+
+	header->size    = size;
+	header->account = account;
+
+	size_t heap_bytes = __atomic_add_fetch(&counter->heap_bytes, size, __ATOMIC_RELAXED);
+	size_t peak_bytes = __atomic_load_n(&counter->heap_peak_bytes, __ATOMIC_RELAXED);
+
+	while (heap_bytes > peak_bytes &&
+	       !__atomic_compare_exchange_n(&counter->heap_peak_bytes, &peak_bytes, heap_bytes, true, __ATOMIC_RELAXED,
+	                                    __ATOMIC_RELAXED))
+	{
+	}
+
+	__atomic_add_fetch(&counter->allocation_count, 1, __ATOMIC_RELAXED);
+
+	return block + ALLOCATION_HEADER_SIZE;
+}
+
+
+void accounted_free(void *ptr)
+{
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	uint8_t                 *block   = (uint8_t *)ptr - ALLOCATION_HEADER_SIZE;
+	allocation_header_t     *header  = (allocation_header_t *)(void *)block;
+	acc_os_memory_account_t *counter = &memory_accounts[header->account];
+
+	__atomic_sub_fetch(&counter->heap_bytes, header->size, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&counter->allocation_count, 1, __ATOMIC_RELAXED);
+
+	inside_allocator = true;
+	acc_device_os_mem_free_func(block);
+	inside_allocator = false;
+}
@@ -23,6 +23,7 @@ void                (*acc_device_spi_destroy_func)(acc_device_handle_t *handle)
 bool                (*acc_device_spi_transfer_func)(acc_device_handle_t handle, uint8_t *buffer, size_t buffer_size) = NULL;
 bool		(*acc_device_spi_transfer_async_func)(acc_device_handle_t handle, uint8_t *buffer, bool rx, bool tx, size_t buffer_size, acc_device_spi_transfer_callback_t callback) = NULL;
 uint8_t	            (*acc_device_spi_get_bus_func)(acc_device_handle_t) = NULL;
+bool                (*acc_device_spi_set_speed_func)(acc_device_handle_t handle, uint32_t speed) = NULL;
 
 
 /**
@@ -68,6 +69,16 @@ uint_fast8_t acc_device_spi_get_bus(acc_device_handle_t handle)
 }
 
 
+bool acc_device_spi_set_speed(acc_device_handle_t handle, uint32_t speed)
+{
+	if (acc_device_spi_set_speed_func != NULL) {
+		return acc_device_spi_set_speed_func(handle, speed);
+	}
+
+	return false;
+}
+
+
 bool acc_device_spi_lock(uint_fast8_t bus)
 {
 	if (bus >= ACC_DEVICE_SPI_BUS_MAX) {
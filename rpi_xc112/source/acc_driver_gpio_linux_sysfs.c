@@ -15,6 +15,7 @@
 #include "acc_device_os.h"
 #include "acc_driver_gpio_linux_sysfs.h"
 #include "acc_log.h"
+#include "acc_trace.h"
 
 
 /**
@@ -435,6 +436,8 @@ static void wait_for_interrupts(void *param)
 				return;
 			}
 
+			ACC_TRACE1(gpio_interrupt, gpio->pin);
+
 			// Call the callback.
 			if (is_isr_registered(gpio))
 			{
@@ -8,9 +8,11 @@
 
 #include "acc_board.h"
 #include "acc_definitions.h"
+#include "acc_device_os.h"
 #include "acc_device_spi.h"
 #include "acc_driver_os.h"
 #include "acc_hal_definitions.h"
+#include "acc_log.h"
 #include "acc_log_integration.h"
 
 
@@ -34,6 +36,9 @@ bool acc_driver_hal_init(void)
 		return false;
 	}
 
+	// Create the log lock now rather than at the first message, which may come in steady state
+	acc_log_init();
+
 	return true;
 }
 
@@ -54,8 +59,8 @@ acc_hal_t acc_driver_hal_get_implementation(void)
 		.sensor_device.hibernate_enter = acc_board_hibernate_enter_func,
 		.sensor_device.hibernate_exit = acc_board_hibernate_exit_func,
 
-		.os.mem_alloc = acc_device_os_mem_alloc_func,
-		.os.mem_free = acc_device_os_mem_free_func,
+		.os.mem_alloc = acc_os_hal_mem_alloc,
+		.os.mem_free = acc_os_hal_mem_free,
 		.os.gettime = acc_device_os_get_time_func,
 
 		.log.log_level = ACC_LOG_LEVEL_INFO,
@@ -14,6 +14,7 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <malloc.h>
 #include <netdb.h>
 #include <pthread.h>
 #include <semaphore.h>
@@ -24,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <time.h>
@@ -39,10 +41,29 @@
 #include "acc_driver_os.h"
 #include "acc_driver_os_linux.h"
 #include "acc_log.h"
+#include "acc_trace.h"
 
 
 #define MODULE "os"
 
+
+/**
+ * @brief Stack size of the threads created by acc_os_thread_create, unless set with acc_driver_os_linux_set_thread_stack_size
+ *
+ * Instead of the 8 MB of the pthread default. The high water marks in acc_os_memory_report
+ * show how much of it is used.
+ */
+#ifndef ACC_DRIVER_OS_LINUX_THREAD_STACK_SIZE
+#define ACC_DRIVER_OS_LINUX_THREAD_STACK_SIZE (128 * 1024)
+#endif
+
+
+/**
+ * @brief Maximum number of threads whose stacks are tracked
+ */
+#define THREAD_STACKS_MAX 16
+
+
 typedef struct acc_app_integration_mutex
 {
 	uint_fast8_t    is_initialized;
@@ -65,13 +86,29 @@ typedef struct acc_app_integration_thread_handle
 {
 	pthread_t handle;
 	thread_t  info;
+	uint8_t   *map;
+	size_t    map_size;
+	uint16_t  stack_index;
 } acc_app_integration_thread_handle_s;
 
 
 /**
- * @brief Flag set if stack has been prepared for usage measurement
+ * @brief Stack of a created thread, the lowest page of the map is a guard page
  */
-static uint_fast8_t acc_os_stack_setup_done = 0;
+typedef struct
+{
+	acc_os_thread_stack_t stack;
+	const uint8_t         *base;
+	bool                  in_use;
+} thread_stack_t;
+
+
+static size_t          thread_stack_size = ACC_DRIVER_OS_LINUX_THREAD_STACK_SIZE;
+static pthread_mutex_t thread_stacks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static thread_stack_t  thread_stacks[THREAD_STACKS_MAX];
+
+
+static size_t get_stack_high_water(const uint8_t *base, size_t size);
 
 
 /**
@@ -109,6 +146,8 @@ static void acc_driver_os_init(void)
 		fprintf(stderr, "Failed to setup signal handler for SIGINT, %s\n", strerror(errno));
 	}
 
+	acc_trace_init();
+
 	init_done = true;
 }
 
@@ -116,53 +155,76 @@ static void acc_driver_os_init(void)
 /**
  * @brief Prepare stack for measuring stack usage - to be called as early as possible
  *
+ * Nothing needs to be prepared, the usage is measured from the pages of the stack that the
+ * kernel has made resident. Filling the stack, as on targets without virtual memory, would
+ * make all of it resident.
+ *
  * @param stack_size Amount of stack in bytes that is allocated
  */
 static void acc_driver_os_stack_setup(size_t stack_size)
 {
-	if (!stack_size)
-	{
-		return;
-	}
-
-	uint8_t stack_filler[stack_size];
-	memset(stack_filler, 0x5a, sizeof(stack_filler));
-
-	/* Prevent compiler from optimizing away stack_filler[] */
-	__asm__ __volatile__ ("" : : "m" (stack_filler));
-
-	acc_os_stack_setup_done = 1;
+	(void)stack_size;
 }
 
 
 /**
  * @brief Measure amount of used stack in bytes
  *
- * @param stack_size Amount of stack in bytes that is allocated
+ * The high water mark of the calling thread, with a resolution of one page. A stack is only
+ * made resident as it grows, so the lowest resident page is the deepest the stack has been.
+ *
+ * @param stack_size Amount of stack in bytes that is allocated, or 0 for the whole stack of the thread
  * @return Number of bytes of used stack space
  */
 static size_t acc_driver_os_stack_get_usage(size_t stack_size)
 {
-	if (!stack_size || !acc_os_stack_setup_done)
+	pthread_attr_t attr;
+	void           *stack_address;
+	size_t         size;
+
+	if (pthread_getattr_np(pthread_self(), &attr) != 0)
 	{
 		return 0;
 	}
 
-	uint8_t stack_filler[stack_size];
-	size_t  usage = 0;
+	int result = pthread_attr_getstack(&attr, &stack_address, &size);
 
-	/* This does not give an exact figure but is useful as an indication of the used size.
-	   The reason for counting backwards to allow future improvement handling any misalignment
-	   garbage at the end. */
-	for (size_t index = stack_size - 1; index; index--)
+	pthread_attr_destroy(&attr);
+
+	if (result != 0)
 	{
-		if (stack_filler[index] != 0x5a)
-		{
-			usage += 1;
-		}
+		return 0;
 	}
 
-	return usage;
+	const uint8_t *base = stack_address;
+
+	if (stack_size != 0 && stack_size < size)
+	{
+		base += size - stack_size;
+		size  = stack_size;
+	}
+
+	return get_stack_high_water(base, size);
+}
+
+
+/**
+ * @brief Measure amount of used heap in bytes
+ *
+ * @param heap_size Total amount of heap bytes, not used
+ * @return Number of bytes allocated from the libc heap by the process
+ */
+static size_t acc_driver_os_heap_get_usage(size_t heap_size)
+{
+	(void)heap_size;
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 info = mallinfo2();
+#else
+	struct mallinfo info = mallinfo();
+#endif
+
+	return (size_t)info.uordblks + (size_t)info.hblkhd;
 }
 
 
@@ -305,15 +367,88 @@ static acc_app_integration_thread_handle_t acc_driver_os_thread_create(void (*fu
 
 	if (thread != NULL)
 	{
-		thread->info = (thread_t){func, param};
+		thread->info        = (thread_t){func, param};
+		thread->stack_index = THREAD_STACKS_MAX;
+
+		// The stack is mapped here, with a guard page below it, so its size and usage are known
+		size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+		size_t size      = (thread_stack_size + page_size - 1) / page_size * page_size;
+
+		if (size < (size_t)PTHREAD_STACK_MIN)
+		{
+			size = (size_t)PTHREAD_STACK_MIN;
+		}
+
+		thread->map_size = size + page_size;
+		thread->map      = mmap(NULL, thread->map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+
+		pthread_attr_t attr;
+
+		ret = pthread_attr_init(&attr);
+
+		if (thread->map == MAP_FAILED)
+		{
+			thread->map = NULL;
+			ACC_LOG_WARNING("%s: Could not map thread stack, %s", __func__, strerror(errno));
+		}
+		else if (ret == 0)
+		{
+			mprotect(thread->map, page_size, PROT_NONE);
+			ret = pthread_attr_setstack(&attr, thread->map + page_size, size);
+		}
+
+		if (ret == 0)
+		{
+			ret = pthread_create(&thread->handle, &attr, thread_start, &thread->info);
+		}
+
+		pthread_attr_destroy(&attr);
 
-		ret = pthread_create(&thread->handle, NULL, thread_start, &thread->info);
 		if (ret != 0)
 		{
 			ACC_LOG_ERROR("%s: Error %d, %s", __func__, ret, strerror(ret));
+
+			if (thread->map != NULL)
+			{
+				munmap(thread->map, thread->map_size);
+				thread->map = NULL;
+			}
+
 			return thread;
 		}
 
+		if (thread->map != NULL)
+		{
+			pthread_mutex_lock(&thread_stacks_mutex);
+
+			// A free entry, or else the entry of a thread that has exited
+			for (uint16_t pass = 0; pass < 2 && thread->stack_index == THREAD_STACKS_MAX; pass++)
+			{
+				for (uint16_t i = 0; i < THREAD_STACKS_MAX; i++)
+				{
+					if (!thread_stacks[i].in_use && (pass == 1 || thread_stacks[i].stack.stack_size == 0))
+					{
+						thread->stack_index = i;
+						break;
+					}
+				}
+			}
+
+			if (thread->stack_index < THREAD_STACKS_MAX)
+			{
+				thread_stack_t *stack = &thread_stacks[thread->stack_index];
+
+				memset(stack, 0, sizeof(*stack));
+				strncpy(stack->stack.name, (name != NULL) ? name : "", ACC_OS_THREAD_NAME_LENGTH_MAX);
+				stack->stack.stack_size = size;
+				stack->stack.running    = true;
+				stack->base             = thread->map + page_size;
+				stack->in_use           = true;
+			}
+
+			pthread_mutex_unlock(&thread_stacks_mutex);
+		}
+
 		if (name != NULL)
 		{
 			ret = pthread_setname_np(thread->handle, name);
@@ -341,7 +476,7 @@ static void acc_driver_os_thread_exit(void)
 
 	if (stack_usage > 0)
 	{
-		ACC_LOG_INFO("Stack usage %u bytes", (unsigned int)stack_usage);
+		ACC_LOG_VERBOSE("Stack usage %u bytes", (unsigned int)stack_usage);
 	}
 
 	pthread_exit(NULL);
@@ -367,11 +502,57 @@ static void acc_driver_os_thread_cleanup(acc_app_integration_thread_handle_t thr
 	}
 	else
 	{
+		if (thread->stack_index < THREAD_STACKS_MAX)
+		{
+			thread_stack_t *stack = &thread_stacks[thread->stack_index];
+
+			pthread_mutex_lock(&thread_stacks_mutex);
+			stack->stack.stack_high_water = get_stack_high_water(stack->base, stack->stack.stack_size);
+			stack->stack.running          = false;
+			stack->base                   = NULL;
+			stack->in_use                 = false;
+			pthread_mutex_unlock(&thread_stacks_mutex);
+		}
+
+		if (thread->map != NULL)
+		{
+			munmap(thread->map, thread->map_size);
+		}
+
 		acc_os_mem_free(thread);
 	}
 }
 
 
+static uint16_t acc_driver_os_thread_stacks_get(acc_os_thread_stack_t *stacks, uint16_t max_count)
+{
+	uint16_t count = 0;
+
+	pthread_mutex_lock(&thread_stacks_mutex);
+
+	for (uint16_t i = 0; i < THREAD_STACKS_MAX && count < max_count; i++)
+	{
+		thread_stack_t *stack = &thread_stacks[i];
+
+		if (stack->stack.stack_size == 0)
+		{
+			continue;
+		}
+
+		if (stack->in_use)
+		{
+			stack->stack.stack_high_water = get_stack_high_water(stack->base, stack->stack.stack_size);
+		}
+
+		stacks[count++] = stack->stack;
+	}
+
+	pthread_mutex_unlock(&thread_stacks_mutex);
+
+	return count;
+}
+
+
 static acc_app_integration_semaphore_t acc_driver_os_semaphore_create(void)
 {
 	acc_app_integration_semaphore_t sem = NULL;
@@ -425,11 +606,15 @@ static bool acc_driver_os_semaphore_wait(acc_app_integration_semaphore_t sem, ui
 
 	int s;
 
+	ACC_TRACE2(semaphore_wait_begin, (uintptr_t)sem, timeout_ms);
+
 	while ((s = sem_timedwait(&(sem->handle), &ts)) == -1 && errno == EINTR)
 	{
 		continue; /* Restart if interrupted by handler */
 	}
 
+	ACC_TRACE2(semaphore_wait_end, (uintptr_t)sem, s == 0);
+
 	if (s != 0)
 	{
 		if (errno == ETIMEDOUT)
@@ -456,6 +641,7 @@ static void acc_driver_os_semaphore_signal(acc_app_integration_semaphore_t sem)
 {
 	if (sem != NULL && sem->is_initialized)
 	{
+		ACC_TRACE1(semaphore_signal, (uintptr_t)sem);
 		sem_post(&sem->handle);
 	}
 }
@@ -478,11 +664,75 @@ static void acc_driver_os_semaphore_destroy(acc_app_integration_semaphore_t sem)
 }
 
 
+void acc_driver_os_linux_set_thread_stack_size(size_t stack_size)
+{
+	thread_stack_size = stack_size;
+}
+
+
+/**
+ * @brief Get the high water mark of a stack growing down from base + size
+ *
+ * @param base The lowest address of the stack, aligned to a page
+ * @param size The size of the stack
+ * @return Number of bytes from the lowest resident page to the top of the stack
+ */
+static size_t get_stack_high_water(const uint8_t *base, size_t size)
+{
+	size_t        page_size = (size_t)sysconf(_SC_PAGESIZE);
+	uintptr_t     start     = (uintptr_t)base / page_size * page_size;
+	size_t        length    = (uintptr_t)base + size - start;
+	size_t        pages     = (length + page_size - 1) / page_size;
+	unsigned char residency[256];
+
+	// In chunks, a small vector is enough for the default thread stacks
+	for (size_t page = 0; page < pages; page += sizeof(residency))
+	{
+		size_t count = pages - page;
+
+		if (count > sizeof(residency))
+		{
+			count = sizeof(residency);
+		}
+
+		if (mincore((void *)(start + page * page_size), count * page_size, residency) != 0)
+		{
+			if (errno != ENOMEM)
+			{
+				return 0;
+			}
+
+			// The main thread stack is only mapped as far as it has grown, unmapped pages are unused
+			for (size_t i = 0; i < count; i++)
+			{
+				if (mincore((void *)(start + (page + i) * page_size), page_size, &residency[i]) != 0)
+				{
+					residency[i] = 0;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (residency[i] & 1)
+			{
+				uintptr_t lowest = start + (page + i) * page_size;
+
+				return (uintptr_t)base + size - ((lowest > (uintptr_t)base) ? lowest : (uintptr_t)base);
+			}
+		}
+	}
+
+	return 0;
+}
+
+
 void acc_driver_os_linux_register(void)
 {
 	acc_device_os_init_func                            = acc_driver_os_init;
 	acc_device_os_stack_setup_func                     = acc_driver_os_stack_setup;
 	acc_device_os_stack_get_usage_func                 = acc_driver_os_stack_get_usage;
+	acc_device_os_heap_get_usage_func                  = acc_driver_os_heap_get_usage;
 	acc_device_os_sleep_us_func                        = acc_driver_os_sleep_us;
 	acc_device_os_sleep_ms_func                        = acc_driver_os_sleep_ms;
 	acc_device_os_mem_alloc_func                       = malloc;
@@ -496,6 +746,7 @@ void acc_driver_os_linux_register(void)
 	acc_device_os_thread_create_func                   = acc_driver_os_thread_create;
 	acc_device_os_thread_exit_func                     = acc_driver_os_thread_exit;
 	acc_device_os_thread_cleanup_func                  = acc_driver_os_thread_cleanup;
+	acc_device_os_thread_stacks_get_func               = acc_driver_os_thread_stacks_get;
 	acc_device_os_semaphore_create_func                = acc_driver_os_semaphore_create;
 	acc_device_os_semaphore_wait_func                  = acc_driver_os_semaphore_wait;
 	acc_device_os_semaphore_signal_func                = acc_driver_os_semaphore_signal;
@@ -17,6 +17,7 @@
 #include "acc_driver_spi_linux_spidev.h"
 #include "acc_device_spi.h"
 #include "acc_log.h"
+#include "acc_trace.h"
 
 /**
  * @brief The module name
@@ -185,7 +186,12 @@ static bool acc_driver_spi_linux_spidev_transfer(
 		.pad		= 0,
 	};
 
+	ACC_TRACE2(spi_transfer_begin, handle->bus, buffer_size);
+
 	int ret_val = ioctl(spidev_fd[handle->bus][handle->device], _IOW('k', 0, char[ACC_SPI_TRANSFER_SIZE(1)]), &spi_transfer);
+
+	ACC_TRACE2(spi_transfer_end, handle->bus, ret_val);
+
 	if (ret_val < 0) {
 		ACC_LOG_ERROR("SPI transfer failure: %s", strerror(errno));
 		return false;
@@ -209,6 +215,30 @@ static uint8_t acc_driver_spi_linux_spidev_get_bus(acc_device_handle_t dev_handl
 }
 
 
+/**
+ * @brief Change the clock speed of the handle
+ *
+ * The speed is set per transfer, the kernel driver rounds it down to a divider of the
+ * controller clock.
+ *
+ * @param dev_handle SPI device handle
+ * @param speed The clock speed in Hz
+ * @return True if successful, false otherwise
+ */
+static bool acc_driver_spi_linux_spidev_set_speed(acc_device_handle_t dev_handle, uint32_t speed)
+{
+	acc_driver_spi_linux_spidev_handle_t *handle = dev_handle;
+
+	if (speed == 0) {
+		return false;
+	}
+
+	handle->speed = speed;
+
+	return true;
+}
+
+
 /**
  * @brief Request driver to register with appropriate device(s)
  */
@@ -219,4 +249,5 @@ void acc_driver_spi_linux_spidev_register(void)
 	acc_device_spi_get_max_transfer_size_func	= acc_driver_spi_linux_spidev_get_max_transfer_size;
 	acc_device_spi_transfer_func			= acc_driver_spi_linux_spidev_transfer;
 	acc_device_spi_get_bus_func			= acc_driver_spi_linux_spidev_get_bus;
+	acc_device_spi_set_speed_func			= acc_driver_spi_linux_spidev_set_speed;
 }
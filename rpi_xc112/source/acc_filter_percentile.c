@@ -0,0 +1,328 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acc_filter_percentile.h"
+
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "filter_percentile"
+
+#define MAGIC_NUMBER (0xACC0F117)
+
+
+/**
+ * @brief Window state of one point
+ *
+ * The heap is stored as heap[0..lower_count-1], a max-heap of the lowest values with the
+ * percentile value at the top, followed by a min-heap of the remaining values. Heap entries
+ * are window slots, slot_heap is the inverse mapping from slot to heap position.
+ */
+typedef struct
+{
+	uint16_t *value;
+	uint16_t *slot_heap;
+	uint16_t *heap;
+} window_t;
+
+
+typedef struct acc_filter_percentile_handle
+{
+	uint32_t magic_number;
+	uint16_t data_length;
+	uint16_t window_length;
+	uint16_t lower_count;
+	uint16_t slot;
+	bool     filled;
+	uint16_t *state;
+} acc_filter_percentile_handle_internal_t;
+
+
+static bool handle_valid(acc_filter_percentile_handle_t handle);
+static uint16_t replace(window_t *window, uint16_t slot, uint16_t value, uint16_t lower_count, uint16_t upper_count);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+acc_filter_percentile_handle_t acc_filter_percentile_create(uint16_t data_length, uint16_t window_length,
+                                                            uint8_t percentile)
+{
+	if (data_length == 0 || window_length == 0 || window_length > ACC_FILTER_PERCENTILE_WINDOW_LENGTH_MAX ||
+	    percentile > 100)
+	{
+		ACC_LOG_ERROR("Invalid percentile filter parameters");
+		return NULL;
+	}
+
+	size_t                                  state_size = sizeof(uint16_t) * 3 * window_length * data_length;
+	acc_filter_percentile_handle_internal_t *handle    = acc_os_mem_alloc(sizeof(*handle) + state_size);
+
+	if (handle == NULL)
+	{
+		ACC_LOG_ERROR("Percentile filter not possible to allocate");
+		return NULL;
+	}
+
+	handle->magic_number  = MAGIC_NUMBER;
+	handle->data_length   = data_length;
+	handle->window_length = window_length;
+	handle->lower_count   = (uint16_t)(((uint32_t)percentile * (window_length - 1) + 50) / 100) + 1;
+	handle->slot          = 0;
+	handle->filled        = false;
+	handle->state         = (uint16_t *)(handle + 1);
+
+	return handle;
+}
+
+
+void acc_filter_percentile_destroy(acc_filter_percentile_handle_t *handle)
+{
+	if (handle != NULL && *handle != NULL)
+	{
+		if (handle_valid(*handle))
+		{
+			(*handle)->magic_number = 0;
+			acc_os_mem_free(*handle);
+			*handle = NULL;
+		}
+	}
+}
+
+
+void acc_filter_percentile_reset(acc_filter_percentile_handle_t handle)
+{
+	if (handle_valid(handle))
+	{
+		handle->slot   = 0;
+		handle->filled = false;
+	}
+}
+
+
+bool acc_filter_percentile_process(acc_filter_percentile_handle_t handle, const uint16_t *input, uint16_t *output)
+{
+	if (!handle_valid(handle) || input == NULL || output == NULL)
+	{
+		return false;
+	}
+
+	const uint16_t window_length = handle->window_length;
+	const uint16_t lower_count   = handle->lower_count;
+	const uint16_t upper_count   = window_length - lower_count;
+	const uint16_t slot          = handle->slot;
+	uint16_t       *state        = handle->state;
+	window_t       window;
+
+	if (!handle->filled)
+	{
+		// All values equal, any order is a valid pair of heaps
+		for (uint16_t point = 0; point < handle->data_length; point++)
+		{
+			window.value     = state;
+			window.slot_heap = state + window_length;
+			window.heap      = state + 2 * window_length;
+
+			for (uint16_t i = 0; i < window_length; i++)
+			{
+				window.value[i]     = input[point];
+				window.slot_heap[i] = i;
+				window.heap[i]      = i;
+			}
+
+			output[point]  = input[point];
+			state         += 3 * window_length;
+		}
+
+		handle->filled = true;
+		return true;
+	}
+
+	for (uint16_t point = 0; point < handle->data_length; point++)
+	{
+		window.value     = state;
+		window.slot_heap = state + window_length;
+		window.heap      = state + 2 * window_length;
+
+		output[point]  = replace(&window, slot, input[point], lower_count, upper_count);
+		state         += 3 * window_length;
+	}
+
+	handle->slot = (slot + 1 < window_length) ? slot + 1 : 0;
+
+	return true;
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+static inline uint16_t heap_value(const window_t *window, uint16_t position)
+{
+	return window->value[window->heap[position]];
+}
+
+
+static inline void swap_nodes(window_t *window, uint16_t a, uint16_t b)
+{
+	uint16_t slot_a = window->heap[a];
+	uint16_t slot_b = window->heap[b];
+
+	window->heap[a]           = slot_b;
+	window->heap[b]           = slot_a;
+	window->slot_heap[slot_b] = a;
+	window->slot_heap[slot_a] = b;
+}
+
+
+static void lower_sift_up(window_t *window, uint16_t position)
+{
+	while (position > 0)
+	{
+		uint16_t parent = (position - 1) / 2;
+
+		if (heap_value(window, position) <= heap_value(window, parent))
+		{
+			break;
+		}
+
+		swap_nodes(window, position, parent);
+		position = parent;
+	}
+}
+
+
+static void lower_sift_down(window_t *window, uint16_t position, uint16_t count)
+{
+	for (;;)
+	{
+		uint16_t largest = position;
+		uint32_t child   = 2 * (uint32_t)position + 1;
+
+		if (child < count && heap_value(window, child) > heap_value(window, largest))
+		{
+			largest = child;
+		}
+
+		if (child + 1 < count && heap_value(window, child + 1) > heap_value(window, largest))
+		{
+			largest = child + 1;
+		}
+
+		if (largest == position)
+		{
+			break;
+		}
+
+		swap_nodes(window, position, largest);
+		position = largest;
+	}
+}
+
+
+static void upper_sift_up(window_t *window, uint16_t position, uint16_t base)
+{
+	while (position > 0)
+	{
+		uint16_t parent = (position - 1) / 2;
+
+		if (heap_value(window, base + position) >= heap_value(window, base + parent))
+		{
+			break;
+		}
+
+		swap_nodes(window, base + position, base + parent);
+		position = parent;
+	}
+}
+
+
+static void upper_sift_down(window_t *window, uint16_t position, uint16_t base, uint16_t count)
+{
+	for (;;)
+	{
+		uint16_t smallest = position;
+		uint32_t child    = 2 * (uint32_t)position + 1;
+
+		if (child < count && heap_value(window, base + child) < heap_value(window, base + smallest))
+		{
+			smallest = child;
+		}
+
+		if (child + 1 < count && heap_value(window, base + child + 1) < heap_value(window, base + smallest))
+		{
+			smallest = child + 1;
+		}
+
+		if (smallest == position)
+		{
+			break;
+		}
+
+		swap_nodes(window, base + position, base + smallest);
+		position = smallest;
+	}
+}
+
+
+/**
+ * @brief Replace the value in a window slot and return the percentile value
+ */
+uint16_t replace(window_t *window, uint16_t slot, uint16_t value, uint16_t lower_count, uint16_t upper_count)
+{
+	uint16_t old_value = window->value[slot];
+	uint16_t position  = window->slot_heap[slot];
+
+	window->value[slot] = value;
+
+	if (position < lower_count)
+	{
+		if (value > old_value)
+		{
+			lower_sift_up(window, position);
+		}
+		else
+		{
+			lower_sift_down(window, position, lower_count);
+		}
+	}
+	else
+	{
+		if (value < old_value)
+		{
+			upper_sift_up(window, position - lower_count, lower_count);
+		}
+		else
+		{
+			upper_sift_down(window, position - lower_count, lower_count, upper_count);
+		}
+	}
+
+	// A single exchange of the tops restores max(lower) <= min(upper)
+	if (upper_count > 0 && heap_value(window, 0) > heap_value(window, lower_count))
+	{
+		swap_nodes(window, 0, lower_count);
+		lower_sift_down(window, 0, lower_count);
+		upper_sift_down(window, 0, lower_count, upper_count);
+	}
+
+	return heap_value(window, 0);
+}
+
+
+bool handle_valid(acc_filter_percentile_handle_t handle)
+{
+	bool valid = true;
+
+	if ((handle == NULL) || (handle->magic_number != MAGIC_NUMBER))
+	{
+		ACC_LOG_ERROR("Invalid percentile filter handle");
+		valid = false;
+	}
+
+	return valid;
+}
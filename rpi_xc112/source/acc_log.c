@@ -24,10 +24,7 @@ static acc_app_integration_mutex_t  mutex           = NULL;
 static acc_log_level_t log_level_limit = ACC_LOG_LEVEL_INFO;
 
 
-/**
- * @brief Perform any init of log module
- */
-static void acc_log_init(void)
+void acc_log_init(void)
 {
 	static bool init_done = false;
 
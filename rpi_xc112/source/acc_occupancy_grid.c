@@ -0,0 +1,615 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_occupancy_grid.h"
+
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "occupancy_grid"
+
+#define MAGIC_NUMBER (0xACC0060D)
+
+#define TILE_SHIFT 4
+#define TILE_SIZE  (1 << TILE_SHIFT)
+#define TILE_MASK  (TILE_SIZE - 1)
+#define TILE_CELLS (TILE_SIZE * TILE_SIZE)
+
+#define CELL_COORDINATE_LIMIT 1.0e8f
+
+/**
+ * @brief Unit vectors and velocity ratios are Q15
+ */
+#define Q15_SHIFT 15
+#define Q15_ONE   (1 << Q15_SHIFT)
+
+/**
+ * @brief Positions and distances in the update are in cells with 8 fraction bits
+ *
+ * Positions are limited so that a position plus a distance does not overflow.
+ */
+#define POSITION_SHIFT       8
+#define POSITION_ONE         (1 << POSITION_SHIFT)
+#define POSITION_LIMIT_CELLS 4.0e6f
+
+#define PI 3.14159265358979f
+
+
+typedef struct acc_occupancy_grid_handle
+{
+	uint32_t magic_number;
+	float    cell_size_m;
+	float    cells_per_m;
+	uint16_t tiles_x;
+	uint16_t tiles_y;
+	int32_t  origin_tile_x;
+	int32_t  origin_tile_y;
+	int8_t   hit_log_odds;
+	int8_t   miss_log_odds;
+	int8_t   min_log_odds;
+	int8_t   max_log_odds;
+	bool     right_side;
+	int8_t   *tiles;
+} acc_occupancy_grid_handle_internal_t;
+
+
+/**
+ * @brief Position of a cell during ray traversal
+ */
+typedef struct
+{
+	int32_t tile_x;
+	int32_t tile_y;
+	int8_t  *tile;
+	uint8_t cell_x;
+	uint8_t cell_y;
+} cursor_t;
+
+
+static bool handle_valid(acc_occupancy_grid_handle_t handle);
+
+
+static int32_t floor_div(int32_t value, int32_t divisor);
+
+
+static int32_t cell_coordinate(acc_occupancy_grid_handle_t handle, float position_m);
+
+
+static int32_t to_fixed(float value, float limit);
+
+
+static uint32_t square_root(uint32_t value);
+
+
+static int8_t *tile_get(acc_occupancy_grid_handle_t handle, int32_t tile_x, int32_t tile_y);
+
+
+static bool cursor_set(acc_occupancy_grid_handle_t handle, cursor_t *cursor, int32_t cell_x, int32_t cell_y);
+
+
+static bool cursor_step_x(acc_occupancy_grid_handle_t handle, cursor_t *cursor, int32_t step);
+
+
+static bool cursor_step_y(acc_occupancy_grid_handle_t handle, cursor_t *cursor, int32_t step);
+
+
+static void cell_add(acc_occupancy_grid_handle_t handle, const cursor_t *cursor, int8_t log_odds);
+
+
+static void trace_free(acc_occupancy_grid_handle_t handle, int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+void acc_occupancy_grid_configuration_default(acc_occupancy_grid_configuration_t *configuration)
+{
+	configuration->cell_size_m   = 0.05f;
+	configuration->width_cells   = 256;
+	configuration->height_cells  = 256;
+	configuration->hit_log_odds  = 12;
+	configuration->miss_log_odds = -4;
+	configuration->min_log_odds  = -100;
+	configuration->max_log_odds  = 100;
+	configuration->right_side    = false;
+}
+
+
+acc_occupancy_grid_handle_t acc_occupancy_grid_create(const acc_occupancy_grid_configuration_t *configuration)
+{
+	if (configuration == NULL || !(configuration->cell_size_m > 0.0f) || configuration->width_cells == 0 ||
+	    configuration->height_cells == 0 || configuration->hit_log_odds <= 0 || configuration->miss_log_odds >= 0 ||
+	    configuration->min_log_odds >= 0 || configuration->max_log_odds <= 0)
+	{
+		ACC_LOG_ERROR("Invalid occupancy grid configuration");
+		return NULL;
+	}
+
+	uint16_t tiles_x = (configuration->width_cells + TILE_MASK) / TILE_SIZE;
+	uint16_t tiles_y = (configuration->height_cells + TILE_MASK) / TILE_SIZE;
+
+	acc_occupancy_grid_handle_internal_t *handle =
+		acc_os_mem_alloc(sizeof(*handle) + (size_t)tiles_x * tiles_y * TILE_CELLS);
+
+	if (handle == NULL)
+	{
+		ACC_LOG_ERROR("Occupancy grid not possible to allocate");
+		return NULL;
+	}
+
+	memset(handle, 0, sizeof(*handle) + (size_t)tiles_x * tiles_y * TILE_CELLS);
+
+	handle->magic_number  = MAGIC_NUMBER;
+	handle->cell_size_m   = configuration->cell_size_m;
+	handle->cells_per_m   = 1.0f / configuration->cell_size_m;
+	handle->tiles_x       = tiles_x;
+	handle->tiles_y       = tiles_y;
+	handle->origin_tile_x = -(tiles_x / 2);
+	handle->origin_tile_y = -(tiles_y / 2);
+	handle->hit_log_odds  = configuration->hit_log_odds;
+	handle->miss_log_odds = configuration->miss_log_odds;
+	handle->min_log_odds  = configuration->min_log_odds;
+	handle->max_log_odds  = configuration->max_log_odds;
+	handle->right_side    = configuration->right_side;
+	handle->tiles         = (int8_t *)(handle + 1);
+
+	return handle;
+}
+
+
+void acc_occupancy_grid_destroy(acc_occupancy_grid_handle_t *handle)
+{
+	if (handle != NULL && *handle != NULL)
+	{
+		if (handle_valid(*handle))
+		{
+			(*handle)->magic_number = 0;
+			acc_os_mem_free(*handle);
+			*handle = NULL;
+		}
+	}
+}
+
+
+bool acc_occupancy_grid_angles_get(acc_occupancy_grid_handle_t handle, float speed, const acc_obstacle_t *obstacles,
+                                   uint16_t count, float *degrees)
+{
+	if (!handle_valid(handle) || (obstacles == NULL && count > 0) || (degrees == NULL && count > 0))
+	{
+		return false;
+	}
+
+	if (speed == 0.0f)
+	{
+		return false;
+	}
+
+	const float scale = 1.0f / speed;
+
+	// A stationary obstacle at an angle from the direction of travel closes in at speed * cos(angle)
+	for (uint16_t i = 0; i < count; i++)
+	{
+		float ratio = obstacles[i].radial_velocity * scale;
+
+		if (ratio > 1.0f)
+		{
+			ratio = 1.0f;
+		}
+		else if (!(ratio > -1.0f))
+		{
+			ratio = -1.0f;
+		}
+
+		degrees[i] = acosf(ratio) * (180.0f / PI);
+	}
+
+	return true;
+}
+
+
+bool acc_occupancy_grid_update(acc_occupancy_grid_handle_t handle, const acc_occupancy_grid_pose_t *pose, float speed,
+                               const acc_detector_obstacle_t *obstacle_data)
+{
+	int32_t end_x[UINT8_MAX];
+	int32_t end_y[UINT8_MAX];
+
+	if (!handle_valid(handle) || pose == NULL || obstacle_data == NULL)
+	{
+		return false;
+	}
+
+	uint8_t count = obstacle_data->nbr_of_obstacles;
+
+	if (count == 0 || speed == 0.0f)
+	{
+		return true;
+	}
+
+	// The pose and speed are brought to fixed point once per update
+	const float          position_per_m = handle->cells_per_m * POSITION_ONE;
+	const float          ratio_scale    = Q15_ONE / speed;
+	const int32_t        side           = handle->right_side ? -1 : 1;
+	const int32_t        heading_cos    = to_fixed(cosf(pose->heading_rad) * Q15_ONE, Q15_ONE);
+	const int32_t        heading_sin    = to_fixed(sinf(pose->heading_rad) * Q15_ONE, Q15_ONE);
+	const int32_t        position_x     = to_fixed(pose->x_m * position_per_m, POSITION_LIMIT_CELLS * POSITION_ONE);
+	const int32_t        position_y     = to_fixed(pose->y_m * position_per_m, POSITION_LIMIT_CELLS * POSITION_ONE);
+	const int32_t        sensor_x       = floor_div(position_x, POSITION_ONE);
+	const int32_t        sensor_y       = floor_div(position_y, POSITION_ONE);
+	const uint32_t       unit_squared   = (uint32_t)Q15_ONE * Q15_ONE;
+	const acc_obstacle_t *obstacles     = obstacle_data->obstacles;
+
+	// Free space first so that one ray does not clear the obstacle at the end of another
+	for (uint8_t i = 0; i < count; i++)
+	{
+		// Cosine and sine of the angle from the direction of travel
+		int32_t along  = to_fixed(obstacles[i].radial_velocity * ratio_scale, Q15_ONE);
+		int32_t across = side * (int32_t)square_root(unit_squared - (uint32_t)(along * along));
+
+		// The direction of travel rotated by the angle, towards the side the sensor faces
+		int64_t direction_x = ((int64_t)heading_cos * along - (int64_t)heading_sin * across) >> Q15_SHIFT;
+		int64_t direction_y = ((int64_t)heading_sin * along + (int64_t)heading_cos * across) >> Q15_SHIFT;
+		int32_t distance    = to_fixed(obstacles[i].distance * position_per_m, POSITION_LIMIT_CELLS * POSITION_ONE);
+
+		end_x[i] = floor_div(position_x + (int32_t)((distance * direction_x) >> Q15_SHIFT), POSITION_ONE);
+		end_y[i] = floor_div(position_y + (int32_t)((distance * direction_y) >> Q15_SHIFT), POSITION_ONE);
+
+		trace_free(handle, sensor_x, sensor_y, end_x[i], end_y[i]);
+	}
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		cursor_t cursor;
+
+		if (cursor_set(handle, &cursor, end_x[i], end_y[i]))
+		{
+			cell_add(handle, &cursor, handle->hit_log_odds);
+		}
+	}
+
+	return true;
+}
+
+
+void acc_occupancy_grid_recenter(acc_occupancy_grid_handle_t handle, float x_m, float y_m)
+{
+	if (!handle_valid(handle))
+	{
+		return;
+	}
+
+	int32_t old_x = handle->origin_tile_x;
+	int32_t old_y = handle->origin_tile_y;
+	int32_t new_x = floor_div(cell_coordinate(handle, x_m), TILE_SIZE) - handle->tiles_x / 2;
+	int32_t new_y = floor_div(cell_coordinate(handle, y_m), TILE_SIZE) - handle->tiles_y / 2;
+
+	if (new_x == old_x && new_y == old_y)
+	{
+		return;
+	}
+
+	handle->origin_tile_x = new_x;
+	handle->origin_tile_y = new_y;
+
+	for (int32_t tile_y = new_y; tile_y < new_y + handle->tiles_y; tile_y++)
+	{
+		bool row_kept = tile_y >= old_y && tile_y < old_y + handle->tiles_y;
+
+		for (int32_t tile_x = new_x; tile_x < new_x + handle->tiles_x; tile_x++)
+		{
+			if (!row_kept || tile_x < old_x || tile_x >= old_x + handle->tiles_x)
+			{
+				memset(tile_get(handle, tile_x, tile_y), 0, TILE_CELLS);
+			}
+		}
+	}
+}
+
+
+void acc_occupancy_grid_get_metadata(acc_occupancy_grid_handle_t handle, acc_occupancy_grid_metadata_t *metadata)
+{
+	if (!handle_valid(handle) || metadata == NULL)
+	{
+		return;
+	}
+
+	metadata->origin_x_m   = handle->origin_tile_x * TILE_SIZE * handle->cell_size_m;
+	metadata->origin_y_m   = handle->origin_tile_y * TILE_SIZE * handle->cell_size_m;
+	metadata->cell_size_m  = handle->cell_size_m;
+	metadata->width_cells  = handle->tiles_x * TILE_SIZE;
+	metadata->height_cells = handle->tiles_y * TILE_SIZE;
+}
+
+
+int8_t acc_occupancy_grid_log_odds_get(acc_occupancy_grid_handle_t handle, float x_m, float y_m)
+{
+	cursor_t cursor;
+
+	if (!handle_valid(handle) || !cursor_set(handle, &cursor, cell_coordinate(handle, x_m), cell_coordinate(handle, y_m)))
+	{
+		return 0;
+	}
+
+	return cursor.tile[(cursor.cell_y << TILE_SHIFT) | cursor.cell_x];
+}
+
+
+void acc_occupancy_grid_copy(acc_occupancy_grid_handle_t handle, int8_t *cells)
+{
+	if (!handle_valid(handle) || cells == NULL)
+	{
+		return;
+	}
+
+	for (int32_t tile_y = handle->origin_tile_y; tile_y < handle->origin_tile_y + handle->tiles_y; tile_y++)
+	{
+		for (uint16_t row = 0; row < TILE_SIZE; row++)
+		{
+			for (int32_t tile_x = handle->origin_tile_x; tile_x < handle->origin_tile_x + handle->tiles_x; tile_x++)
+			{
+				memcpy(cells, tile_get(handle, tile_x, tile_y) + row * TILE_SIZE, TILE_SIZE);
+				cells += TILE_SIZE;
+			}
+		}
+	}
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+bool handle_valid(acc_occupancy_grid_handle_t handle)
+{
+	bool valid = true;
+
+	if ((handle == NULL) || (handle->magic_number != MAGIC_NUMBER))
+	{
+		ACC_LOG_ERROR("Invalid occupancy grid handle");
+		valid = false;
+	}
+
+	return valid;
+}
+
+
+int32_t floor_div(int32_t value, int32_t divisor)
+{
+	int32_t quotient = value / divisor;
+
+	if ((value % divisor) != 0 && (value < 0) != (divisor < 0))
+	{
+		quotient--;
+	}
+
+	return quotient;
+}
+
+
+int32_t cell_coordinate(acc_occupancy_grid_handle_t handle, float position_m)
+{
+	float cell = floorf(position_m * handle->cells_per_m);
+
+	if (cell > CELL_COORDINATE_LIMIT)
+	{
+		cell = CELL_COORDINATE_LIMIT;
+	}
+	else if (!(cell > -CELL_COORDINATE_LIMIT))
+	{
+		cell = -CELL_COORDINATE_LIMIT;
+	}
+
+	return (int32_t)cell;
+}
+
+
+/**
+ * @brief Round a value to an integer within +-limit, NaN gives -limit
+ */
+int32_t to_fixed(float value, float limit)
+{
+	if (value > limit)
+	{
+		value = limit;
+	}
+	else if (!(value > -limit))
+	{
+		value = -limit;
+	}
+
+	return (int32_t)lrintf(value);
+}
+
+
+/**
+ * @brief Integer square root, rounded down
+ */
+uint32_t square_root(uint32_t value)
+{
+	uint32_t root = 0;
+	uint32_t bit  = 1u << 30;
+
+	while (bit > value)
+	{
+		bit >>= 2;
+	}
+
+	while (bit != 0)
+	{
+		if (value >= root + bit)
+		{
+			value -= root + bit;
+			root   = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+
+		bit >>= 2;
+	}
+
+	return root;
+}
+
+
+/**
+ * @brief Storage of a tile, tiles are indexed modulo the grid size
+ */
+int8_t *tile_get(acc_occupancy_grid_handle_t handle, int32_t tile_x, int32_t tile_y)
+{
+	int32_t slot_x = tile_x - floor_div(tile_x, handle->tiles_x) * handle->tiles_x;
+	int32_t slot_y = tile_y - floor_div(tile_y, handle->tiles_y) * handle->tiles_y;
+
+	return handle->tiles + ((size_t)slot_y * handle->tiles_x + slot_x) * TILE_CELLS;
+}
+
+
+bool cursor_set(acc_occupancy_grid_handle_t handle, cursor_t *cursor, int32_t cell_x, int32_t cell_y)
+{
+	cursor->tile_x = floor_div(cell_x, TILE_SIZE);
+	cursor->tile_y = floor_div(cell_y, TILE_SIZE);
+	cursor->cell_x = cell_x & TILE_MASK;
+	cursor->cell_y = cell_y & TILE_MASK;
+
+	if (cursor->tile_x < handle->origin_tile_x || cursor->tile_x >= handle->origin_tile_x + handle->tiles_x ||
+	    cursor->tile_y < handle->origin_tile_y || cursor->tile_y >= handle->origin_tile_y + handle->tiles_y)
+	{
+		return false;
+	}
+
+	cursor->tile = tile_get(handle, cursor->tile_x, cursor->tile_y);
+
+	return true;
+}
+
+
+/**
+ * @brief Move the cursor one cell in x, the tile is only looked up when a tile border is crossed
+ */
+bool cursor_step_x(acc_occupancy_grid_handle_t handle, cursor_t *cursor, int32_t step)
+{
+	int32_t cell_x = cursor->cell_x + step;
+
+	if (cell_x >= 0 && cell_x < TILE_SIZE)
+	{
+		cursor->cell_x = cell_x;
+		return true;
+	}
+
+	cursor->tile_x += step;
+	cursor->cell_x  = cell_x & TILE_MASK;
+
+	if (cursor->tile_x < handle->origin_tile_x || cursor->tile_x >= handle->origin_tile_x + handle->tiles_x)
+	{
+		return false;
+	}
+
+	cursor->tile = tile_get(handle, cursor->tile_x, cursor->tile_y);
+
+	return true;
+}
+
+
+/**
+ * @brief Move the cursor one cell in y, the tile is only looked up when a tile border is crossed
+ */
+bool cursor_step_y(acc_occupancy_grid_handle_t handle, cursor_t *cursor, int32_t step)
+{
+	int32_t cell_y = cursor->cell_y + step;
+
+	if (cell_y >= 0 && cell_y < TILE_SIZE)
+	{
+		cursor->cell_y = cell_y;
+		return true;
+	}
+
+	cursor->tile_y += step;
+	cursor->cell_y  = cell_y & TILE_MASK;
+
+	if (cursor->tile_y < handle->origin_tile_y || cursor->tile_y >= handle->origin_tile_y + handle->tiles_y)
+	{
+		return false;
+	}
+
+	cursor->tile = tile_get(handle, cursor->tile_x, cursor->tile_y);
+
+	return true;
+}
+
+
+void cell_add(acc_occupancy_grid_handle_t handle, const cursor_t *cursor, int8_t log_odds)
+{
+	int8_t  *cell  = &cursor->tile[(cursor->cell_y << TILE_SHIFT) | cursor->cell_x];
+	int16_t value = *cell + log_odds;
+
+	if (value < handle->min_log_odds)
+	{
+		value = handle->min_log_odds;
+	}
+	else if (value > handle->max_log_odds)
+	{
+		value = handle->max_log_odds;
+	}
+
+	*cell = (int8_t)value;
+}
+
+
+/**
+ * @brief Update the cells from the sensor up to, but not including, the obstacle towards free
+ *
+ * Integer line traversal, stops where the ray leaves the grid.
+ */
+void trace_free(acc_occupancy_grid_handle_t handle, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+	cursor_t cursor;
+
+	if (!cursor_set(handle, &cursor, x0, y0))
+	{
+		return;
+	}
+
+	int32_t dx     = abs(x1 - x0);
+	int32_t dy     = -abs(y1 - y0);
+	int32_t step_x = (x0 < x1) ? 1 : -1;
+	int32_t step_y = (y0 < y1) ? 1 : -1;
+	int32_t error  = dx + dy;
+	int32_t x      = x0;
+	int32_t y      = y0;
+
+	while (x != x1 || y != y1)
+	{
+		cell_add(handle, &cursor, handle->miss_log_odds);
+
+		int32_t error2 = 2 * error;
+
+		if (error2 >= dy)
+		{
+			error += dy;
+			x     += step_x;
+
+			if (!cursor_step_x(handle, &cursor, step_x))
+			{
+				return;
+			}
+		}
+
+		if (error2 <= dx)
+		{
+			error += dx;
+			y     += step_y;
+
+			if (!cursor_step_y(handle, &cursor, step_y))
+			{
+				return;
+			}
+		}
+	}
+}
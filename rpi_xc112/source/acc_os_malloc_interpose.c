@@ -0,0 +1,90 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acc_device_os.h"
+
+
+/**
+ * @brief Interposition of the libc allocator for the steady state tripwire
+ *
+ * Linking this object into a program replaces malloc, calloc, realloc, posix_memalign and
+ * free with versions that report to acc_os_steady_state_record before forwarding to the
+ * glibc implementation. Allocations made by libc itself, for example stdio buffers, are
+ * then caught as well. Build with ACC_MALLOC_INTERPOSE=1 to link it into all programs.
+ */
+
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+
+void *malloc(size_t size);
+void *calloc(size_t num, size_t size);
+void *realloc(void *ptr, size_t size);
+int posix_memalign(void **ptr, size_t alignment, size_t size);
+void free(void *ptr);
+
+
+void *malloc(size_t size)
+{
+	acc_os_steady_state_record(NULL, 0, __builtin_return_address(0), false);
+
+	return __libc_malloc(size);
+}
+
+
+void *calloc(size_t num, size_t size)
+{
+	acc_os_steady_state_record(NULL, 0, __builtin_return_address(0), false);
+
+	return __libc_calloc(num, size);
+}
+
+
+void *realloc(void *ptr, size_t size)
+{
+	acc_os_steady_state_record(NULL, 0, __builtin_return_address(0), false);
+
+	return __libc_realloc(ptr, size);
+}
+
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+	acc_os_steady_state_record(NULL, 0, __builtin_return_address(0), false);
+
+	if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+	{
+		return EINVAL;
+	}
+
+	void *result = __libc_memalign(alignment, size);
+
+	if (result == NULL)
+	{
+		return ENOMEM;
+	}
+
+	*ptr = result;
+
+	return 0;
+}
+
+
+void free(void *ptr)
+{
+	if (ptr != NULL)
+	{
+		acc_os_steady_state_record(NULL, 0, __builtin_return_address(0), true);
+	}
+
+	__libc_free(ptr);
+}
@@ -2,6 +2,8 @@
 // All rights reserved
 
 #include <complex.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <signal.h>
 #include <stdbool.h>
@@ -10,8 +12,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "acc_board.h"
 #include "acc_definitions.h"
+#include "acc_capture_writer.h"
 #include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_log.h"
@@ -20,6 +25,10 @@
 #include "acc_service_envelope.h"
 #include "acc_service_iq.h"
 #include "acc_service_power_bins.h"
+#include "acc_spi_calibration.h"
+#include "acc_sweep_output.h"
+#include "acc_text_format.h"
+#include "acc_trace.h"
 
 #include "acc_version.h"
 
@@ -34,9 +43,27 @@
 #define DEFAULT_RUNNING_AVG        -1.0f     //-1.0 will trigger that the stack default will be used
 #define DEFAULT_SENSOR             1
 #define DEFAULT_LOG_LEVEL          ACC_LOG_LEVEL_ERROR
+#define SPI_CHECK_REPETITIONS      3
+
 
 volatile sig_atomic_t interrupted = 0;
 
+/**
+ * Stream buffers, given to stdio up front since it otherwise allocates them at the first write
+ */
+static char stdout_buffer[BUFSIZ];
+static char file_buffer[BUFSIZ];
+
+/**
+ * Print the memory of the service, the outputs and the threads at the end of the capture
+ */
+static bool report_memory = false;
+
+/**
+ * The sensor whose interrupt wait statistics are printed at the end of the capture, 0 for none
+ */
+static acc_sensor_id_t interrupt_wait_sensor = 0;
+
 
 typedef enum
 {
@@ -46,6 +73,32 @@ typedef enum
 	IQ
 } service_type_t;
 
+
+typedef enum
+{
+	OUTPUT_MODE_STDIO,
+	OUTPUT_MODE_SPLICE,
+	OUTPUT_MODE_DIRECT
+} output_mode_t;
+
+
+/**
+ * Output of sweeps, either a stdio stream, a sweep output that splices to the file descriptor
+ * or a capture writer that writes the file with O_DIRECT
+ */
+typedef struct
+{
+	FILE                 *file;
+	acc_sweep_output_t   sweep_output;
+	acc_capture_writer_t capture_writer;
+	int                  fd;
+	char                 *line;
+	char                 *line_start;
+	size_t               line_size;
+	bool                 flush_sweeps;
+	bool                 failed;
+} output_t;
+
 typedef struct
 {
 	service_type_t                 service_type;
@@ -61,6 +114,11 @@ typedef struct
 	int                            sensor;
 	acc_log_level_t                log_level;
 	char                           *file_path;
+	output_mode_t                  output_mode;
+	bool                           shortest_float;
+	bool                           report_memory;
+	long                           interrupt_wait_us;
+	bool                           spi_check;
 } input_t;
 
 
@@ -79,6 +137,11 @@ static void initialize_input(input_t *input)
 	input->sensor             = DEFAULT_SENSOR;
 	input->log_level          = DEFAULT_LOG_LEVEL;
 	input->file_path          = NULL;
+	input->output_mode        = OUTPUT_MODE_STDIO;
+	input->shortest_float     = false;
+	input->report_memory      = false;
+	input->interrupt_wait_us  = -1;
+	input->spi_check          = false;
 }
 
 
@@ -88,21 +151,37 @@ static bool parse_options(int argc, char *argv[], input_t *input);
 static acc_service_configuration_t set_up_power_bin(input_t *input);
 
 
-static bool execute_power_bin(acc_service_configuration_t power_bin_configuration, char *file_path, bool wait_for_interrupt,
-                              uint16_t update_count);
+static bool execute_power_bin(acc_service_configuration_t power_bin_configuration, char *file_path, output_mode_t output_mode,
+                              bool wait_for_interrupt, uint16_t update_count);
 
 
 static acc_service_configuration_t set_up_envelope(input_t *input);
 
 
-static bool execute_envelope(acc_service_configuration_t envelope_configuration, char *file_path, bool wait_for_interrupt,
-                             uint16_t update_count);
+static bool execute_envelope(acc_service_configuration_t envelope_configuration, char *file_path, output_mode_t output_mode,
+                             bool wait_for_interrupt, uint16_t update_count);
 
 
 static acc_service_configuration_t set_up_iq(input_t *input);
 
 
-static bool execute_iq(acc_service_configuration_t iq_configuration, char *file_path, bool wait_for_interrupt, uint16_t update_count);
+static bool execute_iq(acc_service_configuration_t iq_configuration, char *file_path, output_mode_t output_mode,
+                       bool shortest_float, bool wait_for_interrupt, uint16_t update_count);
+
+
+static bool open_output(const char *file_path, output_mode_t output_mode, size_t line_size, output_t *output);
+
+
+static char *output_begin_line(output_t *output);
+
+
+static bool output_end_line(output_t *output, char *end);
+
+
+static bool close_output(output_t *output);
+
+
+static void report_interrupt_wait(void);
 
 
 static void interrupt_handler(int signum)
@@ -120,6 +199,8 @@ int main(int argc, char *argv[])
 
 	initialize_input(&input);
 
+	setvbuf(stdout, stdout_buffer, _IOLBF, sizeof(stdout_buffer));
+
 	signal(SIGINT, interrupt_handler);
 
 	if (!acc_driver_hal_init())
@@ -137,6 +218,8 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	report_memory = input.report_memory;
+
 	acc_hal_t hal = acc_driver_hal_get_implementation();
 
 	hal.log.log_level = input.log_level;
@@ -146,6 +229,27 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (input.interrupt_wait_us >= 0)
+	{
+		acc_board_interrupt_wait_mode_t mode = input.interrupt_wait_us > 0 ? ACC_BOARD_INTERRUPT_WAIT_SPIN_THEN_BLOCK :
+		                                       ACC_BOARD_INTERRUPT_WAIT_BLOCK;
+
+		if (!acc_board_set_sensor_interrupt_wait_mode(input.sensor, mode, (uint32_t)input.interrupt_wait_us))
+		{
+			return EXIT_FAILURE;
+		}
+
+		interrupt_wait_sensor = input.sensor;
+	}
+
+	// Transfers corrupted by a too high SPI speed do not fail in the driver, on request the speed
+	// is lowered until the communication tests pass before the service is created
+	if (input.spi_check && !acc_spi_calibration_check(input.sensor, SPI_CHECK_REPETITIONS))
+	{
+		printf("Communication with sensor %u failed\n", (unsigned int)input.sensor);
+		return EXIT_FAILURE;
+	}
+
 	bool service_status;
 
 	switch (input.service_type)
@@ -164,7 +268,8 @@ int main(int argc, char *argv[])
 				return EXIT_FAILURE;
 			}
 
-			service_status = execute_power_bin(power_bin_configuration, input.file_path, input.wait_for_interrupt, input.update_count);
+			service_status = execute_power_bin(power_bin_configuration, input.file_path, input.output_mode, input.wait_for_interrupt,
+			                                   input.update_count);
 
 			if (input.file_path != NULL)
 			{
@@ -195,7 +300,8 @@ int main(int argc, char *argv[])
 				return EXIT_FAILURE;
 			}
 
-			service_status = execute_envelope(envelope_configuration, input.file_path, input.wait_for_interrupt, input.update_count);
+			service_status = execute_envelope(envelope_configuration, input.file_path, input.output_mode, input.wait_for_interrupt,
+			                                  input.update_count);
 
 			if (input.file_path != NULL)
 			{
@@ -224,7 +330,8 @@ int main(int argc, char *argv[])
 				}
 			}
 
-			service_status = execute_iq(iq_configuration, input.file_path, input.wait_for_interrupt, input.update_count);
+			service_status = execute_iq(iq_configuration, input.file_path, input.output_mode, input.shortest_float,
+			                            input.wait_for_interrupt, input.update_count);
 
 			if (input.file_path != NULL)
 			{
@@ -253,6 +360,247 @@ int main(int argc, char *argv[])
 }
 
 
+bool open_output(const char *file_path, output_mode_t output_mode, size_t line_size, output_t *output)
+{
+	memset(output, 0, sizeof(*output));
+
+	output->fd           = -1;
+	output->line_size    = line_size;
+	output->flush_sweeps = file_path == NULL;
+
+	if (output_mode != OUTPUT_MODE_SPLICE)
+	{
+		// Allocated here since the sweep loop must not allocate after the steady state is armed
+		output->line = acc_os_mem_alloc(line_size);
+
+		if (output->line == NULL)
+		{
+			return false;
+		}
+	}
+
+	if (output_mode == OUTPUT_MODE_DIRECT)
+	{
+		acc_capture_writer_configuration_t configuration;
+
+		acc_capture_writer_configuration_default(&configuration);
+
+		output->capture_writer = acc_capture_writer_create(file_path, &configuration);
+
+		if (output->capture_writer == NULL)
+		{
+			acc_os_mem_free(output->line);
+			return false;
+		}
+
+		return true;
+	}
+
+	if (output_mode == OUTPUT_MODE_STDIO)
+	{
+		if (file_path == NULL)
+		{
+			output->file = stdout;
+			return true;
+		}
+
+		output->file = fopen(file_path, "w");
+
+		if (output->file == NULL)
+		{
+			acc_os_mem_free(output->line);
+			return false;
+		}
+
+		setvbuf(output->file, file_buffer, _IOFBF, sizeof(file_buffer));
+
+		return true;
+	}
+
+	if (file_path == NULL)
+	{
+		// Text already printed must come before the sweeps
+		fflush(stdout);
+		output->fd = STDOUT_FILENO;
+	}
+	else
+	{
+		output->fd = open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+		if (output->fd < 0)
+		{
+			return false;
+		}
+	}
+
+	acc_sweep_output_configuration_t configuration;
+
+	acc_sweep_output_configuration_default(&configuration);
+
+	if (configuration.buffer_size < line_size)
+	{
+		configuration.buffer_size = line_size;
+	}
+
+	output->sweep_output = acc_sweep_output_create(output->fd, &configuration);
+
+	if (output->sweep_output == NULL)
+	{
+		if (file_path != NULL)
+		{
+			close(output->fd);
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+
+char *output_begin_line(output_t *output)
+{
+	if (output->sweep_output != NULL)
+	{
+		output->line_start = acc_sweep_output_reserve(output->sweep_output, output->line_size);
+	}
+	else
+	{
+		output->line_start = output->line;
+	}
+
+	if (output->line_start == NULL)
+	{
+		output->failed = true;
+	}
+
+	return output->line_start;
+}
+
+
+bool output_end_line(output_t *output, char *end)
+{
+	if (output->line_start == NULL)
+	{
+		return false;
+	}
+
+	*end++ = '\n';
+
+	size_t length = (size_t)(end - output->line_start);
+
+	if (output->capture_writer != NULL)
+	{
+		if (!acc_capture_writer_write(output->capture_writer, output->line_start, length))
+		{
+			output->failed = true;
+		}
+	}
+	else if (output->sweep_output != NULL)
+	{
+		acc_sweep_output_commit(output->sweep_output, length);
+
+		if (output->flush_sweeps && !acc_sweep_output_flush(output->sweep_output))
+		{
+			output->failed = true;
+		}
+	}
+	else if (output->flush_sweeps)
+	{
+		// The whole sweep in one write, after any text already buffered by stdio
+		const char *data = output->line_start;
+
+		if (fflush(output->file) != 0)
+		{
+			output->failed = true;
+		}
+
+		while (length > 0 && !output->failed)
+		{
+			ssize_t written = write(fileno(output->file), data, length);
+
+			if (written > 0)
+			{
+				data   += written;
+				length -= (size_t)written;
+			}
+			else if (written == 0 || errno != EINTR)
+			{
+				output->failed = true;
+			}
+		}
+	}
+	else if (fwrite(output->line_start, 1, length, output->file) != length)
+	{
+		output->failed = true;
+	}
+
+	return !output->failed;
+}
+
+
+bool close_output(output_t *output)
+{
+	bool success = !output->failed;
+
+	if (output->line != NULL)
+	{
+		acc_os_mem_free(output->line);
+		output->line = NULL;
+	}
+
+	if (output->capture_writer != NULL)
+	{
+		acc_capture_writer_statistics_t statistics;
+
+		success = acc_capture_writer_wait(output->capture_writer) && success;
+		acc_capture_writer_get_statistics(output->capture_writer, &statistics);
+		success = acc_capture_writer_destroy(&output->capture_writer) && success;
+
+		printf("Capture written%s, longest write %u us, longest until on disk %u ms, %u stalls\n",
+		       statistics.direct ? " with O_DIRECT" : "", (unsigned int)statistics.max_write_time_us,
+		       (unsigned int)(statistics.max_latency_us / 1000), (unsigned int)statistics.stall_count);
+	}
+	else if (output->sweep_output != NULL)
+	{
+		success = acc_sweep_output_destroy(&output->sweep_output) && success;
+
+		if (output->fd != STDOUT_FILENO)
+		{
+			success = close(output->fd) == 0 && success;
+		}
+	}
+	else if (output->file != stdout)
+	{
+		success = fclose(output->file) == 0 && success;
+	}
+
+	return success;
+}
+
+
+void report_interrupt_wait(void)
+{
+	if (interrupt_wait_sensor == 0)
+	{
+		return;
+	}
+
+	acc_board_interrupt_statistics_t statistics;
+
+	acc_board_get_sensor_interrupt_statistics(interrupt_wait_sensor, &statistics);
+
+	fprintf(stderr, "Interrupt waits: %" PRIu32 ", timeouts: %" PRIu32 ", interval: %" PRIu32 " us\n",
+	        statistics.wait_count, statistics.timeout_count, statistics.interval_us);
+	fprintf(stderr, "  spin:  %" PRIu32 " waits, latency %" PRIu64 " us mean, spun %" PRIu64 " us in total\n",
+	        statistics.spin_count, statistics.spin_count > 0 ? statistics.spin_latency_us / statistics.spin_count : 0,
+	        statistics.spin_time_us);
+	fprintf(stderr, "  block: %" PRIu32 " waits, latency %" PRIu64 " us mean\n",
+	        statistics.block_count, statistics.block_count > 0 ? statistics.block_latency_us / statistics.block_count : 0);
+	fprintf(stderr, "  latency max: %" PRIu32 " us\n", statistics.latency_max_us);
+}
+
+
 static void print_usage(void)
 {
 	printf("Usage: data_logger [OPTION]...\n\n");
@@ -271,6 +619,14 @@ static void print_usage(void)
 	printf("-g, --gain                gain (default service dependent)\n");
 	printf("-n, --number-of-bins      number of bins (powerbins only), default %d.\n", DEFAULT_N_BINS);
 	printf("-o, --out                 path to out file, default stdout\n");
+	printf("-p, --splice              hand sweeps to the output with vmsplice or splice, falls back to write\n");
+	printf("-d, --direct              write the out file with O_DIRECT in the background, for long captures\n");
+	printf("-x, --shortest-float      write iq values with the fewest digits that read back exactly, not six decimals\n");
+	printf("-m, --memory              print heap, mapped memory and thread stacks at the end of the capture\n");
+	printf("-w, --interrupt-wait      spin up to this many us for the sensor interrupt before blocking, 0 blocks at once,\n");
+	printf("                          prints wait latency and spin time at the end of the capture\n");
+	printf("-k, --spi-check           run the communication tests before the capture, lower and persist\n");
+	printf("                          the SPI speed of the sensor until they pass\n");
 	printf("-y, --service-profile     service profile to use (starting at index 1), default %u\n",
 	       DEFAULT_SERVICE_PROFILE);
 	printf("                            means no profile is set explicitly\n");
@@ -294,6 +650,12 @@ bool parse_options(int argc, char *argv[], input_t *input)
 		{"gain",               required_argument,  0, 'g'},
 		{"number-of-bins",     required_argument,  0, 'n'},
 		{"out",                required_argument,  0, 'o'},
+		{"splice",             no_argument,        0, 'p'},
+		{"direct",             no_argument,        0, 'd'},
+		{"shortest-float",     no_argument,        0, 'x'},
+		{"memory",             no_argument,        0, 'm'},
+		{"interrupt-wait",     required_argument,  0, 'w'},
+		{"spi-check",          no_argument,        0, 'k'},
 		{"service-profile",    required_argument,  0, 'y'},
 		{"running-avg-factor", required_argument,  0, 'r'},
 		{"sensor",             required_argument,  0, 's'},
@@ -305,7 +667,7 @@ bool parse_options(int argc, char *argv[], input_t *input)
 	int16_t character_code;
 	int32_t option_index = 0;
 
-	while ((character_code = getopt_long(argc, argv, "t:c:b:e:f:g:n:o:r:s:vh?:y:", long_options, &option_index)) != -1)
+	while ((character_code = getopt_long(argc, argv, "t:c:b:e:f:g:n:o:pdxmw:kr:s:vh?:y:", long_options, &option_index)) != -1)
 	{
 		switch (character_code)
 		{
@@ -417,6 +779,47 @@ bool parse_options(int argc, char *argv[], input_t *input)
 				snprintf(input->file_path, strlen(optarg) + 1, "%s", optarg);
 				break;
 			}
+			case 'p':
+			{
+				input->output_mode = OUTPUT_MODE_SPLICE;
+				break;
+			}
+			case 'd':
+			{
+				input->output_mode = OUTPUT_MODE_DIRECT;
+				break;
+			}
+			case 'x':
+			{
+				input->shortest_float = true;
+				break;
+			}
+			case 'm':
+			{
+				input->report_memory = true;
+				break;
+			}
+			case 'k':
+			{
+				input->spi_check = true;
+				break;
+			}
+			case 'w':
+			{
+				long w = strtol(optarg, NULL, 10);
+				if (w >= 0 && w <= 1000000)
+				{
+					input->interrupt_wait_us = w;
+				}
+				else
+				{
+					printf("Interrupt wait out of range.\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				}
+
+				break;
+			}
 			case 'r':
 			{
 				float r = strtof(optarg, NULL);
@@ -470,6 +873,13 @@ bool parse_options(int argc, char *argv[], input_t *input)
 		return false;
 	}
 
+	if (input->output_mode == OUTPUT_MODE_DIRECT && input->file_path == NULL)
+	{
+		printf("Direct output needs an out file.\n");
+		print_usage();
+		return false;
+	}
+
 	return true;
 }
 
@@ -512,13 +922,15 @@ acc_service_configuration_t set_up_power_bin(input_t *input)
 }
 
 
-bool execute_power_bin(acc_service_configuration_t power_bin_configuration, char *file_path, bool wait_for_interrupt,
-                       uint16_t update_count)
+bool execute_power_bin(acc_service_configuration_t power_bin_configuration, char *file_path, output_mode_t output_mode,
+                       bool wait_for_interrupt, uint16_t update_count)
 {
-	acc_service_handle_t handle = acc_service_create(power_bin_configuration);
+	uint16_t             memory_scope = acc_os_memory_scope_begin("power bins service");
+	acc_service_handle_t handle       = acc_service_create(power_bin_configuration);
 
 	if (handle == NULL)
 	{
+		acc_os_memory_scope_end(memory_scope);
 		printf("acc_service_create failed\n");
 		return false;
 	}
@@ -531,46 +943,54 @@ bool execute_power_bin(acc_service_configuration_t power_bin_configuration, char
 	acc_service_power_bins_result_info_t result_info;
 	bool                                 service_status = acc_service_activate(handle);
 
+	acc_os_memory_scope_end(memory_scope);
+
 	if (service_status)
 	{
-		FILE *file = stdout;
+		output_t output;
+		size_t   line_size = (size_t)power_bins_metadata.bin_count * (ACC_TEXT_FORMAT_UINT32_LENGTH_MAX + 1) + 1;
 
-		if (file_path != NULL)
+		if (!open_output(file_path, output_mode, line_size, &output))
 		{
-			file = fopen(file_path, "w");
-
-			if (file == NULL)
-			{
-				printf("opening file failed\n");
-				return false;
-			}
+			printf("opening file failed\n");
+			acc_service_deactivate(handle);
+			acc_service_destroy(&handle);
+			return false;
 		}
 
-		uint16_t updates = 0;
+		uint16_t updates   = 0;
+		bool     output_ok = true;
+
+		acc_os_steady_state_arm();
 
 		while ((wait_for_interrupt && interrupted == 0) || updates < update_count)
 		{
+			ACC_TRACE0(get_next_begin);
 			service_status = acc_service_power_bins_get_next(handle, power_bins_data, power_bins_metadata.bin_count, &result_info);
+			ACC_TRACE1(get_next_end, service_status);
 
 			if (service_status)
 			{
-				for (uint_fast16_t index = 0; index < power_bins_metadata.bin_count; index++)
+				char *position = output_begin_line(&output);
+
+				for (uint_fast16_t index = 0; position != NULL && index < power_bins_metadata.bin_count; index++)
 				{
-					fprintf(file, "%u\t", (unsigned int)power_bins_data[index]);
+					position    = acc_text_format_uint32(position, power_bins_data[index]);
+					*position++ = '\t';
 				}
 
-				fprintf(file, "\n");
-
-				if (file_path == NULL)
+				if (!output_end_line(&output, position))
 				{
-					fflush(stdout);
+					printf("Writing output failed\n");
+					output_ok = false;
+					break;
 				}
 			}
 			else
 			{
 				printf("Power bin data not properly retrieved\n");
 				fflush(stdout);
-				return false;
+				break;
 			}
 
 			if (!wait_for_interrupt)
@@ -579,12 +999,22 @@ bool execute_power_bin(acc_service_configuration_t power_bin_configuration, char
 			}
 		}
 
-		if (file_path != NULL)
+		acc_os_steady_state_check();
+
+		if (report_memory)
+		{
+			acc_os_memory_report();
+		}
+
+		report_interrupt_wait();
+
+		if (!close_output(&output) && output_ok)
 		{
-			fclose(file);
+			printf("Writing output failed\n");
+			output_ok = false;
 		}
 
-		service_status = acc_service_deactivate(handle);
+		service_status = acc_service_deactivate(handle) && service_status && output_ok;
 	}
 	else
 	{
@@ -637,13 +1067,15 @@ acc_service_configuration_t set_up_envelope(input_t *input)
 }
 
 
-bool execute_envelope(acc_service_configuration_t envelope_configuration, char *file_path, bool wait_for_interrupt,
-                      uint16_t update_count)
+bool execute_envelope(acc_service_configuration_t envelope_configuration, char *file_path, output_mode_t output_mode,
+                      bool wait_for_interrupt, uint16_t update_count)
 {
-	acc_service_handle_t handle = acc_service_create(envelope_configuration);
+	uint16_t             memory_scope = acc_os_memory_scope_begin("envelope service");
+	acc_service_handle_t handle       = acc_service_create(envelope_configuration);
 
 	if (handle == NULL)
 	{
+		acc_os_memory_scope_end(memory_scope);
 		printf("acc_Service_create failed\n");
 		return false;
 	}
@@ -656,46 +1088,54 @@ bool execute_envelope(acc_service_configuration_t envelope_configuration, char *
 	acc_service_envelope_result_info_t result_info;
 	bool                               service_status = acc_service_activate(handle);
 
+	acc_os_memory_scope_end(memory_scope);
+
 	if (service_status)
 	{
-		FILE *file = stdout;
+		output_t output;
+		size_t   line_size = (size_t)envelope_metadata.data_length * (ACC_TEXT_FORMAT_UINT32_LENGTH_MAX + 1) + 1;
 
-		if (file_path != NULL)
+		if (!open_output(file_path, output_mode, line_size, &output))
 		{
-			file = fopen(file_path, "w");
-
-			if (file == NULL)
-			{
-				printf("opening file failed\n");
-				return false;
-			}
+			printf("opening file failed\n");
+			acc_service_deactivate(handle);
+			acc_service_destroy(&handle);
+			return false;
 		}
 
-		uint16_t updates = 0;
+		uint16_t updates   = 0;
+		bool     output_ok = true;
+
+		acc_os_steady_state_arm();
 
 		while ((wait_for_interrupt && interrupted == 0) || updates < update_count)
 		{
+			ACC_TRACE0(get_next_begin);
 			service_status = acc_service_envelope_get_next(handle, envelope_data, envelope_metadata.data_length, &result_info);
+			ACC_TRACE1(get_next_end, service_status);
 
 			if (service_status)
 			{
-				for (uint_fast16_t index = 0; index < envelope_metadata.data_length; index++)
+				char *position = output_begin_line(&output);
+
+				for (uint_fast16_t index = 0; position != NULL && index < envelope_metadata.data_length; index++)
 				{
-					fprintf(file, "%u\t", (unsigned int)(envelope_data[index] + 0.5f));
+					position    = acc_text_format_uint32(position, envelope_data[index]);
+					*position++ = '\t';
 				}
 
-				fprintf(file, "\n");
-
-				if (file_path == NULL)
+				if (!output_end_line(&output, position))
 				{
-					fflush(stdout);
+					printf("Writing output failed\n");
+					output_ok = false;
+					break;
 				}
 			}
 			else
 			{
 				printf("Envelope data not properly retrieved\n");
 				fflush(stdout);
-				return false;
+				break;
 			}
 
 			if (!wait_for_interrupt)
@@ -704,12 +1144,22 @@ bool execute_envelope(acc_service_configuration_t envelope_configuration, char *
 			}
 		}
 
-		if (file_path != NULL)
+		acc_os_steady_state_check();
+
+		if (report_memory)
+		{
+			acc_os_memory_report();
+		}
+
+		report_interrupt_wait();
+
+		if (!close_output(&output) && output_ok)
 		{
-			fclose(file);
+			printf("Writing output failed\n");
+			output_ok = false;
 		}
 
-		service_status = acc_service_deactivate(handle);
+		service_status = acc_service_deactivate(handle) && service_status && output_ok;
 	}
 	else
 	{
@@ -758,12 +1208,15 @@ acc_service_configuration_t set_up_iq(input_t *input)
 }
 
 
-bool execute_iq(acc_service_configuration_t iq_configuration, char *file_path, bool wait_for_interrupt, uint16_t update_count)
+bool execute_iq(acc_service_configuration_t iq_configuration, char *file_path, output_mode_t output_mode,
+                bool shortest_float, bool wait_for_interrupt, uint16_t update_count)
 {
-	acc_service_handle_t handle = acc_service_create(iq_configuration);
+	uint16_t             memory_scope = acc_os_memory_scope_begin("iq service");
+	acc_service_handle_t handle       = acc_service_create(iq_configuration);
 
 	if (handle == NULL)
 	{
+		acc_os_memory_scope_end(memory_scope);
 		printf("acc_service_create failed\n");
 		return false;
 	}
@@ -776,48 +1229,70 @@ bool execute_iq(acc_service_configuration_t iq_configuration, char *file_path, b
 
 	bool service_status = acc_service_activate(handle);
 
+	acc_os_memory_scope_end(memory_scope);
+
 	if (service_status)
 	{
-		FILE *file = stdout;
+		output_t output;
+		char     *(*format_float)(char *buffer, float value);
+		size_t   value_length;
 
-		if (file_path != NULL)
+		if (shortest_float)
 		{
-			file = fopen(file_path, "w");
+			format_float = acc_text_format_float;
+			value_length = ACC_TEXT_FORMAT_FLOAT_LENGTH_MAX;
+		}
+		else
+		{
+			format_float = acc_text_format_prifloat;
+			value_length = ACC_TEXT_FORMAT_PRIFLOAT_LENGTH_MAX;
+		}
 
-			if (file == NULL)
-			{
-				printf("opening file failed\n");
-				return false;
-			}
+		size_t line_size = (size_t)iq_metadata.data_length * 2 * (value_length + 1) + 1;
+
+		if (!open_output(file_path, output_mode, line_size, &output))
+		{
+			printf("opening file failed\n");
+			acc_service_deactivate(handle);
+			acc_service_destroy(&handle);
+			return false;
 		}
 
-		uint16_t updates = 0;
+		uint16_t updates   = 0;
+		bool     output_ok = true;
+
+		acc_os_steady_state_arm();
 
 		while ((wait_for_interrupt && interrupted == 0) || updates < update_count)
 		{
+			ACC_TRACE0(get_next_begin);
 			service_status = acc_service_iq_get_next(handle, iq_data, iq_metadata.data_length, &result_info);
+			ACC_TRACE1(get_next_end, service_status);
 
 			if (service_status)
 			{
-				for (uint_fast16_t index = 0; index < iq_metadata.data_length; index++)
+				char *position = output_begin_line(&output);
+
+				for (uint_fast16_t index = 0; position != NULL && index < iq_metadata.data_length; index++)
 				{
-					fprintf(file, "%" PRIfloat "\t%" PRIfloat "\t", ACC_LOG_FLOAT_TO_INTEGER(crealf(
-															 iq_data[index])),
-					        ACC_LOG_FLOAT_TO_INTEGER(cimagf(iq_data[index])));
+					position    = format_float(position, crealf(iq_data[index]));
+					*position++ = '\t';
+					position    = format_float(position, cimagf(iq_data[index]));
+					*position++ = '\t';
 				}
 
-				fprintf(file, "\n");
-
-				if (file_path == NULL)
+				if (!output_end_line(&output, position))
 				{
-					fflush(stdout);
+					printf("Writing output failed\n");
+					output_ok = false;
+					break;
 				}
 			}
 			else
 			{
 				printf("IQ data not properly retrieved\n");
 				fflush(stdout);
-				return false;
+				break;
 			}
 
 			if (!wait_for_interrupt)
@@ -826,12 +1301,22 @@ bool execute_iq(acc_service_configuration_t iq_configuration, char *file_path, b
 			}
 		}
 
-		if (file_path != NULL)
+		acc_os_steady_state_check();
+
+		if (report_memory)
+		{
+			acc_os_memory_report();
+		}
+
+		report_interrupt_wait();
+
+		if (!close_output(&output) && output_ok)
 		{
-			fclose(file);
+			printf("Writing output failed\n");
+			output_ok = false;
 		}
 
-		service_status = acc_service_deactivate(handle);
+		service_status = acc_service_deactivate(handle) && service_status && output_ok;
 	}
 	else
 	{
@@ -0,0 +1,312 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "acc_session.h"
+
+#include "acc_board.h"
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "session"
+
+#define TIMELINE_BAR_LENGTH 50
+#define SCOPE_NAME_LENGTH   24
+
+
+typedef struct
+{
+	acc_service_configuration_t         configuration;
+	acc_service_handle_t                service;
+	acc_app_integration_thread_handle_t thread;
+	uint64_t                            start_us;
+	acc_session_timeline_t              timeline;
+} session_sensor_t;
+
+
+struct acc_session
+{
+	uint_fast8_t     sensor_count;
+	uint32_t         startup_time_us;
+	session_sensor_t sensors[ACC_SESSION_SENSOR_COUNT_MAX];
+};
+
+
+/**
+ * @brief Create and activate the service of one sensor, run in a thread per sensor
+ *
+ * @param param The session_sensor_t of the sensor
+ */
+static void bring_up_sensor(void *param);
+
+
+/**
+ * @brief Deactivate and destroy the services that were brought up
+ */
+static void release_services(acc_session_t session);
+
+
+static uint64_t get_time_us(void);
+
+
+acc_session_t acc_session_create(const acc_service_configuration_t *configurations, uint_fast8_t count, bool parallel)
+{
+	if (configurations == NULL || count == 0 || count > ACC_SESSION_SENSOR_COUNT_MAX)
+	{
+		ACC_LOG_ERROR("Invalid number of sensors %u", (unsigned int)count);
+		return NULL;
+	}
+
+	acc_session_t session = acc_os_mem_alloc(sizeof(*session));
+
+	if (session == NULL)
+	{
+		return NULL;
+	}
+
+	memset(session, 0, sizeof(*session));
+
+	session->sensor_count = count;
+
+	uint64_t start_us = get_time_us();
+
+	for (uint_fast8_t i = 0; i < count; i++)
+	{
+		session_sensor_t *sensor = &session->sensors[i];
+
+		sensor->configuration   = configurations[i];
+		sensor->start_us        = start_us;
+		sensor->timeline.sensor = acc_service_sensor_get(configurations[i]);
+
+		if (sensor->timeline.sensor < 1 || sensor->timeline.sensor > acc_board_get_sensor_count())
+		{
+			ACC_LOG_ERROR("Sensor %u is not on the board", (unsigned int)sensor->timeline.sensor);
+			acc_os_mem_free(session);
+			return NULL;
+		}
+
+		for (uint_fast8_t j = 0; j < i; j++)
+		{
+			if (session->sensors[j].timeline.sensor == sensor->timeline.sensor)
+			{
+				ACC_LOG_ERROR("Sensor %u is in more than one configuration", (unsigned int)sensor->timeline.sensor);
+				acc_os_mem_free(session);
+				return NULL;
+			}
+		}
+	}
+
+	parallel = parallel && count > 1 && acc_os_multithread_support();
+
+	for (uint_fast8_t i = 0; i < count; i++)
+	{
+		session_sensor_t *sensor = &session->sensors[i];
+
+		if (parallel)
+		{
+			sensor->thread = acc_os_thread_create(&bring_up_sensor, sensor, "session");
+		}
+
+		// Without a thread the sensor is brought up here, before the next thread is started
+		if (sensor->thread == NULL)
+		{
+			bring_up_sensor(sensor);
+		}
+	}
+
+	bool success = true;
+
+	for (uint_fast8_t i = 0; i < count; i++)
+	{
+		session_sensor_t *sensor = &session->sensors[i];
+
+		if (sensor->thread != NULL)
+		{
+			acc_os_thread_cleanup(sensor->thread);
+			sensor->thread = NULL;
+		}
+
+		if (!sensor->timeline.success)
+		{
+			ACC_LOG_ERROR("Sensor %u could not be %s", (unsigned int)sensor->timeline.sensor,
+			              (sensor->service == NULL) ? "created" : "activated");
+			success = false;
+		}
+	}
+
+	session->startup_time_us = (uint32_t)(get_time_us() - start_us);
+
+	if (!success)
+	{
+		release_services(session);
+		acc_os_mem_free(session);
+		return NULL;
+	}
+
+	return session;
+}
+
+
+void acc_session_destroy(acc_session_t *session)
+{
+	if (session == NULL || *session == NULL)
+	{
+		return;
+	}
+
+	release_services(*session);
+	acc_os_mem_free(*session);
+
+	*session = NULL;
+}
+
+
+acc_service_handle_t acc_session_get_service(acc_session_t session, uint_fast8_t index)
+{
+	return (index < session->sensor_count) ? session->sensors[index].service : NULL;
+}
+
+
+void acc_session_get_timeline(acc_session_t session, uint_fast8_t index, acc_session_timeline_t *timeline)
+{
+	if (index < session->sensor_count)
+	{
+		*timeline = session->sensors[index].timeline;
+	}
+	else
+	{
+		memset(timeline, 0, sizeof(*timeline));
+	}
+}
+
+
+uint32_t acc_session_get_startup_time_us(acc_session_t session)
+{
+	return session->startup_time_us;
+}
+
+
+void acc_session_print_timeline(acc_session_t session)
+{
+	uint32_t end_us = 1;
+
+	for (uint_fast8_t i = 0; i < session->sensor_count; i++)
+	{
+		if (session->sensors[i].timeline.activate_end_us > end_us)
+		{
+			end_us = session->sensors[i].timeline.activate_end_us;
+		}
+	}
+
+	printf("Startup of %u sensors in %.1f ms, - create, # activate\n", (unsigned int)session->sensor_count,
+	       (double)session->startup_time_us / 1000.0);
+	printf("%-6s %9s %9s %9s %9s %9s %9s\n", "sensor", "create", "activate", "end", "transfers", "spi ms", "bus wait");
+
+	for (uint_fast8_t i = 0; i < session->sensor_count; i++)
+	{
+		const acc_session_timeline_t *timeline = &session->sensors[i].timeline;
+		char                         bar[TIMELINE_BAR_LENGTH + 1];
+
+		for (uint_fast8_t column = 0; column < TIMELINE_BAR_LENGTH; column++)
+		{
+			// Middle of the column on the common time axis
+			uint32_t time_us = (uint32_t)(((uint64_t)column * 2 + 1) * end_us / (TIMELINE_BAR_LENGTH * 2));
+
+			if (time_us >= timeline->create_start_us && time_us < timeline->create_end_us)
+			{
+				bar[column] = '-';
+			}
+			else if (time_us >= timeline->activate_start_us && time_us < timeline->activate_end_us)
+			{
+				bar[column] = '#';
+			}
+			else
+			{
+				bar[column] = ' ';
+			}
+		}
+
+		bar[TIMELINE_BAR_LENGTH] = '\0';
+
+		printf("%-6u %9.1f %9.1f %9.1f %9u %9.1f %9.1f |%s|\n", (unsigned int)timeline->sensor,
+		       (double)timeline->create_start_us / 1000.0, (double)timeline->activate_start_us / 1000.0,
+		       (double)timeline->activate_end_us / 1000.0, (unsigned int)timeline->transfer_count,
+		       (double)timeline->transfer_time_us / 1000.0, (double)timeline->bus_wait_us / 1000.0, bar);
+	}
+}
+
+
+void bring_up_sensor(void *param)
+{
+	session_sensor_t                *sensor   = param;
+	acc_session_timeline_t          *timeline = &sensor->timeline;
+	acc_board_transfer_statistics_t before;
+	acc_board_transfer_statistics_t after;
+	char                            scope_name[SCOPE_NAME_LENGTH];
+
+	snprintf(scope_name, sizeof(scope_name), "session sensor %u", (unsigned int)timeline->sensor);
+
+	uint16_t memory_scope = acc_os_memory_scope_begin(scope_name);
+
+	acc_board_get_sensor_transfer_statistics(timeline->sensor, &before);
+
+	timeline->create_start_us = (uint32_t)(get_time_us() - sensor->start_us);
+	sensor->service           = acc_service_create(sensor->configuration);
+	timeline->create_end_us   = (uint32_t)(get_time_us() - sensor->start_us);
+
+	timeline->activate_start_us = timeline->create_end_us;
+	timeline->activate_end_us   = timeline->create_end_us;
+
+	if (sensor->service != NULL)
+	{
+		timeline->success         = acc_service_activate(sensor->service);
+		timeline->activate_end_us = (uint32_t)(get_time_us() - sensor->start_us);
+	}
+
+	acc_board_get_sensor_transfer_statistics(timeline->sensor, &after);
+
+	timeline->transfer_count   = after.transfer_count - before.transfer_count;
+	timeline->transfer_time_us = (uint32_t)(after.time_us - before.time_us);
+	timeline->bus_wait_us      = (uint32_t)(after.bus_wait_us - before.bus_wait_us);
+
+	acc_os_memory_scope_end(memory_scope);
+}
+
+
+void release_services(acc_session_t session)
+{
+	for (uint_fast8_t i = 0; i < session->sensor_count; i++)
+	{
+		session_sensor_t *sensor = &session->sensors[i];
+
+		if (sensor->service == NULL)
+		{
+			continue;
+		}
+
+		if (sensor->timeline.success)
+		{
+			acc_service_deactivate(sensor->service);
+		}
+
+		acc_service_destroy(&sensor->service);
+	}
+}
+
+
+uint64_t get_time_us(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (uint64_t)time_ts.tv_sec * 1000000 + (uint64_t)time_ts.tv_nsec / 1000;
+}
@@ -0,0 +1,453 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "acc_sliding_dft.h"
+
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "sliding_dft"
+
+#define MAGIC_NUMBER (0xACC05DF7)
+
+#define PI 3.14159265358979323846
+
+
+typedef struct acc_sliding_dft_handle
+{
+	uint32_t                magic_number;
+	acc_sliding_dft_input_t input;
+	uint16_t                data_length;
+	uint16_t                window_length;
+	uint8_t                 frequency_bin_count;
+	uint16_t                frequency_bins[ACC_SLIDING_DFT_FREQUENCY_BINS_MAX];
+	uint16_t                reanchor_count;
+	uint16_t                reanchor_position;
+	uint16_t                position;
+	uint16_t                sweep_count;
+	float                   *cos_table;
+	float                   *sin_table;
+	float                   *sum_real;
+	float                   *sum_imag;
+	float                   *difference_real;
+	float                   *difference_imag;
+	uint16_t                *envelope_history;
+	float                   *iq_history_real;
+	float                   *iq_history_imag;
+} acc_sliding_dft_handle_internal_t;
+
+
+static bool handle_valid(acc_sliding_dft_handle_t handle);
+static bool input_valid(acc_sliding_dft_handle_t handle, acc_sliding_dft_input_t input);
+static void update(acc_sliding_dft_handle_t handle);
+static void reanchor(acc_sliding_dft_handle_t handle, uint16_t point);
+static void advance(acc_sliding_dft_handle_t handle);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+acc_sliding_dft_handle_t acc_sliding_dft_create(const acc_sliding_dft_configuration_t *configuration)
+{
+	if (configuration == NULL || configuration->data_length == 0 || configuration->window_length < 2 ||
+	    configuration->frequency_bin_count == 0 || configuration->frequency_bin_count > ACC_SLIDING_DFT_FREQUENCY_BINS_MAX ||
+	    (configuration->input != ACC_SLIDING_DFT_INPUT_ENVELOPE && configuration->input != ACC_SLIDING_DFT_INPUT_IQ))
+	{
+		ACC_LOG_ERROR("Invalid sliding DFT configuration");
+		return NULL;
+	}
+
+	for (uint8_t k = 0; k < configuration->frequency_bin_count; k++)
+	{
+		if (configuration->frequency_bins[k] >= configuration->window_length)
+		{
+			ACC_LOG_ERROR("Frequency bin %u out of range", (unsigned int)configuration->frequency_bins[k]);
+			return NULL;
+		}
+	}
+
+	const size_t data_length   = configuration->data_length;
+	const size_t window_length = configuration->window_length;
+	const size_t sums          = configuration->frequency_bin_count * data_length;
+	const bool   iq            = configuration->input == ACC_SLIDING_DFT_INPUT_IQ;
+
+	size_t state_size = sizeof(float) * (2 * window_length + 2 * sums + 2 * data_length);
+
+	state_size += iq ? sizeof(float) * 2 * window_length * data_length : sizeof(uint16_t) * window_length * data_length;
+
+	acc_sliding_dft_handle_internal_t *handle = acc_os_mem_alloc(sizeof(*handle) + state_size);
+
+	if (handle == NULL)
+	{
+		ACC_LOG_ERROR("Sliding DFT not possible to allocate");
+		return NULL;
+	}
+
+	memset(handle, 0, sizeof(*handle));
+
+	handle->magic_number        = MAGIC_NUMBER;
+	handle->input               = configuration->input;
+	handle->data_length         = configuration->data_length;
+	handle->window_length       = configuration->window_length;
+	handle->frequency_bin_count = configuration->frequency_bin_count;
+	memcpy(handle->frequency_bins, configuration->frequency_bins, sizeof(handle->frequency_bins));
+
+	if (configuration->reanchor_interval > 0)
+	{
+		handle->reanchor_count = (uint16_t)((data_length + configuration->reanchor_interval - 1) / configuration->reanchor_interval);
+	}
+
+	handle->cos_table       = (float *)(handle + 1);
+	handle->sin_table       = handle->cos_table + window_length;
+	handle->sum_real        = handle->sin_table + window_length;
+	handle->sum_imag        = handle->sum_real + sums;
+	handle->difference_real = handle->sum_imag + sums;
+	handle->difference_imag = handle->difference_real + data_length;
+
+	if (iq)
+	{
+		handle->iq_history_real = handle->difference_imag + data_length;
+		handle->iq_history_imag = handle->iq_history_real + window_length * data_length;
+	}
+	else
+	{
+		handle->envelope_history = (uint16_t *)(handle->difference_imag + data_length);
+	}
+
+	// e^(-j 2 pi m / N), the twiddle factor of bin k at time n is entry k * n modulo N
+	for (size_t m = 0; m < window_length; m++)
+	{
+		double angle = 2.0 * PI * (double)m / (double)window_length;
+
+		handle->cos_table[m] = (float)cos(angle);
+		handle->sin_table[m] = (float)-sin(angle);
+	}
+
+	acc_sliding_dft_reset(handle);
+
+	return handle;
+}
+
+
+void acc_sliding_dft_destroy(acc_sliding_dft_handle_t *handle)
+{
+	if (handle != NULL && *handle != NULL)
+	{
+		if (handle_valid(*handle))
+		{
+			(*handle)->magic_number = 0;
+			acc_os_mem_free(*handle);
+			*handle = NULL;
+		}
+	}
+}
+
+
+bool acc_sliding_dft_process_envelope(acc_sliding_dft_handle_t handle, const uint16_t *data)
+{
+	if (!input_valid(handle, ACC_SLIDING_DFT_INPUT_ENVELOPE) || data == NULL)
+	{
+		return false;
+	}
+
+	uint16_t *history = handle->envelope_history + (size_t)handle->position * handle->data_length;
+
+	for (uint16_t point = 0; point < handle->data_length; point++)
+	{
+		handle->difference_real[point] = (float)((int32_t)data[point] - (int32_t)history[point]);
+	}
+
+	memcpy(history, data, sizeof(*data) * handle->data_length);
+
+	update(handle);
+	advance(handle);
+
+	return true;
+}
+
+
+bool acc_sliding_dft_process_iq(acc_sliding_dft_handle_t handle, const float complex *data)
+{
+	if (!input_valid(handle, ACC_SLIDING_DFT_INPUT_IQ) || data == NULL)
+	{
+		return false;
+	}
+
+	float *history_real = handle->iq_history_real + (size_t)handle->position * handle->data_length;
+	float *history_imag = handle->iq_history_imag + (size_t)handle->position * handle->data_length;
+
+	for (uint16_t point = 0; point < handle->data_length; point++)
+	{
+		float real = crealf(data[point]);
+		float imag = cimagf(data[point]);
+
+		handle->difference_real[point] = real - history_real[point];
+		handle->difference_imag[point] = imag - history_imag[point];
+		history_real[point]            = real;
+		history_imag[point]            = imag;
+	}
+
+	update(handle);
+	advance(handle);
+
+	return true;
+}
+
+
+bool acc_sliding_dft_process_iq_int16(acc_sliding_dft_handle_t handle, const acc_int16_complex_t *data)
+{
+	if (!input_valid(handle, ACC_SLIDING_DFT_INPUT_IQ) || data == NULL)
+	{
+		return false;
+	}
+
+	float *history_real = handle->iq_history_real + (size_t)handle->position * handle->data_length;
+	float *history_imag = handle->iq_history_imag + (size_t)handle->position * handle->data_length;
+
+	for (uint16_t point = 0; point < handle->data_length; point++)
+	{
+		float real = data[point].real;
+		float imag = data[point].imag;
+
+		handle->difference_real[point] = real - history_real[point];
+		handle->difference_imag[point] = imag - history_imag[point];
+		history_real[point]            = real;
+		history_imag[point]            = imag;
+	}
+
+	update(handle);
+	advance(handle);
+
+	return true;
+}
+
+
+bool acc_sliding_dft_get_spectrum(acc_sliding_dft_handle_t handle, uint8_t frequency_bin_index, float complex *spectrum)
+{
+	if (!handle_valid(handle) || frequency_bin_index >= handle->frequency_bin_count ||
+	    handle->sweep_count < handle->window_length || spectrum == NULL)
+	{
+		return false;
+	}
+
+	// The oldest sweep of the window is at the position of the next sweep
+	uint32_t     index      = ((uint32_t)handle->frequency_bins[frequency_bin_index] * handle->position) % handle->window_length;
+	const float  scale      = 1.0f / handle->window_length;
+	const float  rotation_r = handle->cos_table[index] * scale;
+	const float  rotation_i = -handle->sin_table[index] * scale;
+	const size_t offset     = (size_t)frequency_bin_index * handle->data_length;
+
+	for (uint16_t point = 0; point < handle->data_length; point++)
+	{
+		float real = handle->sum_real[offset + point];
+		float imag = handle->sum_imag[offset + point];
+
+		spectrum[point] = (real * rotation_r - imag * rotation_i) + (real * rotation_i + imag * rotation_r) * I;
+	}
+
+	return true;
+}
+
+
+bool acc_sliding_dft_get_magnitude(acc_sliding_dft_handle_t handle, uint8_t frequency_bin_index, float *magnitude)
+{
+	if (!handle_valid(handle) || frequency_bin_index >= handle->frequency_bin_count ||
+	    handle->sweep_count < handle->window_length || magnitude == NULL)
+	{
+		return false;
+	}
+
+	const float  scale  = 1.0f / handle->window_length;
+	const size_t offset = (size_t)frequency_bin_index * handle->data_length;
+
+	for (uint16_t point = 0; point < handle->data_length; point++)
+	{
+		float real = handle->sum_real[offset + point];
+		float imag = handle->sum_imag[offset + point];
+
+		magnitude[point] = sqrtf(real * real + imag * imag) * scale;
+	}
+
+	return true;
+}
+
+
+void acc_sliding_dft_reset(acc_sliding_dft_handle_t handle)
+{
+	if (!handle_valid(handle))
+	{
+		return;
+	}
+
+	const size_t data_length = handle->data_length;
+	const size_t history     = (size_t)handle->window_length * data_length;
+	const size_t sums        = (size_t)handle->frequency_bin_count * data_length;
+
+	memset(handle->sum_real, 0, sizeof(float) * sums);
+	memset(handle->sum_imag, 0, sizeof(float) * sums);
+	memset(handle->difference_imag, 0, sizeof(float) * data_length);
+
+	if (handle->input == ACC_SLIDING_DFT_INPUT_IQ)
+	{
+		memset(handle->iq_history_real, 0, sizeof(float) * history);
+		memset(handle->iq_history_imag, 0, sizeof(float) * history);
+	}
+	else
+	{
+		memset(handle->envelope_history, 0, sizeof(uint16_t) * history);
+	}
+
+	handle->position          = 0;
+	handle->sweep_count       = 0;
+	handle->reanchor_position = 0;
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+bool handle_valid(acc_sliding_dft_handle_t handle)
+{
+	bool valid = true;
+
+	if ((handle == NULL) || (handle->magic_number != MAGIC_NUMBER))
+	{
+		ACC_LOG_ERROR("Invalid sliding DFT handle");
+		valid = false;
+	}
+
+	return valid;
+}
+
+
+bool input_valid(acc_sliding_dft_handle_t handle, acc_sliding_dft_input_t input)
+{
+	if (!handle_valid(handle))
+	{
+		return false;
+	}
+
+	if (handle->input != input)
+	{
+		ACC_LOG_ERROR("Sliding DFT created for another input");
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * @brief Add the differences of the latest sweep to the sums of all frequency bins
+ */
+void update(acc_sliding_dft_handle_t handle)
+{
+	const uint16_t        data_length     = handle->data_length;
+	const float *restrict difference_real = handle->difference_real;
+	const float *restrict difference_imag = handle->difference_imag;
+
+	for (uint8_t k = 0; k < handle->frequency_bin_count; k++)
+	{
+		uint32_t        index    = ((uint32_t)handle->frequency_bins[k] * handle->position) % handle->window_length;
+		const float     c        = handle->cos_table[index];
+		const float     s        = handle->sin_table[index];
+		float *restrict sum_real = handle->sum_real + (size_t)k * data_length;
+		float *restrict sum_imag = handle->sum_imag + (size_t)k * data_length;
+
+		if (handle->input == ACC_SLIDING_DFT_INPUT_ENVELOPE)
+		{
+			for (uint16_t point = 0; point < data_length; point++)
+			{
+				sum_real[point] += difference_real[point] * c;
+				sum_imag[point] += difference_real[point] * s;
+			}
+		}
+		else
+		{
+			for (uint16_t point = 0; point < data_length; point++)
+			{
+				sum_real[point] += difference_real[point] * c - difference_imag[point] * s;
+				sum_imag[point] += difference_real[point] * s + difference_imag[point] * c;
+			}
+		}
+	}
+}
+
+
+/**
+ * @brief Recompute the sums of one range bin from the window, in double precision
+ */
+void reanchor(acc_sliding_dft_handle_t handle, uint16_t point)
+{
+	const uint16_t data_length   = handle->data_length;
+	const uint16_t window_length = handle->window_length;
+
+	for (uint8_t k = 0; k < handle->frequency_bin_count; k++)
+	{
+		const uint16_t bin   = handle->frequency_bins[k];
+		uint16_t       index = 0;
+		double         real  = 0.0;
+		double         imag  = 0.0;
+
+		// The sweep at window row m was taken at a time that is m modulo N
+		for (uint16_t m = 0; m < window_length; m++)
+		{
+			double c = handle->cos_table[index];
+			double s = handle->sin_table[index];
+
+			if (handle->input == ACC_SLIDING_DFT_INPUT_ENVELOPE)
+			{
+				double x = handle->envelope_history[(size_t)m * data_length + point];
+
+				real += x * c;
+				imag += x * s;
+			}
+			else
+			{
+				double x_real = handle->iq_history_real[(size_t)m * data_length + point];
+				double x_imag = handle->iq_history_imag[(size_t)m * data_length + point];
+
+				real += x_real * c - x_imag * s;
+				imag += x_real * s + x_imag * c;
+			}
+
+			index += bin;
+
+			if (index >= window_length)
+			{
+				index -= window_length;
+			}
+		}
+
+		handle->sum_real[(size_t)k * data_length + point] = (float)real;
+		handle->sum_imag[(size_t)k * data_length + point] = (float)imag;
+	}
+}
+
+
+/**
+ * @brief Move to the next window row and re-anchor the next range bins
+ */
+void advance(acc_sliding_dft_handle_t handle)
+{
+	handle->position = (uint16_t)((handle->position + 1) % handle->window_length);
+
+	if (handle->sweep_count < handle->window_length)
+	{
+		handle->sweep_count++;
+	}
+
+	for (uint16_t i = 0; i < handle->reanchor_count; i++)
+	{
+		reanchor(handle, handle->reanchor_position);
+		handle->reanchor_position = (uint16_t)((handle->reanchor_position + 1) % handle->data_length);
+	}
+}
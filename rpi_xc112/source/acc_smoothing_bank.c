@@ -0,0 +1,335 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "acc_smoothing_bank.h"
+
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "smoothing_bank"
+
+#define MAGIC_NUMBER (0xACC05B4C)
+
+#define EXPONENTIAL_Q 16
+#define RECIPROCAL_Q  24
+
+
+typedef struct
+{
+	acc_smoothing_bank_callback_t callback;
+	void                          *client_data;
+	uint8_t                       level;
+} subscriber_t;
+
+
+typedef struct acc_smoothing_bank_handle
+{
+	uint32_t     magic_number;
+	uint16_t     data_length;
+	uint8_t      level_count;
+	uint8_t      exponential_count;
+	uint8_t      boxcar_count;
+	uint8_t      subscriber_count;
+	bool         started;
+	uint16_t     history_length;
+	uint16_t     history_head;
+	uint16_t     *output[ACC_SMOOTHING_BANK_LEVELS_MAX];
+	uint16_t     *exponential_output[ACC_SMOOTHING_BANK_LEVELS_MAX];
+	uint16_t     *boxcar_output[ACC_SMOOTHING_BANK_LEVELS_MAX];
+	int64_t      exponential_alpha[ACC_SMOOTHING_BANK_LEVELS_MAX];
+	uint16_t     boxcar_length[ACC_SMOOTHING_BANK_LEVELS_MAX];
+	uint64_t     boxcar_reciprocal[ACC_SMOOTHING_BANK_LEVELS_MAX];
+	subscriber_t subscribers[ACC_SMOOTHING_BANK_SUBSCRIBERS_MAX];
+	uint32_t     *exponential_state;
+	uint32_t     *boxcar_sum;
+	uint16_t     *history;
+} acc_smoothing_bank_handle_internal_t;
+
+
+static bool handle_valid(acc_smoothing_bank_handle_t handle);
+static void start(acc_smoothing_bank_handle_t handle, const uint16_t *data);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+acc_smoothing_bank_handle_t acc_smoothing_bank_create(uint16_t data_length, const acc_smoothing_bank_level_t *levels,
+                                                      uint8_t level_count)
+{
+	uint8_t  exponential_count = 0;
+	uint8_t  boxcar_count      = 0;
+	uint16_t history_length    = 0;
+
+	if (data_length == 0 || levels == NULL || level_count == 0 || level_count > ACC_SMOOTHING_BANK_LEVELS_MAX)
+	{
+		ACC_LOG_ERROR("Invalid smoothing bank parameters");
+		return NULL;
+	}
+
+	for (uint8_t level = 0; level < level_count; level++)
+	{
+		if (levels[level].type == ACC_SMOOTHING_BANK_EXPONENTIAL && levels[level].length > 0)
+		{
+			exponential_count++;
+		}
+		else if (levels[level].type == ACC_SMOOTHING_BANK_BOXCAR && levels[level].length > 0 &&
+		         levels[level].length <= ACC_SMOOTHING_BANK_BOXCAR_LENGTH_MAX)
+		{
+			boxcar_count++;
+
+			if (levels[level].length > history_length)
+			{
+				history_length = levels[level].length;
+			}
+		}
+		else
+		{
+			ACC_LOG_ERROR("Invalid smoothing level %u", (unsigned int)level);
+			return NULL;
+		}
+	}
+
+	size_t state_size = sizeof(uint32_t) * (exponential_count + boxcar_count) * data_length +
+	                    sizeof(uint16_t) * (level_count + history_length) * data_length;
+
+	acc_smoothing_bank_handle_internal_t *handle = acc_os_mem_alloc(sizeof(*handle) + state_size);
+
+	if (handle == NULL)
+	{
+		ACC_LOG_ERROR("Smoothing bank not possible to allocate");
+		return NULL;
+	}
+
+	memset(handle, 0, sizeof(*handle));
+
+	handle->magic_number      = MAGIC_NUMBER;
+	handle->data_length       = data_length;
+	handle->level_count       = level_count;
+	handle->exponential_count = exponential_count;
+	handle->boxcar_count      = boxcar_count;
+	handle->history_length    = history_length;
+	handle->exponential_state = (uint32_t *)(handle + 1);
+	handle->boxcar_sum        = handle->exponential_state + exponential_count * data_length;
+
+	uint16_t *output = (uint16_t *)(handle->boxcar_sum + boxcar_count * data_length);
+
+	handle->history = output + level_count * data_length;
+
+	exponential_count = 0;
+	boxcar_count      = 0;
+
+	for (uint8_t level = 0; level < level_count; level++)
+	{
+		handle->output[level] = output + level * data_length;
+
+		if (levels[level].type == ACC_SMOOTHING_BANK_EXPONENTIAL)
+		{
+			handle->exponential_alpha[exponential_count]  = ((1 << EXPONENTIAL_Q) + levels[level].length / 2) / levels[level].length;
+			handle->exponential_output[exponential_count] = handle->output[level];
+			exponential_count++;
+		}
+		else
+		{
+			handle->boxcar_length[boxcar_count]     = levels[level].length;
+			handle->boxcar_reciprocal[boxcar_count] = ((1ULL << RECIPROCAL_Q) + levels[level].length - 1) / levels[level].length;
+			handle->boxcar_output[boxcar_count]     = handle->output[level];
+			boxcar_count++;
+		}
+	}
+
+	return handle;
+}
+
+
+void acc_smoothing_bank_destroy(acc_smoothing_bank_handle_t *handle)
+{
+	if (handle != NULL && *handle != NULL)
+	{
+		if (handle_valid(*handle))
+		{
+			(*handle)->magic_number = 0;
+			acc_os_mem_free(*handle);
+			*handle = NULL;
+		}
+	}
+}
+
+
+bool acc_smoothing_bank_subscribe(acc_smoothing_bank_handle_t handle, uint8_t level, acc_smoothing_bank_callback_t callback,
+                                  void *client_data)
+{
+	if (!handle_valid(handle) || level >= handle->level_count || callback == NULL)
+	{
+		return false;
+	}
+
+	if (handle->subscriber_count >= ACC_SMOOTHING_BANK_SUBSCRIBERS_MAX)
+	{
+		ACC_LOG_ERROR("Too many smoothing bank subscribers");
+		return false;
+	}
+
+	subscriber_t *subscriber = &handle->subscribers[handle->subscriber_count++];
+
+	subscriber->callback    = callback;
+	subscriber->client_data = client_data;
+	subscriber->level       = level;
+
+	return true;
+}
+
+
+bool acc_smoothing_bank_process(acc_smoothing_bank_handle_t handle, const uint16_t *data)
+{
+	if (!handle_valid(handle) || data == NULL)
+	{
+		return false;
+	}
+
+	if (!handle->started)
+	{
+		start(handle, data);
+	}
+	else
+	{
+		const uint16_t data_length       = handle->data_length;
+		const uint8_t  exponential_count = handle->exponential_count;
+		const uint8_t  boxcar_count      = handle->boxcar_count;
+		uint32_t       *state            = handle->exponential_state;
+		uint32_t       *sum              = handle->boxcar_sum;
+		uint16_t       *history_head     = handle->history + handle->history_head * data_length;
+		const uint16_t *leaving[ACC_SMOOTHING_BANK_LEVELS_MAX];
+
+		for (uint8_t b = 0; b < boxcar_count; b++)
+		{
+			uint16_t row = (handle->history_head + handle->history_length - handle->boxcar_length[b]) % handle->history_length;
+
+			leaving[b] = handle->history + row * data_length;
+		}
+
+		// One pass over the points, all levels of a point are updated together
+		for (uint16_t point = 0; point < data_length; point++)
+		{
+			uint32_t value = data[point];
+
+			for (uint8_t e = 0; e < exponential_count; e++)
+			{
+				int64_t difference = ((int64_t)value << EXPONENTIAL_Q) - state[e];
+
+				state[e] += (int32_t)((difference * handle->exponential_alpha[e]) >> EXPONENTIAL_Q);
+
+				handle->exponential_output[e][point] = (state[e] + (1 << (EXPONENTIAL_Q - 1))) >> EXPONENTIAL_Q;
+			}
+
+			for (uint8_t b = 0; b < boxcar_count; b++)
+			{
+				sum[b] += value - leaving[b][point];
+
+				handle->boxcar_output[b][point] = (uint16_t)((sum[b] * handle->boxcar_reciprocal[b] +
+				                                              (1ULL << (RECIPROCAL_Q - 1))) >> RECIPROCAL_Q);
+			}
+
+			if (boxcar_count > 0)
+			{
+				history_head[point] = value;
+			}
+
+			state += exponential_count;
+			sum   += boxcar_count;
+		}
+
+		if (boxcar_count > 0)
+		{
+			handle->history_head = (handle->history_head + 1) % handle->history_length;
+		}
+	}
+
+	for (uint8_t i = 0; i < handle->subscriber_count; i++)
+	{
+		const subscriber_t *subscriber = &handle->subscribers[i];
+
+		subscriber->callback(handle->output[subscriber->level], handle->data_length, subscriber->client_data);
+	}
+
+	return true;
+}
+
+
+const uint16_t *acc_smoothing_bank_get(acc_smoothing_bank_handle_t handle, uint8_t level)
+{
+	if (!handle_valid(handle) || level >= handle->level_count)
+	{
+		return NULL;
+	}
+
+	return handle->output[level];
+}
+
+
+void acc_smoothing_bank_reset(acc_smoothing_bank_handle_t handle)
+{
+	if (handle_valid(handle))
+	{
+		handle->started = false;
+	}
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+bool handle_valid(acc_smoothing_bank_handle_t handle)
+{
+	bool valid = true;
+
+	if ((handle == NULL) || (handle->magic_number != MAGIC_NUMBER))
+	{
+		ACC_LOG_ERROR("Invalid smoothing bank handle");
+		valid = false;
+	}
+
+	return valid;
+}
+
+
+/**
+ * @brief Start all smoothers as if they had seen the sweep forever
+ */
+void start(acc_smoothing_bank_handle_t handle, const uint16_t *data)
+{
+	const uint16_t data_length = handle->data_length;
+	uint32_t       *state      = handle->exponential_state;
+	uint32_t       *sum        = handle->boxcar_sum;
+
+	for (uint16_t point = 0; point < data_length; point++)
+	{
+		for (uint8_t e = 0; e < handle->exponential_count; e++)
+		{
+			*state++ = (uint32_t)data[point] << EXPONENTIAL_Q;
+		}
+
+		for (uint8_t b = 0; b < handle->boxcar_count; b++)
+		{
+			*sum++ = (uint32_t)data[point] * handle->boxcar_length[b];
+		}
+	}
+
+	for (uint16_t row = 0; row < handle->history_length; row++)
+	{
+		memcpy(handle->history + row * data_length, data, sizeof(*data) * data_length);
+	}
+
+	for (uint8_t level = 0; level < handle->level_count; level++)
+	{
+		memcpy(handle->output[level], data, sizeof(*data) * data_length);
+	}
+
+	handle->history_head = 0;
+	handle->started      = true;
+}
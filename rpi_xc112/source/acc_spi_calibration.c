@@ -0,0 +1,260 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "acc_spi_calibration.h"
+
+#include "acc_board.h"
+#include "acc_definitions.h"
+#include "acc_device_os.h"
+#include "acc_log.h"
+#include "acc_rss_assembly_test.h"
+#include "acc_service.h"
+#include "acc_service_envelope.h"
+
+
+#define MODULE "spi_calibration"
+
+#define SWEEP_START_M  0.2f
+#define SWEEP_LENGTH_M 1.0f
+
+
+static const uint32_t default_speeds[] = {
+	5000000, 8000000, 10000000, 12000000, 15000000, 20000000, 25000000, 31250000, 41666666, 50000000
+};
+
+
+static bool communication_test(acc_sensor_id_t sensor);
+static bool measure_sweep(acc_sensor_id_t sensor, uint16_t sweep_count, acc_spi_calibration_step_t *step);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+void acc_spi_calibration_configuration_default(acc_spi_calibration_configuration_t *configuration)
+{
+	configuration->speeds       = default_speeds;
+	configuration->speed_count  = sizeof(default_speeds) / sizeof(default_speeds[0]);
+	configuration->repetitions  = 5;
+	configuration->sweep_count  = 10;
+	configuration->margin_steps = 1;
+}
+
+
+bool acc_spi_calibration_run(acc_sensor_id_t sensor, const acc_spi_calibration_configuration_t *configuration,
+                             acc_spi_calibration_result_t *result)
+{
+	uint32_t previous_speed = acc_board_get_sensor_spi_speed(sensor);
+
+	memset(result, 0, sizeof(*result));
+
+	if (previous_speed == 0 || configuration->speed_count == 0 ||
+	    configuration->speed_count > ACC_SPI_CALIBRATION_STEP_COUNT_MAX)
+	{
+		ACC_LOG_ERROR("Invalid sensor or speed count");
+		return false;
+	}
+
+	uint16_t passed_count = 0;
+
+	for (uint16_t i = 0; i < configuration->speed_count; i++)
+	{
+		acc_spi_calibration_step_t *step = &result->steps[i];
+
+		if (i > 0 && configuration->speeds[i] <= configuration->speeds[i - 1])
+		{
+			ACC_LOG_ERROR("Speeds must be increasing");
+			break;
+		}
+
+		step->speed = configuration->speeds[i];
+		result->step_count++;
+
+		if (!acc_board_set_sensor_spi_speed(sensor, step->speed))
+		{
+			break;
+		}
+
+		step->passed = true;
+
+		acc_board_reset_sensor_transfer_statistics(sensor);
+
+		for (uint16_t repetition = 0; repetition < configuration->repetitions && step->passed; repetition++)
+		{
+			step->passed = communication_test(sensor);
+		}
+
+		if (step->passed)
+		{
+			acc_board_transfer_statistics_t statistics;
+
+			// A failed transfer has made the board fall back to a lower speed
+			acc_board_get_sensor_transfer_statistics(sensor, &statistics);
+			step->passed = statistics.failure_count == 0;
+		}
+
+		if (step->passed && configuration->sweep_count > 0)
+		{
+			step->passed = measure_sweep(sensor, configuration->sweep_count, step);
+		}
+
+		ACC_LOG_INFO("%u Hz: %s, %u us per sweep", (unsigned int)step->speed, step->passed ? "passed" : "failed",
+		             (unsigned int)step->sweep_transfer_time_us);
+
+		if (!step->passed)
+		{
+			// Faster speeds are not reliable either
+			break;
+		}
+
+		passed_count++;
+	}
+
+	if (passed_count == 0)
+	{
+		acc_board_set_sensor_spi_speed(sensor, previous_speed);
+		return false;
+	}
+
+	uint16_t selected = (passed_count > configuration->margin_steps) ? passed_count - 1 - configuration->margin_steps : 0;
+
+	result->speed = result->steps[selected].speed;
+
+	return acc_board_set_sensor_spi_speed(sensor, result->speed);
+}
+
+
+bool acc_spi_calibration_check(acc_sensor_id_t sensor, uint16_t repetitions)
+{
+	uint32_t initial_speed = acc_board_get_sensor_spi_speed(sensor);
+
+	if (initial_speed == 0)
+	{
+		ACC_LOG_ERROR("Invalid sensor");
+		return false;
+	}
+
+	// The board may already have lowered the speed after a failed transfer
+	acc_board_reset_sensor_transfer_statistics(sensor);
+
+	bool passed = false;
+
+	do
+	{
+		acc_board_transfer_statistics_t statistics;
+
+		passed = true;
+
+		for (uint16_t repetition = 0; repetition < repetitions && passed; repetition++)
+		{
+			passed = communication_test(sensor);
+		}
+
+		acc_board_get_sensor_transfer_statistics(sensor, &statistics);
+		acc_board_reset_sensor_transfer_statistics(sensor);
+
+		passed = passed && statistics.failure_count == 0;
+	} while (!passed && acc_board_sensor_spi_speed_fallback(sensor));
+
+	uint32_t speed = acc_board_get_sensor_spi_speed(sensor);
+
+	if (passed && speed != initial_speed && !acc_board_store_sensor_spi_speed(sensor))
+	{
+		ACC_LOG_WARNING("SPI speed %u Hz of sensor %u not persisted", (unsigned int)speed, (unsigned int)sensor);
+	}
+
+	return passed;
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+bool communication_test(acc_sensor_id_t sensor)
+{
+	acc_rss_assembly_test_result_t test_results[ACC_RSS_ASSEMBLY_TEST_MAX_NUMBER_OF_TESTS];
+	uint16_t                       nr_of_test_results = ACC_RSS_ASSEMBLY_TEST_MAX_NUMBER_OF_TESTS;
+
+	acc_rss_assembly_test_configuration_t configuration = acc_rss_assembly_test_configuration_create();
+
+	if (configuration == NULL)
+	{
+		return false;
+	}
+
+	acc_rss_assembly_test_configuration_sensor_set(configuration, sensor);
+	acc_rss_assembly_test_configuration_communication_interrupt_test_disable(configuration);
+	acc_rss_assembly_test_configuration_communication_hibernate_test_disable(configuration);
+	acc_rss_assembly_test_configuration_supply_test_disable(configuration);
+	acc_rss_assembly_test_configuration_clock_test_disable(configuration);
+
+	bool passed = acc_rss_assembly_test(configuration, test_results, &nr_of_test_results);
+
+	for (uint16_t i = 0; passed && i < nr_of_test_results; i++)
+	{
+		passed = test_results[i].test_passed;
+	}
+
+	acc_rss_assembly_test_configuration_destroy(&configuration);
+
+	return passed;
+}
+
+
+bool measure_sweep(acc_sensor_id_t sensor, uint16_t sweep_count, acc_spi_calibration_step_t *step)
+{
+	acc_service_configuration_t configuration = acc_service_envelope_configuration_create();
+
+	if (configuration == NULL)
+	{
+		return false;
+	}
+
+	acc_service_sensor_set(configuration, sensor);
+	acc_service_requested_start_set(configuration, SWEEP_START_M);
+	acc_service_requested_length_set(configuration, SWEEP_LENGTH_M);
+
+	acc_service_handle_t handle = acc_service_create(configuration);
+
+	acc_service_envelope_configuration_destroy(&configuration);
+
+	if (handle == NULL)
+	{
+		return false;
+	}
+
+	acc_service_envelope_metadata_t metadata;
+
+	acc_service_envelope_get_metadata(handle, &metadata);
+
+	uint16_t *data   = acc_os_mem_alloc(metadata.data_length * sizeof(*data));
+	bool     success = data != NULL && acc_service_activate(handle);
+
+	if (success)
+	{
+		acc_board_transfer_statistics_t statistics;
+
+		acc_board_reset_sensor_transfer_statistics(sensor);
+
+		for (uint16_t sweep = 0; success && sweep < sweep_count; sweep++)
+		{
+			success = acc_service_envelope_get_next(handle, data, metadata.data_length, NULL);
+		}
+
+		acc_board_get_sensor_transfer_statistics(sensor, &statistics);
+
+		success = acc_service_deactivate(handle) && success && statistics.failure_count == 0;
+
+		step->sweep_transfer_time_us = (uint32_t)(statistics.time_us / sweep_count);
+		step->sweep_transfer_bytes   = (uint32_t)(statistics.byte_count / sweep_count);
+	}
+
+	acc_os_mem_free(data);
+	acc_service_destroy(&handle);
+
+	return success;
+}
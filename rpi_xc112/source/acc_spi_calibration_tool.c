@@ -0,0 +1,224 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_board.h"
+#include "acc_driver_hal.h"
+#include "acc_hal_definitions.h"
+#include "acc_rss.h"
+#include "acc_spi_calibration.h"
+#include "acc_version.h"
+
+
+/**
+ * @brief SPI speed calibration of the sensors on the board
+ *
+ * Probes increasing SPI speeds on each given sensor, prints the result of each speed with
+ * the transfer time of one sweep, and persists the selected speeds in the key-value store on
+ * the board EEPROM unless told not to. Persisted speeds are applied when the board is
+ * initialized by any application.
+ */
+
+
+#define MAX_SENSOR_COUNT 4
+
+
+typedef struct
+{
+	acc_sensor_id_t sensors[MAX_SENSOR_COUNT];
+	uint16_t        sensor_count;
+	uint16_t        margin_steps;
+	uint16_t        repetitions;
+	uint16_t        sweep_count;
+	bool            store;
+} input_t;
+
+
+static bool parse_options(int argc, char *argv[], input_t *input);
+
+
+static bool calibrate(acc_sensor_id_t sensor, const input_t *input);
+
+
+int main(int argc, char *argv[])
+{
+	acc_spi_calibration_configuration_t configuration;
+	input_t                             input;
+
+	acc_spi_calibration_configuration_default(&configuration);
+
+	memset(&input, 0, sizeof(input));
+	input.margin_steps = configuration.margin_steps;
+	input.repetitions  = configuration.repetitions;
+	input.sweep_count  = configuration.sweep_count;
+	input.store        = true;
+
+	if (!parse_options(argc, argv, &input))
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!acc_driver_hal_init())
+	{
+		return EXIT_FAILURE;
+	}
+
+	printf("Acconeer software version %s\n", acc_version_get());
+
+	acc_hal_t hal = acc_driver_hal_get_implementation();
+
+	if (!acc_rss_activate(&hal))
+	{
+		fprintf(stderr, "acc_rss_activate() failed\n");
+		return EXIT_FAILURE;
+	}
+
+	bool status = true;
+
+	for (uint16_t i = 0; i < input.sensor_count; i++)
+	{
+		status = calibrate(input.sensors[i], &input) && status;
+	}
+
+	acc_rss_deactivate();
+
+	return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+bool calibrate(acc_sensor_id_t sensor, const input_t *input)
+{
+	acc_spi_calibration_configuration_t configuration;
+	acc_spi_calibration_result_t        result;
+
+	acc_spi_calibration_configuration_default(&configuration);
+	configuration.margin_steps = input->margin_steps;
+	configuration.repetitions  = input->repetitions;
+	configuration.sweep_count  = input->sweep_count;
+
+	printf("Sensor %" PRIsensor_id ", currently %u Hz\n", sensor, (unsigned int)acc_board_get_sensor_spi_speed(sensor));
+
+	bool status = acc_spi_calibration_run(sensor, &configuration, &result);
+
+	for (uint16_t i = 0; i < result.step_count; i++)
+	{
+		const acc_spi_calibration_step_t *step = &result.steps[i];
+
+		printf("  %9u Hz  %s", (unsigned int)step->speed, step->passed ? "pass" : "fail");
+
+		if (step->passed && step->sweep_transfer_time_us > 0)
+		{
+			printf("  %6u us/sweep  %6u bytes/sweep", (unsigned int)step->sweep_transfer_time_us,
+			       (unsigned int)step->sweep_transfer_bytes);
+		}
+
+		printf("\n");
+	}
+
+	if (!status)
+	{
+		fprintf(stderr, "Sensor %" PRIsensor_id ": no speed passed\n", sensor);
+		return false;
+	}
+
+	printf("Sensor %" PRIsensor_id ": selected %u Hz\n", sensor, (unsigned int)result.speed);
+
+	if (input->store && !acc_board_store_sensor_spi_speed(sensor))
+	{
+		fprintf(stderr, "Sensor %" PRIsensor_id ": failed to persist the speed\n", sensor);
+		return false;
+	}
+
+	return true;
+}
+
+
+static void print_usage(void)
+{
+	printf("Usage: acc_spi_calibration_tool [OPTION]...\n\n");
+	printf("Selects and persists the fastest reliable SPI speed of sensors\n\n");
+	printf("-h, --help                this help\n");
+	printf("-s, --sensor-id           sensor to calibrate, may be repeated, default 1\n");
+	printf("-m, --margin              number of speed steps below the fastest passed speed, default 1\n");
+	printf("-r, --repetitions         communication test runs at each speed, default 5\n");
+	printf("-n, --sweep-count         sweeps to measure transfer time over, default 10\n");
+	printf("-d, --dry-run             do not persist the selected speeds\n");
+}
+
+
+bool parse_options(int argc, char *argv[], input_t *input)
+{
+	static struct option long_options[] =
+	{
+		{"sensor-id",   required_argument,  0, 's'},
+		{"margin",      required_argument,  0, 'm'},
+		{"repetitions", required_argument,  0, 'r'},
+		{"sweep-count", required_argument,  0, 'n'},
+		{"dry-run",     no_argument,        0, 'd'},
+		{"help",        no_argument,        0, 'h'},
+		{NULL,          0,                  NULL, 0}
+	};
+
+	int16_t character_code;
+	int32_t option_index = 0;
+
+	while ((character_code = getopt_long(argc, argv, "s:m:r:n:dh?", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 's':
+			{
+				int sensor = atoi(optarg);
+
+				if (sensor < 1 || sensor > MAX_SENSOR_COUNT || input->sensor_count >= MAX_SENSOR_COUNT)
+				{
+					fprintf(stderr, "Invalid sensor %s\n", optarg);
+					return false;
+				}
+
+				input->sensors[input->sensor_count++] = sensor;
+				break;
+			}
+			case 'm':
+			{
+				input->margin_steps = atoi(optarg);
+				break;
+			}
+			case 'r':
+			{
+				input->repetitions = atoi(optarg);
+				break;
+			}
+			case 'n':
+			{
+				input->sweep_count = atoi(optarg);
+				break;
+			}
+			case 'd':
+			{
+				input->store = false;
+				break;
+			}
+			case 'h':
+			case '?':
+			default:
+			{
+				print_usage();
+				return false;
+			}
+		}
+	}
+
+	if (input->sensor_count == 0)
+	{
+		input->sensors[input->sensor_count++] = 1;
+	}
+
+	return true;
+}
@@ -0,0 +1,623 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "acc_stitch_correction.h"
+
+#include "acc_definitions.h"
+#include "acc_device_memory_kv.h"
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "stitch_correction"
+
+#define MAGIC_NUMBER      (0xACC05717)
+#define SERIALIZED_MAGIC  (0x31435453)
+#define GAIN_Q            10
+#define GAIN_MIN          (1.0f / 32.0f)
+#define GAIN_MAX          30.0f
+#define OFFSET_MAX        65535.0f
+#define SIDE_POINTS_MAX   16
+#define HEADER_SIZE       12
+#define SEAM_SIZE         10
+#define EPSILON           1e-6
+#define KV_KEY_COUNT      256
+#define KV_PROBE_COUNT    8
+
+
+typedef struct acc_stitch_correction_handle
+{
+	uint32_t                     magic_number;
+	uint32_t                     configuration_id;
+	uint16_t                     data_length;
+	uint16_t                     stitch_count;
+	bool                         calibration_iq;
+	uint32_t                     calibration_count;
+	double                       *sum;
+	double                       *sum_squares;
+	int32_t                      *gain_q;
+	int32_t                      *offset_q;
+	float                        *gain;
+	acc_stitch_correction_seam_t seams[ACC_STITCH_CORRECTION_STITCH_COUNT_MAX];
+} acc_stitch_correction_handle_internal_t;
+
+
+static bool handle_valid(acc_stitch_correction_handle_t handle);
+static void build_tables(acc_stitch_correction_handle_t handle);
+static void find_seam(acc_stitch_correction_handle_t handle, uint16_t seam, const double *mean, const double *deviation);
+static bool find_kv_key(acc_stitch_correction_handle_t handle, uint16_t *key);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+uint32_t acc_stitch_correction_configuration_id(float start_m, float length_m, uint16_t data_length,
+                                                uint16_t stitch_count, uint32_t profile)
+{
+	uint8_t  bytes[sizeof(start_m) + sizeof(length_m) + sizeof(data_length) + sizeof(stitch_count) + sizeof(profile)];
+	uint8_t  *p   = bytes;
+	uint32_t hash = 2166136261UL;
+
+	memcpy(p, &start_m, sizeof(start_m));
+	p += sizeof(start_m);
+	memcpy(p, &length_m, sizeof(length_m));
+	p += sizeof(length_m);
+	memcpy(p, &data_length, sizeof(data_length));
+	p += sizeof(data_length);
+	memcpy(p, &stitch_count, sizeof(stitch_count));
+	p += sizeof(stitch_count);
+	memcpy(p, &profile, sizeof(profile));
+
+	for (size_t i = 0; i < sizeof(bytes); i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619UL;
+	}
+
+	return hash;
+}
+
+
+acc_stitch_correction_handle_t acc_stitch_correction_create(uint16_t data_length, uint16_t stitch_count,
+                                                            uint32_t configuration_id)
+{
+	if (data_length == 0 || stitch_count > ACC_STITCH_CORRECTION_STITCH_COUNT_MAX || stitch_count >= data_length)
+	{
+		ACC_LOG_ERROR("Invalid stitch correction parameters");
+		return NULL;
+	}
+
+	size_t                                  table_size = (2 * sizeof(double) + 2 * sizeof(int32_t) + sizeof(float)) * data_length;
+	acc_stitch_correction_handle_internal_t *handle    = acc_os_mem_alloc(sizeof(*handle) + table_size);
+
+	if (handle == NULL)
+	{
+		ACC_LOG_ERROR("Stitch correction not possible to allocate");
+		return NULL;
+	}
+
+	handle->magic_number      = MAGIC_NUMBER;
+	handle->configuration_id  = configuration_id;
+	handle->data_length       = data_length;
+	handle->stitch_count      = stitch_count;
+	handle->calibration_iq    = false;
+	handle->calibration_count = 0;
+	handle->sum               = (double *)(handle + 1);
+	handle->sum_squares       = handle->sum + data_length;
+	handle->gain_q            = (int32_t *)(handle->sum_squares + data_length);
+	handle->offset_q          = handle->gain_q + data_length;
+	handle->gain              = (float *)(handle->offset_q + data_length);
+
+	for (uint16_t seam = 0; seam < stitch_count; seam++)
+	{
+		handle->seams[seam].index  = (uint16_t)(((uint32_t)(seam + 1) * data_length) / (stitch_count + 1));
+		handle->seams[seam].gain   = 1.0f;
+		handle->seams[seam].offset = 0.0f;
+	}
+
+	build_tables(handle);
+
+	return handle;
+}
+
+
+void acc_stitch_correction_destroy(acc_stitch_correction_handle_t *handle)
+{
+	if (handle != NULL && *handle != NULL)
+	{
+		if (handle_valid(*handle))
+		{
+			(*handle)->magic_number = 0;
+			acc_os_mem_free(*handle);
+			*handle = NULL;
+		}
+	}
+}
+
+
+bool acc_stitch_correction_calibration_add_envelope(acc_stitch_correction_handle_t handle, const uint16_t *envelope_data)
+{
+	if (!handle_valid(handle) || envelope_data == NULL)
+	{
+		return false;
+	}
+
+	if (handle->calibration_count == 0)
+	{
+		memset(handle->sum, 0, 2 * sizeof(double) * handle->data_length);
+	}
+
+	for (uint16_t i = 0; i < handle->data_length; i++)
+	{
+		double value = envelope_data[i];
+
+		handle->sum[i]         += value;
+		handle->sum_squares[i] += value * value;
+	}
+
+	handle->calibration_iq = false;
+	handle->calibration_count++;
+
+	return true;
+}
+
+
+bool acc_stitch_correction_calibration_add_iq(acc_stitch_correction_handle_t handle, const float complex *iq_data)
+{
+	if (!handle_valid(handle) || iq_data == NULL)
+	{
+		return false;
+	}
+
+	if (handle->calibration_count == 0)
+	{
+		memset(handle->sum, 0, 2 * sizeof(double) * handle->data_length);
+	}
+
+	for (uint16_t i = 0; i < handle->data_length; i++)
+	{
+		double value = (double)cabsf(iq_data[i]);
+
+		handle->sum[i]         += value;
+		handle->sum_squares[i] += value * value;
+	}
+
+	handle->calibration_iq = true;
+	handle->calibration_count++;
+
+	return true;
+}
+
+
+bool acc_stitch_correction_calibration_finish(acc_stitch_correction_handle_t handle)
+{
+	if (!handle_valid(handle))
+	{
+		return false;
+	}
+
+	if (handle->calibration_count < 2)
+	{
+		ACC_LOG_ERROR("Too few calibration sweeps");
+		return false;
+	}
+
+	// Mean and deviation over time of each point, computed in place of the sums
+	double *mean      = handle->sum;
+	double *deviation = handle->sum_squares;
+
+	for (uint16_t i = 0; i < handle->data_length; i++)
+	{
+		double m        = handle->sum[i] / handle->calibration_count;
+		double variance = handle->sum_squares[i] / handle->calibration_count - m * m;
+
+		mean[i]      = m;
+		deviation[i] = (variance > 0.0) ? sqrt(variance) : 0.0;
+	}
+
+	for (uint16_t seam = 0; seam < handle->stitch_count; seam++)
+	{
+		find_seam(handle, seam, mean, deviation);
+	}
+
+	handle->calibration_count = 0;
+
+	build_tables(handle);
+
+	return true;
+}
+
+
+void acc_stitch_correction_seams_get(acc_stitch_correction_handle_t handle, acc_stitch_correction_seam_t *seams)
+{
+	if (handle_valid(handle) && seams != NULL)
+	{
+		memcpy(seams, handle->seams, sizeof(*seams) * handle->stitch_count);
+	}
+}
+
+
+bool acc_stitch_correction_seams_set(acc_stitch_correction_handle_t handle, const acc_stitch_correction_seam_t *seams)
+{
+	if (!handle_valid(handle) || seams == NULL)
+	{
+		return false;
+	}
+
+	uint16_t previous = 0;
+
+	for (uint16_t seam = 0; seam < handle->stitch_count; seam++)
+	{
+		if (seams[seam].index <= previous || seams[seam].index >= handle->data_length ||
+		    !(seams[seam].gain >= GAIN_MIN && seams[seam].gain <= GAIN_MAX))
+		{
+			ACC_LOG_ERROR("Invalid stitch correction seam");
+			return false;
+		}
+
+		previous = seams[seam].index;
+	}
+
+	memcpy(handle->seams, seams, sizeof(*seams) * handle->stitch_count);
+	build_tables(handle);
+
+	return true;
+}
+
+
+void acc_stitch_correction_apply_envelope(acc_stitch_correction_handle_t handle, const uint16_t *input, uint16_t *output)
+{
+	if (!handle_valid(handle) || input == NULL || output == NULL)
+	{
+		return;
+	}
+
+	const int32_t *gain_q   = handle->gain_q;
+	const int32_t *offset_q = handle->offset_q;
+
+	for (uint16_t i = 0; i < handle->data_length; i++)
+	{
+		int32_t value = (int32_t)input[i] * gain_q[i] + offset_q[i];
+
+		value = (value > 0) ? (value + (1 << (GAIN_Q - 1))) >> GAIN_Q : 0;
+
+		output[i] = (value > UINT16_MAX) ? UINT16_MAX : (uint16_t)value;
+	}
+}
+
+
+void acc_stitch_correction_apply_iq(acc_stitch_correction_handle_t handle, const float complex *input,
+                                    float complex *output)
+{
+	if (!handle_valid(handle) || input == NULL || output == NULL)
+	{
+		return;
+	}
+
+	const float *gain = handle->gain;
+
+	for (uint16_t i = 0; i < handle->data_length; i++)
+	{
+		output[i] = input[i] * gain[i];
+	}
+}
+
+
+void acc_stitch_correction_apply_iq_int16(acc_stitch_correction_handle_t handle, const acc_int16_complex_t *input,
+                                          acc_int16_complex_t *output)
+{
+	if (!handle_valid(handle) || input == NULL || output == NULL)
+	{
+		return;
+	}
+
+	const int32_t *gain_q = handle->gain_q;
+
+	for (uint16_t i = 0; i < handle->data_length; i++)
+	{
+		int32_t real = (int32_t)input[i].real * gain_q[i] / (1 << GAIN_Q);
+		int32_t imag = (int32_t)input[i].imag * gain_q[i] / (1 << GAIN_Q);
+
+		output[i].real = (real > INT16_MAX) ? INT16_MAX : (real < INT16_MIN) ? INT16_MIN : (int16_t)real;
+		output[i].imag = (imag > INT16_MAX) ? INT16_MAX : (imag < INT16_MIN) ? INT16_MIN : (int16_t)imag;
+	}
+}
+
+
+size_t acc_stitch_correction_serialized_size(uint16_t stitch_count)
+{
+	return HEADER_SIZE + SEAM_SIZE * (size_t)stitch_count;
+}
+
+
+bool acc_stitch_correction_serialize(acc_stitch_correction_handle_t handle, void *buffer, size_t size)
+{
+	if (!handle_valid(handle) || buffer == NULL || size < acc_stitch_correction_serialized_size(handle->stitch_count))
+	{
+		return false;
+	}
+
+	uint8_t  *p     = buffer;
+	uint32_t magic  = SERIALIZED_MAGIC;
+
+	memcpy(p, &magic, 4);
+	memcpy(p + 4, &handle->configuration_id, 4);
+	memcpy(p + 8, &handle->data_length, 2);
+	memcpy(p + 10, &handle->stitch_count, 2);
+	p += HEADER_SIZE;
+
+	for (uint16_t seam = 0; seam < handle->stitch_count; seam++)
+	{
+		memcpy(p, &handle->seams[seam].index, 2);
+		memcpy(p + 2, &handle->seams[seam].gain, 4);
+		memcpy(p + 6, &handle->seams[seam].offset, 4);
+		p += SEAM_SIZE;
+	}
+
+	return true;
+}
+
+
+bool acc_stitch_correction_deserialize(acc_stitch_correction_handle_t handle, const void *buffer, size_t size)
+{
+	if (!handle_valid(handle) || buffer == NULL || size != acc_stitch_correction_serialized_size(handle->stitch_count))
+	{
+		return false;
+	}
+
+	const uint8_t                *p = buffer;
+	uint32_t                     magic;
+	uint32_t                     configuration_id;
+	uint16_t                     data_length;
+	uint16_t                     stitch_count;
+	acc_stitch_correction_seam_t seams[ACC_STITCH_CORRECTION_STITCH_COUNT_MAX];
+
+	memcpy(&magic, p, 4);
+	memcpy(&configuration_id, p + 4, 4);
+	memcpy(&data_length, p + 8, 2);
+	memcpy(&stitch_count, p + 10, 2);
+	p += HEADER_SIZE;
+
+	if (magic != SERIALIZED_MAGIC || configuration_id != handle->configuration_id ||
+	    data_length != handle->data_length || stitch_count != handle->stitch_count)
+	{
+		return false;
+	}
+
+	for (uint16_t seam = 0; seam < stitch_count; seam++)
+	{
+		memcpy(&seams[seam].index, p, 2);
+		memcpy(&seams[seam].gain, p + 2, 4);
+		memcpy(&seams[seam].offset, p + 6, 4);
+		p += SEAM_SIZE;
+	}
+
+	return acc_stitch_correction_seams_set(handle, seams);
+}
+
+
+bool acc_stitch_correction_store(acc_stitch_correction_handle_t handle)
+{
+	uint8_t  buffer[HEADER_SIZE + SEAM_SIZE * ACC_STITCH_CORRECTION_STITCH_COUNT_MAX];
+	uint16_t key;
+
+	if (!acc_stitch_correction_serialize(handle, buffer, sizeof(buffer)))
+	{
+		return false;
+	}
+
+	find_kv_key(handle, &key);
+
+	return acc_device_memory_kv_store(key, buffer, acc_stitch_correction_serialized_size(handle->stitch_count));
+}
+
+
+bool acc_stitch_correction_restore(acc_stitch_correction_handle_t handle)
+{
+	uint8_t  buffer[HEADER_SIZE + SEAM_SIZE * ACC_STITCH_CORRECTION_STITCH_COUNT_MAX];
+	uint16_t key;
+	uint16_t length;
+
+	if (!handle_valid(handle) || !find_kv_key(handle, &key))
+	{
+		return false;
+	}
+
+	if (!acc_device_memory_kv_load(key, buffer, sizeof(buffer), &length))
+	{
+		return false;
+	}
+
+	return acc_stitch_correction_deserialize(handle, buffer, length);
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+bool handle_valid(acc_stitch_correction_handle_t handle)
+{
+	bool valid = true;
+
+	if ((handle == NULL) || (handle->magic_number != MAGIC_NUMBER))
+	{
+		ACC_LOG_ERROR("Invalid stitch correction handle");
+		valid = false;
+	}
+
+	return valid;
+}
+
+
+/**
+ * @brief Locate a seam and learn its gain and offset
+ *
+ * The seam is placed at the largest step of the mean near its nominal position. The mean and
+ * deviation of the points on each side are then matched.
+ */
+void find_seam(acc_stitch_correction_handle_t handle, uint16_t seam, const double *mean, const double *deviation)
+{
+	const uint16_t length   = handle->data_length;
+	const uint16_t segment  = length / (handle->stitch_count + 1);
+	const uint16_t nominal  = (uint16_t)(((uint32_t)(seam + 1) * length) / (handle->stitch_count + 1));
+	const uint16_t radius   = segment / 8;
+	uint16_t       side     = segment / 4;
+	uint16_t       index    = nominal;
+	double         max_step = -1.0;
+
+	if (side > SIDE_POINTS_MAX)
+	{
+		side = SIDE_POINTS_MAX;
+	}
+
+	if (side == 0)
+	{
+		side = 1;
+	}
+
+	for (uint16_t i = (nominal > radius + 1) ? nominal - radius : 1; i <= nominal + radius && i < length; i++)
+	{
+		double step = fabs(mean[i] - mean[i - 1]);
+
+		if (step > max_step)
+		{
+			max_step = step;
+			index    = i;
+		}
+	}
+
+	double   mean_before      = 0.0;
+	double   mean_after       = 0.0;
+	double   deviation_before = 0.0;
+	double   deviation_after  = 0.0;
+	uint16_t count_before     = 0;
+	uint16_t count_after      = 0;
+
+	for (uint16_t i = 1; i <= side && i <= index; i++)
+	{
+		mean_before      += mean[index - i];
+		deviation_before += deviation[index - i];
+		count_before++;
+	}
+
+	for (uint16_t i = 0; i < side && index + i < length; i++)
+	{
+		mean_after      += mean[index + i];
+		deviation_after += deviation[index + i];
+		count_after++;
+	}
+
+	mean_before      /= count_before;
+	deviation_before /= count_before;
+	mean_after       /= count_after;
+	deviation_after  /= count_after;
+
+	double gain   = 1.0;
+	double offset = 0.0;
+
+	if (!handle->calibration_iq && deviation_before > EPSILON && deviation_after > EPSILON)
+	{
+		gain   = deviation_before / deviation_after;
+		offset = mean_before - gain * mean_after;
+	}
+	else if (mean_after > EPSILON)
+	{
+		gain = mean_before / mean_after;
+	}
+
+	if (gain < (double)GAIN_MIN || gain > (double)GAIN_MAX)
+	{
+		gain   = (gain < (double)GAIN_MIN) ? (double)GAIN_MIN : (double)GAIN_MAX;
+		offset = handle->calibration_iq ? 0.0 : mean_before - gain * mean_after;
+	}
+
+	handle->seams[seam].index  = index;
+	handle->seams[seam].gain   = (float)gain;
+	handle->seams[seam].offset = (float)offset;
+}
+
+
+/**
+ * @brief Compute the per point tables, composing the seam corrections from the first segment
+ */
+void build_tables(acc_stitch_correction_handle_t handle)
+{
+	float    gain   = 1.0f;
+	float    offset = 0.0f;
+	uint16_t seam   = 0;
+
+	for (uint16_t i = 0; i < handle->data_length; i++)
+	{
+		while (seam < handle->stitch_count && handle->seams[seam].index == i)
+		{
+			offset = gain * handle->seams[seam].offset + offset;
+			gain   = gain * handle->seams[seam].gain;
+			seam++;
+		}
+
+		float gain_limited = (gain < GAIN_MIN) ? GAIN_MIN : (gain > GAIN_MAX) ? GAIN_MAX : gain;
+
+		float offset_limited = (offset < -OFFSET_MAX) ? -OFFSET_MAX : (offset > OFFSET_MAX) ? OFFSET_MAX : offset;
+
+		handle->gain[i]     = gain_limited;
+		handle->gain_q[i]   = (int32_t)lroundf(gain_limited * (1 << GAIN_Q));
+		handle->offset_q[i] = (int32_t)lroundf(offset_limited * (1 << GAIN_Q));
+	}
+}
+
+
+/**
+ * @brief Find the key of the configuration in the key-value store
+ *
+ * The identity selects a first key, and configurations that share it are stored in the
+ * following keys. The full identity in the stored header tells them apart.
+ *
+ * @param[in] handle The handle
+ * @param[out] key The key of the stored correction, otherwise the key to store it under
+ * @return True if a correction of the configuration is stored under key, false otherwise
+ */
+bool find_kv_key(acc_stitch_correction_handle_t handle, uint16_t *key)
+{
+	uint8_t  buffer[HEADER_SIZE + SEAM_SIZE * ACC_STITCH_CORRECTION_STITCH_COUNT_MAX];
+	uint16_t first      = (uint16_t)(handle->configuration_id % KV_KEY_COUNT);
+	bool     free_found = false;
+
+	// When all probed keys hold other configurations the first key is replaced
+	*key = ACC_STITCH_CORRECTION_KV_KEY_BASE + first;
+
+	for (uint16_t probe = 0; probe < KV_PROBE_COUNT; probe++)
+	{
+		uint16_t candidate = (uint16_t)(ACC_STITCH_CORRECTION_KV_KEY_BASE + (first + probe) % KV_KEY_COUNT);
+		uint16_t length;
+		uint32_t magic;
+		uint32_t configuration_id;
+
+		if (!acc_device_memory_kv_load(candidate, buffer, sizeof(buffer), &length) || length < HEADER_SIZE)
+		{
+			if (!free_found)
+			{
+				*key       = candidate;
+				free_found = true;
+			}
+
+			continue;
+		}
+
+		memcpy(&magic, buffer, 4);
+		memcpy(&configuration_id, buffer + 4, 4);
+
+		if (magic == SERIALIZED_MAGIC && configuration_id == handle->configuration_id)
+		{
+			*key = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,389 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_driver_hal.h"
+#include "acc_stitch_correction.h"
+
+
+/**
+ * @brief Stitch correction of recorded envelope captures
+ *
+ * Learns the stitch correction from a calibration capture or loads it from a file, and
+ * applies it to a capture. Captures are envelope data as written by the data logger, one
+ * sweep per line with tab separated values. Since recordings carry no service metadata the
+ * stitch count is given on the command line, and the configuration identity of saved
+ * corrections is 0.
+ */
+
+
+#define MAX_DATA_LENGTH 2048
+#define MAX_LINE_LENGTH (MAX_DATA_LENGTH * 8)
+
+
+typedef struct
+{
+	uint16_t stitch_count;
+	char     *calibration_path;
+	char     *load_path;
+	char     *save_path;
+	char     *input_path;
+	char     *output_path;
+} input_t;
+
+
+static bool parse_options(int argc, char *argv[], input_t *input);
+
+
+static uint16_t read_sweep(FILE *file, uint16_t *data);
+
+
+static bool calibrate(const char *path, uint16_t *data_length, uint16_t stitch_count, acc_stitch_correction_handle_t *handle);
+
+
+static bool load(const char *path, acc_stitch_correction_handle_t handle);
+
+
+static bool save(const char *path, acc_stitch_correction_handle_t handle, uint16_t stitch_count);
+
+
+static char     line[MAX_LINE_LENGTH];
+static uint16_t sweep[MAX_DATA_LENGTH];
+
+
+int main(int argc, char *argv[])
+{
+	input_t input;
+
+	memset(&input, 0, sizeof(input));
+
+	if (!parse_options(argc, argv, &input))
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!acc_driver_hal_init())
+	{
+		return EXIT_FAILURE;
+	}
+
+	acc_stitch_correction_handle_t handle      = NULL;
+	uint16_t                       data_length = 0;
+	bool                           status      = true;
+
+	if (input.calibration_path != NULL)
+	{
+		status = calibrate(input.calibration_path, &data_length, input.stitch_count, &handle);
+	}
+
+	FILE *in  = stdin;
+	FILE *out = stdout;
+
+	if (status && input.input_path != NULL)
+	{
+		in = fopen(input.input_path, "r");
+		if (in == NULL)
+		{
+			fprintf(stderr, "Failed to open %s\n", input.input_path);
+			status = false;
+		}
+	}
+
+	if (status && input.output_path != NULL)
+	{
+		out = fopen(input.output_path, "w");
+		if (out == NULL)
+		{
+			fprintf(stderr, "Failed to open %s\n", input.output_path);
+			status = false;
+		}
+	}
+
+	bool apply = input.input_path != NULL || input.calibration_path == NULL;
+
+	while (status && apply)
+	{
+		uint16_t length = read_sweep(in, sweep);
+
+		if (length == 0)
+		{
+			break;
+		}
+
+		if (handle == NULL)
+		{
+			data_length = length;
+			handle      = acc_stitch_correction_create(data_length, input.stitch_count, 0);
+			status      = handle != NULL && (input.load_path == NULL || load(input.load_path, handle));
+			if (!status)
+			{
+				break;
+			}
+		}
+		else if (length != data_length)
+		{
+			fprintf(stderr, "Sweep has %u points, expected %u\n", (unsigned int)length, (unsigned int)data_length);
+			status = false;
+			break;
+		}
+
+		acc_stitch_correction_apply_envelope(handle, sweep, sweep);
+
+		for (uint16_t i = 0; i < data_length; i++)
+		{
+			fprintf(out, "%u\t", (unsigned int)sweep[i]);
+		}
+
+		fprintf(out, "\n");
+	}
+
+	if (status && input.save_path != NULL && handle != NULL)
+	{
+		status = save(input.save_path, handle, input.stitch_count);
+	}
+
+	acc_stitch_correction_destroy(&handle);
+
+	if (in != stdin && in != NULL)
+	{
+		fclose(in);
+	}
+
+	if (out != stdout && out != NULL)
+	{
+		fclose(out);
+	}
+
+	return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+uint16_t read_sweep(FILE *file, uint16_t *data)
+{
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		uint16_t length   = 0;
+		char     *position = line;
+
+		while (length < MAX_DATA_LENGTH)
+		{
+			char          *end;
+			unsigned long value = strtoul(position, &end, 10);
+
+			if (end == position)
+			{
+				break;
+			}
+
+			data[length++] = (value > UINT16_MAX) ? UINT16_MAX : value;
+			position       = end;
+		}
+
+		if (length > 0)
+		{
+			return length;
+		}
+	}
+
+	return 0;
+}
+
+
+bool calibrate(const char *path, uint16_t *data_length, uint16_t stitch_count, acc_stitch_correction_handle_t *handle)
+{
+	FILE *file = fopen(path, "r");
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return false;
+	}
+
+	bool     status = true;
+	uint16_t length;
+
+	while (status && (length = read_sweep(file, sweep)) > 0)
+	{
+		if (*handle == NULL)
+		{
+			*data_length = length;
+			*handle      = acc_stitch_correction_create(length, stitch_count, 0);
+			status       = *handle != NULL;
+		}
+		else if (length != *data_length)
+		{
+			fprintf(stderr, "Calibration sweep has %u points, expected %u\n", (unsigned int)length, (unsigned int)*data_length);
+			status = false;
+		}
+
+		status = status && acc_stitch_correction_calibration_add_envelope(*handle, sweep);
+	}
+
+	fclose(file);
+
+	status = status && *handle != NULL && acc_stitch_correction_calibration_finish(*handle);
+
+	if (status)
+	{
+		acc_stitch_correction_seam_t seams[ACC_STITCH_CORRECTION_STITCH_COUNT_MAX];
+
+		acc_stitch_correction_seams_get(*handle, seams);
+
+		for (uint16_t seam = 0; seam < stitch_count; seam++)
+		{
+			fprintf(stderr, "Seam at %u: gain %f, offset %f\n", (unsigned int)seams[seam].index, (double)seams[seam].gain,
+			        (double)seams[seam].offset);
+		}
+	}
+
+	return status;
+}
+
+
+bool load(const char *path, acc_stitch_correction_handle_t handle)
+{
+	uint8_t buffer[64 + 16 * ACC_STITCH_CORRECTION_STITCH_COUNT_MAX];
+	FILE    *file = fopen(path, "rb");
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return false;
+	}
+
+	size_t size = fread(buffer, 1, sizeof(buffer), file);
+
+	fclose(file);
+
+	if (!acc_stitch_correction_deserialize(handle, buffer, size))
+	{
+		fprintf(stderr, "%s is not a correction for this data\n", path);
+		return false;
+	}
+
+	return true;
+}
+
+
+bool save(const char *path, acc_stitch_correction_handle_t handle, uint16_t stitch_count)
+{
+	uint8_t buffer[64 + 16 * ACC_STITCH_CORRECTION_STITCH_COUNT_MAX];
+	size_t  size = acc_stitch_correction_serialized_size(stitch_count);
+
+	if (!acc_stitch_correction_serialize(handle, buffer, sizeof(buffer)))
+	{
+		return false;
+	}
+
+	FILE *file = fopen(path, "wb");
+
+	if (file == NULL || fwrite(buffer, 1, size, file) != size)
+	{
+		fprintf(stderr, "Failed to write %s\n", path);
+
+		if (file != NULL)
+		{
+			fclose(file);
+		}
+
+		return false;
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+
+static void print_usage(void)
+{
+	printf("Usage: acc_stitch_correction_tool [OPTION]...\n\n");
+	printf("Corrects amplitude steps at stitches in data logger envelope captures\n\n");
+	printf("-h, --help                this help\n");
+	printf("-n, --stitch-count        number of stitches in the data\n");
+	printf("-c, --calibration         learn the correction from this capture of an empty scene\n");
+	printf("-l, --load                load the correction from this file instead\n");
+	printf("-s, --save                save the correction to this file\n");
+	printf("-i, --in                  capture to correct, default stdin unless calibrating\n");
+	printf("-o, --out                 path to out file, default stdout\n");
+}
+
+
+bool parse_options(int argc, char *argv[], input_t *input)
+{
+	static struct option long_options[] =
+	{
+		{"stitch-count", required_argument,  0, 'n'},
+		{"calibration",  required_argument,  0, 'c'},
+		{"load",         required_argument,  0, 'l'},
+		{"save",         required_argument,  0, 's'},
+		{"in",           required_argument,  0, 'i'},
+		{"out",          required_argument,  0, 'o'},
+		{"help",         no_argument,        0, 'h'},
+		{NULL,           0,                  NULL, 0}
+	};
+
+	int16_t character_code;
+	int32_t option_index = 0;
+	bool    stitch_count_set = false;
+
+	while ((character_code = getopt_long(argc, argv, "n:c:l:s:i:o:h?", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 'n':
+			{
+				input->stitch_count = atoi(optarg);
+				stitch_count_set    = true;
+				break;
+			}
+			case 'c':
+			{
+				input->calibration_path = optarg;
+				break;
+			}
+			case 'l':
+			{
+				input->load_path = optarg;
+				break;
+			}
+			case 's':
+			{
+				input->save_path = optarg;
+				break;
+			}
+			case 'i':
+			{
+				input->input_path = optarg;
+				break;
+			}
+			case 'o':
+			{
+				input->output_path = optarg;
+				break;
+			}
+			case 'h':
+			case '?':
+			default:
+			{
+				print_usage();
+				return false;
+			}
+		}
+	}
+
+	if (!stitch_count_set || (input->calibration_path == NULL) == (input->load_path == NULL))
+	{
+		print_usage();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,472 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "acc_sweep_output.h"
+
+#include "acc_device_os.h"
+#include "acc_log.h"
+
+
+#define MODULE "sweep_output"
+
+#define MAGIC_NUMBER (0xACC05E0F)
+
+#define DEFAULT_BUFFER_SIZE  (64 * 1024)
+#define DEFAULT_BUFFER_COUNT 4
+#define DRAIN_CHUNK_SIZE     4096
+
+
+typedef struct acc_sweep_output
+{
+	uint32_t                      magic_number;
+	int                           fd;
+	int                           pipe_fd[2];
+	size_t                        pipe_size;
+	size_t                        page_size;
+	size_t                        buffer_size;
+	uint16_t                      buffer_count;
+	uint8_t                       *pool;
+	uint16_t                      current;
+	size_t                        fill;
+	size_t                        sent;
+	bool                          spliced;
+	bool                          retire_spliced;
+	bool                          failed;
+	acc_sweep_output_statistics_t statistics;
+} acc_sweep_output_internal_t;
+
+
+static bool handle_valid(acc_sweep_output_t output);
+static bool hand_over(acc_sweep_output_t output, const uint8_t *data, size_t size);
+static bool hand_over_vmsplice(acc_sweep_output_t output, int fd, const uint8_t *data, size_t size);
+static bool drain_private_pipe(acc_sweep_output_t output, size_t size);
+static bool write_all(int fd, const uint8_t *data, size_t size);
+static void fall_back_to_write(acc_sweep_output_t output);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+void acc_sweep_output_configuration_default(acc_sweep_output_configuration_t *configuration)
+{
+	configuration->buffer_size  = DEFAULT_BUFFER_SIZE;
+	configuration->buffer_count = DEFAULT_BUFFER_COUNT;
+	configuration->allow_splice = true;
+}
+
+
+acc_sweep_output_t acc_sweep_output_create(int fd, const acc_sweep_output_configuration_t *configuration)
+{
+	struct stat file_stat;
+
+	if (fd < 0 || fstat(fd, &file_stat) != 0 || configuration->buffer_size == 0 || configuration->buffer_count == 0)
+	{
+		ACC_LOG_ERROR("Invalid file descriptor or configuration");
+		return NULL;
+	}
+
+	acc_sweep_output_t output = acc_os_mem_alloc(sizeof(*output));
+
+	if (output == NULL)
+	{
+		return NULL;
+	}
+
+	memset(output, 0, sizeof(*output));
+
+	output->magic_number = MAGIC_NUMBER;
+	output->fd           = fd;
+	output->pipe_fd[0]   = -1;
+	output->pipe_fd[1]   = -1;
+	output->page_size    = (size_t)sysconf(_SC_PAGESIZE);
+	output->buffer_size  = (configuration->buffer_size + output->page_size - 1) & ~(output->page_size - 1);
+	output->buffer_count = configuration->buffer_count;
+
+	output->pool = mmap(NULL, output->buffer_size * output->buffer_count, PROT_READ | PROT_WRITE,
+	                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (output->pool == MAP_FAILED)
+	{
+		ACC_LOG_ERROR("Failed to map buffer pool: %s", strerror(errno));
+		acc_os_mem_free(output);
+		return NULL;
+	}
+
+	acc_os_memory_mapped(REL_FILE_PATH, output->buffer_size * output->buffer_count);
+
+	output->statistics.method = ACC_SWEEP_OUTPUT_METHOD_WRITE;
+
+	if (configuration->allow_splice)
+	{
+		if (S_ISFIFO(file_stat.st_mode))
+		{
+			output->statistics.method = ACC_SWEEP_OUTPUT_METHOD_VMSPLICE;
+		}
+		else if ((S_ISREG(file_stat.st_mode) || S_ISSOCK(file_stat.st_mode)) && pipe2(output->pipe_fd, O_CLOEXEC) == 0)
+		{
+			// A private pipe that holds a whole buffer if allowed, so a buffer is spliced in one go
+			fcntl(output->pipe_fd[1], F_SETPIPE_SZ, (int)output->buffer_size);
+
+			int pipe_size = fcntl(output->pipe_fd[1], F_GETPIPE_SZ);
+
+			output->pipe_size         = (pipe_size > 0) ? (size_t)pipe_size : output->page_size;
+			output->statistics.method = ACC_SWEEP_OUTPUT_METHOD_SPLICE;
+		}
+	}
+
+	// Splicing to a regular file copies the data to the page cache before the private pipe is drained
+	output->retire_spliced = !S_ISREG(file_stat.st_mode);
+
+	return output;
+}
+
+
+bool acc_sweep_output_destroy(acc_sweep_output_t *output)
+{
+	bool success = true;
+
+	if (output != NULL && *output != NULL)
+	{
+		if (handle_valid(*output))
+		{
+			success = acc_sweep_output_flush(*output);
+
+			if ((*output)->pipe_fd[0] >= 0)
+			{
+				close((*output)->pipe_fd[0]);
+				close((*output)->pipe_fd[1]);
+			}
+
+			munmap((*output)->pool, (*output)->buffer_size * (*output)->buffer_count);
+			acc_os_memory_unmapped(REL_FILE_PATH, (*output)->buffer_size * (*output)->buffer_count);
+			(*output)->magic_number = 0;
+			acc_os_mem_free(*output);
+		}
+
+		*output = NULL;
+	}
+
+	return success;
+}
+
+
+char *acc_sweep_output_reserve(acc_sweep_output_t output, size_t size)
+{
+	if (!handle_valid(output) || size > output->buffer_size)
+	{
+		return NULL;
+	}
+
+	if (output->buffer_size - output->fill < size)
+	{
+		acc_sweep_output_flush(output);
+
+		uint8_t *buffer = output->pool + (size_t)output->current * output->buffer_size;
+
+		if (output->spliced && output->retire_spliced)
+		{
+			// The kernel may still reference the spliced pages, give it the pages and start over with new ones
+			madvise(buffer, output->buffer_size, MADV_DONTNEED);
+			output->statistics.retired_count++;
+		}
+
+		output->current = (uint16_t)((output->current + 1) % output->buffer_count);
+		output->fill    = 0;
+		output->sent    = 0;
+		output->spliced = false;
+	}
+
+	return (char *)output->pool + (size_t)output->current * output->buffer_size + output->fill;
+}
+
+
+void acc_sweep_output_commit(acc_sweep_output_t output, size_t size)
+{
+	if (handle_valid(output))
+	{
+		output->fill += size;
+	}
+}
+
+
+bool acc_sweep_output_flush(acc_sweep_output_t output)
+{
+	if (!handle_valid(output))
+	{
+		return false;
+	}
+
+	if (output->fill > output->sent && !output->failed)
+	{
+		const uint8_t *buffer = output->pool + (size_t)output->current * output->buffer_size;
+
+		output->failed = !hand_over(output, buffer + output->sent, output->fill - output->sent);
+		output->statistics.flush_count++;
+	}
+
+	output->sent = output->fill;
+
+	return !output->failed;
+}
+
+
+void acc_sweep_output_get_statistics(acc_sweep_output_t output, acc_sweep_output_statistics_t *statistics)
+{
+	if (handle_valid(output))
+	{
+		*statistics = output->statistics;
+	}
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+bool handle_valid(acc_sweep_output_t output)
+{
+	if (output == NULL || output->magic_number != MAGIC_NUMBER)
+	{
+		ACC_LOG_ERROR("Invalid handle");
+		return false;
+	}
+
+	return true;
+}
+
+
+bool hand_over(acc_sweep_output_t output, const uint8_t *data, size_t size)
+{
+	switch (output->statistics.method)
+	{
+		case ACC_SWEEP_OUTPUT_METHOD_VMSPLICE:
+		{
+			if (hand_over_vmsplice(output, output->fd, data, size))
+			{
+				output->statistics.bytes         += size;
+				output->statistics.spliced_bytes += size;
+				return true;
+			}
+
+			break;
+		}
+		case ACC_SWEEP_OUTPUT_METHOD_SPLICE:
+		{
+			const uint8_t *position = data;
+
+			while (position < data + size)
+			{
+				size_t chunk = (size_t)(data + size - position);
+
+				// The private pipe must take a chunk without blocking, it holds pipe_size / page_size pages
+				size_t room = output->pipe_size - ((uintptr_t)position % output->page_size);
+
+				if (chunk > room)
+				{
+					chunk = room;
+				}
+
+				if (!hand_over_vmsplice(output, output->pipe_fd[1], position, chunk))
+				{
+					break;
+				}
+
+				if (!drain_private_pipe(output, chunk))
+				{
+					return false;
+				}
+
+				position                 += chunk;
+				output->statistics.bytes += chunk;
+
+				if (output->statistics.method != ACC_SWEEP_OUTPUT_METHOD_SPLICE)
+				{
+					break;
+				}
+
+				output->statistics.spliced_bytes += chunk;
+			}
+
+			if (position == data + size)
+			{
+				return true;
+			}
+
+			size -= (size_t)(position - data);
+			data  = position;
+			break;
+		}
+		default:
+			break;
+	}
+
+	if (output->failed)
+	{
+		return false;
+	}
+
+	if (output->statistics.method != ACC_SWEEP_OUTPUT_METHOD_WRITE)
+	{
+		fall_back_to_write(output);
+	}
+
+	if (!write_all(output->fd, data, size))
+	{
+		ACC_LOG_ERROR("Failed to write output: %s", strerror(errno));
+		return false;
+	}
+
+	output->statistics.bytes += size;
+
+	return true;
+}
+
+
+/**
+ * @brief vmsplice all of data into a pipe
+ *
+ * @return True if successful, false otherwise, failed is set unless the output should fall back to write
+ */
+bool hand_over_vmsplice(acc_sweep_output_t output, int fd, const uint8_t *data, size_t size)
+{
+	struct iovec iov = {
+		.iov_base = (void *)(uintptr_t)data,
+		.iov_len  = size,
+	};
+
+	while (iov.iov_len > 0)
+	{
+		// Whole pages can be gifted, the buffer is not written again after splicing
+		unsigned int flags = 0;
+
+		if (((uintptr_t)iov.iov_base % output->page_size) == 0 && (iov.iov_len % output->page_size) == 0)
+		{
+			flags |= SPLICE_F_GIFT;
+		}
+
+		ssize_t result = vmsplice(fd, &iov, 1, flags);
+
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			if (iov.iov_len != size || (errno != EINVAL && errno != ENOSYS))
+			{
+				// Part of the data may be in the pipe and can not be taken back, or the reader is gone
+				ACC_LOG_ERROR("vmsplice failed: %s", strerror(errno));
+				output->failed = true;
+			}
+
+			return false;
+		}
+
+		output->spliced = true;
+		iov.iov_base    = (uint8_t *)iov.iov_base + result;
+		iov.iov_len    -= (size_t)result;
+	}
+
+	return true;
+}
+
+
+/**
+ * @brief Move size bytes from the private pipe to the file descriptor
+ *
+ * If splice is not supported by the file descriptor the data is read back from the pipe and
+ * written, and the output falls back to write.
+ */
+bool drain_private_pipe(acc_sweep_output_t output, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t result = splice(output->pipe_fd[0], NULL, output->fd, NULL, size, SPLICE_F_MOVE);
+
+		if (result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (result <= 0)
+		{
+			if (result < 0 && (errno == EINVAL || errno == ENOSYS))
+			{
+				uint8_t chunk[DRAIN_CHUNK_SIZE];
+
+				fall_back_to_write(output);
+
+				while (size > 0)
+				{
+					ssize_t length = read(output->pipe_fd[0], chunk, (size > sizeof(chunk)) ? sizeof(chunk) : size);
+
+					if (length <= 0 || !write_all(output->fd, chunk, (size_t)length))
+					{
+						break;
+					}
+
+					size -= (size_t)length;
+				}
+
+				if (size == 0)
+				{
+					return true;
+				}
+			}
+
+			ACC_LOG_ERROR("splice failed: %s", strerror(errno));
+			output->failed = true;
+			return false;
+		}
+
+		size -= (size_t)result;
+	}
+
+	return true;
+}
+
+
+bool write_all(int fd, const uint8_t *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t result = write(fd, data, size);
+
+		if (result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (result <= 0)
+		{
+			return false;
+		}
+
+		data += result;
+		size -= (size_t)result;
+	}
+
+	return true;
+}
+
+
+void fall_back_to_write(acc_sweep_output_t output)
+{
+	ACC_LOG_DEBUG("Splicing not supported, falling back to write");
+	output->statistics.method = ACC_SWEEP_OUTPUT_METHOD_WRITE;
+}
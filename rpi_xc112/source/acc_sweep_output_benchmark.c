@@ -0,0 +1,478 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "acc_device_os.h"
+#include "acc_driver_os_linux.h"
+#include "acc_sweep_output.h"
+#include "acc_text_format.h"
+
+
+/**
+ * @brief Benchmark of sweep output to a pipe or a file, stdio compared with acc_sweep_output
+ *
+ * Synthetic envelope sweeps are written as the data logger writes them, tab separated and
+ * flushed after each sweep unless batched. For each output the sweeps are either formatted
+ * value by value with printf, formatted with acc_text_format into one line, which is what the
+ * data logger does, or copied preformatted, which shows the cost of the output alone. By default
+ * the sweeps go to a pipe read by a child process that discards the data.
+ *
+ * The CPU time of the writing process per MB is reported, together with the CPU time of the
+ * reader.
+ */
+
+
+#define DEFAULT_SWEEP_COUNT 20000
+#define DEFAULT_POINT_COUNT 1000
+#define MAX_POINT_COUNT     4000
+#define MAX_VALUE_LENGTH    6
+#define READ_BUFFER_SIZE    (64 * 1024)
+
+
+typedef enum
+{
+	OUTPUT_STDIO,
+	OUTPUT_WRITE,
+	OUTPUT_SPLICE,
+	OUTPUT_COUNT
+} output_t;
+
+
+typedef enum
+{
+	LOAD_PRINTF,
+	LOAD_TEXT_FORMAT,
+	LOAD_PREFORMATTED,
+	LOAD_COUNT
+} load_t;
+
+
+typedef struct
+{
+	uint32_t sweep_count;
+	uint16_t point_count;
+	bool     batch;
+	char     *file_path;
+} input_t;
+
+
+typedef struct
+{
+	uint64_t bytes;
+	double   cpu_s;
+	double   wall_s;
+	double   reader_cpu_s;
+	uint32_t method;
+} result_t;
+
+
+static const char *output_names[OUTPUT_COUNT] = {"stdio", "write", "splice"};
+static const char *load_names[LOAD_COUNT]     = {"printf", "text_format", "preformatted"};
+
+
+static bool parse_options(int argc, char *argv[], input_t *input);
+
+
+static size_t format_line(char *buffer, const input_t *input);
+
+
+static bool run(const input_t *input, output_t output, load_t load, result_t *result);
+
+
+static uint16_t sweep[MAX_POINT_COUNT];
+static char     stdio_buffer[BUFSIZ];
+static char     line[MAX_POINT_COUNT * MAX_VALUE_LENGTH + 2];
+static size_t   line_length;
+
+
+int main(int argc, char *argv[])
+{
+	input_t input;
+
+	if (!parse_options(argc, argv, &input))
+	{
+		return EXIT_FAILURE;
+	}
+
+	// acc_sweep_output allocates through the OS layer
+	acc_driver_os_linux_register();
+	acc_os_init();
+
+	uint32_t seed = 1;
+
+	for (uint16_t i = 0; i < input.point_count; i++)
+	{
+		seed     = seed * 1103515245 + 12345;
+		sweep[i] = (uint16_t)(seed >> 16);
+	}
+
+	line_length = 0;
+	for (uint16_t i = 0; i < input.point_count; i++)
+	{
+		line_length += (size_t)sprintf(line + line_length, "%u\t", (unsigned int)sweep[i]);
+	}
+
+	line[line_length++] = '\n';
+
+	static char text_format_line[sizeof(line)];
+
+	if (format_line(text_format_line, &input) != line_length || memcmp(text_format_line, line, line_length) != 0)
+	{
+		fprintf(stderr, "acc_text_format line differs from the printf line\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%u sweeps of %u points, %s, to %s\n", (unsigned int)input.sweep_count, (unsigned int)input.point_count,
+	       input.batch ? "batched" : "flushed per sweep", (input.file_path != NULL) ? input.file_path : "a pipe");
+	printf("%-8s %-12s %10s %10s %10s %12s %10s\n", "output", "load", "MB", "cpu ms/MB", "MB/s", "reader ms/MB", "method");
+
+	for (load_t load = LOAD_PRINTF; load < LOAD_COUNT; load++)
+	{
+		for (output_t output = OUTPUT_STDIO; output < OUTPUT_COUNT; output++)
+		{
+			result_t result;
+
+			if (!run(&input, output, load, &result))
+			{
+				return EXIT_FAILURE;
+			}
+
+			double megabytes = (double)result.bytes / 1e6;
+
+			printf("%-8s %-12s %10.1f %10.2f %10.1f %12.2f %10s\n", output_names[output],
+			       load_names[load], megabytes, result.cpu_s * 1e3 / megabytes,
+			       megabytes / result.wall_s, result.reader_cpu_s * 1e3 / megabytes,
+			       (output == OUTPUT_STDIO) ? "fwrite" :
+			       (result.method == ACC_SWEEP_OUTPUT_METHOD_VMSPLICE) ? "vmsplice" :
+			       (result.method == ACC_SWEEP_OUTPUT_METHOD_SPLICE) ? "splice" : "write");
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+
+static double get_cpu_time(int who)
+{
+	struct rusage usage;
+
+	getrusage(who, &usage);
+
+	return (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6 +
+	       (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+}
+
+
+static double get_wall_time(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (double)time_ts.tv_sec + (double)time_ts.tv_nsec / 1e9;
+}
+
+
+static void read_until_end(int fd)
+{
+	static char buffer[READ_BUFFER_SIZE];
+
+	while (read(fd, buffer, sizeof(buffer)) > 0)
+	{
+	}
+}
+
+
+size_t format_line(char *buffer, const input_t *input)
+{
+	char *position = buffer;
+
+	for (uint16_t i = 0; i < input->point_count; i++)
+	{
+		position    = acc_text_format_uint32(position, sweep[i]);
+		*position++ = '\t';
+	}
+
+	*position++ = '\n';
+
+	return (size_t)(position - buffer);
+}
+
+
+static bool write_stdio(FILE *file, const input_t *input, load_t load)
+{
+	static char buffer[sizeof(line)];
+
+	for (uint32_t n = 0; n < input->sweep_count; n++)
+	{
+		if (load == LOAD_PREFORMATTED)
+		{
+			fwrite(line, 1, line_length, file);
+		}
+		else if (load == LOAD_TEXT_FORMAT)
+		{
+			fwrite(buffer, 1, format_line(buffer, input), file);
+		}
+		else
+		{
+			for (uint16_t i = 0; i < input->point_count; i++)
+			{
+				fprintf(file, "%u\t", (unsigned int)sweep[i]);
+			}
+
+			fprintf(file, "\n");
+		}
+
+		if (!input->batch)
+		{
+			fflush(file);
+		}
+	}
+
+	return fflush(file) == 0;
+}
+
+
+static bool write_sweep_output(acc_sweep_output_t output, const input_t *input, load_t load)
+{
+	for (uint32_t n = 0; n < input->sweep_count; n++)
+	{
+		char *buffer = acc_sweep_output_reserve(output, sizeof(line));
+
+		if (buffer == NULL)
+		{
+			return false;
+		}
+
+		size_t length = 0;
+
+		if (load == LOAD_PREFORMATTED)
+		{
+			memcpy(buffer, line, line_length);
+			length = line_length;
+		}
+		else if (load == LOAD_TEXT_FORMAT)
+		{
+			length = format_line(buffer, input);
+		}
+		else
+		{
+			for (uint16_t i = 0; i < input->point_count; i++)
+			{
+				length += (size_t)snprintf(buffer + length, MAX_VALUE_LENGTH + 1, "%u\t", (unsigned int)sweep[i]);
+			}
+
+			buffer[length++] = '\n';
+		}
+
+		acc_sweep_output_commit(output, length);
+
+		if (!input->batch && !acc_sweep_output_flush(output))
+		{
+			return false;
+		}
+	}
+
+	return acc_sweep_output_flush(output);
+}
+
+
+bool run(const input_t *input, output_t output, load_t load, result_t *result)
+{
+	int   fd;
+	pid_t reader = -1;
+
+	memset(result, 0, sizeof(*result));
+
+	if (input->file_path != NULL)
+	{
+		fd = open(input->file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+	else
+	{
+		int pipe_fd[2];
+
+		if (pipe(pipe_fd) != 0)
+		{
+			return false;
+		}
+
+		reader = fork();
+
+		if (reader == 0)
+		{
+			close(pipe_fd[1]);
+			read_until_end(pipe_fd[0]);
+			_exit(EXIT_SUCCESS);
+		}
+
+		close(pipe_fd[0]);
+		fd = pipe_fd[1];
+	}
+
+	if (fd < 0)
+	{
+		fprintf(stderr, "Failed to open output: %s\n", strerror(errno));
+		return false;
+	}
+
+	double cpu_start  = get_cpu_time(RUSAGE_SELF);
+	double wall_start = get_wall_time();
+	bool   success;
+
+	if (output == OUTPUT_STDIO)
+	{
+		FILE *file = fdopen(fd, "w");
+
+		success = file != NULL && setvbuf(file, stdio_buffer, _IOFBF, sizeof(stdio_buffer)) == 0 &&
+		          write_stdio(file, input, load);
+
+		if (file != NULL)
+		{
+			fclose(file);
+		}
+	}
+	else
+	{
+		acc_sweep_output_configuration_t configuration;
+		acc_sweep_output_statistics_t    statistics;
+
+		acc_sweep_output_configuration_default(&configuration);
+		configuration.allow_splice = output == OUTPUT_SPLICE;
+
+		acc_sweep_output_t sweep_output = acc_sweep_output_create(fd, &configuration);
+
+		if (sweep_output == NULL)
+		{
+			fprintf(stderr, "acc_sweep_output_create() failed\n");
+		}
+
+		success = sweep_output != NULL && write_sweep_output(sweep_output, input, load);
+
+		if (sweep_output != NULL)
+		{
+			acc_sweep_output_get_statistics(sweep_output, &statistics);
+			result->method = statistics.method;
+		}
+
+		success = acc_sweep_output_destroy(&sweep_output) && success;
+		close(fd);
+	}
+
+	result->cpu_s  = get_cpu_time(RUSAGE_SELF) - cpu_start;
+	result->bytes  = (uint64_t)line_length * input->sweep_count;
+
+	if (reader > 0)
+	{
+		int           status;
+		struct rusage usage;
+
+		wait4(reader, &status, 0, &usage);
+		result->reader_cpu_s = (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6 +
+		                       (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+	}
+
+	result->wall_s = get_wall_time() - wall_start;
+
+	if (!success)
+	{
+		fprintf(stderr, "%s output failed\n", output_names[output]);
+	}
+
+	return success;
+}
+
+
+static void print_usage(void)
+{
+	printf("Usage: acc_sweep_output_benchmark [OPTION]...\n\n");
+	printf("Compares the CPU time of sweep output with stdio, write and splice\n\n");
+	printf("-h, --help                this help\n");
+	printf("-c, --sweep-count         number of sweeps, default %u\n", (unsigned int)DEFAULT_SWEEP_COUNT);
+	printf("-p, --points              points per sweep, default %u\n", (unsigned int)DEFAULT_POINT_COUNT);
+	printf("-b, --batch               do not flush after each sweep\n");
+	printf("-o, --out                 write to this file instead of a pipe\n");
+}
+
+
+bool parse_options(int argc, char *argv[], input_t *input)
+{
+	static struct option long_options[] =
+	{
+		{"sweep-count", required_argument,  0, 'c'},
+		{"points",      required_argument,  0, 'p'},
+		{"batch",       no_argument,        0, 'b'},
+		{"out",         required_argument,  0, 'o'},
+		{"help",        no_argument,        0, 'h'},
+		{NULL,          0,                  NULL, 0}
+	};
+
+	int16_t character_code;
+	int32_t option_index = 0;
+
+	input->sweep_count = DEFAULT_SWEEP_COUNT;
+	input->point_count = DEFAULT_POINT_COUNT;
+	input->batch       = false;
+	input->file_path   = NULL;
+
+	while ((character_code = getopt_long(argc, argv, "c:p:bo:h?", long_options, &option_index)) != -1)
+	{
+		switch (character_code)
+		{
+			case 'c':
+			{
+				input->sweep_count = (uint32_t)atoi(optarg);
+				break;
+			}
+			case 'p':
+			{
+				int points = atoi(optarg);
+
+				if (points < 1 || points > MAX_POINT_COUNT)
+				{
+					fprintf(stderr, "Points must be 1 to %u\n", (unsigned int)MAX_POINT_COUNT);
+					return false;
+				}
+
+				input->point_count = (uint16_t)points;
+				break;
+			}
+			case 'b':
+			{
+				input->batch = true;
+				break;
+			}
+			case 'o':
+			{
+				input->file_path = optarg;
+				break;
+			}
+			case 'h':
+			case '?':
+			default:
+			{
+				print_usage();
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
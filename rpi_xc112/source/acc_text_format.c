@@ -0,0 +1,452 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acc_text_format.h"
+
+#include "acc_log.h"
+
+
+#define FLOAT_DIGITS_MAX 9
+#define POW10_MAX        53
+#define LOG10_2          (0.30102999566398120)
+
+/**
+ * Largest power of ten whose product with a 24-bit significand is exact in double
+ */
+#define POW10_EXACT_PRODUCT_MAX 12
+#define TWO_POW_52              (4503599627370496.0)
+
+/**
+ * Relative margin of the double arithmetic, closer decisions are made exactly with
+ * snprintf and strtof
+ */
+#define MARGIN (1e-14)
+
+
+typedef enum
+{
+	READ_BACK_NO,
+	READ_BACK_YES,
+	READ_BACK_AMBIGUOUS
+} read_back_t;
+
+
+/**
+ * @brief A positive float with its decimal exponent and the boundaries of the texts that read back as it
+ */
+typedef struct
+{
+	double  value;
+	int32_t exponent10;
+	double  low;
+	double  high;
+	bool    even;
+} float_bounds_t;
+
+
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+
+static const double pow10_double[POW10_MAX + 1] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+	1e18, 1e19, 1e20, 1e21, 1e22, 1e23, 1e24, 1e25, 1e26, 1e27, 1e28, 1e29, 1e30, 1e31, 1e32, 1e33, 1e34, 1e35,
+	1e36, 1e37, 1e38, 1e39, 1e40, 1e41, 1e42, 1e43, 1e44, 1e45, 1e46, 1e47, 1e48, 1e49, 1e50, 1e51, 1e52, 1e53
+};
+
+
+static uint8_t digit_count(uint32_t value);
+static char *write_digits(char *end, uint32_t value);
+static double scale_pow10(double value, int32_t exponent);
+static uint32_t float_bits(float value);
+static bool within(double candidate, double low, double high, bool inclusive);
+static read_back_t round_digits(const float_bounds_t *bounds, uint8_t digits, double *rounded);
+static bool shortest(float value, uint32_t *significand, int32_t *exponent, uint8_t *digits);
+static char *format_exactly(char *buffer, float value);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+char *acc_text_format_uint32(char *buffer, uint32_t value)
+{
+	char *end = buffer + digit_count(value);
+
+	write_digits(end, value);
+
+	return end;
+}
+
+
+char *acc_text_format_prifloat(char *buffer, float value)
+{
+	// The same expressions as the log, with the same float rounding
+	uint32_t integer  = (uint32_t)ACC_LOG_FLOAT_INT(value * ACC_LOG_SIGN(value));
+	uint32_t decimals = (uint32_t)ACC_LOG_FLOAT_DEC(value * ACC_LOG_SIGN(value));
+
+	*buffer++ = (value < 0.0f) ? '-' : ' ';
+	buffer    = acc_text_format_uint32(buffer, integer);
+	*buffer++ = '.';
+
+	if (decimals < 1000000)
+	{
+		memcpy(buffer, &digit_pairs[2 * (decimals / 10000)], 2);
+		memcpy(buffer + 2, &digit_pairs[2 * (decimals / 100 % 100)], 2);
+		memcpy(buffer + 4, &digit_pairs[2 * (decimals % 100)], 2);
+
+		return buffer + 6;
+	}
+
+	return acc_text_format_uint32(buffer, decimals);
+}
+
+
+char *acc_text_format_float(char *buffer, float value)
+{
+	if (isnan(value) || isinf(value))
+	{
+		return format_exactly(buffer, value);
+	}
+
+	if (signbit(value))
+	{
+		*buffer++ = '-';
+		value     = -value;
+	}
+
+	if (value == 0.0f)
+	{
+		*buffer++ = '0';
+		return buffer;
+	}
+
+	uint8_t  digits;
+	uint32_t significand;
+	int32_t  exponent;
+
+	if (!shortest(value, &significand, &exponent, &digits))
+	{
+		return format_exactly(buffer, value);
+	}
+
+	// The significand has the given number of digits, or one more if it was rounded up to a power of ten
+	uint8_t significand_digits = digit_count(significand);
+
+	exponent += significand_digits - 1;
+
+	while (significand % 10 == 0)
+	{
+		significand /= 10;
+		significand_digits--;
+	}
+
+	// As printf %g, fixed notation unless the exponent is less than -4 or at least the precision
+	if (exponent < -4 || exponent >= digits)
+	{
+		char *end = buffer + significand_digits + ((significand_digits > 1) ? 1 : 0);
+
+		write_digits(end, significand);
+
+		if (significand_digits > 1)
+		{
+			buffer[0] = buffer[1];
+			buffer[1] = '.';
+		}
+
+		buffer    = end;
+		*buffer++ = 'e';
+		*buffer++ = (exponent < 0) ? '-' : '+';
+
+		uint32_t exponent_magnitude = (uint32_t)((exponent < 0) ? -exponent : exponent);
+
+		memcpy(buffer, &digit_pairs[2 * exponent_magnitude], 2);
+
+		return buffer + 2;
+	}
+
+	if (exponent < 0)
+	{
+		*buffer++ = '0';
+		*buffer++ = '.';
+
+		for (int32_t i = -1; i > exponent; i--)
+		{
+			*buffer++ = '0';
+		}
+
+		buffer += significand_digits;
+		write_digits(buffer, significand);
+
+		return buffer;
+	}
+
+	if (significand_digits <= exponent + 1)
+	{
+		write_digits(buffer + significand_digits, significand);
+		buffer += significand_digits;
+
+		for (int32_t i = significand_digits; i <= exponent; i++)
+		{
+			*buffer++ = '0';
+		}
+
+		return buffer;
+	}
+
+	// Write the digits one position to the right, then move the integer digits left over the point
+	char *end = buffer + significand_digits + 1;
+
+	write_digits(end, significand);
+	memmove(buffer, buffer + 1, (size_t)exponent + 1);
+	buffer[exponent + 1] = '.';
+
+	return end;
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+uint8_t digit_count(uint32_t value)
+{
+	uint8_t count = 1;
+
+	count += (value >= 10) + (value >= 100) + (value >= 1000) + (value >= 10000);
+	count += (value >= 100000) + (value >= 1000000) + (value >= 10000000) + (value >= 100000000);
+	count += (value >= 1000000000);
+
+	return count;
+}
+
+
+/**
+ * @brief Write the digits of a value backwards from the end, two at a time
+ */
+char *write_digits(char *end, uint32_t value)
+{
+	while (value >= 100)
+	{
+		uint32_t pair = value % 100;
+
+		value /= 100;
+		end   -= 2;
+		memcpy(end, &digit_pairs[2 * pair], 2);
+	}
+
+	if (value >= 10)
+	{
+		end -= 2;
+		memcpy(end, &digit_pairs[2 * value], 2);
+	}
+	else
+	{
+		*--end = (char)('0' + value);
+	}
+
+	return end;
+}
+
+
+double scale_pow10(double value, int32_t exponent)
+{
+	return (exponent >= 0) ? value * pow10_double[exponent] : value / pow10_double[-exponent];
+}
+
+
+uint32_t float_bits(float value)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+
+/**
+ * @brief Check if a text reads back as the float between the boundaries, a tie rounds to an even float
+ */
+bool within(double candidate, double low, double high, bool inclusive)
+{
+	return (candidate > low && candidate < high) || (inclusive && (candidate == low || candidate == high));
+}
+
+
+/**
+ * @brief Round the value to a number of significant digits and check if it reads back
+ *
+ * When the value scaled to the digits is exact in double, or the value is an integer, the
+ * rounding and the check are exact. Otherwise they are done in double, and the result is
+ * ambiguous when a tie or a boundary of the float is too close to decide.
+ */
+read_back_t round_digits(const float_bounds_t *bounds, uint8_t digits, double *rounded)
+{
+	const double x     = bounds->value;
+	int32_t      scale = digits - 1 - bounds->exponent10;
+	bool         inside;
+
+	if (scale >= 0 && scale <= POW10_EXACT_PRODUCT_MAX)
+	{
+		// The products of the 25-bit values and 10^scale are exact, a tie rounds to even as printf
+		double   digits_scaled = x * pow10_double[scale];
+		uint64_t integer       = (uint64_t)digits_scaled;
+		double   fraction      = digits_scaled - (double)integer;
+
+		if (fraction > 0.5 || (fraction == 0.5 && (integer & 1) != 0))
+		{
+			integer++;
+		}
+
+		*rounded = (double)integer;
+		inside   = within(*rounded, bounds->low * pow10_double[scale], bounds->high * pow10_double[scale], bounds->even);
+	}
+	else if (scale < 0 && x < TWO_POW_52 && x == (double)(uint64_t)x)
+	{
+		// An integer, rounded exactly, and the rounded integer is exact in double
+		uint64_t integer   = (uint64_t)x;
+		uint64_t divisor   = (uint64_t)pow10_double[-scale];
+		uint64_t quotient  = integer / divisor;
+		uint64_t remainder = integer % divisor;
+
+		if (2 * remainder > divisor || (2 * remainder == divisor && (quotient & 1) != 0))
+		{
+			quotient++;
+		}
+
+		*rounded = (double)quotient;
+		inside   = within((double)(quotient * divisor), bounds->low, bounds->high, bounds->even);
+	}
+	else
+	{
+		double digits_scaled = scale_pow10(x, scale);
+		double integer       = floor(digits_scaled);
+		double fraction      = digits_scaled - integer;
+
+		if (fabs(fraction - 0.5) < MARGIN * digits_scaled)
+		{
+			return READ_BACK_AMBIGUOUS;
+		}
+
+		*rounded = (fraction > 0.5) ? integer + 1.0 : integer;
+
+		double candidate = scale_pow10(*rounded, -scale);
+		double margin    = MARGIN * x;
+
+		if (fabs(candidate - bounds->low) < margin || fabs(candidate - bounds->high) < margin)
+		{
+			return READ_BACK_AMBIGUOUS;
+		}
+
+		inside = candidate > bounds->low && candidate < bounds->high;
+	}
+
+	return inside ? READ_BACK_YES : READ_BACK_NO;
+}
+
+
+/**
+ * @brief Find the fewest significant digits that read back as the value, which is positive
+ *
+ * The text is significand * 10^exponent. More digits never read back worse, so the number of
+ * digits is found by bisection. False if a decision was ambiguous.
+ */
+bool shortest(float value, uint32_t *significand, int32_t *exponent, uint8_t *digits)
+{
+	float_bounds_t bounds;
+	int            exponent2;
+	uint32_t       bits = float_bits(value);
+	float          below;
+	float          above;
+
+	bounds.value = value;
+	frexp(bounds.value, &exponent2);
+	bounds.exponent10 = (int32_t)floor((exponent2 - 1) * LOG10_2);
+
+	if (scale_pow10(1.0, bounds.exponent10 + 1) <= bounds.value)
+	{
+		bounds.exponent10++;
+	}
+
+	// Half way to the neighbouring floats, exact in double
+	bounds.even = (bits & 1) == 0;
+	bits--;
+	memcpy(&below, &bits, sizeof(below));
+	bits += 2;
+	memcpy(&above, &bits, sizeof(above));
+
+	bounds.low  = (bounds.value + (double)below) / 2.0;
+	bounds.high = isinf(above) ? bounds.value + (bounds.value - (double)below) / 2.0 : (bounds.value + (double)above) / 2.0;
+
+	uint8_t minimum = 1;
+	uint8_t maximum = FLOAT_DIGITS_MAX;
+	double  rounded;
+
+	while (minimum < maximum)
+	{
+		uint8_t middle = (uint8_t)((minimum + maximum) / 2);
+
+		switch (round_digits(&bounds, middle, &rounded))
+		{
+			case READ_BACK_YES:
+				maximum = middle;
+				break;
+			case READ_BACK_NO:
+				minimum = (uint8_t)(middle + 1);
+				break;
+			default:
+				return false;
+		}
+	}
+
+	if (round_digits(&bounds, minimum, &rounded) != READ_BACK_YES)
+	{
+		return false;
+	}
+
+	*significand = (uint32_t)rounded;
+	*exponent    = bounds.exponent10 - minimum + 1;
+	*digits      = minimum;
+
+	return true;
+}
+
+
+/**
+ * @brief Format with snprintf and check with strtof, for the rare values the fast path cannot decide
+ */
+char *format_exactly(char *buffer, float value)
+{
+	char text[32];
+	int  length = 0;
+
+	for (int precision = 1; precision <= FLOAT_DIGITS_MAX; precision++)
+	{
+		length = snprintf(text, sizeof(text), "%.*g", precision, (double)value);
+
+		if (strtof(text, NULL) == value || isnan(value))
+		{
+			break;
+		}
+	}
+
+	memcpy(buffer, text, (size_t)length);
+
+	return buffer + length;
+}
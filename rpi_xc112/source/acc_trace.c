@@ -0,0 +1,134 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "acc_trace.h"
+
+
+#if defined(ACC_TRACE)
+
+#define MARKER_LENGTH_MAX 64
+
+
+static const char *trace_marker_paths[] = {
+	"/sys/kernel/tracing/trace_marker",
+	"/sys/kernel/debug/tracing/trace_marker"
+};
+
+int acc_trace_marker_fd = -1;
+
+
+void acc_trace_marker_write(const char *probe, int arg_count, long arg1, long arg2)
+{
+	char marker[MARKER_LENGTH_MAX];
+	int  length;
+
+	switch (arg_count)
+	{
+		case 0:
+			length = snprintf(marker, sizeof(marker), "acc:%s", probe);
+			break;
+		case 1:
+			length = snprintf(marker, sizeof(marker), "acc:%s %ld", probe, arg1);
+			break;
+		default:
+			length = snprintf(marker, sizeof(marker), "acc:%s %ld %ld", probe, arg1, arg2);
+			break;
+	}
+
+	if (length <= 0)
+	{
+		return;
+	}
+
+	if ((size_t)length >= sizeof(marker))
+	{
+		length = sizeof(marker) - 1;
+	}
+
+	// One write is one entry in the trace buffer, a failed write only loses the marker
+	if (write(acc_trace_marker_fd, marker, (size_t)length) < 0)
+	{
+		return;
+	}
+}
+
+
+bool acc_trace_marker_open(void)
+{
+	if (acc_trace_marker_fd >= 0)
+	{
+		return true;
+	}
+
+	for (size_t i = 0; i < sizeof(trace_marker_paths) / sizeof(trace_marker_paths[0]); i++)
+	{
+		int fd = open(trace_marker_paths[i], O_WRONLY | O_CLOEXEC);
+
+		if (fd >= 0)
+		{
+			acc_trace_marker_fd = fd;
+			return true;
+		}
+	}
+
+	fprintf(stderr, "%s: Could not open the ftrace trace_marker, markers are not written\n", __func__);
+
+	return false;
+}
+
+
+void acc_trace_marker_close(void)
+{
+	if (acc_trace_marker_fd >= 0)
+	{
+		int fd = acc_trace_marker_fd;
+
+		acc_trace_marker_fd = -1;
+		close(fd);
+	}
+}
+
+
+#else
+
+
+bool acc_trace_marker_open(void)
+{
+	fprintf(stderr, "%s: The tracepoints are not built in, build with ACC_CFG_TRACE=1\n", __func__);
+
+	return false;
+}
+
+
+void acc_trace_marker_close(void)
+{
+}
+
+
+#endif
+
+
+void acc_trace_init(void)
+{
+	static bool init_done = false;
+
+	if (init_done)
+	{
+		return;
+	}
+
+	init_done = true;
+
+	if (getenv("ACC_TRACE_MARKER") != NULL)
+	{
+		acc_trace_marker_open();
+	}
+}
@@ -0,0 +1,562 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "acc_virtual_service.h"
+
+#include "acc_definitions.h"
+#include "acc_device_os.h"
+#include "acc_log.h"
+#include "acc_service_iq.h"
+
+
+#define MODULE "virtual_service"
+
+#define SOURCE_MAGIC_NUMBER  (0xACC0505C)
+#define SERVICE_MAGIC_NUMBER (0xACC0F5E7)
+
+#define RECIPROCAL_Q 24
+
+
+typedef enum
+{
+	SOURCE_ENVELOPE,
+	SOURCE_IQ
+} source_type_t;
+
+
+typedef enum
+{
+	VIRTUAL_POWER_BINS,
+	VIRTUAL_ENVELOPE
+} virtual_type_t;
+
+
+typedef struct acc_virtual_service_source
+{
+	uint32_t                           magic_number;
+	source_type_t                      type;
+	acc_service_handle_t               service;
+	uint16_t                           data_length;
+	uint16_t                           stitch_count;
+	float                              start_m;
+	float                              step_length_m;
+	uint32_t                           sequence;
+	acc_service_envelope_result_info_t result_info;
+	const uint16_t                     *sweep;
+	uint16_t                           *amplitude;
+	uint32_t                           *prefix;
+} acc_virtual_service_source_internal_t;
+
+
+typedef struct acc_virtual_service_handle
+{
+	uint32_t                     magic_number;
+	virtual_type_t               type;
+	acc_virtual_service_source_t source;
+	uint32_t                     sequence;
+	uint16_t                     output_length;
+	uint16_t                     first;
+	uint16_t                     downsampling_factor;
+	uint32_t                     reciprocal;
+	uint16_t                     *edges;
+	uint32_t                     *reciprocals;
+} acc_virtual_service_handle_internal_t;
+
+
+static acc_virtual_service_source_t source_create(acc_service_handle_t service, source_type_t type, uint16_t data_length,
+                                                  uint16_t stitch_count, float start_m, float step_length_m);
+
+
+static bool source_valid(acc_virtual_service_source_t source);
+
+
+static bool handle_valid(acc_virtual_service_handle_t handle, virtual_type_t type);
+
+
+static bool acquire(acc_virtual_service_source_t source);
+
+
+static bool next(acc_virtual_service_handle_t handle, acc_service_envelope_result_info_t *result_info);
+
+
+static uint16_t point_index(acc_virtual_service_source_t source, float distance_m);
+
+
+static uint32_t reciprocal(uint16_t count);
+
+
+static uint16_t scale(uint32_t sum, uint32_t reciprocal);
+
+
+//-----------------------------
+// Public definitions
+//-----------------------------
+acc_virtual_service_source_t acc_virtual_service_source_create_envelope(acc_service_handle_t service)
+{
+	acc_service_envelope_metadata_t metadata;
+
+	if (service == NULL)
+	{
+		ACC_LOG_ERROR("Invalid service");
+		return NULL;
+	}
+
+	acc_service_envelope_get_metadata(service, &metadata);
+
+	return source_create(service, SOURCE_ENVELOPE, metadata.data_length, metadata.stitch_count, metadata.start_m,
+	                     metadata.step_length_m);
+}
+
+
+acc_virtual_service_source_t acc_virtual_service_source_create_iq(acc_service_handle_t service)
+{
+	acc_service_iq_metadata_t metadata;
+
+	if (service == NULL)
+	{
+		ACC_LOG_ERROR("Invalid service");
+		return NULL;
+	}
+
+	acc_service_iq_get_metadata(service, &metadata);
+
+	return source_create(service, SOURCE_IQ, metadata.data_length, metadata.stitch_count, metadata.start_m,
+	                     metadata.step_length_m);
+}
+
+
+void acc_virtual_service_source_destroy(acc_virtual_service_source_t *source)
+{
+	if (source != NULL && *source != NULL)
+	{
+		if (source_valid(*source))
+		{
+			(*source)->magic_number = 0;
+			acc_os_mem_free(*source);
+			*source = NULL;
+		}
+	}
+}
+
+
+acc_virtual_service_handle_t acc_virtual_service_power_bins_create(acc_virtual_service_source_t source, const float *bin_edges_m,
+                                                                   uint16_t bin_count)
+{
+	if (!source_valid(source) || bin_edges_m == NULL || bin_count == 0 || bin_count > source->data_length)
+	{
+		ACC_LOG_ERROR("Invalid power bins parameters");
+		return NULL;
+	}
+
+	size_t                                size    = sizeof(uint32_t) * bin_count + sizeof(uint16_t) * (bin_count + 1);
+	acc_virtual_service_handle_internal_t *handle = acc_os_mem_alloc(sizeof(*handle) + size);
+
+	if (handle == NULL)
+	{
+		ACC_LOG_ERROR("Virtual power bins not possible to allocate");
+		return NULL;
+	}
+
+	memset(handle, 0, sizeof(*handle));
+
+	handle->magic_number  = SERVICE_MAGIC_NUMBER;
+	handle->type          = VIRTUAL_POWER_BINS;
+	handle->source        = source;
+	handle->sequence      = source->sequence;
+	handle->output_length = bin_count;
+	handle->reciprocals   = (uint32_t *)(handle + 1);
+	handle->edges         = (uint16_t *)(handle->reciprocals + bin_count);
+
+	handle->edges[0] = point_index(source, bin_edges_m[0]);
+
+	for (uint16_t bin = 0; bin < bin_count; bin++)
+	{
+		handle->edges[bin + 1] = point_index(source, bin_edges_m[bin + 1]);
+
+		if (handle->edges[bin + 1] <= handle->edges[bin])
+		{
+			ACC_LOG_ERROR("Power bin %u covers no points", (unsigned int)bin);
+			handle->magic_number = 0;
+			acc_os_mem_free(handle);
+			return NULL;
+		}
+
+		handle->reciprocals[bin] = reciprocal(handle->edges[bin + 1] - handle->edges[bin]);
+	}
+
+	return handle;
+}
+
+
+acc_virtual_service_handle_t acc_virtual_service_envelope_create(acc_virtual_service_source_t source, float start_m,
+                                                                 float length_m, uint16_t downsampling_factor)
+{
+	if (!source_valid(source) || length_m <= 0.0f || downsampling_factor == 0)
+	{
+		ACC_LOG_ERROR("Invalid envelope parameters");
+		return NULL;
+	}
+
+	uint16_t first = point_index(source, start_m);
+	uint16_t end   = point_index(source, start_m + length_m);
+	uint16_t count = (end - first) / downsampling_factor;
+
+	if (count == 0)
+	{
+		ACC_LOG_ERROR("Envelope window covers no points");
+		return NULL;
+	}
+
+	acc_virtual_service_handle_internal_t *handle = acc_os_mem_alloc(sizeof(*handle));
+
+	if (handle == NULL)
+	{
+		ACC_LOG_ERROR("Virtual envelope not possible to allocate");
+		return NULL;
+	}
+
+	memset(handle, 0, sizeof(*handle));
+
+	handle->magic_number        = SERVICE_MAGIC_NUMBER;
+	handle->type                = VIRTUAL_ENVELOPE;
+	handle->source              = source;
+	handle->sequence            = source->sequence;
+	handle->output_length       = count;
+	handle->first               = first;
+	handle->downsampling_factor = downsampling_factor;
+	handle->reciprocal          = reciprocal(downsampling_factor);
+
+	return handle;
+}
+
+
+void acc_virtual_service_destroy(acc_virtual_service_handle_t *handle)
+{
+	if (handle != NULL && *handle != NULL)
+	{
+		if (handle_valid(*handle, (*handle)->type))
+		{
+			(*handle)->magic_number = 0;
+			acc_os_mem_free(*handle);
+			*handle = NULL;
+		}
+	}
+}
+
+
+void acc_virtual_service_power_bins_get_metadata(acc_virtual_service_handle_t handle, acc_service_power_bins_metadata_t *metadata)
+{
+	if (!handle_valid(handle, VIRTUAL_POWER_BINS) || metadata == NULL)
+	{
+		return;
+	}
+
+	acc_virtual_service_source_t source = handle->source;
+	uint16_t                     points = handle->edges[handle->output_length] - handle->edges[0];
+
+	metadata->start_m       = source->start_m + handle->edges[0] * source->step_length_m;
+	metadata->length_m      = points * source->step_length_m;
+	metadata->bin_count     = handle->output_length;
+	metadata->stitch_count  = source->stitch_count;
+	metadata->step_length_m = metadata->length_m / handle->output_length;
+}
+
+
+bool acc_virtual_service_power_bins_get_next(acc_virtual_service_handle_t handle, uint16_t *data, uint16_t data_length,
+                                             acc_service_power_bins_result_info_t *result_info)
+{
+	acc_service_envelope_result_info_t info;
+
+	if (!handle_valid(handle, VIRTUAL_POWER_BINS) || data == NULL || data_length < handle->output_length)
+	{
+		return false;
+	}
+
+	if (!next(handle, &info))
+	{
+		return false;
+	}
+
+	const uint32_t *prefix = handle->source->prefix;
+	const uint16_t *edges  = handle->edges;
+
+	for (uint16_t bin = 0; bin < handle->output_length; bin++)
+	{
+		data[bin] = scale(prefix[edges[bin + 1]] - prefix[edges[bin]], handle->reciprocals[bin]);
+	}
+
+	if (result_info != NULL)
+	{
+		result_info->missed_data                = info.missed_data;
+		result_info->sensor_communication_error = info.sensor_communication_error;
+		result_info->data_saturated             = info.data_saturated;
+	}
+
+	return true;
+}
+
+
+void acc_virtual_service_envelope_get_metadata(acc_virtual_service_handle_t handle, acc_service_envelope_metadata_t *metadata)
+{
+	if (!handle_valid(handle, VIRTUAL_ENVELOPE) || metadata == NULL)
+	{
+		return;
+	}
+
+	acc_virtual_service_source_t source = handle->source;
+
+	metadata->start_m       = source->start_m + handle->first * source->step_length_m;
+	metadata->step_length_m = source->step_length_m * handle->downsampling_factor;
+	metadata->length_m      = handle->output_length * metadata->step_length_m;
+	metadata->data_length   = handle->output_length;
+	metadata->stitch_count  = source->stitch_count;
+}
+
+
+bool acc_virtual_service_envelope_get_next(acc_virtual_service_handle_t handle, uint16_t *data, uint16_t data_length,
+                                           acc_service_envelope_result_info_t *result_info)
+{
+	acc_service_envelope_result_info_t info;
+
+	if (!handle_valid(handle, VIRTUAL_ENVELOPE) || data == NULL || data_length < handle->output_length)
+	{
+		return false;
+	}
+
+	if (!next(handle, &info))
+	{
+		return false;
+	}
+
+	acc_virtual_service_source_t source = handle->source;
+
+	if (handle->downsampling_factor == 1)
+	{
+		memcpy(data, source->sweep + handle->first, sizeof(*data) * handle->output_length);
+	}
+	else
+	{
+		const uint32_t *prefix = source->prefix + handle->first;
+		const uint16_t factor  = handle->downsampling_factor;
+
+		for (uint16_t point = 0; point < handle->output_length; point++)
+		{
+			data[point] = scale(prefix[factor] - prefix[0], handle->reciprocal);
+			prefix     += factor;
+		}
+	}
+
+	if (result_info != NULL)
+	{
+		*result_info = info;
+	}
+
+	return true;
+}
+
+
+//-----------------------------
+// Private definitions
+//-----------------------------
+acc_virtual_service_source_t source_create(acc_service_handle_t service, source_type_t type, uint16_t data_length,
+                                           uint16_t stitch_count, float start_m, float step_length_m)
+{
+	if (data_length == 0)
+	{
+		ACC_LOG_ERROR("Service has no data");
+		return NULL;
+	}
+
+	size_t size = sizeof(uint32_t) * (data_length + 1);
+
+	if (type == SOURCE_IQ)
+	{
+		size += sizeof(uint16_t) * data_length;
+	}
+
+	acc_virtual_service_source_internal_t *source = acc_os_mem_alloc(sizeof(*source) + size);
+
+	if (source == NULL)
+	{
+		ACC_LOG_ERROR("Virtual service source not possible to allocate");
+		return NULL;
+	}
+
+	memset(source, 0, sizeof(*source));
+
+	source->magic_number  = SOURCE_MAGIC_NUMBER;
+	source->type          = type;
+	source->service       = service;
+	source->data_length   = data_length;
+	source->stitch_count  = stitch_count;
+	source->start_m       = start_m;
+	source->step_length_m = step_length_m;
+	source->prefix        = (uint32_t *)(source + 1);
+
+	if (type == SOURCE_IQ)
+	{
+		source->amplitude = (uint16_t *)(source->prefix + data_length + 1);
+	}
+
+	return source;
+}
+
+
+bool source_valid(acc_virtual_service_source_t source)
+{
+	bool valid = true;
+
+	if ((source == NULL) || (source->magic_number != SOURCE_MAGIC_NUMBER))
+	{
+		ACC_LOG_ERROR("Invalid virtual service source");
+		valid = false;
+	}
+
+	return valid;
+}
+
+
+bool handle_valid(acc_virtual_service_handle_t handle, virtual_type_t type)
+{
+	bool valid = true;
+
+	if ((handle == NULL) || (handle->magic_number != SERVICE_MAGIC_NUMBER) || (handle->type != type))
+	{
+		ACC_LOG_ERROR("Invalid virtual service handle");
+		valid = false;
+	}
+
+	return valid;
+}
+
+
+/**
+ * @brief Get a new physical sweep and reduce it to a prefix sum of its amplitude
+ */
+bool acquire(acc_virtual_service_source_t source)
+{
+	const uint16_t data_length = source->data_length;
+	uint32_t       *prefix     = source->prefix;
+	uint32_t       sum         = 0;
+
+	if (source->type == SOURCE_ENVELOPE)
+	{
+		uint16_t *data;
+
+		if (!acc_service_envelope_get_next_by_reference(source->service, &data, &source->result_info))
+		{
+			return false;
+		}
+
+		source->sweep = data;
+	}
+	else
+	{
+		acc_int16_complex_t          *data;
+		acc_service_iq_result_info_t result_info;
+
+		if (!acc_service_iq_get_next_by_reference(source->service, &data, &result_info))
+		{
+			return false;
+		}
+
+		for (uint16_t point = 0; point < data_length; point++)
+		{
+			int32_t  real = data[point].real;
+			int32_t  imag = data[point].imag;
+			// Each square fits in int32_t, their sum reaches 2^31 only in uint32_t
+			uint32_t power = (uint32_t)(real * real) + (uint32_t)(imag * imag);
+			float    norm  = sqrtf((float)power);
+
+			source->amplitude[point] = (norm >= (float)UINT16_MAX) ? UINT16_MAX : (uint16_t)(norm + 0.5f);
+		}
+
+		source->result_info.missed_data                = result_info.missed_data;
+		source->result_info.sensor_communication_error = result_info.sensor_communication_error;
+		source->result_info.data_saturated             = result_info.data_saturated;
+		source->sweep                                  = source->amplitude;
+	}
+
+	prefix[0] = 0;
+
+	for (uint16_t point = 0; point < data_length; point++)
+	{
+		sum              += source->sweep[point];
+		prefix[point + 1] = sum;
+	}
+
+	source->sequence++;
+
+	return true;
+}
+
+
+/**
+ * @brief Make the latest physical sweep available to a virtual service
+ *
+ * A new sweep is acquired if the virtual service has already consumed the latest one.
+ */
+bool next(acc_virtual_service_handle_t handle, acc_service_envelope_result_info_t *result_info)
+{
+	acc_virtual_service_source_t source = handle->source;
+
+	if (!source_valid(source))
+	{
+		return false;
+	}
+
+	if (handle->sequence == source->sequence && !acquire(source))
+	{
+		return false;
+	}
+
+	*result_info              = source->result_info;
+	result_info->missed_data |= (source->sequence - handle->sequence) > 1;
+	handle->sequence          = source->sequence;
+
+	return true;
+}
+
+
+/**
+ * @brief Index of the point nearest a distance, clipped to the sweep
+ */
+uint16_t point_index(acc_virtual_service_source_t source, float distance_m)
+{
+	float index = roundf((distance_m - source->start_m) / source->step_length_m);
+
+	if (index <= 0.0f)
+	{
+		return 0;
+	}
+
+	if (index >= (float)source->data_length)
+	{
+		return source->data_length;
+	}
+
+	return (uint16_t)index;
+}
+
+
+uint32_t reciprocal(uint16_t count)
+{
+	return ((1UL << RECIPROCAL_Q) + count - 1) / count;
+}
+
+
+/**
+ * @brief Mean from a sum of points and the reciprocal of the number of points
+ */
+uint16_t scale(uint32_t sum, uint32_t reciprocal)
+{
+	uint64_t mean = ((uint64_t)sum * reciprocal + (1ULL << (RECIPROCAL_Q - 1))) >> RECIPROCAL_Q;
+
+	return (mean > UINT16_MAX) ? UINT16_MAX : (uint16_t)mean;
+}
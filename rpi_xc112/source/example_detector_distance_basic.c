@@ -8,6 +8,7 @@
 
 #include "acc_definitions.h"
 #include "acc_detector_distance_basic.h"
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -75,6 +76,8 @@ bool acc_example_detector_distance_basic(void)
 
 	const int iterations = 10;
 
+	acc_os_steady_state_arm();
+
 	for (int i = 0; i < iterations; i++)
 	{
 		reflection = acc_detector_distance_basic_get_reflection(handle);
@@ -82,6 +85,8 @@ bool acc_example_detector_distance_basic(void)
 		printf("%d mm (%u)\n", (int)(reflection.distance * 1000.0f), (unsigned int)reflection.amplitude);
 	}
 
+	acc_os_steady_state_check();
+
 	acc_detector_distance_basic_destroy(&handle);
 
 	acc_rss_deactivate();
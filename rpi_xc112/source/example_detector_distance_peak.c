@@ -8,6 +8,7 @@
 
 #include "acc_base_configuration.h"
 #include "acc_detector_distance_peak.h"
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -143,6 +144,8 @@ bool execute_detection(acc_detector_distance_peak_configuration_t distance_confi
 	bool      success    = true;
 	const int iterations = 5;
 
+	acc_os_steady_state_arm();
+
 	for (int i = 0; i < iterations; i++)
 	{
 		uint16_t reflection_count = reflection_count_max;
@@ -161,6 +164,8 @@ bool execute_detection(acc_detector_distance_peak_configuration_t distance_confi
 		print_distances(reflection_count, reflections);
 	}
 
+	acc_os_steady_state_check();
+
 	bool deactivated = acc_detector_distance_peak_deactivate(handle);
 
 	acc_detector_distance_peak_destroy(&handle);
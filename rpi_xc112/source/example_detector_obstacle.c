@@ -7,6 +7,7 @@
 #include <stdlib.h>
 
 #include "acc_detector_obstacle.h"
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -162,6 +163,8 @@ bool execute_obstacle_detection(acc_detector_obstacle_configuration_t configurat
 	bool      success    = true;
 	const int iterations = 20;
 
+	acc_os_steady_state_arm();
+
 	for (uint16_t i = 0; i < iterations; i++)
 	{
 		acc_detector_obstacle_result_info_t result_info;
@@ -193,6 +196,8 @@ bool execute_obstacle_detection(acc_detector_obstacle_configuration_t configurat
 		printf("\n");
 	}
 
+	acc_os_steady_state_check();
+
 	bool deactivated = acc_detector_obstacle_deactivate(handle);
 
 	acc_detector_obstacle_destroy(&handle);
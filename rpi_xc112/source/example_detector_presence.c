@@ -7,6 +7,7 @@
 #include "acc_app_integration.h"
 #include "acc_definitions.h"
 #include "acc_detector_presence.h"
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -87,6 +88,8 @@ bool acc_example_detector_presence(void)
 
 	acc_detector_presence_result_t result;
 
+	acc_os_steady_state_arm();
+
 	for (int i = 0; i < 200; i++)
 	{
 		acc_detector_presence_get_next(handle, &result);
@@ -105,6 +108,8 @@ bool acc_example_detector_presence(void)
 		acc_app_integration_sleep_ms(1000 / DEFAULT_UPDATE_RATE);
 	}
 
+	acc_os_steady_state_check();
+
 	acc_detector_presence_deactivate(handle);
 
 	acc_detector_presence_destroy(&handle);
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -128,6 +129,8 @@ bool execute_envelope(acc_service_configuration_t envelope_configuration)
 	bool      success    = true;
 	const int iterations = 5;
 
+	acc_os_steady_state_arm();
+
 	for (int i = 0; i < iterations; i++)
 	{
 		success = acc_service_envelope_get_next_by_reference(handle, &data, &result_info);
@@ -153,6 +156,8 @@ bool execute_envelope(acc_service_configuration_t envelope_configuration)
 		printf("\n");
 	}
 
+	acc_os_steady_state_check();
+
 	bool deactivated = acc_service_deactivate(handle);
 
 	acc_service_destroy(&handle);
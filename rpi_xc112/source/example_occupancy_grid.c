@@ -0,0 +1,242 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "acc_detector_obstacle.h"
+#include "acc_driver_hal.h"
+#include "acc_hal_definitions.h"
+#include "acc_occupancy_grid.h"
+#include "acc_rss.h"
+#include "acc_version.h"
+
+
+/**
+ * @brief Example that shows how to build an occupancy grid from the obstacle detector
+ *
+ * The platform is taken to move along the x axis at a constant speed, with the sensor facing
+ * its left side. The example executes as follows:
+ *   - Activate Radar System Software (RSS)
+ *   - Create an obstacle detector configuration for the platform speed
+ *   - Create and activate the obstacle detector and estimate the background
+ *   - Create an occupancy grid
+ *   - Get the obstacles 100 times, move the pose by the time passed and fuse the obstacles
+ *     into the grid
+ *   - Print the grid
+ *   - Destroy the occupancy grid, the obstacle detector and its configuration
+ *   - Deactivate Radar System Software (RSS)
+ */
+
+
+#define PLATFORM_SPEED   0.5f
+#define ITERATIONS       100
+#define PRINT_CELL_COUNT 4
+
+
+static bool acc_example_occupancy_grid(void);
+
+
+static bool execute_occupancy_grid(acc_detector_obstacle_handle_t handle, acc_occupancy_grid_handle_t grid);
+
+
+static void print_grid(acc_occupancy_grid_handle_t grid);
+
+
+static uint64_t get_time_us(void);
+
+
+int main(void)
+{
+	if (!acc_driver_hal_init())
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!acc_example_occupancy_grid())
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+
+bool acc_example_occupancy_grid(void)
+{
+	printf("Acconeer software version %s\n", acc_version_get());
+
+	acc_hal_t hal = acc_driver_hal_get_implementation();
+
+	if (!acc_rss_activate(&hal))
+	{
+		fprintf(stderr, "acc_rss_activate() failed\n");
+		return false;
+	}
+
+	acc_detector_obstacle_configuration_t configuration = acc_detector_obstacle_configuration_create();
+
+	if (configuration == NULL)
+	{
+		fprintf(stderr, "acc_detector_obstacle_configuration_create failed\n");
+		acc_rss_deactivate();
+		return false;
+	}
+
+	acc_detector_obstacle_configuration_set_max_speed(configuration, PLATFORM_SPEED, true);
+
+	acc_detector_obstacle_handle_t handle = acc_detector_obstacle_create(configuration);
+
+	acc_detector_obstacle_configuration_destroy(&configuration);
+
+	if (handle == NULL)
+	{
+		fprintf(stderr, "acc_detector_obstacle_create() failed\n");
+		acc_rss_deactivate();
+		return false;
+	}
+
+	acc_occupancy_grid_configuration_t grid_configuration;
+
+	acc_occupancy_grid_configuration_default(&grid_configuration);
+
+	acc_occupancy_grid_handle_t grid = acc_occupancy_grid_create(&grid_configuration);
+
+	if (grid == NULL)
+	{
+		fprintf(stderr, "acc_occupancy_grid_create() failed\n");
+		acc_detector_obstacle_destroy(&handle);
+		acc_rss_deactivate();
+		return false;
+	}
+
+	bool success = execute_occupancy_grid(handle, grid);
+
+	if (success)
+	{
+		print_grid(grid);
+	}
+
+	acc_occupancy_grid_destroy(&grid);
+	acc_detector_obstacle_destroy(&handle);
+
+	acc_rss_deactivate();
+
+	return success;
+}
+
+
+bool execute_occupancy_grid(acc_detector_obstacle_handle_t handle, acc_occupancy_grid_handle_t grid)
+{
+	if (!acc_detector_obstacle_activate(handle))
+	{
+		fprintf(stderr, "acc_detector_obstacle_activate() failed\n");
+		return false;
+	}
+
+	acc_detector_obstacle_result_info_t result_info;
+	bool                                completed;
+	bool                                success = true;
+
+	do
+	{
+		success = acc_detector_obstacle_estimate_background(handle, &completed, &result_info);
+	} while (success && !completed);
+
+	if (!success)
+	{
+		fprintf(stderr, "acc_detector_obstacle_estimate_background() failed\n");
+		acc_detector_obstacle_deactivate(handle);
+		return false;
+	}
+
+	acc_obstacle_t          obstacles[16];
+	acc_detector_obstacle_t obstacle_data;
+	obstacle_data.obstacles = obstacles;
+
+	acc_occupancy_grid_pose_t pose      = {0.0f, 0.0f, 0.0f};
+	uint64_t                  last_time = get_time_us();
+
+	for (uint16_t i = 0; i < ITERATIONS; i++)
+	{
+		do
+		{
+			success = acc_detector_obstacle_get_next(handle, &obstacle_data, &result_info);
+		} while (success && !result_info.data_available);
+
+		if (!success)
+		{
+			fprintf(stderr, "acc_detector_obstacle_get_next() failed\n");
+			break;
+		}
+
+		uint64_t time = get_time_us();
+
+		pose.x_m += PLATFORM_SPEED * (float)(time - last_time) / 1000000.0f;
+		last_time = time;
+
+		acc_occupancy_grid_recenter(grid, pose.x_m, pose.y_m);
+
+		if (!acc_occupancy_grid_update(grid, &pose, PLATFORM_SPEED, &obstacle_data))
+		{
+			fprintf(stderr, "acc_occupancy_grid_update() failed\n");
+			success = false;
+			break;
+		}
+	}
+
+	bool deactivated = acc_detector_obstacle_deactivate(handle);
+
+	return deactivated && success;
+}
+
+
+void print_grid(acc_occupancy_grid_handle_t grid)
+{
+	acc_occupancy_grid_metadata_t metadata;
+
+	acc_occupancy_grid_get_metadata(grid, &metadata);
+
+	printf("Occupancy grid from (%d, %d) mm, %d mm per character, # occupied, . free\n",
+	       (int)(metadata.origin_x_m * 1000.0f), (int)(metadata.origin_y_m * 1000.0f),
+	       (int)(metadata.cell_size_m * PRINT_CELL_COUNT * 1000.0f));
+
+	// Print the rows from the top, a character per PRINT_CELL_COUNT cells in both directions
+	for (int32_t row = metadata.height_cells - PRINT_CELL_COUNT; row >= 0; row -= PRINT_CELL_COUNT)
+	{
+		for (uint16_t column = 0; column + PRINT_CELL_COUNT <= metadata.width_cells; column += PRINT_CELL_COUNT)
+		{
+			int32_t log_odds_sum = 0;
+
+			for (uint16_t j = 0; j < PRINT_CELL_COUNT; j++)
+			{
+				for (uint16_t k = 0; k < PRINT_CELL_COUNT; k++)
+				{
+					float x_m = metadata.origin_x_m + ((float)(column + k) + 0.5f) * metadata.cell_size_m;
+					float y_m = metadata.origin_y_m + ((float)row + (float)j + 0.5f) * metadata.cell_size_m;
+
+					log_odds_sum += acc_occupancy_grid_log_odds_get(grid, x_m, y_m);
+				}
+			}
+
+			putchar((log_odds_sum > 0) ? '#' : (log_odds_sum < 0) ? '.' : ' ');
+		}
+
+		putchar('\n');
+	}
+}
+
+
+uint64_t get_time_us(void)
+{
+	struct timespec time_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_ts);
+
+	return (uint64_t)time_ts.tv_sec * 1000000 + (uint64_t)time_ts.tv_nsec / 1000;
+}
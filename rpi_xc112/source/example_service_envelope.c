@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -126,6 +127,8 @@ bool execute_envelope(acc_service_configuration_t envelope_configuration)
 	bool      success    = true;
 	const int iterations = 5;
 
+	acc_os_steady_state_arm();
+
 	for (int i = 0; i < iterations; i++)
 	{
 		success = acc_service_envelope_get_next(handle, data, envelope_metadata.data_length, &result_info);
@@ -151,6 +154,8 @@ bool execute_envelope(acc_service_configuration_t envelope_configuration)
 		printf("\n");
 	}
 
+	acc_os_steady_state_check();
+
 	bool deactivated = acc_service_deactivate(handle);
 
 	acc_service_destroy(&handle);
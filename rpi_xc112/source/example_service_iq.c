@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "acc_complex_math.h"
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -116,6 +118,8 @@ bool execute_iq(acc_service_configuration_t iq_configuration)
 	printf("Data length: %u\n", (unsigned int)(iq_metadata.data_length));
 
 	float complex                data[iq_metadata.data_length];
+	float                        magnitude[iq_metadata.data_length];
+	float                        phase[iq_metadata.data_length];
 	acc_service_iq_result_info_t result_info;
 
 	if (!acc_service_activate(handle))
@@ -128,6 +132,8 @@ bool execute_iq(acc_service_configuration_t iq_configuration)
 	bool      success    = true;
 	const int iterations = 5;
 
+	acc_os_steady_state_arm();
+
 	for (int i = 0; i < iterations; i++)
 	{
 		success = acc_service_iq_get_next(handle, data, iq_metadata.data_length, &result_info);
@@ -138,6 +144,9 @@ bool execute_iq(acc_service_configuration_t iq_configuration)
 			break;
 		}
 
+		acc_complex_math_magnitude(data, magnitude, iq_metadata.data_length);
+		acc_complex_math_phase(data, phase, iq_metadata.data_length, ACC_COMPLEX_MATH_ACCURACY_HIGH);
+
 		printf("IQ data in polar coordinates (r, phi) (multiplied by 1000):\n");
 
 		for (uint16_t j = 0; j < iq_metadata.data_length; j++)
@@ -147,12 +156,14 @@ bool execute_iq(acc_service_configuration_t iq_configuration)
 				printf("\n");
 			}
 
-			printf("(%d, %d)\t", (int)(cabsf(data[j]) * 1000), (int)(cargf(data[j]) * 1000));
+			printf("(%d, %d)\t", (int)(magnitude[j] * 1000), (int)(phase[j] * 1000));
 		}
 
 		printf("\n");
 	}
 
+	acc_os_steady_state_check();
+
 	bool deactivated = acc_service_deactivate(handle);
 
 	acc_service_destroy(&handle);
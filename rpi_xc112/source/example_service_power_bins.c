@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -126,6 +127,8 @@ bool execute_power_bins(acc_service_configuration_t power_bins_configuration)
 	bool      success    = true;
 	const int iterations = 5;
 
+	acc_os_steady_state_arm();
+
 	for (int i = 0; i < iterations; i++)
 	{
 		success = acc_service_power_bins_get_next(handle, data, power_bins_metadata.bin_count, &result_info);
@@ -146,6 +149,8 @@ bool execute_power_bins(acc_service_configuration_t power_bins_configuration)
 		printf("\n");
 	}
 
+	acc_os_steady_state_check();
+
 	bool deactivated = acc_service_deactivate(handle);
 
 	acc_service_destroy(&handle);
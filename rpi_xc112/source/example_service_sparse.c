@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "acc_device_os.h"
 #include "acc_driver_hal.h"
 #include "acc_hal_definitions.h"
 #include "acc_rss.h"
@@ -135,6 +136,8 @@ bool execute_sparse(acc_service_configuration_t sparse_configuration)
 	bool      success    = true;
 	const int iterations = 5;
 
+	acc_os_steady_state_arm();
+
 	for (int i = 0; i < iterations; i++)
 	{
 		success = acc_service_sparse_get_next(handle, data, sparse_metadata.data_length, &result_info);
@@ -162,6 +165,8 @@ bool execute_sparse(acc_service_configuration_t sparse_configuration)
 		printf("\n");
 	}
 
+	acc_os_steady_state_check();
+
 	bool deactivated = acc_service_deactivate(handle);
 
 	acc_service_destroy(&handle);
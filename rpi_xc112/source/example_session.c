@@ -0,0 +1,158 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "acc_board.h"
+#include "acc_driver_hal.h"
+#include "acc_hal_definitions.h"
+#include "acc_rss.h"
+#include "acc_service.h"
+#include "acc_service_envelope.h"
+#include "acc_session.h"
+
+#include "acc_version.h"
+
+
+/**
+ * @brief Example that shows how to bring up several sensors at once with a session
+ *
+ * The example executes as follows:
+ *   - Activate Radar System Software (RSS)
+ *   - Create an envelope service configuration for each sensor of the board
+ *   - Create and activate the services one sensor after another, print the timeline and
+ *     destroy the session
+ *   - Create and activate the services of all sensors at once, print the timeline
+ *   - Get the result of each sensor once and print its peak
+ *   - Destroy the session and the configurations
+ *   - Deactivate Radar System Software (RSS)
+ */
+
+
+static bool acc_example_session(void);
+
+
+static bool bring_up(const acc_service_configuration_t *configurations, uint_fast8_t count, bool parallel,
+                     bool get_results);
+
+
+int main(void)
+{
+	if (!acc_driver_hal_init())
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!acc_example_session())
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+
+bool acc_example_session(void)
+{
+	printf("Acconeer software version %s\n", acc_version_get());
+
+	acc_hal_t hal = acc_driver_hal_get_implementation();
+
+	if (!acc_rss_activate(&hal))
+	{
+		fprintf(stderr, "acc_rss_activate() failed\n");
+		return false;
+	}
+
+	acc_service_configuration_t configurations[ACC_SESSION_SENSOR_COUNT_MAX];
+	uint_fast8_t                count   = 0;
+	bool                        success = true;
+
+	for (uint32_t sensor = 1; sensor <= acc_board_get_sensor_count() && count < ACC_SESSION_SENSOR_COUNT_MAX; sensor++)
+	{
+		acc_service_configuration_t configuration = acc_service_envelope_configuration_create();
+
+		if (configuration == NULL)
+		{
+			fprintf(stderr, "acc_service_envelope_configuration_create() failed\n");
+			success = false;
+			break;
+		}
+
+		acc_service_sensor_set(configuration, (acc_sensor_id_t)sensor);
+		acc_service_requested_start_set(configuration, 0.2f);
+		acc_service_requested_length_set(configuration, 0.5f);
+
+		configurations[count++] = configuration;
+	}
+
+	if (success)
+	{
+		success = bring_up(configurations, count, false, false) && bring_up(configurations, count, true, true);
+	}
+
+	for (uint_fast8_t i = 0; i < count; i++)
+	{
+		acc_service_envelope_configuration_destroy(&configurations[i]);
+	}
+
+	acc_rss_deactivate();
+
+	return success;
+}
+
+
+bool bring_up(const acc_service_configuration_t *configurations, uint_fast8_t count, bool parallel, bool get_results)
+{
+	printf("\n%s:\n", parallel ? "All sensors at once" : "One sensor after another");
+
+	acc_session_t session = acc_session_create(configurations, count, parallel);
+
+	if (session == NULL)
+	{
+		fprintf(stderr, "acc_session_create() failed\n");
+		return false;
+	}
+
+	acc_session_print_timeline(session);
+
+	bool success = true;
+
+	for (uint_fast8_t i = 0; i < count && get_results; i++)
+	{
+		acc_service_handle_t               handle = acc_session_get_service(session, i);
+		acc_service_envelope_result_info_t result_info;
+		uint16_t                           *data;
+
+		if (!acc_service_envelope_get_next_by_reference(handle, &data, &result_info))
+		{
+			fprintf(stderr, "acc_service_envelope_get_next_by_reference() failed\n");
+			success = false;
+			break;
+		}
+
+		acc_service_envelope_metadata_t metadata;
+		uint16_t                        peak_index = 0;
+
+		acc_service_envelope_get_metadata(handle, &metadata);
+
+		for (uint16_t j = 1; j < metadata.data_length; j++)
+		{
+			if (data[j] > data[peak_index])
+			{
+				peak_index = j;
+			}
+		}
+
+		printf("Sensor %u: peak %u at %d mm\n", (unsigned int)acc_service_sensor_get(configurations[i]),
+		       (unsigned int)data[peak_index],
+		       (int)((metadata.start_m + (float)peak_index * metadata.step_length_m) * 1000.0f));
+	}
+
+	acc_session_destroy(&session);
+
+	return success;
+}
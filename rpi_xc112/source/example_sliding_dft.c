@@ -0,0 +1,226 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "acc_driver_hal.h"
+#include "acc_hal_definitions.h"
+#include "acc_rss.h"
+#include "acc_service.h"
+#include "acc_service_iq.h"
+#include "acc_sliding_dft.h"
+
+#include "acc_version.h"
+
+
+/**
+ * @brief Example that shows how to find slow motion such as breathing with the sliding DFT
+ *
+ * Each range bin of the IQ service is a signal over time sampled at the update rate. The
+ * sliding DFT keeps its spectrum over the latest 10 seconds for the frequencies of breathing,
+ * and once the window is full the strongest frequency and its distance are printed every
+ * second.
+ * The example executes as follows:
+ *   - Activate Radar System Software (RSS)
+ *   - Create an IQ service configuration with int16 output at a fixed update rate
+ *   - Create and activate an IQ service using the previously created configuration
+ *   - Create a sliding DFT for the breathing frequencies
+ *   - Get the result by reference for 20 seconds and process it in the sliding DFT
+ *   - Destroy the sliding DFT
+ *   - Deactivate and destroy the IQ service
+ *   - Destroy the IQ service configuration
+ *   - Deactivate Radar System Software (RSS)
+ */
+
+
+#define UPDATE_RATE   20.0f
+#define WINDOW_LENGTH 200
+#define ITERATIONS    400
+
+// The frequency bins cover 0.2 to 0.8 Hz, 12 to 48 breaths per minute
+#define FREQUENCY_BIN_FIRST 2
+#define FREQUENCY_BIN_COUNT 7
+
+
+static bool acc_example_sliding_dft(void);
+
+
+static bool execute_sliding_dft(acc_service_configuration_t iq_configuration);
+
+
+static void print_strongest(acc_sliding_dft_handle_t dft, const acc_service_iq_metadata_t *metadata);
+
+
+int main(void)
+{
+	if (!acc_driver_hal_init())
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!acc_example_sliding_dft())
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+
+bool acc_example_sliding_dft(void)
+{
+	printf("Acconeer software version %s\n", acc_version_get());
+
+	acc_hal_t hal = acc_driver_hal_get_implementation();
+
+	if (!acc_rss_activate(&hal))
+	{
+		fprintf(stderr, "acc_rss_activate() failed\n");
+		return false;
+	}
+
+	acc_service_configuration_t iq_configuration = acc_service_iq_configuration_create();
+
+	if (iq_configuration == NULL)
+	{
+		fprintf(stderr, "acc_service_iq_configuration_create() failed\n");
+		acc_rss_deactivate();
+		return false;
+	}
+
+	acc_service_requested_start_set(iq_configuration, 0.3f);
+	acc_service_requested_length_set(iq_configuration, 1.2f);
+	acc_service_repetition_mode_streaming_set(iq_configuration, UPDATE_RATE);
+	acc_service_iq_output_format_set(iq_configuration, ACC_SERVICE_IQ_OUTPUT_FORMAT_INT16_COMPLEX);
+
+	if (!execute_sliding_dft(iq_configuration))
+	{
+		acc_service_iq_configuration_destroy(&iq_configuration);
+		acc_rss_deactivate();
+		return false;
+	}
+
+	acc_service_iq_configuration_destroy(&iq_configuration);
+
+	acc_rss_deactivate();
+
+	return true;
+}
+
+
+bool execute_sliding_dft(acc_service_configuration_t iq_configuration)
+{
+	acc_service_handle_t handle = acc_service_create(iq_configuration);
+
+	if (handle == NULL)
+	{
+		fprintf(stderr, "acc_service_create() failed\n");
+		return false;
+	}
+
+	acc_service_iq_metadata_t iq_metadata;
+	acc_service_iq_get_metadata(handle, &iq_metadata);
+
+	acc_sliding_dft_configuration_t dft_configuration;
+
+	dft_configuration.input               = ACC_SLIDING_DFT_INPUT_IQ;
+	dft_configuration.data_length         = iq_metadata.data_length;
+	dft_configuration.window_length       = WINDOW_LENGTH;
+	dft_configuration.frequency_bin_count = FREQUENCY_BIN_COUNT;
+	dft_configuration.reanchor_interval   = WINDOW_LENGTH;
+
+	for (uint8_t k = 0; k < FREQUENCY_BIN_COUNT; k++)
+	{
+		dft_configuration.frequency_bins[k] = FREQUENCY_BIN_FIRST + k;
+	}
+
+	acc_sliding_dft_handle_t dft = acc_sliding_dft_create(&dft_configuration);
+
+	if (dft == NULL)
+	{
+		fprintf(stderr, "acc_sliding_dft_create() failed\n");
+		acc_service_destroy(&handle);
+		return false;
+	}
+
+	if (!acc_service_activate(handle))
+	{
+		fprintf(stderr, "acc_service_activate() failed\n");
+		acc_sliding_dft_destroy(&dft);
+		acc_service_destroy(&handle);
+		return false;
+	}
+
+	bool success = true;
+
+	for (uint16_t i = 0; i < ITERATIONS; i++)
+	{
+		acc_service_iq_result_info_t result_info;
+		acc_int16_complex_t          *data;
+
+		success = acc_service_iq_get_next_by_reference(handle, &data, &result_info);
+
+		if (!success)
+		{
+			fprintf(stderr, "acc_service_iq_get_next_by_reference() failed\n");
+			break;
+		}
+
+		success = acc_sliding_dft_process_iq_int16(dft, data);
+
+		if (!success)
+		{
+			fprintf(stderr, "acc_sliding_dft_process_iq_int16() failed\n");
+			break;
+		}
+
+		if (i + 1 >= WINDOW_LENGTH && (i + 1) % (uint16_t)UPDATE_RATE == 0)
+		{
+			print_strongest(dft, &iq_metadata);
+		}
+	}
+
+	bool deactivated = acc_service_deactivate(handle);
+
+	acc_sliding_dft_destroy(&dft);
+	acc_service_destroy(&handle);
+
+	return deactivated && success;
+}
+
+
+void print_strongest(acc_sliding_dft_handle_t dft, const acc_service_iq_metadata_t *metadata)
+{
+	float    magnitude[metadata->data_length];
+	float    strongest           = 0.0f;
+	uint8_t  strongest_bin_index = 0;
+	uint16_t strongest_point     = 0;
+
+	for (uint8_t k = 0; k < FREQUENCY_BIN_COUNT; k++)
+	{
+		if (!acc_sliding_dft_get_magnitude(dft, k, magnitude))
+		{
+			return;
+		}
+
+		for (uint16_t j = 0; j < metadata->data_length; j++)
+		{
+			if (magnitude[j] > strongest)
+			{
+				strongest           = magnitude[j];
+				strongest_bin_index = k;
+				strongest_point     = j;
+			}
+		}
+	}
+
+	float frequency = (float)(FREQUENCY_BIN_FIRST + strongest_bin_index) * UPDATE_RATE / WINDOW_LENGTH;
+
+	printf("Strongest slow motion %d mHz, %d per minute, at %d mm, magnitude %d\n", (int)(frequency * 1000.0f),
+	       (int)(frequency * 60.0f + 0.5f),
+	       (int)((metadata->start_m + (float)strongest_point * metadata->step_length_m) * 1000.0f), (int)strongest);
+}
@@ -0,0 +1,232 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "acc_driver_hal.h"
+#include "acc_hal_definitions.h"
+#include "acc_rss.h"
+#include "acc_service.h"
+#include "acc_service_envelope.h"
+#include "acc_smoothing_bank.h"
+
+#include "acc_version.h"
+
+
+/**
+ * @brief Example that shows how to smooth envelope data at several levels from one service
+ *
+ * The envelope service runs without its own running average and each raw sweep is given to a
+ * smoothing bank. A light and a heavy smoothing level each have a subscriber that follows the
+ * peak of its level, so a fast and a steady peak are tracked from the same sweeps.
+ * The example executes as follows:
+ *   - Activate Radar System Software (RSS)
+ *   - Create an envelope service configuration without running average
+ *   - Create and activate an envelope service using the previously created configuration
+ *   - Create a smoothing bank and subscribe to two of its levels
+ *   - Get the result 50 times, process it in the smoothing bank and print the peaks of
+ *     every 10th sweep
+ *   - Destroy the smoothing bank
+ *   - Deactivate and destroy the envelope service
+ *   - Destroy the envelope service configuration
+ *   - Deactivate Radar System Software (RSS)
+ */
+
+
+#define ITERATIONS     50
+#define PRINT_INTERVAL 10
+
+// Indices in levels of the subscribed levels
+#define LEVEL_LIGHT 0
+#define LEVEL_HEAVY 2
+
+
+/**
+ * @brief Peak of a smoothing level, updated by its subscriber
+ */
+typedef struct
+{
+	uint16_t index;
+	uint16_t amplitude;
+} peak_t;
+
+
+static bool acc_example_smoothing_bank(void);
+
+
+static bool execute_smoothing_bank(acc_service_configuration_t envelope_configuration);
+
+
+static void update_peak(const uint16_t *data, uint16_t data_length, void *client_data);
+
+
+static const acc_smoothing_bank_level_t levels[] =
+{
+	{ACC_SMOOTHING_BANK_EXPONENTIAL, 2},
+	{ACC_SMOOTHING_BANK_BOXCAR,      8},
+	{ACC_SMOOTHING_BANK_EXPONENTIAL, 16},
+};
+
+
+int main(void)
+{
+	if (!acc_driver_hal_init())
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!acc_example_smoothing_bank())
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+
+bool acc_example_smoothing_bank(void)
+{
+	printf("Acconeer software version %s\n", acc_version_get());
+
+	acc_hal_t hal = acc_driver_hal_get_implementation();
+
+	if (!acc_rss_activate(&hal))
+	{
+		fprintf(stderr, "acc_rss_activate() failed\n");
+		return false;
+	}
+
+	acc_service_configuration_t envelope_configuration = acc_service_envelope_configuration_create();
+
+	if (envelope_configuration == NULL)
+	{
+		fprintf(stderr, "acc_service_envelope_configuration_create() failed\n");
+		acc_rss_deactivate();
+		return false;
+	}
+
+	acc_service_requested_start_set(envelope_configuration, 0.2f);
+	acc_service_requested_length_set(envelope_configuration, 0.5f);
+
+	// The smoothing bank replaces the running average of the service
+	acc_service_envelope_running_average_factor_set(envelope_configuration, 0.0f);
+
+	if (!execute_smoothing_bank(envelope_configuration))
+	{
+		acc_service_envelope_configuration_destroy(&envelope_configuration);
+		acc_rss_deactivate();
+		return false;
+	}
+
+	acc_service_envelope_configuration_destroy(&envelope_configuration);
+
+	acc_rss_deactivate();
+
+	return true;
+}
+
+
+bool execute_smoothing_bank(acc_service_configuration_t envelope_configuration)
+{
+	acc_service_handle_t handle = acc_service_create(envelope_configuration);
+
+	if (handle == NULL)
+	{
+		fprintf(stderr, "acc_service_create() failed\n");
+		return false;
+	}
+
+	acc_service_envelope_metadata_t envelope_metadata;
+	acc_service_envelope_get_metadata(handle, &envelope_metadata);
+
+	acc_smoothing_bank_handle_t bank = acc_smoothing_bank_create(envelope_metadata.data_length, levels,
+	                                                             sizeof(levels) / sizeof(levels[0]));
+
+	if (bank == NULL)
+	{
+		fprintf(stderr, "acc_smoothing_bank_create() failed\n");
+		acc_service_destroy(&handle);
+		return false;
+	}
+
+	peak_t light_peak = {0, 0};
+	peak_t heavy_peak = {0, 0};
+
+	if (!acc_smoothing_bank_subscribe(bank, LEVEL_LIGHT, &update_peak, &light_peak) ||
+	    !acc_smoothing_bank_subscribe(bank, LEVEL_HEAVY, &update_peak, &heavy_peak))
+	{
+		fprintf(stderr, "acc_smoothing_bank_subscribe() failed\n");
+		acc_smoothing_bank_destroy(&bank);
+		acc_service_destroy(&handle);
+		return false;
+	}
+
+	if (!acc_service_activate(handle))
+	{
+		fprintf(stderr, "acc_service_activate() failed\n");
+		acc_smoothing_bank_destroy(&bank);
+		acc_service_destroy(&handle);
+		return false;
+	}
+
+	bool success = true;
+
+	for (uint16_t i = 0; i < ITERATIONS; i++)
+	{
+		acc_service_envelope_result_info_t result_info;
+		uint16_t                           *data;
+
+		success = acc_service_envelope_get_next_by_reference(handle, &data, &result_info);
+
+		if (!success)
+		{
+			fprintf(stderr, "acc_service_envelope_get_next_by_reference() failed\n");
+			break;
+		}
+
+		success = acc_smoothing_bank_process(bank, data);
+
+		if (!success)
+		{
+			fprintf(stderr, "acc_smoothing_bank_process() failed\n");
+			break;
+		}
+
+		if ((i + 1) % PRINT_INTERVAL == 0)
+		{
+			printf("Sweep %u: light peak %u at %d mm, heavy peak %u at %d mm\n", (unsigned int)(i + 1),
+			       (unsigned int)light_peak.amplitude,
+			       (int)((envelope_metadata.start_m + (float)light_peak.index * envelope_metadata.step_length_m) * 1000.0f),
+			       (unsigned int)heavy_peak.amplitude,
+			       (int)((envelope_metadata.start_m + (float)heavy_peak.index * envelope_metadata.step_length_m) * 1000.0f));
+		}
+	}
+
+	bool deactivated = acc_service_deactivate(handle);
+
+	acc_smoothing_bank_destroy(&bank);
+	acc_service_destroy(&handle);
+
+	return deactivated && success;
+}
+
+
+void update_peak(const uint16_t *data, uint16_t data_length, void *client_data)
+{
+	peak_t *peak = client_data;
+
+	peak->index = 0;
+
+	for (uint16_t i = 1; i < data_length; i++)
+	{
+		if (data[i] > data[peak->index])
+		{
+			peak->index = i;
+		}
+	}
+
+	peak->amplitude = data[peak->index];
+}
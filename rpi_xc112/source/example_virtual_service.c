@@ -0,0 +1,190 @@
+// Copyright (c) Acconeer AB, 2020
+// All rights reserved
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "acc_device_os.h"
+#include "acc_driver_hal.h"
+#include "acc_hal_definitions.h"
+#include "acc_rss.h"
+#include "acc_service.h"
+#include "acc_service_envelope.h"
+#include "acc_service_power_bins.h"
+#include "acc_virtual_service.h"
+
+#include "acc_version.h"
+
+
+/**
+ * @brief Example that shows how to derive several outputs from one envelope service
+ *
+ * This is an example on how virtual services can be used.
+ * The example executes as follows:
+ *   - Activate Radar System Software (RSS)
+ *   - Create and activate an envelope service
+ *   - Create a virtual service source for the envelope service
+ *   - Create virtual power bins with uneven bins, and a decimated sub-range envelope
+ *   - Get the results of both virtual services from the same sweep and print them 5 times
+ *   - Destroy the virtual services and the source
+ *   - Deactivate and destroy the envelope service
+ *   - Deactivate Radar System Software (RSS)
+ */
+
+
+static bool acc_example_virtual_service(void);
+
+
+static bool execute_virtual_services(acc_service_handle_t handle);
+
+
+int main(void)
+{
+	if (!acc_driver_hal_init())
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!acc_example_virtual_service())
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+
+bool acc_example_virtual_service(void)
+{
+	printf("Acconeer software version %s\n", acc_version_get());
+
+	acc_hal_t hal = acc_driver_hal_get_implementation();
+
+	if (!acc_rss_activate(&hal))
+	{
+		fprintf(stderr, "acc_rss_activate() failed\n");
+		return false;
+	}
+
+	acc_service_configuration_t envelope_configuration = acc_service_envelope_configuration_create();
+
+	if (envelope_configuration == NULL)
+	{
+		fprintf(stderr, "acc_service_envelope_configuration_create() failed\n");
+		acc_rss_deactivate();
+		return false;
+	}
+
+	acc_service_requested_start_set(envelope_configuration, 0.2f);
+	acc_service_requested_length_set(envelope_configuration, 0.8f);
+
+	acc_service_handle_t handle = acc_service_create(envelope_configuration);
+
+	acc_service_envelope_configuration_destroy(&envelope_configuration);
+
+	if (handle == NULL)
+	{
+		fprintf(stderr, "acc_service_create() failed\n");
+		acc_rss_deactivate();
+		return false;
+	}
+
+	if (!acc_service_activate(handle))
+	{
+		fprintf(stderr, "acc_service_activate() failed\n");
+		acc_service_destroy(&handle);
+		acc_rss_deactivate();
+		return false;
+	}
+
+	bool success     = execute_virtual_services(handle);
+	bool deactivated = acc_service_deactivate(handle);
+
+	acc_service_destroy(&handle);
+
+	acc_rss_deactivate();
+
+	return success && deactivated;
+}
+
+
+bool execute_virtual_services(acc_service_handle_t handle)
+{
+	acc_virtual_service_source_t source = acc_virtual_service_source_create_envelope(handle);
+
+	if (source == NULL)
+	{
+		fprintf(stderr, "acc_virtual_service_source_create_envelope() failed\n");
+		return false;
+	}
+
+	const float                  bin_edges_m[] = {0.2f, 0.3f, 0.4f, 0.6f, 1.0f};
+	acc_virtual_service_handle_t power_bins    = acc_virtual_service_power_bins_create(source, bin_edges_m, 4);
+	acc_virtual_service_handle_t envelope      = acc_virtual_service_envelope_create(source, 0.4f, 0.4f, 4);
+
+	if (power_bins == NULL || envelope == NULL)
+	{
+		fprintf(stderr, "Virtual service creation failed\n");
+		acc_virtual_service_destroy(&power_bins);
+		acc_virtual_service_destroy(&envelope);
+		acc_virtual_service_source_destroy(&source);
+		return false;
+	}
+
+	acc_service_power_bins_metadata_t power_bins_metadata;
+	acc_service_envelope_metadata_t   envelope_metadata;
+
+	acc_virtual_service_power_bins_get_metadata(power_bins, &power_bins_metadata);
+	acc_virtual_service_envelope_get_metadata(envelope, &envelope_metadata);
+
+	printf("Power bins start: %d mm, length: %u mm, bin count: %u\n", (int)(power_bins_metadata.start_m * 1000.0f),
+	       (unsigned int)(power_bins_metadata.length_m * 1000.0f), (unsigned int)power_bins_metadata.bin_count);
+	printf("Envelope start: %d mm, length: %u mm, data length: %u\n", (int)(envelope_metadata.start_m * 1000.0f),
+	       (unsigned int)(envelope_metadata.length_m * 1000.0f), (unsigned int)envelope_metadata.data_length);
+
+	uint16_t power_bins_data[power_bins_metadata.bin_count];
+	uint16_t envelope_data[envelope_metadata.data_length];
+
+	bool      success    = true;
+	const int iterations = 5;
+
+	acc_os_steady_state_arm();
+
+	for (int i = 0; i < iterations; i++)
+	{
+		success = acc_virtual_service_power_bins_get_next(power_bins, power_bins_data, power_bins_metadata.bin_count, NULL) &&
+		          acc_virtual_service_envelope_get_next(envelope, envelope_data, envelope_metadata.data_length, NULL);
+
+		if (!success)
+		{
+			fprintf(stderr, "Virtual service get_next failed\n");
+			break;
+		}
+
+		printf("Power Bins data:\n");
+
+		for (uint16_t j = 0; j < power_bins_metadata.bin_count; j++)
+		{
+			printf("%u\t", (unsigned int)(power_bins_data[j]));
+		}
+
+		printf("\nEnvelope data:\n");
+
+		for (uint16_t j = 0; j < envelope_metadata.data_length; j++)
+		{
+			printf("%u\t", (unsigned int)(envelope_data[j]));
+		}
+
+		printf("\n");
+	}
+
+	acc_os_steady_state_check();
+
+	acc_virtual_service_destroy(&power_bins);
+	acc_virtual_service_destroy(&envelope);
+	acc_virtual_service_source_destroy(&source);
+
+	return success;
+}
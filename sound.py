@@ -1,5 +1,6 @@
 import numpy as np
 import pyaudio
+from pluck import *
 
 # Sound wave configs
 fs = 44100  						# Sample frequency of sound wave
@@ -7,8 +8,6 @@ freq = 0                            # Sound frequency in Hz
 duration = 0.1                      # Duration in s of audio output
 samples = np.arange(duration*fs) 	# Sampling numbers
 
-averaging_array = np.ones(10)
-
 # PyAudio configs
 pya = pyaudio.PyAudio()
 stream = pya.open(format=pyaudio.paInt16, channels=1, rate=fs, input=False, output=True)
@@ -24,8 +23,6 @@ amp_vec = 3000 * np.concatenate([attack, decay, sustain, release])
 f0 = 0
 phaseshift = 0
 
-down = True # Current state
-
 # Initializations
 wave = np.zeros(len(samples))
 old = wave
@@ -36,29 +33,19 @@ def sound_generator(control_variable, dis):
     global f0
     global wave
     global phaseshift
-    global averaging_array
     global old
     global retwave
    
     freq = control_variable
    
-    averaging_array = averaging_array[1:averaging_array.size]
-    averaging_array = np.append(averaging_array,dis)
-    
-    amp = 0
-    for i in range(0, averaging_array.size - 2):
-        amp = amp + averaging_array[i + 1] - averaging_array[i]
-    amp=0.1*amp
-  
-    global down
+    transition = pluck_detect(dis)
     
     # State: Up    
-    if (amp > 3 and amp < 60) and down:
-        down = False
+    if transition == PLUCK_UP:
+        pass
 
     # State: Down (generate sound wave)
-    elif (amp < -2 and amp > -20) and not down:
-        down = True
+    elif transition == PLUCK_DOWN:
         
         #freq = f0 + samples*(control_variable - f0)/(duration*fs) # Chirping
 
@@ -0,0 +1,391 @@
+import heapq
+import sys
+import time
+
+import numpy as np
+
+# Polyphonic synthesis core.
+#
+# All voice state lives in preallocated float32 arrays that are kept dense: the active
+# voices always occupy rows 0..count-1, so a block is rendered with whole-array numpy
+# operations on slices, written into preallocated buffers, with no per-voice Python loop.
+# Each voice has an oscillator bank with the same harmonics as sound_generator() and
+# its own ADSR envelope.
+#
+# Blocks can be rendered in spans, so that the note events of a NoteScheduler take
+# effect at their own sample inside the block.
+
+fs = 44100                          # Sample frequency of sound wave
+block_size = 256                    # Samples per rendered block
+
+# Oscillator bank, harmonic number and relative amplitude
+harmonics = np.array([1, 4, 8], dtype=np.float32)
+harmonic_gains = np.array([2, 1, 1], dtype=np.float32)
+
+# ADSR configs, times in s
+attack_time = 0.01
+decay_time = 0.01
+sustain_level = 0.6
+release_time = 0.3
+
+# Envelope stages
+IDLE = 0
+ATTACK = 1
+DECAY = 2
+SUSTAIN = 3
+RELEASE = 4
+
+NIL = -1
+
+
+class PolySynth:
+    def __init__(self, voices=32, block=block_size, rate=fs, amplitude=3000):
+        self.voices = voices
+        self.block = block
+        self.rate = rate
+        self.amplitude = amplitude
+        self.count = 0
+
+        n_harmonics = harmonics.size
+
+        # Per row state, rows 0..count-1 are the active voices
+        self.phase = np.zeros((voices, n_harmonics), dtype=np.float32)
+        self.increment = np.zeros((voices, n_harmonics), dtype=np.float32)
+        self.level = np.zeros(voices, dtype=np.float32)
+        self.velocity = np.zeros(voices, dtype=np.float32)
+        self.stage = np.zeros(voices, dtype=np.int8)
+        self.row_voice = np.arange(voices)
+
+        # Per voice bookkeeping, indexed by voice id
+        self.voice_row = np.full(voices, NIL)
+        self.voice_note = [None] * voices
+        self.free = list(range(voices - 1, -1, -1))
+        self.note_voice = {}
+
+        # Voices in start order as a doubly linked list, the oldest is stolen first
+        self.older = np.full(voices, NIL)
+        self.newer = np.full(voices, NIL)
+        self.oldest = NIL
+        self.newest = NIL
+
+        # Work buffers
+        self.ramp = np.arange(block, dtype=np.float32)
+        self.ramp_unit = np.arange(1, block + 1, dtype=np.float32) / block
+        self.work = np.empty((voices, n_harmonics, block), dtype=np.float32)
+        self.phase_step = np.empty((voices, n_harmonics), dtype=np.float32)
+        self.voice_out = np.empty((voices, block), dtype=np.float32)
+        self.envelope = np.empty((voices, block), dtype=np.float32)
+        self.level_start = np.empty(voices, dtype=np.float32)
+        self.level_delta = np.empty(voices, dtype=np.float32)
+        self.mix = np.empty(block, dtype=np.float32)
+        self.out = np.empty(block, dtype=np.int16)
+
+        # Envelope change per block in each stage
+        block_time = block / rate
+        self.attack_step = min(1.0, block_time / attack_time)
+        self.decay_step = min(1.0, block_time * (1 - sustain_level) / decay_time)
+        self.release_step = min(1.0, block_time * sustain_level / release_time)
+
+    def _link(self, voice):
+        self.older[voice] = self.newest
+        self.newer[voice] = NIL
+        if self.newest != NIL:
+            self.newer[self.newest] = voice
+        else:
+            self.oldest = voice
+        self.newest = voice
+
+    def _unlink(self, voice):
+        older = self.older[voice]
+        newer = self.newer[voice]
+        if older != NIL:
+            self.newer[older] = newer
+        else:
+            self.oldest = newer
+        if newer != NIL:
+            self.older[newer] = older
+        else:
+            self.newest = older
+
+    def _free_voice(self, voice):
+        # Returns a voice to the free list, moving the last active row into its place
+        row = self.voice_row[voice]
+        last = self.count - 1
+        if row != last:
+            moved = self.row_voice[last]
+            self.phase[row] = self.phase[last]
+            self.increment[row] = self.increment[last]
+            self.level[row] = self.level[last]
+            self.velocity[row] = self.velocity[last]
+            self.stage[row] = self.stage[last]
+            self.row_voice[row] = moved
+            self.voice_row[moved] = row
+        self.stage[last] = IDLE
+        self.count = last
+        self.voice_row[voice] = NIL
+
+        note = self.voice_note[voice]
+        if self.note_voice.get(note) == voice:
+            del self.note_voice[note]
+        self.voice_note[voice] = None
+
+        self._unlink(voice)
+        self.free.append(int(voice))
+
+    def note_on(self, note, freq, velocity=1.0):
+        # Starts a note and returns its voice. A note already sounding with the same id
+        # is retriggered from its current level. When all voices are busy the oldest
+        # voice is stolen.
+        voice = self.note_voice.get(note)
+
+        if voice is None:
+            if not self.free:
+                self._free_voice(self.oldest)
+
+            voice = self.free.pop()
+            row = self.count
+            self.count += 1
+
+            self.phase[row] = 0
+            self.level[row] = 0
+            self.row_voice[row] = voice
+            self.voice_row[voice] = row
+            self.voice_note[voice] = note
+            self.note_voice[note] = voice
+        else:
+            row = self.voice_row[voice]
+            self._unlink(voice)
+
+        self.increment[row] = (2 * np.pi / self.rate) * freq * harmonics
+        self.velocity[row] = velocity
+        self.stage[row] = ATTACK
+        self._link(voice)
+
+        return voice
+
+    def note_off(self, note):
+        voice = self.note_voice.get(note)
+        if voice is not None:
+            self.stage[self.voice_row[voice]] = RELEASE
+
+    def pitch_bend(self, note, freq):
+        voice = self.note_voice.get(note)
+        if voice is not None:
+            self.increment[self.voice_row[voice]] = (2 * np.pi / self.rate) * freq * harmonics
+
+    def _advance_envelopes(self, fraction):
+        # Moves the level of each voice to its value at the end of a span of fraction
+        # of a block
+        n = self.count
+        stage = self.stage[:n]
+        level = self.level[:n]
+
+        level[stage == ATTACK] += self.attack_step * fraction
+        level[stage == DECAY] -= self.decay_step * fraction
+        level[stage == RELEASE] -= self.release_step * fraction
+
+        attacked = (stage == ATTACK) & (level >= 1)
+        level[attacked] = 1
+        stage[attacked] = DECAY
+
+        decayed = (stage == DECAY) & (level <= sustain_level)
+        level[decayed] = sustain_level
+        stage[decayed] = SUSTAIN
+
+        released = (stage == RELEASE) & (level <= 0)
+        level[released] = 0
+
+        return np.flatnonzero(released)
+
+    def render(self):
+        # Renders one block of all active voices and returns it as int16 samples
+        self.render_span(0, self.block)
+        return self.out
+
+    def render_span(self, start, stop):
+        # Renders samples start..stop-1 of the block into the output. Envelopes advance
+        # once per span and are interpolated linearly over it.
+        n = self.count
+        out = self.out[start:stop]
+
+        if n == 0:
+            out.fill(0)
+            return
+
+        k = stop - start
+        level_start = self.level_start[:n]
+        np.copyto(level_start, self.level[:n])
+        finished = self._advance_envelopes(k / self.block)
+
+        # Oscillator bank, phase of every harmonic of every voice at each sample
+        work = self.work[:n, :, :k]
+        np.multiply(self.increment[:n, :, None], self.ramp[:k], out=work)
+        np.add(work, self.phase[:n, :, None], out=work)
+        np.sin(work, out=work)
+        np.multiply(work, harmonic_gains[:, None], out=work)
+        voice_out = self.voice_out[:n, :k]
+        np.sum(work, axis=1, out=voice_out)
+
+        # Envelope, start + (end - start) * t, scaled by velocity
+        delta = self.level_delta[:n]
+        envelope = self.envelope[:n, :k]
+        np.subtract(self.level[:n], level_start, out=delta)
+        np.multiply(delta, self.block / k, out=delta)
+        np.multiply(delta[:, None], self.ramp_unit[:k], out=envelope)
+        np.add(envelope, level_start[:, None], out=envelope)
+        np.multiply(envelope, self.velocity[:n, None], out=envelope)
+
+        # Mix
+        mix = self.mix[:k]
+        np.multiply(voice_out, envelope, out=voice_out)
+        np.sum(voice_out, axis=0, out=mix)
+        np.multiply(mix, self.amplitude, out=mix)
+        np.clip(mix, -32768, 32767, out=mix)
+        np.copyto(out, mix, casting='unsafe')
+
+        # Phases continue after the last sample, wrapped to keep float32 precision
+        phase_step = self.phase_step[:n]
+        np.multiply(self.increment[:n], k, out=phase_step)
+        np.add(self.phase[:n], phase_step, out=self.phase[:n])
+        np.remainder(self.phase[:n], 2 * np.pi, out=self.phase[:n])
+
+        # Free voices whose release ended, highest row first so the rows still to be
+        # freed are not moved
+        for row in finished[::-1]:
+            self._free_voice(int(self.row_voice[row]))
+
+
+# Jitter buffer between note detection and the synthesizer.
+#
+# Events are pushed with the capture time of the sweep they were detected in and are
+# due at capture time + latency. Each block is rendered in spans split at the sample
+# where an event is due, given the time the first sample of the block is played, so
+# the time from sweep to sound is the same for every note as long as the latency
+# covers detection, transfer and rendering. Events that arrive after they were due
+# are applied at the start of the next block and counted as late.
+#
+# The sample of an event is placed by the estimated block time, so it is only off by
+# rounding from the estimate. The timing error is therefore taken once the block has
+# been written, from the time the output stream plays its first sample: the time the
+# event is played minus the time it was due, kept for the last history events.
+class NoteScheduler:
+    def __init__(self, synth, latency, history=1024):
+        self.synth = synth
+        self.latency = latency
+        self.pending = []
+        self.sequence = 0
+
+        # Due time and sample of the events applied in the last rendered block
+        self.block_events = []
+
+        self.errors = np.zeros(history)
+        self.error_count = 0
+        self.event_count = 0
+        self.late_count = 0
+
+    def push(self, timestamp, event):
+        # Sequence numbers keep events with the same due time in order
+        heapq.heappush(self.pending, (timestamp + self.latency, self.sequence, event))
+        self.sequence += 1
+
+    def render(self, block_time):
+        # Renders the block whose first sample is played at block_time, applying the
+        # events due in it, and returns it as int16 samples
+        synth = self.synth
+        rate = synth.rate
+        end_time = block_time + synth.block / rate
+        start = 0
+        self.block_events.clear()
+
+        while self.pending and self.pending[0][0] < end_time:
+            due, _, event = heapq.heappop(self.pending)
+
+            offset = int(round((due - block_time) * rate))
+            offset = min(max(offset, start), synth.block - 1)
+            if offset > start:
+                synth.render_span(start, offset)
+                start = offset
+
+            if event[0] == "on":
+                synth.note_on(event[1], event[2])
+            else:
+                synth.note_off(event[1])
+
+            self.block_events.append((due, offset))
+            self.event_count += 1
+            if block_time + offset / rate - due > 1 / rate:
+                self.late_count += 1
+
+        synth.render_span(start, synth.block)
+        return synth.out
+
+    def played(self, start_time):
+        # Takes the timing error of the events of the last rendered block, given the
+        # time its first sample is played as measured on the output
+        for due, offset in self.block_events:
+            self.errors[self.error_count % self.errors.size] = start_time + offset / self.synth.rate - due
+            self.error_count += 1
+        self.block_events.clear()
+
+    def report(self):
+        # Returns the timing of the events so far as a line of text
+        if self.event_count == 0:
+            return "no note events"
+
+        text = "%d note events at %.0f ms latency, %d late" % (self.event_count, 1000 * self.latency,
+                                                              self.late_count)
+        if self.error_count == 0:
+            return text
+
+        errors = 1000 * self.errors[:min(self.error_count, self.errors.size)]
+        return (text + ", timing error p50 %.3f ms p99 %.3f ms, jitter %.3f ms"
+                % (np.percentile(np.abs(errors), 50), np.percentile(np.abs(errors), 99), np.std(errors)))
+
+
+# Estimate of the time the next written sample is played.
+#
+# After a blocking write returns, the next sample plays after the samples queued in the
+# device, about the output latency from now. The measurements vary with scheduling, so
+# the estimate advances by the block duration with each write and follows the
+# measurements slowly. It starts over when they differ by more than resync, e.g.
+# after an underrun. The difference between the measurement and the estimate is
+# what the timing error of NoteScheduler adds to the rounding.
+class AudioClock:
+    def __init__(self, rate=fs, block=block_size, gain=0.02, resync=0.05):
+        self.block_duration = block / rate
+        self.gain = gain
+        self.resync = resync
+        self.time = None
+
+    def update(self, measured):
+        if self.time is None or abs(measured - self.time) > self.resync:
+            self.time = measured
+        else:
+            self.time += self.gain * (measured - self.time)
+        return self.time
+
+    def advance(self):
+        self.time += self.block_duration
+
+
+# Measures the CPU cost of rendering one block at different numbers of sounding voices
+def benchmark(blocks=2000):
+    block_period = block_size / fs
+    print("voices  us/block  load")
+    for voices in [1, 2, 4, 8, 16, 32]:
+        synth = PolySynth(voices=32)
+        for i in range(voices):
+            synth.note_on(i, 440 * 2 ** (i / 12))
+        for _ in range(100):
+            synth.render()
+
+        start = time.perf_counter()
+        for _ in range(blocks):
+            synth.render()
+        elapsed = (time.perf_counter() - start) / blocks
+
+        print("%6d  %8.1f  %4.1f%%" % (voices, elapsed * 1e6, 100 * elapsed / block_period))
+
+
+if __name__ == "__main__":
+    benchmark(int(sys.argv[1]) if len(sys.argv) > 1 else 2000)
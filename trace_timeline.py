@@ -0,0 +1,256 @@
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+import numpy as np
+
+# Merged timeline of the acquisition tracepoints of the rpi_xc112 SDK and kernel events.
+#
+# The SDK is built with tracepoints, see rpi_xc112/include/acc_trace.h:
+#
+#   make ACC_CFG_TRACE=1
+#
+# record runs a command with ftrace enabled for the SPI, GPIO, IRQ and scheduler events,
+# and with ACC_TRACE_MARKER set so that the tracepoints are written to the trace_marker,
+# which puts them in the same buffer as the kernel events:
+#
+#   sudo python3 trace_timeline.py record --out trace.txt -- \
+#       ./utils/acc_service_data_logger_rpi_xc112_r2b_xr112_r2b_a111_r2c -t 1 -c 1000 -o /dev/null
+#   python3 trace_timeline.py show trace.txt --slow 2000
+#
+# The USDT probes can be recorded with perf instead of the markers. perf must use the
+# monotonic clock, which record sets as the ftrace clock, for the timelines to line up:
+#
+#   sudo perf buildid-cache --add <program>
+#   sudo perf record -k CLOCK_MONOTONIC -e 'sdt_acc:*' -a -- <program> ...
+#   sudo perf script > usdt.txt
+#   python3 trace_timeline.py show trace.txt --perf usdt.txt
+#
+# show prints every event with the time since the previous one, and the duration of the
+# SPI transfers, semaphore waits and get_next calls, and of the path from the sensor
+# interrupt to the wait of the same sensor that takes it, for blocking and spinning waits
+# apart, as p50/p99/max. With --slow only the events of
+# the get_next calls longer than the given time are printed.
+
+EVENTS = [
+    "spi/spi_transfer_start",
+    "spi/spi_transfer_stop",
+    "gpio/gpio_value",
+    "irq/irq_handler_entry",
+    "irq/irq_handler_exit",
+    "sched/sched_wakeup",
+    "sched/sched_switch",
+]
+
+TRACEFS = ["/sys/kernel/tracing", "/sys/kernel/debug/tracing"]
+
+# Both "task-pid [cpu] flags timestamp: event: info" from ftrace and
+# "task pid [cpu] timestamp: event: info" from perf script
+LINE = re.compile(r"^\s*(?P<task>.+?)[- ](?P<pid>\d+)\s+(?:\(\s*[\d-]+\)\s+)?\[(?P<cpu>\d+)\]\s+"
+                  r"(?:\S+\s+)?(?P<time>\d+\.\d+):\s+(?P<event>[\w:]+):\s*(?P<info>.*)$")
+
+# Begin and end tracepoints whose durations are reported
+SPANS = [
+    ("get_next", "get_next_begin", "get_next_end"),
+    ("spi_transfer", "spi_transfer_begin", "spi_transfer_end"),
+    ("semaphore_wait", "semaphore_wait_begin", "semaphore_wait_end"),
+]
+
+
+class Event:
+    def __init__(self, time, cpu, task, pid, name, info):
+        self.time = time
+        self.cpu = cpu
+        self.task = task
+        self.pid = pid
+        self.name = name
+        self.info = info
+
+    # Name of the tracepoint, or None for kernel events
+    @property
+    def probe(self):
+        if self.name.startswith("acc:"):
+            return self.name[4:]
+        return None
+
+
+def find_tracefs():
+    for path in TRACEFS:
+        if os.path.exists(os.path.join(path, "trace_marker")):
+            return path
+    sys.exit("tracefs not found, is debugfs or tracefs mounted?")
+
+
+def write(tracefs, name, value):
+    with open(os.path.join(tracefs, name), "w") as f:
+        f.write(value)
+
+
+def record(args):
+    tracefs = find_tracefs()
+    enabled = []
+
+    write(tracefs, "tracing_on", "0")
+    write(tracefs, "trace_clock", "mono")
+    write(tracefs, "buffer_size_kb", str(args.buffer_kb))
+    write(tracefs, "trace", "")
+
+    for event in args.events or EVENTS:
+        enable = os.path.join(tracefs, "events", event, "enable")
+        if os.path.exists(enable):
+            write(tracefs, os.path.join("events", event, "enable"), "1")
+            enabled.append(event)
+        else:
+            print("event {} is not available".format(event), file=sys.stderr)
+
+    env = dict(os.environ, ACC_TRACE_MARKER="1")
+
+    write(tracefs, "tracing_on", "1")
+    try:
+        status = subprocess.call(args.command, env=env)
+    finally:
+        write(tracefs, "tracing_on", "0")
+        for event in enabled:
+            write(tracefs, os.path.join("events", event, "enable"), "0")
+
+    with open(os.path.join(tracefs, "trace")) as f, open(args.out, "w") as out:
+        out.write(f.read())
+
+    print("{} written, the command exited with {}".format(args.out, status), file=sys.stderr)
+    return status
+
+
+def parse(path):
+    events = []
+    with open(path) as f:
+        for line in f:
+            match = LINE.match(line)
+            if match is None:
+                continue
+            name = match.group("event")
+            info = match.group("info")
+            if name == "tracing_mark_write":
+                # The marker text is "acc:<probe> <arguments>"
+                if not info.startswith("acc:"):
+                    continue
+                name, _, info = info.partition(" ")
+            elif name.startswith("sdt_acc:"):
+                # perf script prints "(address) arg1=... arg2=..."
+                name = "acc:" + name[len("sdt_acc:"):]
+                info = " ".join(value.partition("=")[2] for value in info.split()[1:])
+            events.append(Event(float(match.group("time")), int(match.group("cpu")), match.group("task").strip(),
+                                int(match.group("pid")), name, info.strip()))
+    return events
+
+
+def spans(events):
+    durations = {name: [] for name, _, _ in SPANS}
+    windows = []
+    begins = {}
+    for event in events:
+        for name, begin, end in SPANS:
+            if event.probe == begin:
+                begins[(name, event.pid)] = event
+            elif event.probe == end and (name, event.pid) in begins:
+                start = begins.pop((name, event.pid))
+                durations[name].append(event.time - start.time)
+                if name == "get_next":
+                    windows.append((start.time, event.time))
+
+    # Sensor interrupt to the wait that takes it, matched by sensor. A blocking wait is woken by
+    # the semaphore, a spinning wait takes the interrupt without one. An interrupt that is
+    # followed by another of the same sensor before it is taken is not counted.
+    durations["interrupt_to_wakeup"] = []
+    durations["interrupt_to_spin_take"] = []
+    interrupts = {}
+    for event in events:
+        if event.probe == "sensor_interrupt":
+            interrupts[event.info.split()[0]] = event
+        elif event.probe == "sensor_interrupt_taken":
+            sensor, blocked = event.info.split()[:2]
+            interrupt = interrupts.pop(sensor, None)
+            if interrupt is not None:
+                name = "interrupt_to_wakeup" if int(blocked) else "interrupt_to_spin_take"
+                durations[name].append(event.time - interrupt.time)
+
+    return durations, windows
+
+
+def print_events(events, start):
+    previous = None
+    for event in events:
+        delta = 0 if previous is None else (event.time - previous) * 1e6
+        previous = event.time
+        print("{:12.6f} ms {:+9.1f} us  [{:02d}] {:>20}-{:<6} {:24} {}".format(
+            (event.time - start) * 1e3, delta, event.cpu, event.task[-20:], event.pid, event.name, event.info))
+
+
+def show(args):
+    events = parse(args.trace)
+    for path in args.perf or []:
+        events += parse(path)
+    events.sort(key=lambda event: event.time)
+
+    if not events:
+        sys.exit("no events in {}".format(args.trace))
+
+    if not any(event.probe for event in events):
+        print("no acc tracepoints found, was the SDK built with ACC_CFG_TRACE=1?", file=sys.stderr)
+
+    durations, windows = spans(events)
+    start = events[0].time
+
+    if args.slow is None:
+        print_events(events, start)
+    else:
+        for begin, end in windows:
+            if (end - begin) * 1e6 < args.slow:
+                continue
+            print("get_next of {:.1f} us at {:.6f} ms".format((end - begin) * 1e6, (begin - start) * 1e3))
+            print_events([event for event in events if begin <= event.time <= end], start)
+            print()
+
+    print()
+    print("{:24} {:>8} {:>10} {:>10} {:>10}".format("span", "count", "p50 us", "p99 us", "max us"))
+    for name, values in durations.items():
+        if not values:
+            continue
+        values = np.array(values) * 1e6
+        print("{:24} {:8d} {:10.1f} {:10.1f} {:10.1f}".format(
+            name, len(values), np.percentile(values, 50), np.percentile(values, 99), values.max()))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Merged timeline of acquisition tracepoints and kernel events")
+    commands = parser.add_subparsers(dest="mode")
+
+    parser_record = commands.add_parser("record", help="run a command with ftrace and the trace markers enabled")
+    parser_record.add_argument("--out", default="trace.txt", help="ftrace text output")
+    parser_record.add_argument("--buffer-kb", type=int, default=16384, help="ftrace buffer per CPU")
+    parser_record.add_argument("--event", dest="events", action="append",
+                               help="kernel event as subsystem/name, may be repeated, default SPI, GPIO, IRQ and sched")
+    parser_record.add_argument("command", nargs=argparse.REMAINDER, help="command to trace, after --")
+
+    parser_show = commands.add_parser("show", help="print the merged timeline and span durations")
+    parser_show.add_argument("trace", help="ftrace text from record or trace-cmd report")
+    parser_show.add_argument("--perf", action="append", help="perf script output with sdt_acc events, may be repeated")
+    parser_show.add_argument("--slow", type=float, help="only print the events of get_next calls longer than this [us]")
+
+    args = parser.parse_args()
+
+    if args.mode == "record":
+        if args.command and args.command[0] == "--":
+            args.command = args.command[1:]
+        if not args.command:
+            parser.error("record needs a command")
+        sys.exit(record(args))
+    elif args.mode == "show":
+        show(args)
+    else:
+        parser.print_help()
+
+
+if __name__ == "__main__":
+    main()